@@ -51,6 +51,8 @@ static char help[] = "BOUT++: Uses finite difference methods to solve plasma flu
 #include "utils.h"
 #include "invert_laplace.h"
 #include "interpolation.h"
+#include "profile.h"
+#include "vecmath.h"
 
 #include "mpi.h"
 #include <stdio.h>
@@ -77,6 +79,7 @@ const string time_to_hms(real t);   // Converts to h:mm:ss.s format
 char get_spin();                    // Produces a spinning bar
 
 int bout_monitor(real t, int iter, int NOUT); // Function called by the solver each timestep
+int scaling_run(int nrhs, const char *data_dir); // Times RHS evaluations for scaling studies
 
 /*!************************************************************************
  * Main function
@@ -89,6 +92,8 @@ int main(int argc, char **argv)
   char *grid_name;
   time_t start_time, end_time;
   bool dump_float; // Output dump files as floats
+  bool options_report; // Print the number of option queries at the end
+  int scaling_rhs; // Number of RHS evaluations for a scaling study. 0 for a normal run
 
   char *grid_ext, *dump_ext; ///< Extensions for restart and dump files
   
@@ -108,6 +113,8 @@ int main(int argc, char **argv)
 
   /// Check command-line arguments
   for(i=1;i<argc;i++) {
+    if(strchr(argv[i], '=') != NULL)
+      continue; // An option setting, read later
     if(strncasecmp(argv[i], "re", 2) == 0) {
       restarting = true;
     }
@@ -193,6 +200,9 @@ int main(int argc, char **argv)
   output.write("\nRun started at  : %s\n", ctime(&start_time));
   output.write("Processor number: %d of %d\n\n", MYPE, NPES);
 
+  /// Options set on the command line override the settings file
+  options.command_line(argc, argv);
+
   /// Load settings file
   if(options.read("%s/BOUT.inp", data_dir)) {
     output.write("\tFailed to read settings file. Aborting\n");
@@ -212,14 +222,26 @@ int main(int argc, char **argv)
     grid_name = DEFAULT_GRID;
   
   OPTION(dump_float,   true);
+  OPTION(options_report, false);
+  OPTION(scaling_rhs,  0);
   OPTION(ShiftXderivs, false);
   OPTION(IncIntShear,  false);
   OPTION(TwistShift,   false);
   OPTION(ShiftOrder,   0);
   OPTION(TwistOrder,   0);
   OPTION(non_uniform,  false);
-  OPTION(MZ,           65);
-  if(!is_pow2(MZ-1)) {
+  OPTION(linear_nmodes, 0);
+  if(linear_nmodes > 0) {
+    // Each Z pencil holds the complex amplitudes of modes zperiod ... linear_nmodes*zperiod
+    MZ = 2*linear_nmodes + 1;
+    output.write("Linear mode: %d complex Z mode amplitudes (MZ = %d)\n", linear_nmodes, MZ);
+    if((TwistOrder != 0) || (ShiftOrder != 0)) {
+      output.write("WARNING: Linear mode needs FFT shifts. Setting TwistOrder = ShiftOrder = 0\n");
+      TwistOrder = ShiftOrder = 0;
+    }
+  }else
+    OPTION(MZ,         65);
+  if((linear_nmodes <= 0) && !is_pow2(MZ-1)) {
     if(is_pow2(MZ)) {
       MZ++;
       output.write("WARNING: Number of toroidal points increased to %d\n", MZ);
@@ -271,6 +293,9 @@ int main(int argc, char **argv)
       output.write("%d-point\n", ShiftOrder);
   }
   
+  /// Start the profiler if enabled
+  Profiler::init(data_dir);
+  
   /// Get file extensions
   if((dump_ext = options.getString("dump_format")) == NULL) {
     // Set default extension
@@ -287,7 +312,13 @@ int main(int argc, char **argv)
 
   output.write("Setting grid format\n");
   /// Load the grid
-  if((grid_ext = options.getString("grid_format")) == NULL) {
+  if(strcasecmp(grid_name, "synthetic") == 0) {
+    // No grid file: generate a uniform grid from options
+    if(!grid_synthetic("synthetic")) {
+      output.write("Failed to generate grid. Aborting\n");
+      return(1);
+    }
+  }else if((grid_ext = options.getString("grid_format")) == NULL) {
     // Guess format based on grid filename
     if(!grid_read(data_format(grid_name), grid_name)) {
       output.write("Failed to read grid. Aborting\n");
@@ -321,6 +352,12 @@ int main(int argc, char **argv)
   /// Add book-keeping variables to the output files
   setup_files();
 
+  /// Field memory pool options
+  Field3D::poolInit();
+
+  /// Accuracy of elementwise math functions
+  vmath_init();
+
   /// initialise Laplacian inversion code
   invert_init();
 
@@ -368,8 +405,20 @@ int main(int argc, char **argv)
 
   output.write("Running simulation\n\n");
 
-  /// Run the solver
-  solver.run(bout_monitor);
+  if(scaling_rhs > 0) {
+    /// Time a fixed number of RHS evaluations instead
+    if(scaling_run(scaling_rhs, data_dir))
+      return(1);
+  }else {
+    /// Run the solver
+    solver.run(bout_monitor);
+  }
+
+  if(options_report)
+    options.printQueries();
+
+  /// Profile summary across processors
+  Profiler::summary();
 
   // close MPI
 #ifdef PETSC
@@ -411,6 +460,7 @@ int bout_monitor(real t, int iter, int NOUT)
   static bool first_time = true;
   static real wtime = 0.0;       ///< Wall-time since last output
   static real wall_limit, mpi_start_time; // Keep track of remaining wall time
+  static bool mem_trim, mem_stats; // Memory pool trimming and statistics
 
 #ifdef CHECK
   int msg_point = msg_stack.push("bout_monitor(%e, %d, %d)", t, iter, NOUT);
@@ -430,6 +480,10 @@ int bout_monitor(real t, int iter, int NOUT)
     appending = true;
   }
   
+  /// Check for NaN or Inf each output
+  if(solver.check_finite < 0)
+    solver.checkFinite(simtime);
+
   /// Collect timing information
   int ncalls = solver.rhs_ncalls;
   real wtime_rhs   = solver.rhs_wtime;
@@ -446,6 +500,10 @@ int bout_monitor(real t, int iter, int NOUT)
     options.setSection(NULL);
     OPTION(wall_limit, -1.0); // Wall time limit. By default, no limit
     wall_limit *= 60.0*60.0;  // Convert from hours to seconds
+
+    options.setSection("memory");
+    options.get("trim",  mem_trim,  true);
+    options.get("stats", mem_stats, false);
     
     /// Record the starting time
     mpi_start_time = MPI_Wtime(); // NB: Miss time for first step (can be big!)
@@ -469,6 +527,12 @@ int bout_monitor(real t, int iter, int NOUT)
 		 100.*wtime_io/wtime,      // I/O
 		 100.*(wtime - wtime_io - wtime_rhs)/wtime); // Everything else
   }
+
+  /// Release memory blocks not needed during the last output step
+  if(mem_trim)
+    Field3D::poolTrim();
+  if(mem_stats)
+    Field3D::poolStats();
   
   // This bit only to screen, not log file
   
@@ -493,6 +557,9 @@ int bout_monitor(real t, int iter, int NOUT)
     } 
   }
 
+  /// Write the profile for this output step
+  Profiler::step(simtime, iteration);
+
   /// Reset clocks for next timestep
   
   Communicator::wtime = 0.0; // Reset communicator clock
@@ -507,6 +574,87 @@ int bout_monitor(real t, int iter, int NOUT)
   return 0;
 }
 
+/*!*************************************************************************
+ * SCALING STUDY
+ *
+ * Runs the RHS function a fixed number of times, so that the work done
+ * doesn't depend on the solver or timestep. Averages of the same timing
+ * breakdown as bout_monitor are appended to <data_dir>/BOUT.scaling,
+ * one line per run, so a series of runs with different numbers of
+ * processors and NXPE can be compared.
+ **************************************************************************/
+
+int scaling_run(int nrhs, const char *data_dir)
+{
+#ifdef CHECK
+  int msg_point = msg_stack.push("scaling_run(%d)", nrhs);
+#endif
+
+  output.write("Scaling study: timing %d RHS evaluations\n", nrhs);
+  
+  real wtime_io = Datafile::wtime; // Writing the initial dump file
+  
+  Communicator::wtime = 0.0;
+  wtime_invert = 0.0;
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  real wtime = MPI_Wtime();
+  
+  for(int i=0;i<nrhs;i++) {
+    if(physics_run(simtime)) {
+      output.write("Physics RHS call failed\n");
+#ifdef CHECK
+      msg_stack.pop(msg_point);
+#endif
+      return 1;
+    }
+  }
+  
+  wtime = MPI_Wtime() - wtime;
+  
+  /// Time per RHS evaluation, and total I/O time
+  real local[5], tmax[5], tsum[5];
+  local[0] = wtime / ((real) nrhs);
+  local[1] = (wtime - Communicator::wtime - wtime_invert) / ((real) nrhs);
+  local[2] = wtime_invert / ((real) nrhs);
+  local[3] = Communicator::wtime / ((real) nrhs);
+  local[4] = wtime_io;
+
+  MPI_Reduce(local, tmax, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(local, tsum, 5, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if(MYPE == 0) {
+    output.write("\tWall time per RHS: %e s (max over processors)\n", tmax[0]);
+    output.write("\tCalc %5.1f%%  Inv %5.1f%%  Comm %5.1f%%\n", 
+		 100.*tsum[1]/tsum[0], 100.*tsum[2]/tsum[0], 100.*tsum[3]/tsum[0]);
+    
+    char filename[512];
+    sprintf(filename, "%s/BOUT.scaling", data_dir);
+    FILE *fp = fopen(filename, "a");
+    if(fp == NULL) {
+      output.write("\tWARNING: Could not open '%s'\n", filename);
+    }else {
+      fseek(fp, 0, SEEK_END);
+      if(ftell(fp) == 0) {
+	// New file, so write the column headings
+	fprintf(fp, "# Times in seconds per RHS evaluation (mean over processors, wall time is the max)\n");
+	fprintf(fp, "# I/O is the time to write one dump file (max over processors)\n");
+	fprintf(fp, "# NPES NXPE NYPE   nx   ny   nz nrhs        wall        calc         inv        comm         I/O\n");
+      }
+      fprintf(fp, "%6d %4d %4d %4d %4d %4d %4d %e %e %e %e %e\n",
+	      NPES, NXPE, NYPE, NXPE*MXSUB, NYPE*MYSUB, ncz, nrhs,
+	      tmax[0], tsum[1]/((real) NPES), tsum[2]/((real) NPES), tsum[3]/((real) NPES), tmax[4]);
+      fclose(fp);
+    }
+  }
+  
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+
+  return 0;
+}
+
 /*!*************************************************************************
  * SETUP RESTART & DUMP FILES
  **************************************************************************/
@@ -0,0 +1,1166 @@
+/**************************************************************************
+ * Dual-number fields for forward-mode differentiation
+ *
+ * Each operation on a + b e computes the value a, and the tangent b
+ * using the derivative of the operation (product rule, chain rule).
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#include "globals.h"
+
+#include "dual.h"
+#include "derivs.h"
+#include "difops.h"
+#include "interpolation.h"
+#include "invert_laplace.h"
+#include "boundary.h"
+
+/***************************************************************
+ *                         Dual2D
+ ***************************************************************/
+
+Dual2D::Dual2D()
+{
+
+}
+
+Dual2D::Dual2D(const Dual2D &f)
+{
+  *this = f;
+}
+
+Dual2D::Dual2D(const Field2D &v)
+{
+  *this = v;
+}
+
+Dual2D::Dual2D(const Field2D &v, const Field2D &e)
+{
+  val = v;
+  eps = e;
+}
+
+Dual2D::~Dual2D()
+{
+
+}
+
+/////////////////// ASSIGNMENT ////////////////////
+
+Dual2D & Dual2D::operator=(const Dual2D &rhs)
+{
+  val = rhs.val;
+  eps = rhs.eps;
+  return *this;
+}
+
+Dual2D & Dual2D::operator=(const Field2D &rhs)
+{
+  val = rhs;
+  eps = 0.0;
+  return *this;
+}
+
+real Dual2D::operator=(const real rhs)
+{
+  val = rhs;
+  eps = 0.0;
+  return rhs;
+}
+
+////////////////// OPERATORS ////////////////////
+
+const Dual2D Dual2D::operator-() const
+{
+  return Dual2D(-val, -eps);
+}
+
+Dual2D & Dual2D::operator+=(const Dual2D &rhs)
+{
+  val += rhs.val;
+  eps += rhs.eps;
+  return *this;
+}
+
+Dual2D & Dual2D::operator+=(const Field2D &rhs)
+{
+  val += rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator+=(const real rhs)
+{
+  val += rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator-=(const Dual2D &rhs)
+{
+  val -= rhs.val;
+  eps -= rhs.eps;
+  return *this;
+}
+
+Dual2D & Dual2D::operator-=(const Field2D &rhs)
+{
+  val -= rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator-=(const real rhs)
+{
+  val -= rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator*=(const Dual2D &rhs)
+{
+  eps = eps*rhs.val + val*rhs.eps;
+  val *= rhs.val;
+  return *this;
+}
+
+Dual2D & Dual2D::operator*=(const Field2D &rhs)
+{
+  val *= rhs;
+  eps *= rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator*=(const real rhs)
+{
+  val *= rhs;
+  eps *= rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator/=(const Dual2D &rhs)
+{
+  val /= rhs.val;
+  eps = (eps - val*rhs.eps) / rhs.val;
+  return *this;
+}
+
+Dual2D & Dual2D::operator/=(const Field2D &rhs)
+{
+  val /= rhs;
+  eps /= rhs;
+  return *this;
+}
+
+Dual2D & Dual2D::operator/=(const real rhs)
+{
+  val /= rhs;
+  eps /= rhs;
+  return *this;
+}
+
+///////////////////// FieldData VIRTUAL FUNCTIONS //////////
+
+int Dual2D::getData(int jx, int jy, int jz, void *vptr) const
+{
+  return getData(jx, jy, jz, (real*) vptr) * sizeof(real);
+}
+
+int Dual2D::getData(int jx, int jy, int jz, real *rptr) const
+{
+  val.getData(jx, jy, jz, rptr);
+  eps.getData(jx, jy, jz, rptr+1);
+  return 2;
+}
+
+int Dual2D::setData(int jx, int jy, int jz, void *vptr)
+{
+  return setData(jx, jy, jz, (real*) vptr) * sizeof(real);
+}
+
+int Dual2D::setData(int jx, int jy, int jz, real *rptr)
+{
+  val.setData(jx, jy, jz, rptr);
+  eps.setData(jx, jy, jz, rptr+1);
+  return 2;
+}
+
+/***************************************************************
+ *                         Dual3D
+ ***************************************************************/
+
+Dual3D::Dual3D()
+{
+
+}
+
+Dual3D::Dual3D(const Dual3D &f)
+{
+  *this = f;
+}
+
+Dual3D::Dual3D(const Field3D &v)
+{
+  *this = v;
+}
+
+Dual3D::Dual3D(const Field3D &v, const Field3D &e)
+{
+  val = v;
+  eps = e;
+}
+
+Dual3D::Dual3D(const Dual2D &f)
+{
+  *this = f;
+}
+
+Dual3D::~Dual3D()
+{
+
+}
+
+void Dual3D::setLocation(CELL_LOC loc)
+{
+  val.setLocation(loc);
+  eps.setLocation(loc);
+}
+
+CELL_LOC Dual3D::getLocation() const
+{
+  return val.getLocation();
+}
+
+/////////////////// ASSIGNMENT ////////////////////
+
+Dual3D & Dual3D::operator=(const Dual3D &rhs)
+{
+  val = rhs.val;
+  eps = rhs.eps;
+  return *this;
+}
+
+Dual3D & Dual3D::operator=(const Dual2D &rhs)
+{
+  val = rhs.val;
+  eps = rhs.eps;
+  return *this;
+}
+
+Dual3D & Dual3D::operator=(const Field3D &rhs)
+{
+  val = rhs;
+  eps = 0.0;
+  return *this;
+}
+
+Dual3D & Dual3D::operator=(const Field2D &rhs)
+{
+  val = rhs;
+  eps = 0.0;
+  return *this;
+}
+
+real Dual3D::operator=(const real rhs)
+{
+  val = rhs;
+  eps = 0.0;
+  return rhs;
+}
+
+////////////////// OPERATORS ////////////////////
+
+const Dual3D Dual3D::operator-() const
+{
+  return Dual3D(-val, -eps);
+}
+
+Dual3D & Dual3D::operator+=(const Dual3D &rhs)
+{
+  val += rhs.val;
+  eps += rhs.eps;
+  return *this;
+}
+
+Dual3D & Dual3D::operator+=(const Dual2D &rhs)
+{
+  val += rhs.val;
+  eps += rhs.eps;
+  return *this;
+}
+
+Dual3D & Dual3D::operator+=(const Field3D &rhs)
+{
+  val += rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator+=(const Field2D &rhs)
+{
+  val += rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator+=(const real rhs)
+{
+  val += rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator-=(const Dual3D &rhs)
+{
+  val -= rhs.val;
+  eps -= rhs.eps;
+  return *this;
+}
+
+Dual3D & Dual3D::operator-=(const Dual2D &rhs)
+{
+  val -= rhs.val;
+  eps -= rhs.eps;
+  return *this;
+}
+
+Dual3D & Dual3D::operator-=(const Field3D &rhs)
+{
+  val -= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator-=(const Field2D &rhs)
+{
+  val -= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator-=(const real rhs)
+{
+  val -= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator*=(const Dual3D &rhs)
+{
+  eps = eps*rhs.val + val*rhs.eps;
+  val *= rhs.val;
+  return *this;
+}
+
+Dual3D & Dual3D::operator*=(const Dual2D &rhs)
+{
+  eps = eps*rhs.val + val*rhs.eps;
+  val *= rhs.val;
+  return *this;
+}
+
+Dual3D & Dual3D::operator*=(const Field3D &rhs)
+{
+  val *= rhs;
+  eps *= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator*=(const Field2D &rhs)
+{
+  val *= rhs;
+  eps *= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator*=(const real rhs)
+{
+  val *= rhs;
+  eps *= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator/=(const Dual3D &rhs)
+{
+  val /= rhs.val;
+  eps = (eps - val*rhs.eps) / rhs.val;
+  return *this;
+}
+
+Dual3D & Dual3D::operator/=(const Dual2D &rhs)
+{
+  val /= rhs.val;
+  eps = (eps - val*rhs.eps) / rhs.val;
+  return *this;
+}
+
+Dual3D & Dual3D::operator/=(const Field3D &rhs)
+{
+  val /= rhs;
+  eps /= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator/=(const Field2D &rhs)
+{
+  val /= rhs;
+  eps /= rhs;
+  return *this;
+}
+
+Dual3D & Dual3D::operator/=(const real rhs)
+{
+  val /= rhs;
+  eps /= rhs;
+  return *this;
+}
+
+///////////////////// FieldData VIRTUAL FUNCTIONS //////////
+
+int Dual3D::getData(int jx, int jy, int jz, void *vptr) const
+{
+  return getData(jx, jy, jz, (real*) vptr) * sizeof(real);
+}
+
+int Dual3D::getData(int jx, int jy, int jz, real *rptr) const
+{
+  val.getData(jx, jy, jz, rptr);
+  eps.getData(jx, jy, jz, rptr+1);
+  return 2;
+}
+
+int Dual3D::setData(int jx, int jy, int jz, void *vptr)
+{
+  return setData(jx, jy, jz, (real*) vptr) * sizeof(real);
+}
+
+int Dual3D::setData(int jx, int jy, int jz, real *rptr)
+{
+  val.setData(jx, jy, jz, rptr);
+  eps.setData(jx, jy, jz, rptr+1);
+  return 2;
+}
+
+/***************************************************************
+ *               NON-MEMBER OVERLOADED OPERATORS
+ ***************************************************************/
+
+// Dual2D
+
+const Dual2D operator+(const Dual2D &lhs, const Dual2D &rhs)
+{
+  return Dual2D(lhs.val + rhs.val, lhs.eps + rhs.eps);
+}
+
+const Dual2D operator+(const Dual2D &lhs, const Field2D &rhs)
+{
+  return Dual2D(lhs.val + rhs, lhs.eps);
+}
+
+const Dual2D operator+(const Field2D &lhs, const Dual2D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual2D operator+(const Dual2D &lhs, const real rhs)
+{
+  return Dual2D(lhs.val + rhs, lhs.eps);
+}
+
+const Dual2D operator+(const real lhs, const Dual2D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual2D operator-(const Dual2D &lhs, const Dual2D &rhs)
+{
+  return Dual2D(lhs.val - rhs.val, lhs.eps - rhs.eps);
+}
+
+const Dual2D operator-(const Dual2D &lhs, const Field2D &rhs)
+{
+  return Dual2D(lhs.val - rhs, lhs.eps);
+}
+
+const Dual2D operator-(const Field2D &lhs, const Dual2D &rhs)
+{
+  return Dual2D(lhs - rhs.val, -rhs.eps);
+}
+
+const Dual2D operator-(const Dual2D &lhs, const real rhs)
+{
+  return Dual2D(lhs.val - rhs, lhs.eps);
+}
+
+const Dual2D operator-(const real lhs, const Dual2D &rhs)
+{
+  return Dual2D(lhs - rhs.val, -rhs.eps);
+}
+
+const Dual2D operator*(const Dual2D &lhs, const Dual2D &rhs)
+{
+  return Dual2D(lhs.val * rhs.val, lhs.eps*rhs.val + lhs.val*rhs.eps);
+}
+
+const Dual2D operator*(const Dual2D &lhs, const Field2D &rhs)
+{
+  return Dual2D(lhs.val * rhs, lhs.eps * rhs);
+}
+
+const Dual2D operator*(const Field2D &lhs, const Dual2D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual2D operator*(const Dual2D &lhs, const real rhs)
+{
+  return Dual2D(lhs.val * rhs, lhs.eps * rhs);
+}
+
+const Dual2D operator*(const real lhs, const Dual2D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual2D operator/(const Dual2D &lhs, const Dual2D &rhs)
+{
+  Field2D q = lhs.val / rhs.val;
+  return Dual2D(q, (lhs.eps - q*rhs.eps) / rhs.val);
+}
+
+const Dual2D operator/(const Dual2D &lhs, const Field2D &rhs)
+{
+  return Dual2D(lhs.val / rhs, lhs.eps / rhs);
+}
+
+const Dual2D operator/(const Field2D &lhs, const Dual2D &rhs)
+{
+  Field2D q = lhs / rhs.val;
+  return Dual2D(q, -q*rhs.eps / rhs.val);
+}
+
+const Dual2D operator/(const Dual2D &lhs, const real rhs)
+{
+  return Dual2D(lhs.val / rhs, lhs.eps / rhs);
+}
+
+const Dual2D operator/(const real lhs, const Dual2D &rhs)
+{
+  Field2D q = lhs / rhs.val;
+  return Dual2D(q, -q*rhs.eps / rhs.val);
+}
+
+const Dual2D operator^(const Dual2D &lhs, const real rhs)
+{
+  return Dual2D(lhs.val ^ rhs, rhs * (lhs.val ^ (rhs - 1.)) * lhs.eps);
+}
+
+// Dual3D
+
+const Dual3D operator+(const Dual3D &lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs.val + rhs.val, lhs.eps + rhs.eps);
+}
+
+const Dual3D operator+(const Dual3D &lhs, const Dual2D &rhs)
+{
+  return Dual3D(lhs.val + rhs.val, lhs.eps + rhs.eps);
+}
+
+const Dual3D operator+(const Dual2D &lhs, const Dual3D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual3D operator+(const Dual3D &lhs, const Field3D &rhs)
+{
+  return Dual3D(lhs.val + rhs, lhs.eps);
+}
+
+const Dual3D operator+(const Field3D &lhs, const Dual3D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual3D operator+(const Dual3D &lhs, const Field2D &rhs)
+{
+  return Dual3D(lhs.val + rhs, lhs.eps);
+}
+
+const Dual3D operator+(const Field2D &lhs, const Dual3D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual3D operator+(const Dual3D &lhs, const real rhs)
+{
+  return Dual3D(lhs.val + rhs, lhs.eps);
+}
+
+const Dual3D operator+(const real lhs, const Dual3D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual3D operator-(const Dual3D &lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs.val - rhs.val, lhs.eps - rhs.eps);
+}
+
+const Dual3D operator-(const Dual3D &lhs, const Dual2D &rhs)
+{
+  return Dual3D(lhs.val - rhs.val, lhs.eps - rhs.eps);
+}
+
+const Dual3D operator-(const Dual2D &lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs.val - rhs.val, lhs.eps - rhs.eps);
+}
+
+const Dual3D operator-(const Dual3D &lhs, const Field3D &rhs)
+{
+  return Dual3D(lhs.val - rhs, lhs.eps);
+}
+
+const Dual3D operator-(const Field3D &lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs - rhs.val, -rhs.eps);
+}
+
+const Dual3D operator-(const Dual3D &lhs, const Field2D &rhs)
+{
+  return Dual3D(lhs.val - rhs, lhs.eps);
+}
+
+const Dual3D operator-(const Field2D &lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs - rhs.val, -rhs.eps);
+}
+
+const Dual3D operator-(const Dual3D &lhs, const real rhs)
+{
+  return Dual3D(lhs.val - rhs, lhs.eps);
+}
+
+const Dual3D operator-(const real lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs - rhs.val, -rhs.eps);
+}
+
+const Dual3D operator*(const Dual3D &lhs, const Dual3D &rhs)
+{
+  return Dual3D(lhs.val * rhs.val, lhs.eps*rhs.val + lhs.val*rhs.eps);
+}
+
+const Dual3D operator*(const Dual3D &lhs, const Dual2D &rhs)
+{
+  return Dual3D(lhs.val * rhs.val, lhs.eps*rhs.val + lhs.val*rhs.eps);
+}
+
+const Dual3D operator*(const Dual2D &lhs, const Dual3D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual3D operator*(const Dual3D &lhs, const Field3D &rhs)
+{
+  return Dual3D(lhs.val * rhs, lhs.eps * rhs);
+}
+
+const Dual3D operator*(const Field3D &lhs, const Dual3D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual3D operator*(const Dual3D &lhs, const Field2D &rhs)
+{
+  return Dual3D(lhs.val * rhs, lhs.eps * rhs);
+}
+
+const Dual3D operator*(const Field2D &lhs, const Dual3D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual3D operator*(const Dual3D &lhs, const real rhs)
+{
+  return Dual3D(lhs.val * rhs, lhs.eps * rhs);
+}
+
+const Dual3D operator*(const real lhs, const Dual3D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual3D operator/(const Dual3D &lhs, const Dual3D &rhs)
+{
+  Field3D q = lhs.val / rhs.val;
+  return Dual3D(q, (lhs.eps - q*rhs.eps) / rhs.val);
+}
+
+const Dual3D operator/(const Dual3D &lhs, const Dual2D &rhs)
+{
+  Field3D q = lhs.val / rhs.val;
+  return Dual3D(q, (lhs.eps - q*rhs.eps) / rhs.val);
+}
+
+const Dual3D operator/(const Dual2D &lhs, const Dual3D &rhs)
+{
+  Field3D q = lhs.val / rhs.val;
+  return Dual3D(q, (lhs.eps - q*rhs.eps) / rhs.val);
+}
+
+const Dual3D operator/(const Dual3D &lhs, const Field3D &rhs)
+{
+  return Dual3D(lhs.val / rhs, lhs.eps / rhs);
+}
+
+const Dual3D operator/(const Field3D &lhs, const Dual3D &rhs)
+{
+  Field3D q = lhs / rhs.val;
+  return Dual3D(q, -q*rhs.eps / rhs.val);
+}
+
+const Dual3D operator/(const Dual3D &lhs, const Field2D &rhs)
+{
+  return Dual3D(lhs.val / rhs, lhs.eps / rhs);
+}
+
+const Dual3D operator/(const Field2D &lhs, const Dual3D &rhs)
+{
+  Field3D q = lhs / rhs.val;
+  return Dual3D(q, -q*rhs.eps / rhs.val);
+}
+
+const Dual3D operator/(const Dual3D &lhs, const real rhs)
+{
+  return Dual3D(lhs.val / rhs, lhs.eps / rhs);
+}
+
+const Dual3D operator/(const real lhs, const Dual3D &rhs)
+{
+  Field3D q = lhs / rhs.val;
+  return Dual3D(q, -q*rhs.eps / rhs.val);
+}
+
+const Dual3D operator^(const Dual3D &lhs, const real rhs)
+{
+  return Dual3D(lhs.val ^ rhs, rhs * (lhs.val ^ (rhs - 1.)) * lhs.eps);
+}
+
+// Dual2D and Field3D
+
+const Dual3D operator+(const Dual2D &lhs, const Field3D &rhs)
+{
+  Dual3D result(lhs);
+  result += rhs;
+  return result;
+}
+
+const Dual3D operator+(const Field3D &lhs, const Dual2D &rhs)
+{
+  return rhs + lhs;
+}
+
+const Dual3D operator-(const Dual2D &lhs, const Field3D &rhs)
+{
+  Dual3D result(lhs);
+  result -= rhs;
+  return result;
+}
+
+const Dual3D operator-(const Field3D &lhs, const Dual2D &rhs)
+{
+  Dual3D result(-rhs);
+  result += lhs;
+  return result;
+}
+
+const Dual3D operator*(const Dual2D &lhs, const Field3D &rhs)
+{
+  return Dual3D(rhs * lhs.val, rhs * lhs.eps);
+}
+
+const Dual3D operator*(const Field3D &lhs, const Dual2D &rhs)
+{
+  return rhs * lhs;
+}
+
+const Dual3D operator/(const Dual2D &lhs, const Field3D &rhs)
+{
+  return Dual3D(lhs.val / rhs, lhs.eps / rhs);
+}
+
+const Dual3D operator/(const Field3D &lhs, const Dual2D &rhs)
+{
+  Field3D q = lhs / rhs.val;
+  return Dual3D(q, -q*rhs.eps / rhs.val);
+}
+
+/***************************************************************
+ *                      MATH FUNCTIONS
+ ***************************************************************/
+
+const Dual2D sqrt(const Dual2D &f)
+{
+  Field2D s = sqrt(f.val);
+  return Dual2D(s, 0.5*f.eps / s);
+}
+
+const Dual2D exp(const Dual2D &f)
+{
+  Field2D e = exp(f.val);
+  return Dual2D(e, e*f.eps);
+}
+
+const Dual2D log(const Dual2D &f)
+{
+  return Dual2D(log(f.val), f.eps / f.val);
+}
+
+const Dual2D sin(const Dual2D &f)
+{
+  return Dual2D(sin(f.val), cos(f.val)*f.eps);
+}
+
+const Dual2D cos(const Dual2D &f)
+{
+  return Dual2D(cos(f.val), -sin(f.val)*f.eps);
+}
+
+const Dual2D tan(const Dual2D &f)
+{
+  Field2D t = tan(f.val);
+  return Dual2D(t, (1. + t*t)*f.eps);
+}
+
+const Dual2D sinh(const Dual2D &f)
+{
+  return Dual2D(sinh(f.val), cosh(f.val)*f.eps);
+}
+
+const Dual2D cosh(const Dual2D &f)
+{
+  return Dual2D(cosh(f.val), sinh(f.val)*f.eps);
+}
+
+const Dual2D tanh(const Dual2D &f)
+{
+  Field2D t = tanh(f.val);
+  return Dual2D(t, (1. - t*t)*f.eps);
+}
+
+const Dual3D sqrt(const Dual3D &f)
+{
+  Field3D s = sqrt(f.val);
+  return Dual3D(s, 0.5*f.eps / s);
+}
+
+const Dual3D exp(const Dual3D &f)
+{
+  Field3D e = exp(f.val);
+  return Dual3D(e, e*f.eps);
+}
+
+const Dual3D log(const Dual3D &f)
+{
+  return Dual3D(log(f.val), f.eps / f.val);
+}
+
+const Dual3D sin(const Dual3D &f)
+{
+  return Dual3D(sin(f.val), cos(f.val)*f.eps);
+}
+
+const Dual3D cos(const Dual3D &f)
+{
+  return Dual3D(cos(f.val), -sin(f.val)*f.eps);
+}
+
+const Dual3D tan(const Dual3D &f)
+{
+  Field3D t = tan(f.val);
+  return Dual3D(t, (1. + t*t)*f.eps);
+}
+
+const Dual3D sinh(const Dual3D &f)
+{
+  return Dual3D(sinh(f.val), cosh(f.val)*f.eps);
+}
+
+const Dual3D cosh(const Dual3D &f)
+{
+  return Dual3D(cosh(f.val), sinh(f.val)*f.eps);
+}
+
+const Dual3D tanh(const Dual3D &f)
+{
+  Field3D t = tanh(f.val);
+  return Dual3D(t, (1. - t*t)*f.eps);
+}
+
+const Dual3D filter(const Dual3D &var, int N0)
+{
+  return Dual3D(filter(var.val, N0), filter(var.eps, N0));
+}
+
+const Dual3D low_pass(const Dual3D &var, int zmax)
+{
+  return Dual3D(low_pass(var.val, zmax), low_pass(var.eps, zmax));
+}
+
+const Dual3D low_pass(const Dual3D &var, int zmax, int zmin)
+{
+  return Dual3D(low_pass(var.val, zmax, zmin), low_pass(var.eps, zmax, zmin));
+}
+
+/***************************************************************
+ *                  DIFFERENTIAL OPERATORS
+ ***************************************************************/
+
+const Dual2D DDX(const Dual2D &f)
+{
+  return Dual2D(DDX(f.val), DDX(f.eps));
+}
+
+const Dual2D DDY(const Dual2D &f)
+{
+  return Dual2D(DDY(f.val), DDY(f.eps));
+}
+
+const Dual2D D2DX2(const Dual2D &f)
+{
+  return Dual2D(D2DX2(f.val), D2DX2(f.eps));
+}
+
+const Dual2D D2DY2(const Dual2D &f)
+{
+  return Dual2D(D2DY2(f.val), D2DY2(f.eps));
+}
+
+const Dual2D Grad_par(const Dual2D &f)
+{
+  return Dual2D(Grad_par(f.val), Grad_par(f.eps));
+}
+
+const Dual2D Delp2(const Dual2D &f)
+{
+  return Dual2D(Delp2(f.val), Delp2(f.eps));
+}
+
+const Dual2D Laplacian(const Dual2D &f)
+{
+  return Dual2D(Laplacian(f.val), Laplacian(f.eps));
+}
+
+const Dual3D DDX(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(DDX(f.val, outloc, method), DDX(f.eps, outloc, method));
+}
+
+const Dual3D DDY(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(DDY(f.val, outloc, method), DDY(f.eps, outloc, method));
+}
+
+const Dual3D DDZ(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method, bool inc_xbndry)
+{
+  return Dual3D(DDZ(f.val, outloc, method, inc_xbndry), DDZ(f.eps, outloc, method, inc_xbndry));
+}
+
+const Dual3D D2DX2(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(D2DX2(f.val, outloc, method), D2DX2(f.eps, outloc, method));
+}
+
+const Dual3D D2DY2(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(D2DY2(f.val, outloc, method), D2DY2(f.eps, outloc, method));
+}
+
+const Dual3D D2DZ2(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(D2DZ2(f.val, outloc, method), D2DZ2(f.eps, outloc, method));
+}
+
+const Dual3D D2DXDZ(const Dual3D &f)
+{
+  return Dual3D(D2DXDZ(f.val), D2DXDZ(f.eps));
+}
+
+const Dual3D VDDX(const Field &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDX(v, f.val, outloc, method), VDDX(v, f.eps, outloc, method));
+}
+
+const Dual3D VDDX(const Dual3D &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDX(v.val, f, outloc, method), VDDX_dv(v.val, v.eps, f, outloc, method));
+}
+
+const Dual3D VDDX(const Dual3D &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDX(v.val, f.val, outloc, method),
+		VDDX(v.val, f.eps, outloc, method) + VDDX_dv(v.val, v.eps, f.val, outloc, method));
+}
+
+const Dual3D VDDY(const Field &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDY(v, f.val, outloc, method), VDDY(v, f.eps, outloc, method));
+}
+
+const Dual3D VDDY(const Dual3D &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDY(v.val, f, outloc, method), VDDY_dv(v.val, v.eps, f, outloc, method));
+}
+
+const Dual3D VDDY(const Dual3D &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDY(v.val, f.val, outloc, method),
+		VDDY(v.val, f.eps, outloc, method) + VDDY_dv(v.val, v.eps, f.val, outloc, method));
+}
+
+const Dual3D VDDZ(const Field &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDZ(v, f.val, outloc, method), VDDZ(v, f.eps, outloc, method));
+}
+
+const Dual3D VDDZ(const Dual3D &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDZ(v.val, f, outloc, method), VDDZ_dv(v.val, v.eps, f, outloc, method));
+}
+
+const Dual3D VDDZ(const Dual3D &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(VDDZ(v.val, f.val, outloc, method),
+		VDDZ(v.val, f.eps, outloc, method) + VDDZ_dv(v.val, v.eps, f.val, outloc, method));
+}
+
+const Dual3D Grad_par(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(Grad_par(f.val, outloc, method), Grad_par(f.eps, outloc, method));
+}
+
+const Dual3D Vpar_Grad_par(const Field &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(Vpar_Grad_par(v, f.val, outloc, method), Vpar_Grad_par(v, f.eps, outloc, method));
+}
+
+const Dual3D Vpar_Grad_par(const Dual3D &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(Vpar_Grad_par(v.val, f, outloc, method), VDDY_dv(v.val, v.eps, f, outloc, method)/sqrt(g_22));
+}
+
+const Dual3D Vpar_Grad_par(const Dual3D &v, const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(Vpar_Grad_par(v.val, f.val, outloc, method),
+		Vpar_Grad_par(v.val, f.eps, outloc, method) + VDDY_dv(v.val, v.eps, f.val, outloc, method)/sqrt(g_22));
+}
+
+const Dual3D Div_par(const Dual3D &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return Dual3D(Div_par(f.val, outloc, method), Div_par(f.eps, outloc, method));
+}
+
+const Dual3D Grad2_par2(const Dual3D &f)
+{
+  return Dual3D(Grad2_par2(f.val), Grad2_par2(f.eps));
+}
+
+const Dual3D Delp2(const Dual3D &f, real zsmooth)
+{
+  return Dual3D(Delp2(f.val, zsmooth), Delp2(f.eps, zsmooth));
+}
+
+const Dual3D Laplacian(const Dual3D &f)
+{
+  return Dual3D(Laplacian(f.val), Laplacian(f.eps));
+}
+
+const Dual3D b0xGrad_dot_Grad(const Dual3D &phi, const Field2D &A, CELL_LOC outloc)
+{
+  return Dual3D(b0xGrad_dot_Grad(phi.val, A, outloc), b0xGrad_dot_Grad(phi.eps, A, outloc));
+}
+
+const Dual3D b0xGrad_dot_Grad(const Field2D &phi, const Dual3D &A)
+{
+  return Dual3D(b0xGrad_dot_Grad(phi, A.val), b0xGrad_dot_Grad(phi, A.eps));
+}
+
+const Dual3D b0xGrad_dot_Grad(const Dual3D &phi, const Field3D &A, CELL_LOC outloc)
+{
+  return Dual3D(b0xGrad_dot_Grad(phi.val, A, outloc), b0xGrad_dot_Grad(phi.eps, A, outloc));
+}
+
+const Dual3D b0xGrad_dot_Grad(const Field3D &phi, const Dual3D &A, CELL_LOC outloc)
+{
+  return Dual3D(b0xGrad_dot_Grad(phi, A.val, outloc), b0xGrad_dot_Grad(phi, A.eps, outloc));
+}
+
+const Dual3D b0xGrad_dot_Grad(const Dual3D &phi, const Dual3D &A, CELL_LOC outloc)
+{
+  return Dual3D(b0xGrad_dot_Grad(phi.val, A.val, outloc),
+		b0xGrad_dot_Grad(phi.val, A.eps, outloc) + b0xGrad_dot_Grad(phi.eps, A.val, outloc));
+}
+
+const Dual3D bracket(const Dual3D &f, const Field3D &g, BRACKET_METHOD method)
+{
+  return Dual3D(bracket(f.val, g, method), bracket(f.eps, g, method));
+}
+
+const Dual3D bracket(const Field3D &f, const Dual3D &g, BRACKET_METHOD method)
+{
+  return Dual3D(bracket(f, g.val, method), bracket(f, g.eps, method));
+}
+
+const Dual3D bracket(const Dual3D &f, const Dual3D &g, BRACKET_METHOD method)
+{
+  return Dual3D(bracket(f.val, g.val, method),
+		bracket(f.val, g.eps, method) + bracket(f.eps, g.val, method));
+}
+
+const Dual3D interp_to(const Dual3D &var, CELL_LOC loc)
+{
+  return Dual3D(interp_to(var.val, loc), interp_to(var.eps, loc));
+}
+
+const Dual3D invert_laplace(const Dual3D &b, int flags, const Field2D *a, const Field2D *c)
+{
+  return Dual3D(invert_laplace(b.val, flags, a, c), invert_laplace(b.eps, flags, a, c));
+}
+
+/***************************************************************
+ *                   BOUNDARY CONDITIONS
+ ***************************************************************/
+
+void apply_boundary(Dual2D &var, const char* name)
+{
+  apply_boundary(var.val, name);
+
+  // Boundary conditions are affine: B(x) = Lx + c. Tangent is L eps = B(eps) - B(0)
+  Field2D c = 0.0;
+  apply_boundary(c, name);
+  apply_boundary(var.eps, name);
+  var.eps -= c;
+}
+
+void apply_boundary(Dual3D &var, const char* name)
+{
+  apply_boundary(var.val, name);
+
+  Field3D c;
+  c = 0.0;
+  apply_boundary(c, name);
+  apply_boundary(var.eps, name);
+  var.eps -= c;
+}
@@ -0,0 +1,337 @@
+/*!
+ * \file dual.h
+ *
+ * \brief Forward-mode dual-number fields, for exact Jacobian-vector products
+ *
+ * A dual field a + b e (with e^2 = 0) holds a value and a tangent (the
+ * directional derivative). Writing the physics RHS as a template over the
+ * field types, and evaluating it once with dual fields seeded with the
+ * state and a direction v, gives f(y) in the value and J(y).v in the tangent.
+ *
+ * Linear operators (derivatives, Laplacian inversion, filtering, boundary
+ * conditions) act on the value and tangent separately. In upwinding terms
+ * the velocity perturbation multiplies the derivative upwinded on the
+ * unperturbed velocity, which is exact except where the velocity is zero.
+ * A staggered velocity is first interpolated to the location of f.
+ * WENO (W3) upwinding is nonlinear in f, so its tangent in f is approximate.
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+class Dual2D;
+class Dual3D;
+
+#ifndef __DUAL_H__
+#define __DUAL_H__
+
+#include "field2d.h"
+#include "field3d.h"
+#include "field_data.h"
+#include "derivs.h"
+#include "bout_types.h"
+
+/// Dual-number 2D field
+class Dual2D : public FieldData {
+ public:
+  Dual2D();
+  Dual2D(const Dual2D &f);
+  Dual2D(const Field2D &v); ///< Constant: zero tangent
+  Dual2D(const Field2D &v, const Field2D &e);
+  ~Dual2D();
+
+  Field2D val, eps; ///< Value and tangent
+
+  // Assignment
+  Dual2D & operator=(const Dual2D &rhs);
+  Dual2D & operator=(const Field2D &rhs);
+  real operator=(const real rhs);
+
+  // Operators
+  const Dual2D operator-() const;
+
+  Dual2D & operator+=(const Dual2D &rhs);
+  Dual2D & operator+=(const Field2D &rhs);
+  Dual2D & operator+=(const real rhs);
+
+  Dual2D & operator-=(const Dual2D &rhs);
+  Dual2D & operator-=(const Field2D &rhs);
+  Dual2D & operator-=(const real rhs);
+
+  Dual2D & operator*=(const Dual2D &rhs);
+  Dual2D & operator*=(const Field2D &rhs);
+  Dual2D & operator*=(const real rhs);
+
+  Dual2D & operator/=(const Dual2D &rhs);
+  Dual2D & operator/=(const Field2D &rhs);
+  Dual2D & operator/=(const real rhs);
+
+  // FieldData virtual functions
+
+  bool isReal() const   { return true; }
+  bool is3D() const     { return false; }
+  int  byteSize() const { return 2*sizeof(real); }
+  int  realSize() const { return 2; }
+  int  getData(int jx, int jy, int jz, void *vptr) const;
+  int  getData(int jx, int jy, int jz, real *rptr) const;
+  int  setData(int jx, int jy, int jz, void *vptr);
+  int  setData(int jx, int jy, int jz, real *rptr);
+};
+
+/// Dual-number 3D field
+class Dual3D : public FieldData {
+ public:
+  Dual3D();
+  Dual3D(const Dual3D &f);
+  Dual3D(const Field3D &v); ///< Constant: zero tangent
+  Dual3D(const Field3D &v, const Field3D &e);
+  Dual3D(const Dual2D &f);
+  ~Dual3D();
+
+  Field3D val, eps; ///< Value and tangent
+
+  /// Set variable location of both parts
+  void setLocation(CELL_LOC loc);
+  CELL_LOC getLocation() const;
+
+  // Assignment
+  Dual3D & operator=(const Dual3D &rhs);
+  Dual3D & operator=(const Dual2D &rhs);
+  Dual3D & operator=(const Field3D &rhs);
+  Dual3D & operator=(const Field2D &rhs);
+  real operator=(const real rhs);
+
+  // Operators
+  const Dual3D operator-() const;
+
+  Dual3D & operator+=(const Dual3D &rhs);
+  Dual3D & operator+=(const Dual2D &rhs);
+  Dual3D & operator+=(const Field3D &rhs);
+  Dual3D & operator+=(const Field2D &rhs);
+  Dual3D & operator+=(const real rhs);
+
+  Dual3D & operator-=(const Dual3D &rhs);
+  Dual3D & operator-=(const Dual2D &rhs);
+  Dual3D & operator-=(const Field3D &rhs);
+  Dual3D & operator-=(const Field2D &rhs);
+  Dual3D & operator-=(const real rhs);
+
+  Dual3D & operator*=(const Dual3D &rhs);
+  Dual3D & operator*=(const Dual2D &rhs);
+  Dual3D & operator*=(const Field3D &rhs);
+  Dual3D & operator*=(const Field2D &rhs);
+  Dual3D & operator*=(const real rhs);
+
+  Dual3D & operator/=(const Dual3D &rhs);
+  Dual3D & operator/=(const Dual2D &rhs);
+  Dual3D & operator/=(const Field3D &rhs);
+  Dual3D & operator/=(const Field2D &rhs);
+  Dual3D & operator/=(const real rhs);
+
+  // Z shifting (for twist-shift in communications)
+  void ShiftZ(int jx, int jy, double zangle) {
+    val.ShiftZ(jx, jy, zangle);
+    eps.ShiftZ(jx, jy, zangle);
+  }
+
+  // FieldData virtual functions
+
+  bool isReal() const   { return true; }
+  bool is3D() const     { return true; }
+  int  byteSize() const { return 2*sizeof(real); }
+  int  realSize() const { return 2; }
+  int  getData(int jx, int jy, int jz, void *vptr) const;
+  int  getData(int jx, int jy, int jz, real *rptr) const;
+  int  setData(int jx, int jy, int jz, void *vptr);
+  int  setData(int jx, int jy, int jz, real *rptr);
+};
+
+// Non-member overloaded operators
+
+const Dual2D operator+(const Dual2D &lhs, const Dual2D &rhs);
+const Dual2D operator+(const Dual2D &lhs, const Field2D &rhs);
+const Dual2D operator+(const Field2D &lhs, const Dual2D &rhs);
+const Dual2D operator+(const Dual2D &lhs, const real rhs);
+const Dual2D operator+(const real lhs, const Dual2D &rhs);
+
+const Dual2D operator-(const Dual2D &lhs, const Dual2D &rhs);
+const Dual2D operator-(const Dual2D &lhs, const Field2D &rhs);
+const Dual2D operator-(const Field2D &lhs, const Dual2D &rhs);
+const Dual2D operator-(const Dual2D &lhs, const real rhs);
+const Dual2D operator-(const real lhs, const Dual2D &rhs);
+
+const Dual2D operator*(const Dual2D &lhs, const Dual2D &rhs);
+const Dual2D operator*(const Dual2D &lhs, const Field2D &rhs);
+const Dual2D operator*(const Field2D &lhs, const Dual2D &rhs);
+const Dual2D operator*(const Dual2D &lhs, const real rhs);
+const Dual2D operator*(const real lhs, const Dual2D &rhs);
+
+const Dual2D operator/(const Dual2D &lhs, const Dual2D &rhs);
+const Dual2D operator/(const Dual2D &lhs, const Field2D &rhs);
+const Dual2D operator/(const Field2D &lhs, const Dual2D &rhs);
+const Dual2D operator/(const Dual2D &lhs, const real rhs);
+const Dual2D operator/(const real lhs, const Dual2D &rhs);
+
+const Dual2D operator^(const Dual2D &lhs, const real rhs);
+
+const Dual3D operator+(const Dual3D &lhs, const Dual3D &rhs);
+const Dual3D operator+(const Dual3D &lhs, const Dual2D &rhs);
+const Dual3D operator+(const Dual2D &lhs, const Dual3D &rhs);
+const Dual3D operator+(const Dual3D &lhs, const Field3D &rhs);
+const Dual3D operator+(const Field3D &lhs, const Dual3D &rhs);
+const Dual3D operator+(const Dual3D &lhs, const Field2D &rhs);
+const Dual3D operator+(const Field2D &lhs, const Dual3D &rhs);
+const Dual3D operator+(const Dual3D &lhs, const real rhs);
+const Dual3D operator+(const real lhs, const Dual3D &rhs);
+
+const Dual3D operator-(const Dual3D &lhs, const Dual3D &rhs);
+const Dual3D operator-(const Dual3D &lhs, const Dual2D &rhs);
+const Dual3D operator-(const Dual2D &lhs, const Dual3D &rhs);
+const Dual3D operator-(const Dual3D &lhs, const Field3D &rhs);
+const Dual3D operator-(const Field3D &lhs, const Dual3D &rhs);
+const Dual3D operator-(const Dual3D &lhs, const Field2D &rhs);
+const Dual3D operator-(const Field2D &lhs, const Dual3D &rhs);
+const Dual3D operator-(const Dual3D &lhs, const real rhs);
+const Dual3D operator-(const real lhs, const Dual3D &rhs);
+
+const Dual3D operator*(const Dual3D &lhs, const Dual3D &rhs);
+const Dual3D operator*(const Dual3D &lhs, const Dual2D &rhs);
+const Dual3D operator*(const Dual2D &lhs, const Dual3D &rhs);
+const Dual3D operator*(const Dual3D &lhs, const Field3D &rhs);
+const Dual3D operator*(const Field3D &lhs, const Dual3D &rhs);
+const Dual3D operator*(const Dual3D &lhs, const Field2D &rhs);
+const Dual3D operator*(const Field2D &lhs, const Dual3D &rhs);
+const Dual3D operator*(const Dual3D &lhs, const real rhs);
+const Dual3D operator*(const real lhs, const Dual3D &rhs);
+
+const Dual3D operator/(const Dual3D &lhs, const Dual3D &rhs);
+const Dual3D operator/(const Dual3D &lhs, const Dual2D &rhs);
+const Dual3D operator/(const Dual2D &lhs, const Dual3D &rhs);
+const Dual3D operator/(const Dual3D &lhs, const Field3D &rhs);
+const Dual3D operator/(const Field3D &lhs, const Dual3D &rhs);
+const Dual3D operator/(const Dual3D &lhs, const Field2D &rhs);
+const Dual3D operator/(const Field2D &lhs, const Dual3D &rhs);
+const Dual3D operator/(const Dual3D &lhs, const real rhs);
+const Dual3D operator/(const real lhs, const Dual3D &rhs);
+
+const Dual3D operator^(const Dual3D &lhs, const real rhs);
+
+// Mixing constant 3D fields with 2D duals gives 3D duals
+
+const Dual3D operator+(const Dual2D &lhs, const Field3D &rhs);
+const Dual3D operator+(const Field3D &lhs, const Dual2D &rhs);
+const Dual3D operator-(const Dual2D &lhs, const Field3D &rhs);
+const Dual3D operator-(const Field3D &lhs, const Dual2D &rhs);
+const Dual3D operator*(const Dual2D &lhs, const Field3D &rhs);
+const Dual3D operator*(const Field3D &lhs, const Dual2D &rhs);
+const Dual3D operator/(const Dual2D &lhs, const Field3D &rhs);
+const Dual3D operator/(const Field3D &lhs, const Dual2D &rhs);
+
+// Math functions
+
+const Dual2D sqrt(const Dual2D &f);
+const Dual2D exp(const Dual2D &f);
+const Dual2D log(const Dual2D &f);
+const Dual2D sin(const Dual2D &f);
+const Dual2D cos(const Dual2D &f);
+const Dual2D tan(const Dual2D &f);
+const Dual2D sinh(const Dual2D &f);
+const Dual2D cosh(const Dual2D &f);
+const Dual2D tanh(const Dual2D &f);
+
+const Dual3D sqrt(const Dual3D &f);
+const Dual3D exp(const Dual3D &f);
+const Dual3D log(const Dual3D &f);
+const Dual3D sin(const Dual3D &f);
+const Dual3D cos(const Dual3D &f);
+const Dual3D tan(const Dual3D &f);
+const Dual3D sinh(const Dual3D &f);
+const Dual3D cosh(const Dual3D &f);
+const Dual3D tanh(const Dual3D &f);
+
+const Dual3D filter(const Dual3D &var, int N0);
+const Dual3D low_pass(const Dual3D &var, int zmax);
+const Dual3D low_pass(const Dual3D &var, int zmax, int zmin);
+
+// Differential operators
+
+const Dual2D DDX(const Dual2D &f);
+const Dual2D DDY(const Dual2D &f);
+const Dual2D D2DX2(const Dual2D &f);
+const Dual2D D2DY2(const Dual2D &f);
+const Dual2D Grad_par(const Dual2D &f);
+const Dual2D Delp2(const Dual2D &f);
+const Dual2D Laplacian(const Dual2D &f);
+
+const Dual3D DDX(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D DDY(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D DDZ(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT, bool inc_xbndry = false);
+const Dual3D D2DX2(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D D2DY2(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D D2DZ2(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D D2DXDZ(const Dual3D &f);
+
+// Upwinding terms. The velocity tangent uses the direction of the velocity value
+
+const Dual3D VDDX(const Field &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D VDDX(const Dual3D &v, const Field &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D VDDX(const Dual3D &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+
+const Dual3D VDDY(const Field &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D VDDY(const Dual3D &v, const Field &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D VDDY(const Dual3D &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+
+const Dual3D VDDZ(const Field &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D VDDZ(const Dual3D &v, const Field &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D VDDZ(const Dual3D &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+
+const Dual3D Grad_par(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+
+const Dual3D Vpar_Grad_par(const Field &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D Vpar_Grad_par(const Dual3D &v, const Field &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D Vpar_Grad_par(const Dual3D &v, const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+
+const Dual3D Div_par(const Dual3D &f, CELL_LOC outloc = CELL_DEFAULT, DIFF_METHOD method = DIFF_DEFAULT);
+const Dual3D Grad2_par2(const Dual3D &f);
+const Dual3D Delp2(const Dual3D &f, real zsmooth=0.4);
+const Dual3D Laplacian(const Dual3D &f);
+
+const Dual3D b0xGrad_dot_Grad(const Dual3D &phi, const Field2D &A, CELL_LOC outloc = CELL_DEFAULT);
+const Dual3D b0xGrad_dot_Grad(const Field2D &phi, const Dual3D &A);
+const Dual3D b0xGrad_dot_Grad(const Dual3D &phi, const Field3D &A, CELL_LOC outloc = CELL_DEFAULT);
+const Dual3D b0xGrad_dot_Grad(const Field3D &phi, const Dual3D &A, CELL_LOC outloc = CELL_DEFAULT);
+const Dual3D b0xGrad_dot_Grad(const Dual3D &phi, const Dual3D &A, CELL_LOC outloc = CELL_DEFAULT);
+
+const Dual3D bracket(const Dual3D &f, const Field3D &g, BRACKET_METHOD method = BRACKET_STD);
+const Dual3D bracket(const Field3D &f, const Dual3D &g, BRACKET_METHOD method = BRACKET_STD);
+const Dual3D bracket(const Dual3D &f, const Dual3D &g, BRACKET_METHOD method = BRACKET_STD);
+
+const Dual3D interp_to(const Dual3D &var, CELL_LOC loc);
+
+/// Laplacian inversion, with coefficients independent of the state
+const Dual3D invert_laplace(const Dual3D &b, int flags, const Field2D *a = NULL, const Field2D *c = NULL);
+
+/// Boundary conditions. Any constant part (e.g. relaxing to a value)
+/// is removed from the tangent
+void apply_boundary(Dual2D &var, const char* name);
+void apply_boundary(Dual3D &var, const char* name);
+
+#endif // __DUAL_H__
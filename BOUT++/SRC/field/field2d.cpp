@@ -30,6 +30,7 @@
 #include "field2d.h"
 
 #include "utils.h"
+#include "vecmath.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -347,8 +348,6 @@ Field2D & Field2D::operator/=(const real rhs)
 
 Field2D & Field2D::operator^=(const Field2D &rhs)
 {
-  int jx, jy;
-
 #ifdef CHECK
   if(rhs.data == (real**) NULL) {
     // Invalid data
@@ -364,17 +363,13 @@ Field2D & Field2D::operator^=(const Field2D &rhs)
   name = "("+name + "^" + rhs.name + ")";
 #endif
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      data[jx][jy] = pow(data[jx][jy], rhs.data[jx][jy]);
+  vpow(ngx*ngy, data[0], rhs.data[0], data[0]);
 
   return(*this);
 }
 
 Field2D & Field2D::operator^=(const real rhs)
 {
-  int jx, jy;
-
 #ifdef CHECK
   if(data == (real**) NULL) {
     error("Field2D: *= operates on empty data");
@@ -385,11 +380,7 @@ Field2D & Field2D::operator^=(const real rhs)
   name = "("+name + "^real)";
 #endif
 
-  for(jx=0;jx<ngx;jx++) {
-    for(jy=0;jy<ngy;jy++) {
-      data[jx][jy] = pow(data[jx][jy], rhs);
-    }
-  }
+  vpow(ngx*ngy, data[0], rhs, data[0]);
   
   return(*this);
 }
@@ -483,13 +474,13 @@ const Field2D Field2D::operator^(const real rhs) const
 
 ///////////// Left binary operators ////////////////
 
-const Field3D Field2D::operator+(const Field3D &other) const
+Field3D Field2D::operator+(const Field3D &other) const
 {
   // just turn operator around
   return(other + (*this));
 }
 
-const Field3D Field2D::operator-(const Field3D &other) const
+Field3D Field2D::operator-(const Field3D &other) const
 {
   Field3D result = other;
   real ***d;
@@ -518,13 +509,13 @@ const Field3D Field2D::operator-(const Field3D &other) const
   return(result);
 }
 
-const Field3D Field2D::operator*(const Field3D &other) const
+Field3D Field2D::operator*(const Field3D &other) const
 {
   // turn operator around
   return(other * (*this));
 }
 
-const Field3D Field2D::operator/(const Field3D &other) const
+Field3D Field2D::operator/(const Field3D &other) const
 {
   Field3D result = other;
   real ***d;
@@ -553,7 +544,7 @@ const Field3D Field2D::operator/(const Field3D &other) const
   return(result);
 }
 
-const Field3D Field2D::operator^(const Field3D &other) const
+Field3D Field2D::operator^(const Field3D &other) const
 {
   Field3D result = other;
   real ***d;
@@ -818,9 +809,7 @@ const Field2D Field2D::Sqrt() const
 
   result.Allocate();
 
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = sqrt(data[jx][jy]);
+  vsqrt(ngx*ngy, data[0], result.data[0]);
 
   return result;
 }
@@ -927,8 +916,6 @@ real Field2D::Max(bool allpe) const
 
 bool Field2D::Finite() const
 {
-  int jx, jy;
-
 #ifdef CHECK
   // Check data set
   if(data == (real**) NULL) {
@@ -937,12 +924,22 @@ bool Field2D::Finite() const
   }
 #endif
 
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      if(!finite(data[jx][jy]))
-	return false;
+  // Data is contiguous
+  return first_nonfinite(data[0], ngx*ngy) < 0;
+}
 
-  return true;
+bool Field2D::findNonFinite(int &jx, int &jy) const
+{
+  if(data == (real**) NULL)
+    return false;
+  
+  for(jx=MXG;jx<ngx-MXG;jx++)
+    if((jy = first_nonfinite(data[jx]+MYG, ngy-2*MYG)) >= 0) {
+      jy += MYG;
+      return true;
+    }
+  
+  return false;
 }
 
 ///////////////////// FieldData VIRTUAL FUNCTIONS //////////
@@ -1031,11 +1028,8 @@ bool Field2D::check_data(bool vital) const
     // Do full checks
     int jx, jy;
 
-    for(jx=MXG;jx<ngx-MXG;jx++)
-      for(jy=MYG;jy<ngy-MYG;jy++)
-	if(!finite(data[jx][jy])) {
-	  error("Field2D: Operation on non-finite data at [%d][%d]\n", jx, jy);
-	}
+    if(findNonFinite(jx, jy))
+      error("Field2D: Operation on non-finite data at [%d][%d]\n", jx, jy);
   }
   return false;
 }
@@ -1138,7 +1132,6 @@ const Field2D operator/(const real lhs, const Field2D &rhs)
 const Field2D operator^(const real lhs, const Field2D &rhs)
 {
   Field2D result = rhs;
-  int jx, jy;
   real **d;
 
   d = result.data;
@@ -1154,9 +1147,7 @@ const Field2D operator^(const real lhs, const Field2D &rhs)
   result.name = "(real^"+rhs.name+")";
 #endif
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      d[jx][jy] = pow(lhs, d[jx][jy]);
+  vpow(ngx*ngy, lhs, d[0], d[0]);
 
   return(result);
 }
@@ -1193,17 +1184,14 @@ bool finite(const Field2D &f)
 const Field2D sin(const Field2D &f)
 {
   Field2D result;
-  int jx, jy;
   
 #ifdef TRACK
   result.name = "sin("+f.name+")";
 #endif
 
   result.Allocate();
-  
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = sin(f.data[jx][jy]);
+
+  vsin(ngx*ngy, f.data[0], result.data[0]);
 
   return result;
 }
@@ -1211,17 +1199,14 @@ const Field2D sin(const Field2D &f)
 const Field2D cos(const Field2D &f)
 {
   Field2D result;
-  int jx, jy;
   
 #ifdef TRACK
   result.name = "cos("+f.name+")";
 #endif
 
   result.Allocate();
-  
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = cos(f.data[jx][jy]);
+
+  vcos(ngx*ngy, f.data[0], result.data[0]);
 
   return result;
 }
@@ -1229,17 +1214,14 @@ const Field2D cos(const Field2D &f)
 const Field2D tan(const Field2D &f)
 {
   Field2D result;
-  int jx, jy;
   
 #ifdef TRACK
   result.name = "tan("+f.name+")";
 #endif
 
   result.Allocate();
-  
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = tan(f.data[jx][jy]);
+
+  vtan(ngx*ngy, f.data[0], result.data[0]);
 
   return result;
 }
@@ -1247,17 +1229,14 @@ const Field2D tan(const Field2D &f)
 const Field2D sinh(const Field2D &f)
 {
   Field2D result;
-  int jx, jy;
   
 #ifdef TRACK
   result.name = "sinh("+f.name+")";
 #endif
 
   result.Allocate();
-  
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = sinh(f.data[jx][jy]);
+
+  vsinh(ngx*ngy, f.data[0], result.data[0]);
 
   return result;
 }
@@ -1265,17 +1244,14 @@ const Field2D sinh(const Field2D &f)
 const Field2D cosh(const Field2D &f)
 {
   Field2D result;
-  int jx, jy;
   
 #ifdef TRACK
   result.name = "cosh("+f.name+")";
 #endif
 
   result.Allocate();
-  
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = cosh(f.data[jx][jy]);
+
+  vcosh(ngx*ngy, f.data[0], result.data[0]);
 
   return result;
 }
@@ -1283,17 +1259,44 @@ const Field2D cosh(const Field2D &f)
 const Field2D tanh(const Field2D &f)
 {
   Field2D result;
-  int jx, jy;
   
 #ifdef TRACK
   result.name = "tanh("+f.name+")";
 #endif
 
   result.Allocate();
+
+  vtanh(ngx*ngy, f.data[0], result.data[0]);
+
+  return result;
+}
+
+const Field2D exp(const Field2D &f)
+{
+  Field2D result;
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      result.data[jx][jy] = tanh(f.data[jx][jy]);
+#ifdef TRACK
+  result.name = "exp("+f.name+")";
+#endif
+
+  result.Allocate();
+
+  vexp(ngx*ngy, f.data[0], result.data[0]);
+
+  return result;
+}
+
+const Field2D log(const Field2D &f)
+{
+  Field2D result;
+  
+#ifdef TRACK
+  result.name = "log("+f.name+")";
+#endif
+
+  result.Allocate();
+
+  vlog(ngx*ngy, f.data[0], result.data[0]);
 
   return result;
 }
@@ -90,11 +90,11 @@ class Field2D : public Field, public FieldData {
 
   // Left binary operators
 
-  const Field3D operator+(const Field3D &other) const;
-  const Field3D operator-(const Field3D &other) const;
-  const Field3D operator*(const Field3D &other) const;
-  const Field3D operator/(const Field3D &other) const;
-  const Field3D operator^(const Field3D &other) const;
+  Field3D operator+(const Field3D &other) const;
+  Field3D operator-(const Field3D &other) const;
+  Field3D operator*(const Field3D &other) const;
+  Field3D operator/(const Field3D &other) const;
+  Field3D operator^(const Field3D &other) const;
 
   const FieldPerp operator+(const FieldPerp &other) const;
   const FieldPerp operator-(const FieldPerp &other) const;
@@ -125,6 +125,8 @@ class Field2D : public Field, public FieldData {
   real Min(bool allpe=false) const;
   real Max(bool allpe=false) const;
   bool Finite() const;
+  /// Location of the first NaN or Inf, excluding guard cells. Returns false if none
+  bool findNonFinite(int &jx, int &jy) const;
   
   friend const Field2D sin(const Field2D &f);
   friend const Field2D cos(const Field2D &f);
@@ -134,6 +136,9 @@ class Field2D : public Field, public FieldData {
   friend const Field2D cosh(const Field2D &f);
   friend const Field2D tanh(const Field2D &f);
 
+  friend const Field2D exp(const Field2D &f);
+  friend const Field2D log(const Field2D &f);
+
   bool is_const;
   real value;
 
@@ -27,13 +27,21 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 #include "field3d.h"
 #include "utils.h"
 #include "fft.h"
 #include "dcomplex.h"
+#include "vecmath.h"
 #include "interpolation.h"
 
+#include <sys/mman.h> // For madvise
+
+#if __cplusplus >= 201103L
+#include <utility> // For std::move
+#endif
+
 /// Constructor
 Field3D::Field3D()
 {
@@ -74,6 +82,21 @@ Field3D::Field3D(const Field3D& f)
 #endif
 }
 
+#if __cplusplus >= 201103L
+/// Takes the block from a temporary, so no reference counting needed
+Field3D::Field3D(Field3D&& f)
+{
+#ifdef TRACK
+  name = f.name;
+#endif
+
+  block = f.block;
+  f.block = NULL;
+
+  location = f.location;
+}
+#endif
+
 Field3D::~Field3D()
 {
   /// free the block of data if allocated
@@ -241,6 +264,37 @@ Field3D & Field3D::operator=(const Field3D &rhs)
   return(*this);
 }
 
+#if __cplusplus >= 201103L
+Field3D & Field3D::operator=(Field3D &&rhs)
+{
+  if(this == &rhs)
+    return(*this);
+
+#ifdef CHECK
+  msg_stack.push("Field3D: Move assignment");
+  rhs.check_data(true);
+#endif
+
+#ifdef TRACK
+  name = rhs.name;
+#endif
+
+  free_data();
+  
+  /// Take the block from rhs
+  block = rhs.block;
+  rhs.block = NULL;
+
+  location = rhs.location;
+
+#ifdef CHECK
+  msg_stack.pop();
+#endif
+
+  return(*this);
+}
+#endif
+
 Field3D & Field3D::operator=(const Field2D &rhs)
 {
   int jx, jy, jz;
@@ -904,8 +958,6 @@ Field3D & Field3D::operator/=(const real rhs)
 
 Field3D & Field3D::operator^=(const Field3D &rhs)
 {
-  int jx, jy, jz;
-
   if(StaggerGrids && (rhs.location != location)) {
     // Interpolate and call again
     
@@ -930,18 +982,11 @@ Field3D & Field3D::operator^=(const Field3D &rhs)
 #endif
 
   if(block->refs == 1) {
-    for(jx=0;jx<ngx;jx++)
-      for(jy=0;jy<ngy;jy++)
-	for(jz=0;jz<ngz;jz++)
-	  block->data[jx][jy][jz] = pow(block->data[jx][jy][jz], rhs.block->data[jx][jy][jz]);
-
+    vpow(ngx*ngy*ngz, block->data[0][0], rhs.block->data[0][0], block->data[0][0]);
   }else {
     memblock3d *nb = new_block();
     
-    for(jx=0;jx<ngx;jx++)
-      for(jy=0;jy<ngy;jy++)
-	for(jz=0;jz<ngz;jz++)
-	  nb->data[jx][jy][jz] = pow(block->data[jx][jy][jz], rhs.block->data[jx][jy][jz]);
+    vpow(ngx*ngy*ngz, block->data[0][0], rhs.block->data[0][0], nb->data[0][0]);
     
     block->refs--;
     block = nb;
@@ -956,7 +1001,7 @@ Field3D & Field3D::operator^=(const Field3D &rhs)
 
 Field3D & Field3D::operator^=(const Field2D &rhs)
 {
-  int jx, jy, jz;
+  int jx, jy;
   real **d;
 
 #ifdef CHECK
@@ -971,19 +1016,18 @@ Field3D & Field3D::operator^=(const Field2D &rhs)
   name = "(" + name + "^"+rhs.name+")";
 #endif
 
+  // Exponent is constant in Z
   if(block->refs == 1) {
     for(jx=0;jx<ngx;jx++)
       for(jy=0;jy<ngy;jy++)
-	for(jz=0;jz<ngz;jz++)
-	  block->data[jx][jy][jz] = pow(block->data[jx][jy][jz], d[jx][jy]);
+	vpow(ngz, block->data[jx][jy], d[jx][jy], block->data[jx][jy]);
 
   }else {
     memblock3d *nb = new_block();
 
     for(jx=0;jx<ngx;jx++)
       for(jy=0;jy<ngy;jy++)
-	for(jz=0;jz<ngz;jz++)
-	  nb->data[jx][jy][jz] = pow(block->data[jx][jy][jz], d[jx][jy]);
+	vpow(ngz, block->data[jx][jy], d[jx][jy], nb->data[jx][jy]);
 
     block->refs--;
     block = nb;
@@ -998,8 +1042,6 @@ Field3D & Field3D::operator^=(const Field2D &rhs)
 
 Field3D & Field3D::operator^=(const real rhs)
 {
-  int jx, jy, jz;
-
 #ifdef CHECK
   msg_stack.push("Field3D: ^= ( real )");
   check_data();
@@ -1014,18 +1056,11 @@ Field3D & Field3D::operator^=(const real rhs)
 #endif
 
   if(block->refs == 1) {
-    for(jx=0;jx<ngx;jx++)
-      for(jy=0;jy<ngy;jy++)
-	for(jz=0;jz<ngz;jz++)
-	  block->data[jx][jy][jz] = pow(block->data[jx][jy][jz], rhs);
-
+    vpow(ngx*ngy*ngz, block->data[0][0], rhs, block->data[0][0]);
   }else {
     memblock3d *nb = new_block();
 
-    for(jx=0;jx<ngx;jx++)
-      for(jy=0;jy<ngy;jy++)
-	for(jz=0;jz<ngz;jz++)
-	  nb->data[jx][jy][jz] = pow(block->data[jx][jy][jz], rhs);
+    vpow(ngx*ngy*ngz, block->data[0][0], rhs, nb->data[0][0]);
 
     block->refs--;
     block = nb;
@@ -1045,7 +1080,7 @@ Field3D & Field3D::operator^=(const real rhs)
 
 /////////////////// ADDITION ///////////////////
 
-const Field3D Field3D::operator+() const
+Field3D Field3D::operator+() const
 {
   Field3D result = *this;
 
@@ -1057,14 +1092,14 @@ const Field3D Field3D::operator+() const
 }
 
 
-const Field3D Field3D::operator+(const Field3D &other) const
+Field3D Field3D::operator+(const Field3D &other) const
 {
   Field3D result = *this;
   result += other;
   return(result);
 }
 
-const Field3D Field3D::operator+(const Field2D &other) const
+Field3D Field3D::operator+(const Field2D &other) const
 {
   Field3D result = *this;
   result += other;
@@ -1078,7 +1113,7 @@ const FieldPerp Field3D::operator+(const FieldPerp &other) const
   return(result);
 }
 
-const Field3D Field3D::operator+(const real &rhs) const
+Field3D Field3D::operator+(const real &rhs) const
 {
   Field3D result = *this;
   result += rhs;
@@ -1087,7 +1122,7 @@ const Field3D Field3D::operator+(const real &rhs) const
 
 /////////////////// SUBTRACTION ////////////////
 
-const Field3D Field3D::operator-() const
+Field3D Field3D::operator-() const
 {
   Field3D result = *this;
 
@@ -1100,14 +1135,14 @@ const Field3D Field3D::operator-() const
   return result;
 }
 
-const Field3D Field3D::operator-(const Field3D &other) const
+Field3D Field3D::operator-(const Field3D &other) const
 {
   Field3D result = *this;
   result -= other;
   return(result);
 }
 
-const Field3D Field3D::operator-(const Field2D &other) const
+Field3D Field3D::operator-(const Field2D &other) const
 {
   Field3D result = *this;
   result -= other;
@@ -1134,7 +1169,7 @@ const FieldPerp Field3D::operator-(const FieldPerp &other) const
   return(result);
 }
 
-const Field3D Field3D::operator-(const real &rhs) const
+Field3D Field3D::operator-(const real &rhs) const
 {
   Field3D result = *this;
   result -= rhs;
@@ -1143,14 +1178,14 @@ const Field3D Field3D::operator-(const real &rhs) const
 
 ///////////////// MULTIPLICATION ///////////////
 
-const Field3D Field3D::operator*(const Field3D &other) const
+Field3D Field3D::operator*(const Field3D &other) const
 {
   Field3D result = *this;
   result *= other;
   return(result);
 }
 
-const Field3D Field3D::operator*(const Field2D &other) const
+Field3D Field3D::operator*(const Field2D &other) const
 {
   Field3D result = *this;
   result *= other;
@@ -1164,7 +1199,7 @@ const FieldPerp Field3D::operator*(const FieldPerp &other) const
   return(result);
 }
 
-const Field3D Field3D::operator*(const real rhs) const
+Field3D Field3D::operator*(const real rhs) const
 {
   Field3D result = *this;
   result *= rhs;
@@ -1173,14 +1208,14 @@ const Field3D Field3D::operator*(const real rhs) const
 
 //////////////////// DIVISION ////////////////////
 
-const Field3D Field3D::operator/(const Field3D &other) const
+Field3D Field3D::operator/(const Field3D &other) const
 {
   Field3D result = *this;
   result /= other;
   return(result);
 }
 
-const Field3D Field3D::operator/(const Field2D &other) const
+Field3D Field3D::operator/(const Field2D &other) const
 {
   Field3D result = *this;
   result /= other;
@@ -1211,7 +1246,7 @@ const FieldPerp Field3D::operator/(const FieldPerp &other) const
   return(result);
 }
 
-const Field3D Field3D::operator/(const real rhs) const
+Field3D Field3D::operator/(const real rhs) const
 {
   Field3D result = *this;
   result /= rhs;
@@ -1220,14 +1255,14 @@ const Field3D Field3D::operator/(const real rhs) const
 
 ////////////// EXPONENTIATION /////////////////
 
-const Field3D Field3D::operator^(const Field3D &other) const
+Field3D Field3D::operator^(const Field3D &other) const
 {
   Field3D result = *this;
   result ^= other;
   return(result);
 }
 
-const Field3D Field3D::operator^(const Field2D &other) const
+Field3D Field3D::operator^(const Field2D &other) const
 {
   Field3D result = *this;
   result ^= other;
@@ -1258,7 +1293,7 @@ const FieldPerp Field3D::operator^(const FieldPerp &other) const
   return(result);
 }
 
-const Field3D Field3D::operator^(const real rhs) const
+Field3D Field3D::operator^(const real rhs) const
 {
   Field3D result = *this;
   result ^= rhs;
@@ -1541,8 +1576,6 @@ real Field3D::interp_z(int jx, int jy, int jz0, real zoffset, int order) const
 void Field3D::ShiftZ(int jx, int jy, double zangle)
 {
   static dcomplex *v = (dcomplex*) NULL;
-  int jz;
-  real kwave;
   
 #ifdef CHECK
   // Check data set
@@ -1565,17 +1598,14 @@ void Field3D::ShiftZ(int jx, int jy, double zangle)
   rfft(block->data[jx][jy], ncz, v); // Forward FFT
 
   // Apply phase shift
-  for(jz=1;jz<=ncz/2;jz++) {
-    kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
-    v[jz] *= dcomplex(cos(kwave*zangle) , -sin(kwave*zangle));
-  }
+  cmul(v, zshift_phase(zangle), ncz/2+1);
 
   irfft(v, ncz, block->data[jx][jy]); // Reverse FFT
 
   block->data[jx][jy][ncz] = block->data[jx][jy][0];
 }
 
-const Field3D Field3D::ShiftZ(const Field2D zangle) const
+Field3D Field3D::ShiftZ(const Field2D zangle) const
 {
   Field3D result;
   int jx, jy;
@@ -1600,7 +1630,7 @@ const Field3D Field3D::ShiftZ(const Field2D zangle) const
   return result;
 }
 
-const Field3D Field3D::ShiftZ(const real zangle) const
+Field3D Field3D::ShiftZ(const real zangle) const
 {
   Field3D result;
   int jx, jy;
@@ -1625,7 +1655,7 @@ const Field3D Field3D::ShiftZ(const real zangle) const
   return result;
 }
 
-const Field3D Field3D::ShiftZ(bool toreal) const
+Field3D Field3D::ShiftZ(bool toreal) const
 {
   if(toreal) {
     return ShiftZ(zShift);
@@ -1751,7 +1781,7 @@ const FieldPerp Field3D::Slice(int y) const
  *                      MATH FUNCTIONS
  ***************************************************************/
 
-const Field3D Field3D::Sqrt() const
+Field3D Field3D::Sqrt() const
 {
   int jx, jy, jz;
   Field3D result;
@@ -1781,10 +1811,7 @@ const Field3D Field3D::Sqrt() const
 
   result.Allocate();
 
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++) 
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = sqrt(block->data[jx][jy][jz]);
+  vsqrt(ngx*ngy*ngz, block->data[0][0], result.block->data[0][0]);
 
 #ifdef CHECK
   msg_stack.pop();
@@ -1795,7 +1822,7 @@ const Field3D Field3D::Sqrt() const
   return result;
 }
 
-const Field3D Field3D::Abs() const
+Field3D Field3D::Abs() const
 {
   int jx, jy, jz;
   Field3D result;
@@ -1989,13 +2016,10 @@ bool Field3D::check_data(bool vital) const
     
     int jx, jy, jz;
     
-    for(jx=MXG;jx<ngx-MXG;jx++)
-      for(jy=MYG;jy<ngy-MYG;jy++)
-	for(jz=0;jz<ncz;jz++)
-	  if(!finite(block->data[jx][jy][jz])) {
-	    error("Field3D: Operation on non-finite data at [%d][%d][%d]\n", jx, jy, jz);
-	    return true;
-	  }
+    if(findNonFinite(jx, jy, jz)) {
+      error("Field3D: Operation on non-finite data at [%d][%d][%d]\n", jx, jy, jz);
+      return true;
+    }
   }
     
   return false;
@@ -2009,9 +2033,51 @@ bool Field3D::check_data(bool vital) const
 // GLOBAL VARS
 
 int Field3D::nblocks = 0;
-memblock3d* Field3D::blocklist = NULL;
+int Field3D::nfree = 0;
+int Field3D::peak_blocks = 0;
+int Field3D::recent_peak = 0;
+int Field3D::max_free = -1;
+bool Field3D::huge_pages = false;
 memblock3d* Field3D::free_block = NULL;
 
+/// Allocate data for a block. Same layout as r3tensor, but the data is aligned
+/// and can be backed by huge pages
+static real ***alloc_block_data(bool huge)
+{
+  size_t size = ((size_t) ngx)*ngy*ngz*sizeof(real);
+  size_t align = 64; // Cache line
+#ifdef MADV_HUGEPAGE
+  const size_t HUGE_PAGE = 2*1024*1024;
+  if(huge) {
+    align = HUGE_PAGE;
+    size = ((size + HUGE_PAGE - 1) / HUGE_PAGE) * HUGE_PAGE;
+  }
+#endif
+  
+  void *mem = NULL;
+  if(posix_memalign(&mem, align, size) != 0) {
+    bout_error("Field3D: Could not allocate memory block\n");
+    return NULL; // Not reached: bout_error exits
+  }
+#ifdef MADV_HUGEPAGE
+  // Before the memory is first touched
+  if(huge)
+    madvise(mem, size, MADV_HUGEPAGE);
+#endif
+  
+  real ***t = (real***) malloc(ngx*sizeof(real**));
+  t[0] = (real**) malloc(ngx*ngy*sizeof(real*));
+  t[0][0] = (real*) mem;
+  
+  for(int j=1;j<ngy;j++) t[0][j]=t[0][j-1]+ngz;
+  for(int i=1;i<ngx;i++) {
+    t[i]=t[i-1]+ngy;
+    t[i][0]=t[i-1][0]+ngy*ngz;
+    for(int j=1;j<ngy;j++) t[i][j]=t[i][j-1]+ngz;
+  }
+  return t;
+}
+
 /// Get a new block of data, either from free list or allocate
 memblock3d *Field3D::new_block() const
 {
@@ -2023,25 +2089,73 @@ memblock3d *Field3D::new_block() const
     free_block = nb->next;
     nb->next = NULL;
     nb->refs = 1;
+    nfree--;
   }else {
     // No more blocks left - allocate a new block
     nb = new memblock3d;
 
-    nb->data = r3tensor(ngx, ngy, ngz);
+    nb->data = alloc_block_data(huge_pages);
     nb->refs = 1;
-
-    // add to the global list
-    nb->next = blocklist;
-    blocklist = nb;
+    nb->next = NULL;
 
     nblocks++;
-
-    //output.write("Allocated: %d\n", nblocks);
+  }
+  
+  int inuse = nblocks - nfree;
+  if(inuse > recent_peak) {
+    recent_peak = inuse;
+    if(inuse > peak_blocks)
+      peak_blocks = inuse;
   }
 
   return nb;
 }
 
+void Field3D::release_block(memblock3d *b)
+{
+  free(b->data[0][0]);
+  free(b->data[0]);
+  free(b->data);
+  delete b;
+  nblocks--;
+}
+
+void Field3D::poolInit()
+{
+  options.setSection("memory");
+  options.get("max_free_blocks", max_free, -1);
+  options.get("huge_pages", huge_pages, false);
+#ifndef MADV_HUGEPAGE
+  if(huge_pages)
+    output.write("\tWARNING: Huge pages not supported on this system\n");
+#endif
+}
+
+/// Frees blocks which weren't needed since the last call. Blocks used
+/// every timestep are kept, but a rare large expression doesn't fix
+/// the memory used for the rest of the run
+void Field3D::poolTrim()
+{
+  int inuse = nblocks - nfree;
+  int keep = recent_peak - inuse;
+  if((max_free >= 0) && (keep > max_free))
+    keep = max_free;
+  
+  while(nfree > keep) {
+    memblock3d *b = free_block;
+    free_block = b->next;
+    nfree--;
+    release_block(b);
+  }
+  recent_peak = inuse;
+}
+
+void Field3D::poolStats()
+{
+  real mb = ((real) ngx*ngy*ngz*sizeof(real)) / (1024.*1024.);
+  output.write("Field3D blocks: %d in use, %d free, peak %d (%.1f Mb)\n",
+	       nblocks - nfree, nfree, peak_blocks, peak_blocks*mb);
+}
 
 /// Makes sure data is allocated and only referenced by this object
 void Field3D::alloc_data() const
@@ -2056,10 +2170,8 @@ void Field3D::alloc_data() const
 
       memblock3d* nb = new_block();
 
-      for(int jx=0;jx<ngx;jx++)
-	for(int jy=0;jy<ngy;jy++)
-	  for(int jz=0;jz<ngz;jz++)
-	    nb->data[jx][jy][jz] = block->data[jx][jy][jz];
+      // Blocks are contiguous
+      memcpy(nb->data[0][0], block->data[0][0], sizeof(real)*ngx*ngy*ngz);
 
       block->refs--;
       block = nb;
@@ -2082,10 +2194,15 @@ void Field3D::free_data()
   block->refs--;
 
   if(block->refs == 0) {
-    // No more references to this data - put on free list
-
-    block->next = free_block;
-    free_block = block;
+    // No more references to this data - put on free list, unless full
+    
+    if((max_free >= 0) && (nfree >= max_free)) {
+      release_block(block);
+    }else {
+      block->next = free_block;
+      free_block = block;
+      nfree++;
+    }
   }
 
   block = NULL;
@@ -2095,7 +2212,7 @@ void Field3D::free_data()
  *               NON-MEMBER OVERLOADED OPERATORS
  ***************************************************************/
 
-const Field3D operator-(const real &lhs, const Field3D &rhs)
+Field3D operator-(const real &lhs, const Field3D &rhs)
 {
   Field3D result;
   int jx, jy, jz;
@@ -2116,17 +2233,17 @@ const Field3D operator-(const real &lhs, const Field3D &rhs)
   return result;
 }
 
-const Field3D operator+(const real &lhs, const Field3D &rhs)
+Field3D operator+(const real &lhs, const Field3D &rhs)
 {
   return rhs+lhs;
 }
 
-const Field3D operator*(const real lhs, const Field3D &rhs)
+Field3D operator*(const real lhs, const Field3D &rhs)
 {
   return(rhs * lhs);
 }
 
-const Field3D operator/(const real lhs, const Field3D &rhs)
+Field3D operator/(const real lhs, const Field3D &rhs)
 {
   Field3D result = rhs;
   int jx, jy, jz;
@@ -2153,10 +2270,9 @@ const Field3D operator/(const real lhs, const Field3D &rhs)
   return(result);
 }
 
-const Field3D operator^(const real lhs, const Field3D &rhs)
+Field3D operator^(const real lhs, const Field3D &rhs)
 {
   Field3D result = rhs;
-  int jx, jy, jz;
   real ***d;
 
   d = result.getData();
@@ -2172,24 +2288,214 @@ const Field3D operator^(const real lhs, const Field3D &rhs)
   result.name = "(real^"+rhs.name+")";
 #endif
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	d[jx][jy][jz] = pow(lhs, d[jx][jy][jz]);
+  vpow(ngx*ngy*ngz, lhs, d[0][0], d[0][0]);
 
   result.setLocation( rhs.getLocation() );
 
   return(result);
 }
 
+#if __cplusplus >= 201103L
+/***************************************************************
+ *        OPERATORS ON TEMPORARIES
+ * 
+ * The temporary is modified in place and then moved into the
+ * result, so no new block is needed if it isn't shared.
+ * Addition and multiplication are exactly commutative, so 
+ * can re-use either operand if both are at the same location.
+ ***************************************************************/
+
+Field3D operator-(Field3D &&f)
+{
+  f *= -1.0;
+  return std::move(f);
+}
+
+Field3D operator+(Field3D &&lhs, const Field3D &rhs)
+{
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+Field3D operator+(const Field3D &lhs, Field3D &&rhs)
+{
+  if(lhs.getLocation() != rhs.getLocation())
+    return lhs + rhs; // Result is at the location of lhs
+  
+#ifdef TRACK
+  string name = "(" + lhs.name + "+" + rhs.name + ")";
+#endif
+  rhs += lhs;
+#ifdef TRACK
+  rhs.name = name;
+#endif
+  return std::move(rhs);
+}
+
+Field3D operator+(Field3D &&lhs, Field3D &&rhs)
+{
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+Field3D operator+(Field3D &&lhs, const Field2D &rhs)
+{
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+Field3D operator+(Field3D &&lhs, const real &rhs)
+{
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+Field3D operator+(const real &lhs, Field3D &&rhs)
+{
+  rhs += lhs;
+  return std::move(rhs);
+}
+
+Field3D operator-(Field3D &&lhs, const Field3D &rhs)
+{
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator-(Field3D &&lhs, const Field2D &rhs)
+{
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator-(Field3D &&lhs, const real &rhs)
+{
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator-(const real &lhs, Field3D &&rhs)
+{
+  real ***d = rhs.getData();
+
+#ifdef TRACK
+  rhs.name = "(real-"+rhs.name+")";
+#endif
+
+  for(int jx=0;jx<ngx;jx++)
+    for(int jy=0;jy<ngy;jy++)
+      for(int jz=0;jz<ngz;jz++)
+	d[jx][jy][jz] = lhs - d[jx][jy][jz];
+
+  return std::move(rhs);
+}
+
+Field3D operator*(Field3D &&lhs, const Field3D &rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator*(const Field3D &lhs, Field3D &&rhs)
+{
+  if(lhs.getLocation() != rhs.getLocation())
+    return lhs * rhs; // Result is at the location of lhs
+  
+#ifdef TRACK
+  string name = "(" + lhs.name + "*" + rhs.name + ")";
+#endif
+  rhs *= lhs;
+#ifdef TRACK
+  rhs.name = name;
+#endif
+  return std::move(rhs);
+}
+
+Field3D operator*(Field3D &&lhs, Field3D &&rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator*(Field3D &&lhs, const Field2D &rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator*(Field3D &&lhs, const real rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator*(const real lhs, Field3D &&rhs)
+{
+  rhs *= lhs;
+  return std::move(rhs);
+}
+
+Field3D operator/(Field3D &&lhs, const Field3D &rhs)
+{
+  lhs /= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator/(Field3D &&lhs, const Field2D &rhs)
+{
+  lhs /= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator/(Field3D &&lhs, const real rhs)
+{
+  lhs /= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator/(const real lhs, Field3D &&rhs)
+{
+  real ***d = rhs.getData();
+
+#ifdef TRACK
+  rhs.name = "(real/"+rhs.name+")";
+#endif
+
+  for(int jx=0;jx<ngx;jx++)
+    for(int jy=0;jy<ngy;jy++)
+      for(int jz=0;jz<ngz;jz++)
+	d[jx][jy][jz] = lhs / d[jx][jy][jz];
+
+  return std::move(rhs);
+}
+
+Field3D operator^(Field3D &&lhs, const Field3D &rhs)
+{
+  lhs ^= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator^(Field3D &&lhs, const Field2D &rhs)
+{
+  lhs ^= rhs;
+  return std::move(lhs);
+}
+
+Field3D operator^(Field3D &&lhs, const real rhs)
+{
+  lhs ^= rhs;
+  return std::move(lhs);
+}
+#endif
+
 //////////////// NON-MEMBER FUNCTIONS //////////////////
 
-const Field3D sqrt(const Field3D &f)
+Field3D sqrt(const Field3D &f)
 {
   return f.Sqrt();
 }
 
-const Field3D abs(const Field3D &f)
+Field3D abs(const Field3D &f)
 {
   return f.Abs();
 }
@@ -2206,17 +2512,13 @@ real max(const Field3D &f, bool allpe)
 
 // Friend functions
 
-const Field3D sin(const Field3D &f)
+Field3D sin(const Field3D &f)
 {
   Field3D result;
-  int jx, jy, jz;
   
   result.Allocate();
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = sin(f.block->data[jx][jy][jz]);
+  vsin(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
 
 #ifdef TRACK
   result.name = "sin("+f.name+")";
@@ -2227,17 +2529,13 @@ const Field3D sin(const Field3D &f)
   return result;
 }
 
-const Field3D cos(const Field3D &f)
+Field3D cos(const Field3D &f)
 {
   Field3D result;
-  int jx, jy, jz;
   
   result.Allocate();
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = cos(f.block->data[jx][jy][jz]);
+  vcos(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
 
 #ifdef TRACK
   result.name = "cos("+f.name+")";
@@ -2248,17 +2546,13 @@ const Field3D cos(const Field3D &f)
   return result;
 }
 
-const Field3D tan(const Field3D &f)
+Field3D tan(const Field3D &f)
 {
   Field3D result;
-  int jx, jy, jz;
   
   result.Allocate();
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = tan(f.block->data[jx][jy][jz]);
+  vtan(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
 
 #ifdef TRACK
   result.name = "tan("+f.name+")";
@@ -2269,17 +2563,13 @@ const Field3D tan(const Field3D &f)
   return result;
 }
 
-const Field3D sinh(const Field3D &f)
+Field3D sinh(const Field3D &f)
 {
   Field3D result;
-  int jx, jy, jz;
   
   result.Allocate();
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = sinh(f.block->data[jx][jy][jz]);
+  vsinh(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
 
 #ifdef TRACK
   result.name = "sinh("+f.name+")";
@@ -2290,17 +2580,13 @@ const Field3D sinh(const Field3D &f)
   return result;
 }
 
-const Field3D cosh(const Field3D &f)
+Field3D cosh(const Field3D &f)
 {
   Field3D result;
-  int jx, jy, jz;
   
   result.Allocate();
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = cosh(f.block->data[jx][jy][jz]);
+  vcosh(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
 
 #ifdef TRACK
   result.name = "cosh("+f.name+")";
@@ -2311,17 +2597,13 @@ const Field3D cosh(const Field3D &f)
   return result;
 }
 
-const Field3D tanh(const Field3D &f)
+Field3D tanh(const Field3D &f)
 {
   Field3D result;
-  int jx, jy, jz;
   
   result.Allocate();
   
-  for(jx=0;jx<ngx;jx++)
-    for(jy=0;jy<ngy;jy++)
-      for(jz=0;jz<ngz;jz++)
-	result.block->data[jx][jy][jz] = tanh(f.block->data[jx][jy][jz]);
+  vtanh(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
 
 #ifdef TRACK
   result.name = "tanh("+f.name+")";
@@ -2332,7 +2614,41 @@ const Field3D tanh(const Field3D &f)
   return result;
 }
 
-const Field3D filter(const Field3D &var, int N0)
+Field3D exp(const Field3D &f)
+{
+  Field3D result;
+  
+  result.Allocate();
+  
+  vexp(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
+
+#ifdef TRACK
+  result.name = "exp("+f.name+")";
+#endif
+
+  result.location = f.location;
+
+  return result;
+}
+
+Field3D log(const Field3D &f)
+{
+  Field3D result;
+  
+  result.Allocate();
+  
+  vlog(ngx*ngy*ngz, f.block->data[0][0], result.block->data[0][0]);
+
+#ifdef TRACK
+  result.name = "log("+f.name+")";
+#endif
+
+  result.location = f.location;
+
+  return result;
+}
+
+Field3D filter(const Field3D &var, int N0)
 {
   Field3D result;
   static dcomplex *f = (dcomplex*) NULL;
@@ -2376,7 +2692,7 @@ const Field3D filter(const Field3D &var, int N0)
 // Smooths a field in Fourier space
 // DOESN'T WORK VERY WELL
 /*
-const Field3D smooth(const Field3D &var, real zmax, real xmax)
+Field3D smooth(const Field3D &var, real zmax, real xmax)
 {
   Field3D result;
   static dcomplex **f = NULL, *fx;
@@ -2460,7 +2776,7 @@ const Field3D smooth(const Field3D &var, real zmax, real xmax)
 */
 
 // Fourier filter in z
-const Field3D low_pass(const Field3D &var, int zmax)
+Field3D low_pass(const Field3D &var, int zmax)
 {
   Field3D result;
   static dcomplex *f = NULL;
@@ -2506,7 +2822,7 @@ const Field3D low_pass(const Field3D &var, int zmax)
   return result;
 }
 // Fourier filter in z with zmin
-const Field3D low_pass(const Field3D &var, int zmax, int zmin)
+Field3D low_pass(const Field3D &var, int zmax, int zmin)
 {
   Field3D result;
   static dcomplex *f = NULL;
@@ -2556,6 +2872,19 @@ const Field3D low_pass(const Field3D &var, int zmax, int zmin)
   return result;
 }
 
+bool Field3D::findNonFinite(int &jx, int &jy, int &jz) const
+{
+  if(block == NULL)
+    return false;
+  
+  for(jx=MXG;jx<ngx-MXG;jx++)
+    for(jy=MYG;jy<ngy-MYG;jy++)
+      if((jz = first_nonfinite(block->data[jx][jy], ncz)) >= 0)
+	return true;
+  
+  return false;
+}
+
 bool finite(const Field3D &f)
 {
 #ifdef CHECK
@@ -2571,13 +2900,12 @@ bool finite(const Field3D &f)
   
   for(int jx=0;jx<ngx;jx++)
     for(int jy=0;jy<ngy;jy++)
-      for(int jz=0;jz<ncz;jz++)
-	if(!finite(f.block->data[jx][jy][jz])) {
+      if(first_nonfinite(f.block->data[jx][jy], ncz) >= 0) {
 #ifdef CHECK
-	  msg_stack.pop();
+	msg_stack.pop();
 #endif
-	  return false;
-	}
+	return false;
+      }
 
 #ifdef CHECK
   msg_stack.pop();
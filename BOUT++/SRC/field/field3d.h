@@ -51,6 +51,10 @@ struct memblock3d {
 
   July 2008: Added FieldData virtual functions
   May 2008: Added reference counting to reduce memory copying
+
+  With C++11, temporaries are moved rather than copied, and operators
+  acting on a temporary re-use its memory so that an expression like
+  a*b + c*d - e needs only one new block per product.
  */
 class Field3D : public Field, public FieldData {
  public:
@@ -58,6 +62,10 @@ class Field3D : public Field, public FieldData {
   Field3D();
   /// copy constructor
   Field3D(const Field3D& f);
+#if __cplusplus >= 201103L
+  /// move constructor. Takes the data from f, leaving f empty
+  Field3D(Field3D&& f);
+#endif
   /// Destructor
   ~Field3D();
 
@@ -85,6 +93,9 @@ class Field3D : public Field, public FieldData {
 
   /// Assignment operators
   Field3D & operator=(const Field3D &rhs);
+#if __cplusplus >= 201103L
+  Field3D & operator=(Field3D &&rhs);
+#endif
   Field3D & operator=(const Field2D &rhs);
   Field3D & operator=(const FieldPerp &rhs);
   const bvalue & operator=(const bvalue &val);
@@ -117,32 +128,32 @@ class Field3D : public Field, public FieldData {
   
   // Binary operators
 
-  const Field3D operator+() const;
-  const Field3D operator+(const Field3D &other) const;
-  const Field3D operator+(const Field2D &other) const;
+  Field3D operator+() const;
+  Field3D operator+(const Field3D &other) const;
+  Field3D operator+(const Field2D &other) const;
   const FieldPerp operator+(const FieldPerp &other) const;
-  const Field3D operator+(const real &rhs) const;
+  Field3D operator+(const real &rhs) const;
 
-  const Field3D operator-() const;
-  const Field3D operator-(const Field3D &other) const;
-  const Field3D operator-(const Field2D &other) const;
+  Field3D operator-() const;
+  Field3D operator-(const Field3D &other) const;
+  Field3D operator-(const Field2D &other) const;
   const FieldPerp operator-(const FieldPerp &other) const;
-  const Field3D operator-(const real &rhs) const;
+  Field3D operator-(const real &rhs) const;
 
-  const Field3D operator*(const Field3D &other) const;
-  const Field3D operator*(const Field2D &other) const;
+  Field3D operator*(const Field3D &other) const;
+  Field3D operator*(const Field2D &other) const;
   const FieldPerp operator*(const FieldPerp &other) const;
-  const Field3D operator*(const real rhs) const;
+  Field3D operator*(const real rhs) const;
 
-  const Field3D operator/(const Field3D &other) const;
-  const Field3D operator/(const Field2D &other) const;
+  Field3D operator/(const Field3D &other) const;
+  Field3D operator/(const Field2D &other) const;
   const FieldPerp operator/(const FieldPerp &other) const;
-  const Field3D operator/(const real rhs) const;
+  Field3D operator/(const real rhs) const;
 
-  const Field3D operator^(const Field3D &other) const;
-  const Field3D operator^(const Field2D &other) const;
+  Field3D operator^(const Field3D &other) const;
+  Field3D operator^(const Field2D &other) const;
   const FieldPerp operator^(const FieldPerp &other) const;
-  const Field3D operator^(const real rhs) const;
+  Field3D operator^(const real rhs) const;
 
   // Stencils for differencing
 
@@ -159,10 +170,10 @@ class Field3D : public Field, public FieldData {
   /// Shifts specified points by angle
   void ShiftZ(int jx, int jy, double zangle); 
   /// Shift all points in z by specified angle
-  const Field3D ShiftZ(const Field2D zangle) const; 
-  const Field3D ShiftZ(const real zangle) const;
+  Field3D ShiftZ(const Field2D zangle) const; 
+  Field3D ShiftZ(const real zangle) const;
   /// Shifts to/from real-space (using zShift global variable)
-  const Field3D ShiftZ(bool toreal) const; 
+  Field3D ShiftZ(bool toreal) const; 
   /// virtual function to shift between real and shifted space
   void ShiftToReal(bool toreal) {
     *this = ShiftZ(toreal);
@@ -184,31 +195,37 @@ class Field3D : public Field, public FieldData {
 
   // Functions
   
-  const Field3D Sqrt() const;
-  const Field3D Abs() const;
+  Field3D Sqrt() const;
+  Field3D Abs() const;
   real Min(bool allpe=false) const;
   real Max(bool allpe=false) const;
 
   // Friend operators
-  friend const Field3D operator-(const real &lhs, const Field3D &rhs);
-  friend const Field3D operator+(const real &lhs, const Field3D &rhs);
+  friend Field3D operator-(const real &lhs, const Field3D &rhs);
+  friend Field3D operator+(const real &lhs, const Field3D &rhs);
 
   // Friend functions
   
-  friend const Field3D sin(const Field3D &f);
-  friend const Field3D cos(const Field3D &f);
-  friend const Field3D tan(const Field3D &f);
+  friend Field3D sin(const Field3D &f);
+  friend Field3D cos(const Field3D &f);
+  friend Field3D tan(const Field3D &f);
+
+  friend Field3D sinh(const Field3D &f);
+  friend Field3D cosh(const Field3D &f);
+  friend Field3D tanh(const Field3D &f);
 
-  friend const Field3D sinh(const Field3D &f);
-  friend const Field3D cosh(const Field3D &f);
-  friend const Field3D tanh(const Field3D &f);
+  friend Field3D exp(const Field3D &f);
+  friend Field3D log(const Field3D &f);
 
-  friend const Field3D filter(const Field3D &var, int N0);
-  friend const Field3D low_pass(const Field3D &var, int zmax);
-  friend const Field3D low_pass(const Field3D &var, int zmax, int zmin);
+  friend Field3D filter(const Field3D &var, int N0);
+  friend Field3D low_pass(const Field3D &var, int zmax);
+  friend Field3D low_pass(const Field3D &var, int zmax, int zmin);
 
   friend bool finite(const Field3D &var);
 
+  /// Location of the first NaN or Inf, excluding guard cells. Returns false if none
+  bool findNonFinite(int &jx, int &jy, int &jz) const;
+
   // FieldData virtual functions
   
   bool isReal() const   { return true; }         // Consists of real values
@@ -229,6 +246,12 @@ class Field3D : public Field, public FieldData {
     *this = 0.0;
   }
 
+  /// Memory pool for field data. Blocks are re-used rather than freed,
+  /// up to a limit set in the [memory] options section.
+  static void poolInit();  ///< Read pool options
+  static void poolTrim();  ///< Free blocks which weren't needed since the last trim
+  static void poolStats(); ///< Print number of blocks in use, free and peak
+
 #ifdef CHECK
   bool check_data(bool vital = false) const; ///< Checks if the data is all valid. 
 
@@ -244,15 +267,20 @@ class Field3D : public Field, public FieldData {
   /// Data block for this object
   mutable memblock3d *block;
 
-  /// Number of blocks allocated
-  static int nblocks;
-  /// Linked list of all memory blocks
-  static memblock3d *blocklist;
+  // Pool of memory blocks
+  static int nblocks;     ///< Number of blocks allocated (in use + free)
+  static int nfree;       ///< Number of blocks on the free list
+  static int peak_blocks; ///< Largest number of blocks in use at once
+  static int recent_peak; ///< Largest number in use since the last trim
+  static int max_free;    ///< Maximum number of free blocks kept. < 0 for no limit
+  static bool huge_pages; ///< Request huge pages for new blocks
   /// Linked list of free blocks
   static memblock3d *free_block;
   
   /// Get a new block of data, either from free list or allocate
   memblock3d* new_block() const;
+  /// Return a block's memory to the system
+  static void release_block(memblock3d *b);
   /// Makes sure data is allocated and only referenced by this object
   void alloc_data() const;
   /// Releases the data array, putting onto global stack
@@ -263,13 +291,47 @@ class Field3D : public Field, public FieldData {
 
 // Non-member overloaded operators
 
-const Field3D operator*(const real lhs, const Field3D &rhs);
-const Field3D operator/(const real lhs, const Field3D &rhs);
-const Field3D operator^(const real lhs, const Field3D &rhs);
+Field3D operator*(const real lhs, const Field3D &rhs);
+Field3D operator/(const real lhs, const Field3D &rhs);
+Field3D operator^(const real lhs, const Field3D &rhs);
+
+#if __cplusplus >= 201103L
+// Operators on temporaries, which re-use the temporary's data block
+
+Field3D operator-(Field3D &&f);
+
+Field3D operator+(Field3D &&lhs, const Field3D &rhs);
+Field3D operator+(const Field3D &lhs, Field3D &&rhs);
+Field3D operator+(Field3D &&lhs, Field3D &&rhs);
+Field3D operator+(Field3D &&lhs, const Field2D &rhs);
+Field3D operator+(Field3D &&lhs, const real &rhs);
+Field3D operator+(const real &lhs, Field3D &&rhs);
+
+Field3D operator-(Field3D &&lhs, const Field3D &rhs);
+Field3D operator-(Field3D &&lhs, const Field2D &rhs);
+Field3D operator-(Field3D &&lhs, const real &rhs);
+Field3D operator-(const real &lhs, Field3D &&rhs);
+
+Field3D operator*(Field3D &&lhs, const Field3D &rhs);
+Field3D operator*(const Field3D &lhs, Field3D &&rhs);
+Field3D operator*(Field3D &&lhs, Field3D &&rhs);
+Field3D operator*(Field3D &&lhs, const Field2D &rhs);
+Field3D operator*(Field3D &&lhs, const real rhs);
+Field3D operator*(const real lhs, Field3D &&rhs);
+
+Field3D operator/(Field3D &&lhs, const Field3D &rhs);
+Field3D operator/(Field3D &&lhs, const Field2D &rhs);
+Field3D operator/(Field3D &&lhs, const real rhs);
+Field3D operator/(const real lhs, Field3D &&rhs);
+
+Field3D operator^(Field3D &&lhs, const Field3D &rhs);
+Field3D operator^(Field3D &&lhs, const Field2D &rhs);
+Field3D operator^(Field3D &&lhs, const real rhs);
+#endif
 
 // Non-member functions
-const Field3D sqrt(const Field3D &f);
-const Field3D abs(const Field3D &f);
+Field3D sqrt(const Field3D &f);
+Field3D abs(const Field3D &f);
 real min(const Field3D &f, bool allpe=false);
 real max(const Field3D &f, bool allpe=false);
 
@@ -42,6 +42,13 @@
 
 real Prof1D(real s, real s0, real sMin, real sMax, real sWidth, int nMode, real phase, int opt);
 
+/// Linear mode: unit amplitude for each mode, of a profile shifted by s in Z
+static real linear_amp(int jz, real s)
+{
+  real kwave = (jz/2 + 1)*TWOPI/zlength;
+  return (jz % 2 == 0) ? cos(kwave*s) : sin(kwave*s);
+}
+
 // Initial profile options
 
 bool ShiftInitial; // Shift initial profile? (default true if shifting in X)
@@ -184,6 +191,8 @@ int initial_profile(const char *name, Field3D &var)
 	cx=Prof1D((real) lx, xs_s0, 0., (real) MX, xs_wd, xs_mode, xs_phase, xs_opt);
 	cy=Prof1D((real) ly, ys_s0, 0., (real) nycore, ys_wd, ys_mode, ys_phase, ys_opt);
 	cz=Prof1D((real) jz, zs_s0, 0., (real) (MZ-1), zs_wd, zs_mode, zs_phase, zs_opt);
+	if(linear_nmodes > 0)
+	  cz = linear_amp(jz, 0.0);
 	
 	var[jx][jy][jz] = scale*cx*cy*cz;
 	
@@ -196,11 +205,15 @@ int initial_profile(const char *name, Field3D &var)
 	    // y - i * nycore
 	    cy=Prof1D((real) (ly - i*nycore), ys_s0, 0., (real) nycore, ys_wd, ys_mode, ys_phase, ys_opt);
 	    cz=Prof1D((real) jz + ((real) i)*ShiftAngle[jx]/dz, zs_s0, 0., (real) (MZ-1), zs_wd, zs_mode, zs_phase, zs_opt);
+	    if(linear_nmodes > 0)
+	      cz = linear_amp(jz, ((real) i)*ShiftAngle[jx]);
 	    var[jx][jy][jz] += scale*cx*cy*cz;
 	    
 	    // y + i * nycore
 	    cy=Prof1D((real) (ly + i*nycore), ys_s0, 0., (real) nycore, ys_wd, ys_mode, ys_phase, ys_opt);
 	    cz=Prof1D((real) jz - ((real) i)*ShiftAngle[jx]/dz, zs_s0, 0., (real) (MZ-1), zs_wd, zs_mode, zs_phase, zs_opt);
+	    if(linear_nmodes > 0)
+	      cz = linear_amp(jz, -((real) i)*ShiftAngle[jx]);
 	    var[jx][jy][jz] += scale*cx*cy*cz;
 	  }
 	}
@@ -466,7 +479,7 @@ real Prof1D(real s, real s0, real sMin, real sMax, real sWidth, int nMode, real
   @param[in] n      Mode number. Note that this is mode-number in the domain
   @param[in] phase  Phase shift in units of pi
 */
-const Field3D genZMode(int n, real phase)
+Field3D genZMode(int n, real phase)
 {
   Field3D result;
 
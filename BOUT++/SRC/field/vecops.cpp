@@ -112,7 +112,7 @@ const Field2D Div(const Vector2D &v, CELL_LOC outloc)
   return result;
 }
 
-const Field3D Div(const Vector3D &v, CELL_LOC outloc)
+Field3D Div(const Vector3D &v, CELL_LOC outloc)
 {
   Field3D result;
 
@@ -228,7 +228,7 @@ const Field2D V_dot_Grad(const Vector2D &v, const Field2D &f)
   return result;
 }
 
-const Field3D V_dot_Grad(const Vector2D &v, const Field3D &f)
+Field3D V_dot_Grad(const Vector2D &v, const Field3D &f)
 {
   Field3D result;
   
@@ -249,7 +249,7 @@ const Field3D V_dot_Grad(const Vector2D &v, const Field3D &f)
   return result;
 }
 
-const Field3D V_dot_Grad(const Vector3D &v, const Field2D &f)
+Field3D V_dot_Grad(const Vector3D &v, const Field2D &f)
 {
   Field3D result;
   
@@ -270,7 +270,7 @@ const Field3D V_dot_Grad(const Vector3D &v, const Field2D &f)
   return result;
 }
 
-const Field3D V_dot_Grad(const Vector3D &v, const Field3D &f)
+Field3D V_dot_Grad(const Vector3D &v, const Field3D &f)
 {
   Field3D result;
   
@@ -36,7 +36,7 @@ const Vector2D Grad(const Field2D &f, CELL_LOC outloc = CELL_DEFAULT);
 const Vector3D Grad(const Field3D &f, CELL_LOC outloc = CELL_DEFAULT);
 
 const Field2D Div(const Vector2D &v, CELL_LOC outloc = CELL_DEFAULT);
-const Field3D Div(const Vector3D &v, CELL_LOC outloc = CELL_DEFAULT);
+Field3D Div(const Vector3D &v, CELL_LOC outloc = CELL_DEFAULT);
 
 const Vector2D Curl(const Vector2D &v);
 const Vector3D Curl(const Vector3D &v);
@@ -44,9 +44,9 @@ const Vector3D Curl(const Vector3D &v);
 // Upwinding routines
 
 const Field2D V_dot_Grad(const Vector2D &v, const Field2D &f);
-const Field3D V_dot_Grad(const Vector2D &v, const Field3D &f);
-const Field3D V_dot_Grad(const Vector3D &v, const Field2D &f);
-const Field3D V_dot_Grad(const Vector3D &v, const Field3D &f);
+Field3D V_dot_Grad(const Vector2D &v, const Field3D &f);
+Field3D V_dot_Grad(const Vector3D &v, const Field2D &f);
+Field3D V_dot_Grad(const Vector3D &v, const Field3D &f);
 
 const Vector2D V_dot_Grad(const Vector2D &v, const Vector2D &a);
 const Vector3D V_dot_Grad(const Vector2D &v, const Vector3D &a);
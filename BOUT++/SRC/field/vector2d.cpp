@@ -330,7 +330,7 @@ const Field2D Vector2D::operator*(const Vector2D &rhs) const
   return result;
 }
 
-const Field3D Vector2D::operator*(const Vector3D &rhs) const
+Field3D Vector2D::operator*(const Vector3D &rhs) const
 {
   return rhs*(*this);
 }
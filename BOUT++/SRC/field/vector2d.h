@@ -90,7 +90,7 @@ class Vector2D : public FieldData {
   const Vector3D operator/(const Field3D &rhs) const;
 
   const Field2D operator*(const Vector2D &rhs) const; // Dot product
-  const Field3D operator*(const Vector3D &rhs) const;
+  Field3D operator*(const Vector3D &rhs) const;
 
   const Vector2D operator^(const Vector2D &rhs) const; // Cross product
   const Vector3D operator^(const Vector3D &rhs) const;
@@ -379,7 +379,7 @@ const Vector3D Vector3D::operator/(const Field3D &rhs) const
 
 ////////////////// DOT PRODUCT ///////////////////
 
-const Field3D Vector3D::operator*(const Vector3D &rhs) const
+Field3D Vector3D::operator*(const Vector3D &rhs) const
 {
   Field3D result;
 
@@ -406,7 +406,7 @@ const Field3D Vector3D::operator*(const Vector3D &rhs) const
   return result;
 }
 
-const Field3D Vector3D::operator*(const Vector2D &rhs) const
+Field3D Vector3D::operator*(const Vector2D &rhs) const
 {
   Field3D result;
 
@@ -494,7 +494,7 @@ const Vector3D operator*(const Field3D &lhs, const Vector3D &rhs)
  ***************************************************************/
 
 // Return the magnitude of a vector
-const Field3D abs(const Vector3D &v)
+Field3D abs(const Vector3D &v)
 {
   return sqrt(v*v);
 }
@@ -90,8 +90,8 @@ class Vector3D : public FieldData {
   const Vector3D operator/(const Field2D &rhs) const;
   const Vector3D operator/(const Field3D &rhs) const;
 
-  const Field3D operator*(const Vector3D &rhs) const; // Dot product
-  const Field3D operator*(const Vector2D &rhs) const;
+  Field3D operator*(const Vector3D &rhs) const; // Dot product
+  Field3D operator*(const Vector2D &rhs) const;
   
   const Vector3D operator^(const Vector3D &rhs) const; // Cross product
   const Vector3D operator^(const Vector2D &rhs) const;
@@ -105,7 +105,7 @@ class Vector3D : public FieldData {
   const Vector3D ShiftZ(const real zangle) const;
 
   // Non-member functions
-  friend const Field3D abs(const Vector3D &v);
+  friend Field3D abs(const Vector3D &v);
 
   // FieldData virtual functions
   
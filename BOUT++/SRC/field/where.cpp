@@ -26,7 +26,7 @@
 #include "globals.h"
 #include "where.h"
 
-const Field3D where(const Field2D &test, const Field3D &gt0, const Field3D &le0)
+Field3D where(const Field2D &test, const Field3D &gt0, const Field3D &le0)
 {
   Field3D result;
   
@@ -46,7 +46,7 @@ const Field3D where(const Field2D &test, const Field3D &gt0, const Field3D &le0)
   return result;
 }
 
-const Field3D where(const Field2D &test, const Field3D &gt0, real le0)
+Field3D where(const Field2D &test, const Field3D &gt0, real le0)
 {
   Field3D result;
 
@@ -66,7 +66,7 @@ const Field3D where(const Field2D &test, const Field3D &gt0, real le0)
   return result;
 }
 
-const Field3D where(const Field2D &test, real gt0, const Field3D &le0)
+Field3D where(const Field2D &test, real gt0, const Field3D &le0)
 {
   Field3D result;
 
@@ -86,7 +86,7 @@ const Field3D where(const Field2D &test, real gt0, const Field3D &le0)
   return result;
 }
 
-const Field3D where(const Field2D &test, const Field3D &gt0, const Field2D &le0)
+Field3D where(const Field2D &test, const Field3D &gt0, const Field2D &le0)
 {
   Field3D result;
 
@@ -106,7 +106,7 @@ const Field3D where(const Field2D &test, const Field3D &gt0, const Field2D &le0)
   return result;
 }
 
-const Field3D where(const Field2D &test, const Field2D &gt0, const Field3D &le0)
+Field3D where(const Field2D &test, const Field2D &gt0, const Field3D &le0)
 {
   Field3D result;
 
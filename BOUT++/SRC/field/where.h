@@ -29,11 +29,11 @@
 #include "field3d.h"
 #include "field2d.h"
 
-const Field3D where(const Field2D &test, const Field3D &gt0, const Field3D &le0);
-const Field3D where(const Field2D &test, const Field3D &gt0, real le0);
-const Field3D where(const Field2D &test, real gt0, const Field3D &le0);
-const Field3D where(const Field2D &test, const Field3D &gt0, const Field2D &le0);
-const Field3D where(const Field2D &test, const Field2D &gt0, const Field3D &le0);
+Field3D where(const Field2D &test, const Field3D &gt0, const Field3D &le0);
+Field3D where(const Field2D &test, const Field3D &gt0, real le0);
+Field3D where(const Field2D &test, real gt0, const Field3D &le0);
+Field3D where(const Field2D &test, const Field3D &gt0, const Field2D &le0);
+Field3D where(const Field2D &test, const Field2D &gt0, const Field3D &le0);
 
 #endif // __WHERE_H__
 
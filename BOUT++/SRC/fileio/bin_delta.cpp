@@ -0,0 +1,290 @@
+/**************************************************************************
+ * Incremental (delta) archives of binary restart files
+ *
+ * Delta file layout:
+ *   BinDeltaHeader
+ *   Binary file header block (hdrsize bytes, copied verbatim)
+ *   For each chunk of BIN_DELTA_CHUNK words:
+ *     unsigned int length  (0 if chunk unchanged)
+ *     compressed XOR data
+ *
+ * Compressed data is a sequence of control bytes, one per pair of words,
+ * each followed by the significant bytes of the two words. The low nibble
+ * of the control byte gives the number of significant bytes in the first
+ * word, the high nibble the number in the second.
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#include "bin_delta.h"
+#include "bin_format.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+/// Load word i from a byte array of length nbytes, zero-padding the end
+static uint64_t load_word(const char *p, long i, long nbytes)
+{
+  uint64_t w = 0;
+  long n = nbytes - 8*i;
+  if(n > 8) n = 8;
+  memcpy(&w, p + 8*i, n);
+  return w;
+}
+
+static void store_word(char *p, long i, long nbytes, uint64_t w)
+{
+  long n = nbytes - 8*i;
+  if(n > 8) n = 8;
+  memcpy(p + 8*i, &w, n);
+}
+
+/// Number of significant (non-leading-zero) bytes
+static int sig_bytes(uint64_t w)
+{
+  int n = 0;
+  while(w != 0) {
+    n++;
+    w >>= 8;
+  }
+  return n;
+}
+
+void bin_delta_encode(const char *ref, const char *cur, long nbytes, vector<char> &out)
+{
+  long nwords = (nbytes + 7) / 8;
+
+  uint64_t x[BIN_DELTA_CHUNK];
+
+  for(long c=0; c < nwords; c += BIN_DELTA_CHUNK) {
+    long n = nwords - c;
+    if(n > BIN_DELTA_CHUNK)
+      n = BIN_DELTA_CHUNK;
+
+    // XOR this chunk
+    bool changed = false;
+    for(long i=0;i<n;i++) {
+      x[i] = load_word(ref, c+i, nbytes) ^ load_word(cur, c+i, nbytes);
+      if(x[i] != 0)
+	changed = true;
+    }
+
+    // Reserve space for the length
+    long lenpos = out.size();
+    out.resize(lenpos + sizeof(unsigned int));
+
+    unsigned int len = 0;
+    if(changed) {
+      for(long i=0;i<n;i+=2) {
+	uint64_t w0 = x[i];
+	uint64_t w1 = (i+1 < n) ? x[i+1] : 0;
+	int s0 = sig_bytes(w0);
+	int s1 = sig_bytes(w1);
+
+	out.push_back((char) (s0 | (s1 << 4)));
+	for(int b=0;b<s0;b++)
+	  out.push_back((char) ((w0 >> (8*b)) & 0xFF));
+	for(int b=0;b<s1;b++)
+	  out.push_back((char) ((w1 >> (8*b)) & 0xFF));
+      }
+      len = out.size() - lenpos - sizeof(unsigned int);
+    }
+    memcpy(&out[lenpos], &len, sizeof(unsigned int));
+  }
+}
+
+long bin_delta_decode(const char *in, long insize, char *data, long nbytes)
+{
+  long nwords = (nbytes + 7) / 8;
+  long pos = 0;
+
+  for(long c=0; c < nwords; c += BIN_DELTA_CHUNK) {
+    long n = nwords - c;
+    if(n > BIN_DELTA_CHUNK)
+      n = BIN_DELTA_CHUNK;
+
+    unsigned int len;
+    if(pos + (long) sizeof(unsigned int) > insize)
+      return -1;
+    memcpy(&len, in + pos, sizeof(unsigned int));
+    pos += sizeof(unsigned int);
+
+    if(len == 0)
+      continue; // Unchanged
+
+    if(pos + (long) len > insize)
+      return -1;
+
+    const unsigned char *p = (const unsigned char*) in + pos;
+    const unsigned char *end = p + len;
+
+    for(long i=0;i<n;i+=2) {
+      if(p >= end)
+	return -1;
+      int s[2];
+      s[0] = *p & 0x0F;
+      s[1] = (*p >> 4) & 0x0F;
+      p++;
+
+      for(int k=0;k<2;k++) {
+	if((s[k] > 8) || (p + s[k] > end))
+	  return -1;
+	uint64_t w = 0;
+	for(int b=0;b<s[k];b++)
+	  w |= ((uint64_t) p[b]) << (8*b);
+	p += s[k];
+
+	if(i+k < n)
+	  store_word(data, c+i+k, nbytes, load_word(data, c+i+k, nbytes) ^ w);
+      }
+    }
+    pos += len;
+  }
+  return pos;
+}
+
+bool bin_delta_write(const char *filename, int iteration, int previous,
+		     const char *hdr, long hdrsize,
+		     const char *ref, const char *cur, long datasize)
+{
+  vector<char> delta;
+  bin_delta_encode(ref, cur, datasize, delta);
+
+  BinDeltaHeader dh;
+  memset(&dh, 0, sizeof(BinDeltaHeader));
+  memcpy(dh.magic, BIN_DELTA_MAGIC, 8);
+  dh.version = BIN_DELTA_VERSION;
+  dh.iteration = iteration;
+  dh.previous = previous;
+  dh.hdrsize = hdrsize;
+  dh.datasize = datasize;
+
+  FILE *fp = fopen(filename, "wb");
+  if(fp == NULL)
+    return false;
+
+  bool ok = (fwrite(&dh, sizeof(BinDeltaHeader), 1, fp) == 1) &&
+    (fwrite(hdr, 1, hdrsize, fp) == (size_t) hdrsize);
+  if(ok && !delta.empty())
+    ok = (fwrite(&delta[0], 1, delta.size(), fp) == delta.size());
+
+  if(fclose(fp) != 0)
+    ok = false;
+
+  return ok;
+}
+
+bool bin_write_image(const char *filename, const char *hdr, long hdrsize,
+		     const char *data, long datasize)
+{
+  FILE *fp = fopen(filename, "wb");
+  if(fp == NULL)
+    return false;
+
+  bool ok = (fwrite(hdr, 1, hdrsize, fp) == (size_t) hdrsize);
+  if(ok && (datasize > 0))
+    ok = (fwrite(data, 1, datasize, fp) == (size_t) datasize);
+
+  if(fclose(fp) != 0)
+    ok = false;
+
+  return ok;
+}
+
+/// Read a whole file into memory
+static bool read_file(const char *filename, vector<char> &buffer)
+{
+  FILE *fp = fopen(filename, "rb");
+  if(fp == NULL)
+    return false;
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  buffer.resize(size);
+  bool ok = (size == 0) || (fread(&buffer[0], 1, size, fp) == (size_t) size);
+  fclose(fp);
+
+  return ok;
+}
+
+bool bin_archive_read(const char *dir, int iteration, int pe,
+		      vector<char> &image, long &hdrsize)
+{
+  char filename[512];
+
+  // Full archive?
+  sprintf(filename, "%s/BOUT.restart_%04d.%d.bin", dir, iteration, pe);
+  if(read_file(filename, image)) {
+    if(image.size() < sizeof(BinHeader))
+      return false;
+    BinHeader *hdr = (BinHeader*) &image[0];
+    if(memcmp(hdr->magic, BIN_MAGIC, 8) != 0)
+      return false;
+    hdrsize = hdr->datastart;
+    return true;
+  }
+
+  // Delta archive
+  sprintf(filename, "%s/BOUT.restart_%04d.%d.delta", dir, iteration, pe);
+  vector<char> delta;
+  if(!read_file(filename, delta))
+    return false;
+
+  if(delta.size() < sizeof(BinDeltaHeader))
+    return false;
+
+  BinDeltaHeader dh;
+  memcpy(&dh, &delta[0], sizeof(BinDeltaHeader));
+  if((memcmp(dh.magic, BIN_DELTA_MAGIC, 8) != 0) || (dh.version != BIN_DELTA_VERSION))
+    return false;
+
+  if((dh.previous >= iteration) || (sizeof(BinDeltaHeader) + dh.hdrsize > delta.size()))
+    return false; // Would never terminate, or truncated
+
+  // Reconstruct the previous archive
+  long prevhdr;
+  if(!bin_archive_read(dir, dh.previous, pe, image, prevhdr))
+    return false;
+
+  if((long) image.size() != prevhdr + dh.datasize)
+    return false; // Layout changed; shouldn't happen
+
+  // Replace the header, and apply the difference to the data
+  hdrsize = dh.hdrsize;
+  vector<char> data(image.begin() + prevhdr, image.end());
+
+  long pos = sizeof(BinDeltaHeader) + dh.hdrsize;
+  if(dh.datasize > 0) {
+    if(bin_delta_decode(&delta[pos], delta.size() - pos, &data[0], dh.datasize) < 0)
+      return false;
+  }
+
+  image.resize(hdrsize + dh.datasize);
+  memcpy(&image[0], &delta[sizeof(BinDeltaHeader)], hdrsize);
+  if(dh.datasize > 0)
+    memcpy(&image[hdrsize], &data[0], dh.datasize);
+
+  return true;
+}
@@ -0,0 +1,90 @@
+/*!
+ * \file bin_delta.h
+ *
+ * \brief Incremental (delta) archives of binary restart files
+ *
+ * When archiving restart files (option "archive"), consecutive archives
+ * are usually very similar. Instead of storing a complete copy each time,
+ * a delta file stores the bitwise XOR of the data block with that of the
+ * previous archive, split into chunks. Unchanged chunks cost 4 bytes, and
+ * changed chunks are compressed by dropping the leading zero bytes of
+ * each XOR'd word (which are zero when sign, exponent and leading mantissa
+ * bits are unchanged).
+ *
+ * Archive files are:
+ *   BOUT.restart_<iter>.<pe>.bin    Full (base) archive, a normal binary restart file
+ *   BOUT.restart_<iter>.<pe>.delta  Delta relative to a previous archive
+ *
+ * This code has no dependencies on the rest of BOUT++, so that it can be
+ * used by stand-alone tools (see archiving/restart_rebuild).
+ *
+ * \date   October 2010
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BINDELTA_H__
+#define __BINDELTA_H__
+
+#include <vector>
+
+using std::vector;
+
+/// Identifies a delta file
+const char BIN_DELTA_MAGIC[8] = {'B','O','U','T','D','L','T','\0'};
+const int BIN_DELTA_VERSION = 1;
+
+const int BIN_DELTA_CHUNK = 4096; ///< Number of 8-byte words in each chunk
+
+/// Header at the start of a delta file
+struct BinDeltaHeader {
+  char magic[8];
+  int version;
+  int iteration;  ///< Iteration of this archive
+  int previous;   ///< Iteration of the archive this is relative to
+  int pad;
+  long hdrsize;   ///< Size of the binary file header block which follows
+  long datasize;  ///< Size of the data block in bytes
+};
+
+/// Append the compressed difference between ref and cur to out
+void bin_delta_encode(const char *ref, const char *cur, long nbytes, vector<char> &out);
+
+/// Apply a compressed difference to data (which initially contains the reference)
+/// Returns the number of bytes of input used, or -1 on error
+long bin_delta_decode(const char *in, long insize, char *data, long nbytes);
+
+/// Write a delta file. hdr is the header block of the binary file
+bool bin_delta_write(const char *filename, int iteration, int previous,
+		     const char *hdr, long hdrsize,
+		     const char *ref, const char *cur, long datasize);
+
+/// Write a full binary file from header and data blocks
+bool bin_write_image(const char *filename, const char *hdr, long hdrsize,
+		     const char *data, long datasize);
+
+/// Reconstruct the binary restart file for a given archive iteration
+/// and processor, following the chain of delta files back to a base.
+/// On success, hdrsize is set and image contains header then data blocks
+bool bin_archive_read(const char *dir, int iteration, int pe,
+		      vector<char> &image, long &hdrsize);
+
+#endif // __BINDELTA_H__
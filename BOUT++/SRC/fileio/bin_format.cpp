@@ -0,0 +1,667 @@
+/**************************************************************************
+ * Raw binary file format, used for fast restart files
+ *
+ * File layout:
+ *   BinHeader
+ *   BinEntry x nvars
+ *   (padding to BIN_ALIGN)
+ *   Data block, each variable starting on a BIN_ALIGN boundary
+ *
+ * All data is stored in native byte order. Files are written to a
+ * temporary file then renamed, so a crash during a checkpoint leaves
+ * the previous restart file intact.
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#include "globals.h"
+#include "bin_format.h"
+
+#include "utils.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/// Round up to a multiple of BIN_ALIGN
+static long bin_align(long n)
+{
+  return ((n + BIN_ALIGN - 1) / BIN_ALIGN) * BIN_ALIGN;
+}
+
+/// Size of one element of a given type
+static int bin_typesize(int type)
+{
+  switch(type) {
+  case BIN_INT:   return sizeof(int);
+  case BIN_REAL:  return sizeof(real);
+  case BIN_FLOAT: return sizeof(float);
+  }
+  return 0;
+}
+
+/// Write n bytes at a given offset, handling partial writes
+static bool bin_pwrite(int fd, const char *buf, long n, long offset)
+{
+  while(n > 0) {
+    ssize_t w = pwrite(fd, buf, n, offset);
+    if(w < 0) {
+      if(errno == EINTR)
+	continue;
+      return false;
+    }
+    buf += w;
+    offset += w;
+    n -= w;
+  }
+  return true;
+}
+
+BinFormat::BinFormat()
+{
+  fname = NULL;
+  writing = false;
+  lowPrecision = false;
+  x0 = y0 = z0 = 0;
+
+  fd = -1;
+  mapped = NULL;
+  mapsize = 0;
+
+  wbuffer = NULL;
+  wsize = wcapacity = 0;
+}
+
+BinFormat::BinFormat(const char *name)
+{
+  fname = NULL;
+  writing = false;
+  lowPrecision = false;
+  x0 = y0 = z0 = 0;
+
+  fd = -1;
+  mapped = NULL;
+  mapsize = 0;
+
+  wbuffer = NULL;
+  wsize = wcapacity = 0;
+
+  openr(name);
+}
+
+BinFormat::BinFormat(const string &name)
+{
+  fname = NULL;
+  writing = false;
+  lowPrecision = false;
+  x0 = y0 = z0 = 0;
+
+  fd = -1;
+  mapped = NULL;
+  mapsize = 0;
+
+  wbuffer = NULL;
+  wsize = wcapacity = 0;
+
+  openr(name);
+}
+
+BinFormat::~BinFormat()
+{
+  close();
+  if(wbuffer != NULL)
+    free(wbuffer);
+}
+
+bool BinFormat::openr(const string &name)
+{
+  return openr(name.c_str());
+}
+
+bool BinFormat::openr(const char *name)
+{
+#ifdef CHECK
+  int msg_point = msg_stack.push("BinFormat::openr");
+#endif
+
+  if(is_valid()) // Already open. Close then re-open
+    close();
+
+  if((fd = open(name, O_RDONLY)) < 0) {
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+
+  struct stat st;
+  if((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(BinHeader))) {
+    ::close(fd); fd = -1;
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+  mapsize = st.st_size;
+
+  void *p = mmap(NULL, mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(p == MAP_FAILED) {
+    ::close(fd); fd = -1;
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+  mapped = (char*) p;
+
+  // The whole file is about to be read in order
+  madvise(mapped, mapsize, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+  /// Check the header
+
+  BinHeader *hdr = (BinHeader*) mapped;
+  if(memcmp(hdr->magic, BIN_MAGIC, 8) != 0) {
+    output.write("ERROR: '%s' is not a BOUT++ binary file\n", name);
+    close();
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+  if(hdr->version != BIN_VERSION) {
+    output.write("ERROR: Binary file '%s' has version %d. Expected %d\n",
+		 name, hdr->version, BIN_VERSION);
+    close();
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+  if((hdr->nvars < 0) ||
+     ((long) (sizeof(BinHeader) + hdr->nvars*sizeof(BinEntry)) > hdr->datastart) ||
+     (hdr->datastart + hdr->datasize > mapsize)) {
+    output.write("ERROR: Binary file '%s' is truncated or corrupted\n", name);
+    close();
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+
+  /// Build the index of variables
+
+  BinEntry *ent = (BinEntry*) (mapped + sizeof(BinHeader));
+  for(int i=0;i<hdr->nvars;i++) {
+    if(ent[i].offset + ent[i].nbytes > hdr->datasize) {
+      output.write("WARNING: Variable '%s' in '%s' is truncated. Ignoring\n", ent[i].name, name);
+      continue;
+    }
+    entries[string(ent[i].name)] = ent[i];
+  }
+
+  fname = copy_string(name);
+  writing = false;
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+
+  return true;
+}
+
+bool BinFormat::openw(const string &name, bool append)
+{
+  return openw(name.c_str(), append);
+}
+
+bool BinFormat::openw(const char *name, bool append)
+{
+  if(append) {
+    output.write("ERROR: Binary format cannot append to '%s'. Use for restart files only\n", name);
+    return false;
+  }
+
+  if(is_valid()) // Already open. Close then re-open
+    close();
+
+  fname = copy_string(name);
+  writing = true;
+
+  // Data is collected in wbuffer, then written in close()
+  wentries.clear();
+  wsize = 0;
+
+  return true;
+}
+
+bool BinFormat::is_valid()
+{
+  return writing || (mapped != NULL);
+}
+
+void BinFormat::close()
+{
+  if(writing) {
+    if(!flush())
+      output.write("ERROR: Failed to write binary file '%s'\n", fname);
+    wentries.clear();
+    wsize = 0;
+    writing = false;
+  }
+
+  if(mapped != NULL) {
+    munmap(mapped, mapsize);
+    mapped = NULL;
+    mapsize = 0;
+  }
+  if(fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  entries.clear();
+
+  if(fname != NULL) {
+    free(fname);
+    fname = NULL;
+  }
+}
+
+const vector<int> BinFormat::getSize(const char *var)
+{
+  vector<int> size;
+
+  map<string, BinEntry>::iterator it = entries.find(string(var));
+  if(it == entries.end())
+    return size;
+
+  if(it->second.nd == 0) {
+    size.push_back(1);
+    return size;
+  }
+
+  for(int i=0;i<it->second.nd;i++)
+    size.push_back(it->second.size[i]);
+
+  return size;
+}
+
+const vector<int> BinFormat::getSize(const string &var)
+{
+  return getSize(var.c_str());
+}
+
+bool BinFormat::setOrigin(int x, int y, int z)
+{
+  x0 = x;
+  y0 = y;
+  z0 = z;
+
+  return true;
+}
+
+bool BinFormat::setRecord(int t)
+{
+  // Only one record, so nothing to do
+  return true;
+}
+
+const void* BinFormat::getPointer(const char *name, BinEntry &entry)
+{
+  if(mapped == NULL)
+    return NULL;
+
+  map<string, BinEntry>::iterator it = entries.find(string(name));
+  if(it == entries.end())
+    return NULL;
+
+  entry = it->second;
+
+  BinHeader *hdr = (BinHeader*) mapped;
+  return (const void*) (mapped + hdr->datastart + entry.offset);
+}
+
+const char* BinFormat::getHeaderBlock(long &size)
+{
+  if(mapped == NULL)
+    return NULL;
+
+  size = ((BinHeader*) mapped)->datastart;
+  return mapped;
+}
+
+const char* BinFormat::getDataBlock(long &size)
+{
+  if(mapped == NULL)
+    return NULL;
+
+  BinHeader *hdr = (BinHeader*) mapped;
+  size = hdr->datasize;
+  return mapped + hdr->datastart;
+}
+
+/***************************************************************************
+ * Read / write. All go through readEntry / writeEntry
+ ***************************************************************************/
+
+bool BinFormat::read(int *var, const char *name, int lx, int ly, int lz)
+{
+  return readEntry((void*) var, true, name, lx, ly, lz);
+}
+
+bool BinFormat::read(int *var, const string &name, int lx, int ly, int lz)
+{
+  return read(var, name.c_str(), lx, ly, lz);
+}
+
+bool BinFormat::read(real *var, const char *name, int lx, int ly, int lz)
+{
+  return readEntry((void*) var, false, name, lx, ly, lz);
+}
+
+bool BinFormat::read(real *var, const string &name, int lx, int ly, int lz)
+{
+  return read(var, name.c_str(), lx, ly, lz);
+}
+
+bool BinFormat::write(int *var, const char *name, int lx, int ly, int lz)
+{
+  return writeEntry((void*) var, true, name, lx, ly, lz);
+}
+
+bool BinFormat::write(int *var, const string &name, int lx, int ly, int lz)
+{
+  return write(var, name.c_str(), lx, ly, lz);
+}
+
+bool BinFormat::write(real *var, const char *name, int lx, int ly, int lz)
+{
+  return writeEntry((void*) var, false, name, lx, ly, lz);
+}
+
+bool BinFormat::write(real *var, const string &name, int lx, int ly, int lz)
+{
+  return write(var, name.c_str(), lx, ly, lz);
+}
+
+/***************************************************************************
+ * Record-based (time-dependent) data. Only the latest record is kept
+ ***************************************************************************/
+
+bool BinFormat::read_rec(int *var, const char *name, int lx, int ly, int lz)
+{
+  return read(var, name, lx, ly, lz);
+}
+
+bool BinFormat::read_rec(int *var, const string &name, int lx, int ly, int lz)
+{
+  return read(var, name.c_str(), lx, ly, lz);
+}
+
+bool BinFormat::read_rec(real *var, const char *name, int lx, int ly, int lz)
+{
+  return read(var, name, lx, ly, lz);
+}
+
+bool BinFormat::read_rec(real *var, const string &name, int lx, int ly, int lz)
+{
+  return read(var, name.c_str(), lx, ly, lz);
+}
+
+bool BinFormat::write_rec(int *var, const char *name, int lx, int ly, int lz)
+{
+  return write(var, name, lx, ly, lz);
+}
+
+bool BinFormat::write_rec(int *var, const string &name, int lx, int ly, int lz)
+{
+  return write(var, name.c_str(), lx, ly, lz);
+}
+
+bool BinFormat::write_rec(real *var, const char *name, int lx, int ly, int lz)
+{
+  return write(var, name, lx, ly, lz);
+}
+
+bool BinFormat::write_rec(real *var, const string &name, int lx, int ly, int lz)
+{
+  return write(var, name.c_str(), lx, ly, lz);
+}
+
+/***************************************************************************
+ * Private functions
+ ***************************************************************************/
+
+/// Copy a (sub-)block of a variable out of the mapped file
+bool BinFormat::readEntry(void *var, bool isint, const char *name, int lx, int ly, int lz)
+{
+  if((mapped == NULL) || (name == NULL))
+    return false;
+
+  if((lx < 0) || (ly < 0) || (lz < 0))
+    return false;
+
+  BinEntry ent;
+  const char *data = (const char*) getPointer(name, ent);
+  if(data == NULL)
+    return false;
+
+  // Size of the block stored in the file
+  int sx = (ent.nd > 0) ? ent.size[0] : 1;
+  int sy = (ent.nd > 1) ? ent.size[1] : 1;
+  int sz = (ent.nd > 2) ? ent.size[2] : 1;
+
+  // Size of the block requested
+  int nx = (lx > 0) ? lx : 1;
+  int ny = (ly > 0) ? ly : 1;
+  int nz = (lz > 0) ? lz : 1;
+
+  if((x0 < 0) || (y0 < 0) || (z0 < 0) ||
+     (x0 + nx > sx) || (y0 + ny > sy) || (z0 + nz > sz))
+    return false;
+
+  int *ivar = (int*) var;
+  real *rvar = (real*) var;
+
+  if((!isint) && (ent.type == BIN_REAL) && (nz == sz)) {
+    // Common case (reading whole fields): contiguous in z, so copy (x,y) rows
+    const real *src = (const real*) data;
+    if((ny == sy) && (x0 == 0) && (y0 == 0) && (z0 == 0)) {
+      // Whole block contiguous
+      memcpy(rvar, src, ((long) nx)*ny*nz*sizeof(real));
+    }else {
+      for(int i=0;i<nx;i++)
+	memcpy(rvar + ((long) i)*ny*nz,
+	       src + ((long) (x0+i)*sy + y0)*sz,
+	       ((long) ny)*nz*sizeof(real));
+    }
+    return true;
+  }
+
+  // General case, converting element type
+  for(int i=0;i<nx;i++)
+    for(int j=0;j<ny;j++)
+      for(int k=0;k<nz;k++) {
+	long src = ((long) (x0+i)*sy + (y0+j))*sz + z0+k;
+	long dst = ((long) i*ny + j)*nz + k;
+
+	real val = 0.0;
+	switch(ent.type) {
+	case BIN_INT:   val = (real) ((const int*) data)[src]; break;
+	case BIN_REAL:  val = ((const real*) data)[src]; break;
+	case BIN_FLOAT: val = (real) ((const float*) data)[src]; break;
+	default: return false;
+	}
+
+	if(isint) {
+	  ivar[dst] = ROUND(val);
+	}else
+	  rvar[dst] = val;
+      }
+
+  return true;
+}
+
+/// Add a variable to the write buffer
+bool BinFormat::writeEntry(void *var, bool isint, const char *name, int lx, int ly, int lz)
+{
+  if(!writing || (name == NULL))
+    return false;
+
+  if((lx < 0) || (ly < 0) || (lz < 0))
+    return false;
+
+  if((x0 != 0) || (y0 != 0) || (z0 != 0)) {
+    output.write("ERROR: Binary format can only write whole variables ('%s')\n", name);
+    return false;
+  }
+
+  if(strlen(name) >= BIN_NAMELEN) {
+    output.write("ERROR: Variable name '%s' too long for binary format\n", name);
+    return false;
+  }
+
+  BinEntry ent;
+  memset(&ent, 0, sizeof(BinEntry));
+  strcpy(ent.name, name);
+
+  ent.nd = 0;
+  if(lx != 0) ent.nd = 1;
+  if(ly != 0) ent.nd = 2;
+  if(lz != 0) ent.nd = 3;
+  ent.size[0] = lx;
+  ent.size[1] = ly;
+  ent.size[2] = lz;
+
+  long n = 1;
+  for(int i=0;i<ent.nd;i++)
+    n *= ent.size[i];
+
+  if(isint) {
+    ent.type = BIN_INT;
+  }else
+    ent.type = lowPrecision ? BIN_FLOAT : BIN_REAL;
+
+  ent.offset = bin_align(wsize);
+  ent.nbytes = n * bin_typesize(ent.type);
+
+  // Make sure there's enough space in the buffer
+  if(ent.offset + ent.nbytes > wcapacity) {
+    long newcap = 2*wcapacity;
+    if(newcap < ent.offset + ent.nbytes)
+      newcap = bin_align(ent.offset + ent.nbytes);
+    char *newbuf = (char*) realloc(wbuffer, newcap);
+    if(newbuf == NULL) {
+      output.write("ERROR: Could not allocate %ld bytes for binary file\n", newcap);
+      return false;
+    }
+    wbuffer = newbuf;
+    wcapacity = newcap;
+  }
+
+  // Zero the alignment padding so files are reproducible
+  if(ent.offset > wsize)
+    memset(wbuffer + wsize, 0, ent.offset - wsize);
+
+  char *dest = wbuffer + ent.offset;
+  if(ent.type == BIN_FLOAT) {
+    real *src = (real*) var;
+    float *fdest = (float*) dest;
+    for(long i=0;i<n;i++)
+      fdest[i] = (float) src[i];
+  }else
+    memcpy(dest, var, ent.nbytes);
+
+  wsize = ent.offset + ent.nbytes;
+
+  // Replace any previous entry with the same name
+  for(vector<BinEntry>::iterator it = wentries.begin(); it != wentries.end(); it++) {
+    if(strcmp(it->name, ent.name) == 0) {
+      wentries.erase(it);
+      break;
+    }
+  }
+  wentries.push_back(ent);
+
+  return true;
+}
+
+/// Write header and data block to file
+bool BinFormat::flush()
+{
+#ifdef CHECK
+  int msg_point = msg_stack.push("BinFormat::flush");
+#endif
+
+  int nvars = wentries.size();
+  long hsize = sizeof(BinHeader) + nvars*sizeof(BinEntry);
+  long datastart = bin_align(hsize);
+
+  // Construct the header
+  char *hbuf = (char*) calloc(datastart, 1);
+  BinHeader *hdr = (BinHeader*) hbuf;
+  memcpy(hdr->magic, BIN_MAGIC, 8);
+  hdr->version = BIN_VERSION;
+  hdr->nvars = nvars;
+  hdr->datastart = datastart;
+  hdr->datasize = wsize;
+
+  BinEntry *ent = (BinEntry*) (hbuf + sizeof(BinHeader));
+  for(int i=0;i<nvars;i++)
+    ent[i] = wentries[i];
+
+  // Write to a temporary file, then rename
+  string tmpname = string(fname) + string(".tmp");
+
+  int wfd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(wfd < 0) {
+    free(hbuf);
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return false;
+  }
+
+  bool ok = bin_pwrite(wfd, hbuf, datastart, 0) &&
+    bin_pwrite(wfd, wbuffer, wsize, datastart);
+
+  free(hbuf);
+
+  if(::close(wfd) != 0)
+    ok = false;
+
+  if(ok) {
+    ok = (rename(tmpname.c_str(), fname) == 0);
+  }else
+    unlink(tmpname.c_str());
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+
+  return ok;
+}
@@ -0,0 +1,164 @@
+/*!
+ * \file bin_format.h
+ *
+ * \brief Raw binary data format, used for fast restart files
+ *
+ * Each file consists of a small header followed by the data for
+ * every variable, stored contiguously at a fixed offset. Files are
+ * written with a single pwrite of the data block, and read by
+ * mapping the file into memory (mmap) and copying straight out of the
+ * mapped pages. Only one record (the latest) is stored, so this format
+ * is intended for restart files (restart_format = "bin") rather than
+ * dump files.
+ *
+ * \date   October 2010
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+class BinFormat;
+
+#ifndef __BINFORMAT_H__
+#define __BINFORMAT_H__
+
+#include "dataformat.h"
+
+#include <map>
+#include <string>
+
+using std::string;
+using std::map;
+
+/// Identifies a BOUT++ binary file. Also used to detect byte-order
+const char BIN_MAGIC[8] = {'B','O','U','T','B','I','N','\0'};
+const int BIN_VERSION = 1;
+
+const int BIN_NAMELEN = 64;   ///< Maximum length of a variable name (incl. '\0')
+const int BIN_ALIGN   = 64;   ///< Data blocks aligned to this many bytes
+
+/// Type codes for variables in the file
+enum BIN_TYPE {BIN_INT = 1, BIN_REAL = 2, BIN_FLOAT = 3};
+
+/// File header, at the start of every file
+struct BinHeader {
+  char magic[8];
+  int version;
+  int nvars;      ///< Number of variable entries following the header
+  long datastart; ///< Offset (bytes) of the start of the data block
+  long datasize;  ///< Size of the data block in bytes
+};
+
+/// One of these per variable, immediately after the header
+struct BinEntry {
+  char name[BIN_NAMELEN];
+  int type;       ///< One of BIN_TYPE
+  int nd;         ///< Number of dimensions (0 for scalars)
+  int size[3];    ///< Size in each dimension
+  int pad;
+  long offset;    ///< Offset from start of data block (bytes)
+  long nbytes;    ///< Size of the data (bytes)
+};
+
+class BinFormat : public DataFormat {
+ public:
+  BinFormat();
+  BinFormat(const char *name);
+  BinFormat(const string &name);
+  ~BinFormat();
+
+  bool openr(const string &name);
+  bool openr(const char *name);
+  bool openw(const string &name, bool append=false);
+  bool openw(const char *name, bool append=false);
+
+  bool is_valid();
+
+  void close();
+
+  const char* filename() { return fname; };
+
+  const vector<int> getSize(const char *var);
+  const vector<int> getSize(const string &var);
+
+  // Set the origin for all subsequent calls
+  bool setOrigin(int x = 0, int y = 0, int z = 0);
+  bool setRecord(int t); // Ignored: only one record stored
+
+  // Read / Write simple variables up to 3D
+
+  bool read(int *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  bool read(int *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+  bool read(real *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  bool read(real *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+
+  bool write(int *var, const char *name, int lx = 0, int ly = 0, int lz = 0);
+  bool write(int *var, const string &name, int lx = 0, int ly = 0, int lz = 0);
+  bool write(real *var, const char *name, int lx = 0, int ly = 0, int lz = 0);
+  bool write(real *var, const string &name, int lx = 0, int ly = 0, int lz = 0);
+
+  // Read / Write record-based variables. Only the latest record is stored
+
+  bool read_rec(int *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  bool read_rec(int *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+  bool read_rec(real *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  bool read_rec(real *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+
+  bool write_rec(int *var, const char *name, int lx = 0, int ly = 0, int lz = 0);
+  bool write_rec(int *var, const string &name, int lx = 0, int ly = 0, int lz = 0);
+  bool write_rec(real *var, const char *name, int lx = 0, int ly = 0, int lz = 0);
+  bool write_rec(real *var, const string &name, int lx = 0, int ly = 0, int lz = 0);
+
+  void setLowPrecision() { lowPrecision = true; }
+
+  /// Pointer to the raw (mapped) data of a variable, or NULL if not found.
+  /// Only valid until close() is called
+  const void* getPointer(const char *name, BinEntry &entry);
+
+  /// Raw header and data blocks of the file opened for reading
+  const char* getHeaderBlock(long &size);
+  const char* getDataBlock(long &size);
+
+ private:
+  char *fname; ///< Current file name
+
+  bool writing;  ///< File is open for writing
+  bool lowPrecision; ///< When writing, down-convert to floats
+
+  int x0, y0, z0; ///< Data origins
+
+  // Reading: whole file is mapped into memory
+  int fd;           ///< File descriptor
+  char *mapped;     ///< Start of mapped file (NULL if not mapped)
+  long mapsize;     ///< Size of the mapping
+  map<string, BinEntry> entries; ///< Variables in the file
+
+  // Writing: data collected here then written on close()
+  vector<BinEntry> wentries;
+  char *wbuffer;    ///< Data block. Kept between files to avoid reallocating
+  long wsize;       ///< Size of data currently in wbuffer
+  long wcapacity;   ///< Allocated size of wbuffer
+
+  bool readEntry(void *var, bool isint, const char *name, int lx, int ly, int lz);
+  bool writeEntry(void *var, bool isint, const char *name, int lx, int ly, int lz);
+  bool flush(); ///< Write the collected data to file
+};
+
+#endif // __BINFORMAT_H__
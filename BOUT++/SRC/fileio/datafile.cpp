@@ -40,6 +40,7 @@
 #undef DATAFILE_ORIGIN
 
 #include "globals.h"
+#include "profile.h"
 
 #ifdef PDBF
 #include "pdb_format.h"
@@ -49,6 +50,8 @@
 #include "nc_format.h"
 #endif
 
+#include "bin_format.h"
+
 #include <string.h>
 
 // Define a default file extension
@@ -123,6 +126,12 @@ DataFormat *data_format(const char *filename)
   }
 #endif
 
+  const char *bin_match[] = {"bin"};
+  if(match_string(s, 1, bin_match) != -1) {
+    output.write("\tUsing binary format for file '%s'\n", filename);
+    return new BinFormat;
+  }
+
   output.write("\tFile extension not recognised for '%s'\n", filename);
   // Set to the default
   return data_format(NULL);
@@ -246,6 +255,7 @@ int Datafile::read(const char *format, ...)
 
   // Record starting time
   real tstart = MPI_Wtime();
+  PROFILE_REGION("I/O read");
   
   // Open the file
   
@@ -389,6 +399,7 @@ bool Datafile::write(const string &filename, bool append)
   
   // Record starting time
   real tstart = MPI_Wtime();
+  PROFILE_REGION("I/O write");
 
   if(!file->openw(filename, append))
     return false;
@@ -36,7 +36,17 @@ void ZFFT(dcomplex *cv, real zoffset, int isign, bool shift = true);
 void rfft(real *in, int length, dcomplex *out);
 void irfft(dcomplex *in, int length, real *out);
 
+// Batches of real FFTs. Arrays are consecutive, each of length (real)
+// or length/2+1 (complex). irfft_many overwrites its input
+
+void rfft_many(real *in, int length, int howmany, dcomplex *out);
+void irfft_many(dcomplex *in, int length, int howmany, real *out);
+
 void ZFFT(real *in, real zoffset, dcomplex *cv, bool shift = true);
 void ZFFT_rev(dcomplex *cv, real zoffset, real *out, bool shift = true);
 
+/// Phase factors exp(-i k zoffset) for k = 0 ... ncz/2 (k = jz*2pi/zlength).
+/// Tables are cached, so repeated calls with the same offset (e.g. zShift) are fast
+const dcomplex* zshift_phase(real zoffset);
+
 #endif // __FFT_H__
@@ -27,10 +27,13 @@
 
 #include "globals.h"
 #include "fft.h"
+#include "profile.h"
 
 #include <fftw3.h>
 #include <math.h>
 
+#include <map>
+
 bool fft_options = false;
 bool fft_measure;
 
@@ -44,8 +47,40 @@ void fft_init()
   fft_options = true;
 }
 
+/// dcomplex has the same layout as fftw_complex, so arrays can be passed
+/// straight to FFTW if they have the same SIMD alignment as the arrays
+/// the plan was made with. Otherwise the data is copied.
+static inline bool fft_aligned(void *a, void *b)
+{
+  return fftw_alignment_of((double*) a) == fftw_alignment_of((double*) b);
+}
+
+/// In linear mode (linear_nmodes > 0) a Z pencil of ncz reals holds the
+/// (Re, Im) amplitudes of modes 1 ... ncz/2, so Z "transforms" just
+/// repack the data. Mode 0 is always zero
+static inline bool fft_linear(int length)
+{
+  return (linear_nmodes > 0) && (length == ncz);
+}
+
+static void linear_unpack(const real *in, int length, dcomplex *out)
+{
+  out[0] = 0.0;
+  for(int m=0;m<length/2;m++)
+    out[m+1] = dcomplex(in[2*m], in[2*m+1]);
+}
+
+static void linear_pack(const dcomplex *in, int length, real *out)
+{
+  for(int m=0;m<length/2;m++) {
+    out[2*m]   = in[m+1].Real();
+    out[2*m+1] = in[m+1].Imag();
+  }
+}
+
 void cfft(dcomplex *cv, int length, int isign)
 {
+  PROFILE_REGION("FFT");
   static fftw_complex *in, *out;
   static fftw_plan pf, pb;
   static int n = 0;
@@ -73,52 +108,97 @@ void cfft(dcomplex *cv, int length, int isign)
     n = length;
   }
 
-  // Load input data
-  for(int i=0;i<n;i++) {
-    in[i][0] = cv[i].Real();
-    in[i][1] = cv[i].Imag();
+  fftw_plan p = (isign < 0) ? pf : pb;
+  
+  if(fft_aligned(cv, in)) {
+    // Input read directly from cv (which is overwritten anyway)
+    fftw_execute_dft(p, (fftw_complex*) cv, out);
+  }else {
+    // Load input data
+    for(int i=0;i<n;i++) {
+      in[i][0] = cv[i].Real();
+      in[i][1] = cv[i].Imag();
+    }
+    fftw_execute(p);
   }
   
+  dcomplex *result = (dcomplex*) out;
   if(isign < 0) {
     // Forward transform
-    fftw_execute(pf);
+    // Normalise. Lengths here aren't always powers of 2, where multiplying
+    // by 1/n would add a rounding error, so divide
     for(int i=0;i<n;i++)
-      cv[i] = dcomplex(out[i][0], out[i][1]) / ((double) n); // Normalise
+      cv[i] = result[i] / ((double) n);
   }else {
     // Backward
-    fftw_execute(pb);
     for(int i=0;i<n;i++)
-      cv[i] = dcomplex(out[i][0], out[i][1]);
+      cv[i] = result[i];
   }
 }
 
+/***********************************************************
+ * Phase tables
+ * 
+ * Shifts in Z are by fixed angles (zShift, ShiftAngle, half a
+ * cell for staggered grids), so the phase factors are calculated
+ * once and kept, indexed by angle
+ ***********************************************************/
+
+/// Maximum number of tables kept. Enough for one per grid point
+/// plus a few extra. Beyond this tables are calculated each call
+#define PHASE_TABLE_MAX (4*ngx*ngy + 16)
+
+const dcomplex* zshift_phase(real zoffset)
+{
+  static std::map<real, dcomplex*> tables;
+  static dcomplex *scratch = (dcomplex*) NULL;
+  
+  std::map<real, dcomplex*>::iterator it = tables.find(zoffset);
+  if(it != tables.end())
+    return it->second;
+
+  dcomplex *phs;
+  if(((int) tables.size()) < PHASE_TABLE_MAX) {
+    phs = new dcomplex[ncz/2 + 1];
+    tables[zoffset] = phs;
+  }else {
+    if(scratch == (dcomplex*) NULL)
+      scratch = new dcomplex[ncz/2 + 1];
+    phs = scratch;
+  }
+
+  for(int jz=0;jz<=ncz/2;jz++) {
+    real kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
+    phs[jz] = dcomplex(cos(kwave*zoffset) , -sin(kwave*zoffset));
+  }
+
+  return phs;
+}
+
 void ZFFT(dcomplex *cv, real zoffset, int isign, bool shift)
 {
-  int jz, ikz;
-  real kwave;
-  
-  if((isign > 0) && (ShiftXderivs) && shift) {
-    // Reverse FFT
-    for(jz=0;jz<ncz;jz++) {
-      if (jz <= ncz/2) ikz=jz; else ikz=jz-ncz;
-      kwave=ikz*2.0*PI/zlength; // wave number is 1/[rad]
-      
-      // Multiply by EXP(ik*zoffset)
-      cv[jz] *= dcomplex(cos(kwave*zoffset) , sin(kwave*zoffset));
-    }
+  int jz;
+  const dcomplex *phs = (dcomplex*) NULL;
+  
+  if((ShiftXderivs) && shift)
+    phs = zshift_phase(zoffset);
+  
+  // Negative frequencies jz-ncz have phase conj(phs[ncz-jz])
+  
+  if((isign > 0) && (phs != NULL)) {
+    // Reverse FFT. Multiply by EXP(ik*zoffset)
+    cmulconj(cv, phs, ncz/2+1);
+    for(jz=ncz/2+1;jz<ncz;jz++)
+      cv[jz] *= phs[ncz-jz];
   }
 
   cfft(cv, ncz, isign);
 
-  if((isign < 0) && (ShiftXderivs) && shift) {
-    // Forward FFT
-    for(jz=0;jz<ncz;jz++) {
-      if (jz <= ncz/2) ikz=jz; else ikz=jz-ncz;
-      kwave=ikz*2.0*PI/zlength; // wave number is 1/[rad]
-      
-      // Multiply by EXP(-ik*zoffset)
-      cv[jz] *= dcomplex(cos(kwave*zoffset) , -sin(kwave*zoffset));
-    }
+  if((isign < 0) && (phs != NULL)) {
+    // Forward FFT. Multiply by EXP(-ik*zoffset)
+    cmul(cv, phs, ncz/2+1);
+    for(jz=ncz/2+1;jz<ncz;jz++)
+      cv[jz] *= conj(phs[ncz-jz]);
   }
 }
 /***********************************************************
@@ -127,6 +207,11 @@ void ZFFT(dcomplex *cv, real zoffset, int isign, bool shift)
 
 void rfft(real *in, int length, dcomplex *out)
 {
+  PROFILE_REGION("FFT");
+  if(fft_linear(length)) {
+    linear_unpack(in, length, out);
+    return;
+  }
   static double *fin;
   static fftw_complex *fout;
   static fftw_plan p;
@@ -153,17 +238,33 @@ void rfft(real *in, int length, dcomplex *out)
     n = length;
   }
   
+  real fac = 1.0 / ((double) n); // Normalise. Exact if n is a power of 2, else one extra rounding
+  
+  if(fft_aligned(in, fin) && fft_aligned(out, fout)) {
+    // Transform straight into out. Input is preserved by r2c plans
+    fftw_execute_dft_r2c(p, in, (fftw_complex*) out);
+    for(int i=0;i<(n/2)+1;i++)
+      out[i] *= fac;
+    return;
+  }
+  
   for(int i=0;i<n;i++)
     fin[i] = in[i];
   
   fftw_execute(p);
 
+  dcomplex *result = (dcomplex*) fout;
   for(int i=0;i<(n/2)+1;i++)
-    out[i] = dcomplex(fout[i][0], fout[i][1]) / ((double) n); // Normalise
+    out[i] = result[i] * fac;
 }
 
 void irfft(dcomplex *in, int length, real *out)
 {
+  PROFILE_REGION("FFT");
+  if(fft_linear(length)) {
+    linear_pack(in, length, out);
+    return;
+  }
   static fftw_complex *fin;
   static double *fout;
   static fftw_plan p;
@@ -190,47 +291,168 @@ void irfft(dcomplex *in, int length, real *out)
     n = length;
   }
   
+  // c2r transforms destroy their input, so always copy
   for(int i=0;i<(n/2)+1;i++) {
     fin[i][0] = in[i].Real();
     fin[i][1] = in[i].Imag();
   }
   
+  if(fft_aligned(out, fout)) {
+    fftw_execute_dft_c2r(p, fin, out);
+  }else {
+    fftw_execute(p);
+    
+    for(int i=0;i<n;i++)
+      out[i] = fout[i];
+  }
+}
+
+/***********************************************************
+ * Batched real FFTs
+ * 
+ * A plan is kept for each batch size, all using the same 
+ * buffers which are enlarged (and plans remade) if needed
+ ***********************************************************/
+
+void rfft_many(real *in, int length, int howmany, dcomplex *out)
+{
+  PROFILE_REGION("FFT");
+  if(fft_linear(length)) {
+    for(int i=0;i<howmany;i++)
+      linear_unpack(in + i*length, length, out + i*(length/2 + 1));
+    return;
+  }
+  static double *fin;
+  static fftw_complex *fout;
+  static std::map<int, fftw_plan> plans;
+  static int n = 0, nmax = 0;
+  
+  if((length != n) || (howmany > nmax)) {
+    for(std::map<int, fftw_plan>::iterator it = plans.begin(); it != plans.end(); it++)
+      fftw_destroy_plan(it->second);
+    plans.clear();
+    if(nmax > 0) {
+      fftw_free(fin);
+      fftw_free(fout);
+    }
+    
+    fft_init();
+    
+    n = length;
+    nmax = howmany;
+    fin = (double*) fftw_malloc(sizeof(double) * n * nmax);
+    fout = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (n/2 + 1) * nmax);
+  }
+  
+  fftw_plan p;
+  std::map<int, fftw_plan>::iterator it = plans.find(howmany);
+  if(it == plans.end()) {
+    unsigned int flags = FFTW_ESTIMATE;
+    if(fft_measure)
+      flags = FFTW_MEASURE;
+    
+    p = fftw_plan_many_dft_r2c(1, &n, howmany, 
+			       fin, NULL, 1, n, 
+			       fout, NULL, 1, n/2 + 1, flags);
+    plans[howmany] = p;
+  }else
+    p = it->second;
+  
+  int nc = (n/2 + 1) * howmany;
+  real fac = 1.0 / ((double) n); // Normalise. Exact if n is a power of 2, else one extra rounding
+  
+  if(fft_aligned(in, fin) && fft_aligned(out, fout)) {
+    fftw_execute_dft_r2c(p, in, (fftw_complex*) out);
+    for(int i=0;i<nc;i++)
+      out[i] *= fac;
+    return;
+  }
+  
+  for(int i=0;i<n*howmany;i++)
+    fin[i] = in[i];
+  
   fftw_execute(p);
+  
+  dcomplex *result = (dcomplex*) fout;
+  for(int i=0;i<nc;i++)
+    out[i] = result[i] * fac;
+}
 
-  for(int i=0;i<n;i++)
+void irfft_many(dcomplex *in, int length, int howmany, real *out)
+{
+  PROFILE_REGION("FFT");
+  if(fft_linear(length)) {
+    for(int i=0;i<howmany;i++)
+      linear_pack(in + i*(length/2 + 1), length, out + i*length);
+    return;
+  }
+  static fftw_complex *fin;
+  static double *fout;
+  static std::map<int, fftw_plan> plans;
+  static int n = 0, nmax = 0;
+  
+  if((length != n) || (howmany > nmax)) {
+    for(std::map<int, fftw_plan>::iterator it = plans.begin(); it != plans.end(); it++)
+      fftw_destroy_plan(it->second);
+    plans.clear();
+    if(nmax > 0) {
+      fftw_free(fin);
+      fftw_free(fout);
+    }
+    
+    fft_init();
+    
+    n = length;
+    nmax = howmany;
+    fin = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (n/2 + 1) * nmax);
+    fout = (double*) fftw_malloc(sizeof(double) * n * nmax);
+  }
+  
+  fftw_plan p;
+  std::map<int, fftw_plan>::iterator it = plans.find(howmany);
+  if(it == plans.end()) {
+    unsigned int flags = FFTW_ESTIMATE;
+    if(fft_measure)
+      flags = FFTW_MEASURE;
+    
+    p = fftw_plan_many_dft_c2r(1, &n, howmany, 
+			       fin, NULL, 1, n/2 + 1, 
+			       fout, NULL, 1, n, flags);
+    plans[howmany] = p;
+  }else
+    p = it->second;
+  
+  if(fft_aligned(in, fin) && fft_aligned(out, fout)) {
+    // Input is scratch for the caller, so can transform in place
+    fftw_execute_dft_c2r(p, (fftw_complex*) in, out);
+    return;
+  }
+
+  dcomplex *cin = (dcomplex*) fin;
+  for(int i=0;i<(n/2 + 1)*howmany;i++)
+    cin[i] = in[i];
+  
+  fftw_execute(p);
+
+  for(int i=0;i<n*howmany;i++)
     out[i] = fout[i];
 }
 
 void ZFFT(real *in, real zoffset, dcomplex *cv, bool shift)
 {
-  int jz;
-  real kwave;
-
   rfft(in, ncz, cv);
 
   if((ShiftXderivs) && shift) {
-    // Forward FFT
-    for(jz=0;jz<=ncz/2;jz++) {
-      kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
-      
-      // Multiply by EXP(-ik*zoffset)
-      cv[jz] *= dcomplex(cos(kwave*zoffset) , -sin(kwave*zoffset));
-    }
+    // Forward FFT. Multiply by EXP(-ik*zoffset)
+    cmul(cv, zshift_phase(zoffset), ncz/2+1);
   }
 }
 
 void ZFFT_rev(dcomplex *cv, real zoffset, real *out, bool shift)
 {
-  int jz;
-  real kwave;
-  
   if((ShiftXderivs) && shift) {
-    for(jz=0;jz<=ncz/2;jz++) { // Only do positive frequencies
-      kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
-      
-      // Multiply by EXP(ik*zoffset)
-      cv[jz] *= dcomplex(cos(kwave*zoffset) , sin(kwave*zoffset));
-    }
+    // Only do positive frequencies. Multiply by EXP(ik*zoffset)
+    cmulconj(cv, zshift_phase(zoffset), ncz/2+1);
   }
 
   irfft(cv, ncz, out);
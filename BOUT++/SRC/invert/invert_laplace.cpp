@@ -46,6 +46,7 @@
 #include "utils.h"
 #include "dcomplex.h"
 #include "meshtopology.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -95,6 +96,8 @@ int invert_init()
 
   // convert into an integer
   laplace_maxmode = ROUND((1.0 - filter) * ((double) (ncz / 2)));
+  if(linear_nmodes > 0)
+    laplace_maxmode = ncz/2; // Linear mode: solve for every mode kept
 
   options.get("max_mode", laplace_maxmode, laplace_maxmode);
   
@@ -1480,7 +1483,7 @@ int invert_pdd_start(const FieldPerp &b, int flags, const Field2D *a, PDD_data &
 	e[ix] = 0.0;
     }
 
-    dcomplex v0, x0; // Values to be sent to processor i-1
+    dcomplex v0(0.0, 0.0), x0(0.0, 0.0); // Values to be sent to processor i-1
 
     if(PE_XIND == 0) {
       // Domain includes inner boundary
@@ -1587,7 +1590,7 @@ int invert_pdd_continue(PDD_data &data)
      */
     
     for(int kz = 0; kz <= laplace_maxmode; kz++) {
-      dcomplex v0, x0;
+      dcomplex v0(0.0, 0.0), x0(0.0, 0.0);
       
       // Get x and v0 from processor
       x0 = dcomplex(data.rcv[4*kz], data.rcv[4*kz+1]);
@@ -1706,6 +1709,7 @@ int invert_pdd_finish(PDD_data &data, int flags, FieldPerp &x)
 /// Invert FieldPerp 
 int invert_laplace(const FieldPerp &b, FieldPerp &x, int flags, const Field2D *a, const Field2D *c)
 {
+  PROFILE_REGION("invert_laplace");
   if(NXPE == 1) {
     // Just use the serial code
     return invert_laplace_ser(b, x, flags, a, c);
@@ -1747,6 +1751,7 @@ int invert_laplace(const FieldPerp &b, FieldPerp &x, int flags, const Field2D *a
  */
 int invert_laplace(const Field3D &b, Field3D &x, int flags, const Field2D *a, const Field2D *c)
 {
+  PROFILE_REGION("invert_laplace");
   int jy, jy2;
   FieldPerp xperp;
   int ret;
@@ -1842,7 +1847,7 @@ int invert_laplace(const Field3D &b, Field3D &x, int flags, const Field2D *a, co
 
   return 0;
 }
-const Field3D invert_laplace(const Field3D &b, int flags, const Field2D *a, const Field2D *c)
+Field3D invert_laplace(const Field3D &b, int flags, const Field2D *a, const Field2D *c)
 {
   Field3D x;
   
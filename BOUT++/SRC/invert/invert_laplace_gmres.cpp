@@ -1,54 +1,126 @@
+
+#include "globals.h"
 #include "invert_laplace_gmres.h"
 #include "invert_laplace.h"
 
-const Field3D LaplaceGMRES::invert(const Field3D &b, const Field3D &start, int inv_flags, bool precon, Field3D *a, Field3D *c)
+LaplaceGMRES::LaplaceGMRES()
 {
-  flags = inv_flags;
+  initialised = false;
+}
 
-  enable_a = (a != NULL);
-  if(enable_a)
-    a3d = *a;
-  enable_c = (c != NULL);
-  if(enable_c)
-    c3d = *c;
- 
-  Field3D rhs;
-
-  if(precon) {
-    /// Get DC components for preconditioner
-    aptr = cptr = NULL;
-    if(enable_a) {
-      a2d = a3d.DC();
-      aptr = &a2d;
-    }
-    if(enable_c) {
-      c2d = c3d.DC();
-      cptr = &c2d;
+Field3D LaplaceGMRES::invert(const Field3D &b, const Field3D &start, int inv_flags, bool precon, Field3D *a, Field3D *c)
+{
+#ifdef CHECK
+  int msg_point = msg_stack.push("LaplaceGMRES::invert");
+#endif
+
+  if(!initialised) {
+    options.setSection("laplace");
+    options.get("gmres_restart", restart, 10);
+    options.get("gmres_maxits",  itmax,   100);
+    options.get("gmres_tol",     tol,     1.e-7);
+    initialised = true;
+  }
+
+  flags = inv_flags;
+  enable_precon = precon;
+  
+  mg.setCoefs(a, c);
+  
+  if(NXPE > 1) {
+    // GMRES in Inverter is serial in X
+    static bool warned = false;
+    if(!warned) {
+      output.write("WARNING: LaplaceGMRES only serial in X. Using multigrid solver\n");
+      warned = true;
     }
-    
-    // Need to apply preconditioner to rhs
-    rhs = invert_laplace(b, flags, aptr, cptr);
-  }else
+    Field3D result;
+    if(start.isAllocated())
+      result = start;
+    mg.solve(b, result, flags);
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return result;
+  }
+
+  // Work in real space, as the coefficients in mg are
+  Field3D rhs, result;
+  if(ShiftXderivs) {
+    rhs = b.ShiftZ(true);
+    if(start.isAllocated())
+      result = start.ShiftZ(true);
+  }else {
     rhs = b;
+    if(start.isAllocated())
+      result = start;
+  }
+  if(!result.isAllocated())
+    result = 0.0;
   
-  int restart=10;
-  int itmax=100;
-  real tol=1.e-7;
+  // Right preconditioning doesn't change boundary rows, so the
+  // starting value must satisfy the boundary conditions
+  int xbndry = MXG;
+  if(flags & INVERT_BNDRY_ONE)
+    xbndry = 1;
+  
+  for(int jy=0;jy<ngy;jy++) {
+    for(int jx=0;jx<xbndry;jx++)
+      for(int jz=0;jz<ncz;jz++) {
+	if(flags & INVERT_IN_SET) {
+	  rhs[jx][jy][jz] = result[jx][jy][jz];
+	}else {
+	  rhs[jx][jy][jz] = 0.0;
+	  if(flags & INVERT_AC_IN_GRAD) {
+	    result[jx][jy][jz] = result[xbndry][jy][jz];
+	  }else
+	    result[jx][jy][jz] = 0.0;
+	}
+      }
+    for(int jx=ngx-xbndry;jx<ngx;jx++)
+      for(int jz=0;jz<ncz;jz++) {
+	if(flags & INVERT_OUT_SET) {
+	  rhs[jx][jy][jz] = result[jx][jy][jz];
+	}else {
+	  rhs[jx][jy][jz] = 0.0;
+	  if(flags & INVERT_AC_OUT_GRAD) {
+	    result[jx][jy][jz] = result[ngx-1-xbndry][jy][jz];
+	  }else
+	    result[jx][jy][jz] = 0.0;
+	}
+      }
+    // Periodic point
+    for(int jx=0;jx<ngx;jx++) {
+      rhs[jx][jy][ncz] = 0.0;
+      result[jx][jy][ncz] = result[jx][jy][0];
+    }
+  }
   
   // Call the solver
-  Field3D result;
-  result = start;
-  int status =  solve(rhs, result,
-		      flags, 
-		      restart, itmax, tol);
+  int status = solve(rhs, result,
+		     flags, 
+		     restart, itmax, tol);
+  if(status)
+    output.write("WARNING: LaplaceGMRES failed to converge\n");
+
+  if(ShiftXderivs)
+    result = result.ShiftZ(false);
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+  
   return result;
 }
 
 const FieldPerp LaplaceGMRES::function(const FieldPerp &x)
+{
+  return mg.apply(x, flags);
+}
+
+const FieldPerp LaplaceGMRES::precon(const FieldPerp &x)
 {
   FieldPerp result;
-  
-  //result = Delp2(x); // Need to add this function
-  
-  return x;
+  mg.vcycle(x, result, flags, 1);
+  return result;
 }
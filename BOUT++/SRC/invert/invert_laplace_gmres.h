@@ -9,10 +9,14 @@
  * i.e. this solver does not need to make the Boussinesq approximation for
  * vorticity equation inversion.
  *
- * Optionally uses invert_laplace method as a preconditioner
+ * Optionally uses a multigrid V-cycle (invert_laplace_mg) as a preconditioner
  * 
  * Changelog: 
  *
+ * 2010-10
+ *    * Operator implemented using LaplaceMultigrid, which is also
+ *      used as the preconditioner
+ *
  * 2010-05-04 Ben Dudson <bd512@york.ac.uk>
  *    * Initial version
  *
@@ -42,25 +46,29 @@
 #define __INVERT_LAP_GMRES_H__
 
 #include "inverter.h"
+#include "invert_laplace_mg.h"
 
 class LaplaceGMRES : public Inverter {
  public:
+  LaplaceGMRES();
+  
   /// Main solver function. Pass NULL to omit terms
-  const Field3D invert(const Field3D &b, const Field3D &start, int inv_flags, bool precon=true, Field3D *a=NULL, Field3D *c=NULL);
+  Field3D invert(const Field3D &b, const Field3D &start, int inv_flags, bool precon=true, Field3D *a=NULL, Field3D *c=NULL);
   
   /// Implement the function to be inverted
   const FieldPerp function(const FieldPerp &x);
+ protected:
+  /// One multigrid V-cycle
+  const FieldPerp precon(const FieldPerp &x);
  private:
   int flags;
   
-  bool enable_a, enable_c; // Terms enabled
-  Field3D a3d, c3d;
+  bool initialised;
+  int restart, itmax; // Options
+  real tol;
   
-  bool use_precon;
-  Field2D a2d, c2d;  // DC components (for preconditioner)
-  Field2D *aptr, *cptr; // Pointers to the 2D variables (for passing to preconditioner)
+  LaplaceMultigrid mg; // Operator and preconditioner
 };
 
 #endif // __INVERT_LAP_GMRES_H__
 
-
@@ -0,0 +1,727 @@
+/**************************************************************************
+ * Multigrid solver for Laplacian inversion with 3D coefficients
+ *
+ * See invert_laplace_mg.h for a description of the algorithm
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#include "mpi.h"
+
+#include "globals.h"
+#include "invert_laplace_mg.h"
+#include "invert_laplace.h" // For flags
+#include "lapack_routines.h"
+#include "meshtopology.h"
+#include "utils.h"
+#include "profile.h"
+
+#include <math.h>
+
+// Settings from invert_laplace.cpp, so the same operator is inverted
+extern bool laplace_all_terms;
+extern bool laplace_nonuniform;
+
+const int MG_HALO_IN  = 1124; ///< Tags for MPI messages
+const int MG_HALO_OUT = 1125;
+const int MG_FORWARD  = 1126;
+const int MG_BACK     = 1127;
+
+/// MPI type of the line solver messages
+static MPI_Datatype mpi_type(const vector<real> &) { return MPI_DOUBLE; }
+static MPI_Datatype mpi_type(const vector<float> &) { return MPI_FLOAT; }
+
+/**************************************************************************
+ * Constructor / Destructor
+ **************************************************************************/
+
+LaplaceMultigrid::LaplaceMultigrid()
+{
+  initialised = false;
+  enable_a = enable_c = false;
+}
+
+LaplaceMultigrid::~LaplaceMultigrid()
+{
+  for(unsigned int l=0;l<level.size();l++) {
+    free_rmatrix(level[l].x);
+    free_rmatrix(level[l].b);
+    free_rmatrix(level[l].r);
+    free_rmatrix(level[l].a);
+    free_rmatrix(level[l].c);
+    free_rmatrix(level[l].cxm);
+    free_rmatrix(level[l].cxp);
+    free_rmatrix(level[l].czm);
+    free_rmatrix(level[l].czp);
+    free_rmatrix(level[l].cd);
+    free_rmatrix(level[l].cxz);
+  }
+}
+
+/**************************************************************************
+ * Public functions
+ **************************************************************************/
+
+void LaplaceMultigrid::setCoefs(const Field3D *a, const Field3D *c)
+{
+  // Coefficients are stored in real space, like the solution
+  enable_a = (a != NULL);
+  if(enable_a) {
+    if(ShiftXderivs) {
+      a3d = a->ShiftZ(true);
+    }else
+      a3d = *a;
+  }
+
+  enable_c = (c != NULL);
+  if(enable_c) {
+    if(ShiftXderivs) {
+      c3d = c->ShiftZ(true);
+    }else
+      c3d = *c;
+  }
+}
+
+int LaplaceMultigrid::solve(const Field3D &b, Field3D &x, int flags)
+{
+  PROFILE_REGION("invert_laplace_mg");
+#ifdef CHECK
+  int msg_point = msg_stack.push("LaplaceMultigrid::solve(Field3D)");
+#endif
+
+  real t = MPI_Wtime();
+
+  // Solve in real space (X derivatives at constant toroidal angle)
+  Field3D rhs, result;
+  if(ShiftXderivs) {
+    rhs = b.ShiftZ(true);
+  }else
+    rhs = b;
+
+  if(x.isAllocated()) {
+    if(ShiftXderivs) {
+      result = x.ShiftZ(true);
+    }else
+      result = x;
+  }else
+    result = 0.0;
+
+  int ys = jstart, ye = jend;
+  if(MYPE_IN_CORE == 0) {
+    // NOTE: REFINE THIS TO ONLY SOLVE IN BOUNDARY Y CELLS
+    ys = 0;
+    ye = ngy-1;
+  }
+
+  int status = 0;
+  FieldPerp xperp;
+  for(int y=ys; y <= ye; y++) {
+    xperp = result.Slice(y);
+    if(solve(rhs.Slice(y), xperp, flags))
+      status = 1;
+    result = xperp;
+  }
+
+  if(ShiftXderivs) {
+    x = result.ShiftZ(false);
+  }else
+    x = result;
+
+  x.setLocation(b.getLocation());
+
+  wtime_invert += MPI_Wtime() - t;
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+
+  return status;
+}
+
+int LaplaceMultigrid::solve(const FieldPerp &b, FieldPerp &x, int f)
+{
+  PROFILE_REGION("invert_laplace_mg");
+  if(!initialised)
+    init();
+
+  setup(b.getIndex(), f);
+
+  MGLevel &lev = level[0];
+
+  bool start = (x.getData() != NULL);
+  for(int i=0;i<ngx;i++)
+    for(int k=0;k<ncz;k++) {
+      lev.b[i][k] = b[i][k];
+      lev.x[i][k] = start ? x[i][k] : 0.0;
+    }
+  setBoundary(0);
+
+  // Norm of the right-hand side
+  real local[2], global[2];
+  local[0] = 0.0;
+  for(int i=xs;i<=xe;i++)
+    for(int k=0;k<ncz;k++)
+      local[0] += SQ(lev.b[i][k]);
+  local[1] = calcResidual(0);
+  MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, comm_x);
+
+  real bnorm = sqrt(global[0]);
+  real rnorm = sqrt(global[1]);
+
+  iterations = 0;
+  while((rnorm > rtol*bnorm) && (rnorm > atol) && (iterations < maxits)) {
+    cycle(0);
+    iterations++;
+
+    local[0] = calcResidual(0);
+    MPI_Allreduce(local, global, 1, MPI_DOUBLE, MPI_SUM, comm_x);
+    rnorm = sqrt(global[0]);
+  }
+
+  residual = (bnorm > 0.0) ? rnorm / bnorm : rnorm;
+
+  // Copy result out
+  x.Allocate();
+  x.setIndex(jy);
+  for(int i=0;i<ngx;i++) {
+    for(int k=0;k<ncz;k++)
+      x[i][k] = lev.x[i][k];
+    x[i][ncz] = x[i][0];
+  }
+
+  if((rnorm > rtol*bnorm) && (rnorm > atol))
+    return 1; // Not converged
+
+  return 0;
+}
+
+void LaplaceMultigrid::vcycle(const FieldPerp &b, FieldPerp &x, int f, int ncycles)
+{
+  PROFILE_REGION("invert_laplace_mg");
+  if(!initialised)
+    init();
+
+  setup(b.getIndex(), f);
+
+  MGLevel &lev = level[0];
+  for(int i=0;i<ngx;i++)
+    for(int k=0;k<ncz;k++) {
+      lev.b[i][k] = b[i][k];
+      lev.x[i][k] = 0.0;
+    }
+  setBoundary(0);
+
+  for(int n=0;n<ncycles;n++)
+    cycle(0);
+
+  x.Allocate();
+  x.setIndex(jy);
+  for(int i=0;i<ngx;i++) {
+    for(int k=0;k<ncz;k++)
+      x[i][k] = lev.x[i][k];
+    x[i][ncz] = x[i][0];
+  }
+}
+
+const FieldPerp LaplaceMultigrid::apply(const FieldPerp &x, int f)
+{
+  if(!initialised)
+    init();
+
+  setup(x.getIndex(), f);
+
+  MGLevel &lev = level[0];
+  for(int i=0;i<ngx;i++)
+    for(int k=0;k<ncz;k++)
+      lev.x[i][k] = x[i][k];
+  exchange(lev.x, ncz);
+
+  FieldPerp result;
+  result.Allocate();
+  result.setIndex(jy);
+
+  for(int i=0;i<ngx;i++) {
+    for(int k=0;k<ncz;k++) {
+      if((i >= xs) && (i <= xe)) {
+	int km = (k+ncz-1) % ncz, kp = (k+1) % ncz;
+	result[i][k] = lev.cxm[i][k]*lev.x[i-1][k] + lev.cxp[i][k]*lev.x[i+1][k]
+	  + lev.czm[i][k]*lev.x[i][km] + lev.czp[i][k]*lev.x[i][kp]
+	  + lev.cd[i][k]*lev.x[i][k]
+	  + lev.cxz[i][k]*(lev.x[i+1][kp] - lev.x[i+1][km] - lev.x[i-1][kp] + lev.x[i-1][km]);
+      }else if((i < xs) && (PE_XIND == 0) && in_grad) {
+	result[i][k] = lev.x[i][k] - lev.x[xs][k];
+      }else if((i > xe) && (PE_XIND == NXPE-1) && out_grad) {
+	result[i][k] = lev.x[i][k] - lev.x[xe][k];
+      }else
+	result[i][k] = lev.x[i][k];
+    }
+    // Periodic point
+    result[i][ncz] = x[i][ncz] - x[i][0];
+  }
+
+  return result;
+}
+
+/**************************************************************************
+ * Setup
+ **************************************************************************/
+
+void LaplaceMultigrid::init()
+{
+  output.write("Initialising multigrid Laplacian inversion\n");
+
+  options.setSection("laplace");
+  options.get("mg_levels",     maxlevels, 100);
+  options.get("mg_presmooth",  npre,      2);
+  options.get("mg_postsmooth", npost,     2);
+  options.get("mg_maxits",     maxits,    50);
+  options.get("mg_rtol",       rtol,      1.e-8);
+  options.get("mg_atol",       atol,      1.e-12);
+  options.get("mg_single",     single,    false);
+
+  // Create levels, halving the number of Z points each time
+  int nz = ncz;
+  do {
+    MGLevel lev;
+    lev.nz = nz;
+    lev.x   = rmatrix(ngx, nz);
+    lev.b   = rmatrix(ngx, nz);
+    lev.r   = rmatrix(ngx, nz);
+    lev.a   = rmatrix(ngx, nz);
+    lev.c   = rmatrix(ngx, nz);
+    lev.cxm = rmatrix(ngx, nz);
+    lev.cxp = rmatrix(ngx, nz);
+    lev.czm = rmatrix(ngx, nz);
+    lev.czp = rmatrix(ngx, nz);
+    lev.cd  = rmatrix(ngx, nz);
+    lev.cxz = rmatrix(ngx, nz);
+    level.push_back(lev);
+
+    if((nz % 2) != 0)
+      break; // Can't coarsen any further
+    nz /= 2;
+  }while((int) level.size() < maxlevels);
+
+  output.write("\tUsing %d levels, coarsest has %d Z points\n", (int) level.size(), level.back().nz);
+  if(single)
+    output.write("\tLine solves in single precision\n");
+
+  // Workspace for line solves
+  int n = ngx * (ncz/2 + 1);
+  if(single) {
+    swork.a.resize(n);
+    swork.b.resize(n);
+    swork.c.resize(n);
+    swork.r.resize(n);
+    swork.gam.resize(n);
+    swork.sbuf.resize(ncz+2);
+    swork.rbuf.resize(ncz+2);
+  }else {
+    dwork.a.resize(n);
+    dwork.b.resize(n);
+    dwork.c.resize(n);
+    dwork.r.resize(n);
+    dwork.gam.resize(n);
+    dwork.sbuf.resize(ncz+2);
+    dwork.rbuf.resize(ncz+2);
+  }
+  if(level.back().nz == 1) {
+    ca.resize(ngx);
+    cb.resize(ngx);
+    cc.resize(ngx);
+    cr.resize(ngx);
+    cx.resize(ngx);
+  }
+
+  initialised = true;
+}
+
+/// Set up boundaries and coefficients on all levels for slice y
+void LaplaceMultigrid::setup(int y, int f)
+{
+  flags = f;
+  jy = y;
+
+  int xbndry = MXG;
+  if(flags & INVERT_BNDRY_ONE)
+    xbndry = 1;
+
+  xs = (PE_XIND == 0) ? xbndry : MXG;
+  xe = (PE_XIND == NXPE-1) ? ngx-1-xbndry : ngx-1-MXG;
+
+  // Can't separate DC and AC components in real space, so use AC flags
+  in_set  = (flags & INVERT_IN_SET) != 0;
+  out_set = (flags & INVERT_OUT_SET) != 0;
+  in_grad  = ((flags & INVERT_AC_IN_GRAD) != 0) && !in_set;
+  out_grad = ((flags & INVERT_AC_OUT_GRAD) != 0) && !out_set;
+
+  // Coefficients on the finest level
+  MGLevel &lev = level[0];
+  for(int i=0;i<ngx;i++)
+    for(int k=0;k<ncz;k++) {
+      lev.a[i][k] = enable_a ? a3d[i][jy][k] : 0.0;
+      lev.c[i][k] = enable_c ? c3d[i][jy][k] : 1.0;
+    }
+  setStencil(0);
+
+  // Average onto coarser levels
+  for(unsigned int l=1;l<level.size();l++) {
+    MGLevel &f = level[l-1], &c = level[l];
+    for(int i=0;i<ngx;i++)
+      for(int k=0;k<c.nz;k++) {
+	int km = (2*k + f.nz - 1) % f.nz;
+	c.a[i][k] = 0.25*f.a[i][km] + 0.5*f.a[i][2*k] + 0.25*f.a[i][2*k+1];
+	c.c[i][k] = 0.25*f.c[i][km] + 0.5*f.c[i][2*k] + 0.25*f.c[i][2*k+1];
+      }
+    setStencil(l);
+  }
+}
+
+/// Calculate the finite difference stencil on level l. Same terms as laplace_tridag_coefs
+void LaplaceMultigrid::setStencil(int l)
+{
+  MGLevel &lev = level[l];
+  int nz = lev.nz;
+  real dzl = zlength / ((real) nz); // Grid spacing on this level
+
+  for(int i=xs;i<=xe;i++) {
+    real dxi = dx[i][jy];
+
+    real coef1 = g11[i][jy]/SQ(dxi);          // X 2nd derivative
+    real coef2 = g33[i][jy]/SQ(dzl);          // Z 2nd derivative
+    real coef3 = g13[i][jy]/(2.*dxi*dzl);     // X-Z mixed derivative (includes factor of 2)
+
+    real gx = 0.0, gz = 0.0; // Coefficients of central first derivatives
+    if(laplace_all_terms) {
+      gx = G1[i][jy] / (2.0*dxi);
+      gz = G3[i][jy] / (2.0*dzl);
+    }
+
+    if(laplace_nonuniform) {
+      // non-uniform mesh correction
+      gx -= 0.25*((dx[i+1][jy] - dx[i-1][jy])/dxi)*coef1;
+    }
+
+    if(ShiftXderivs && IncIntShear) {
+      coef2 += g11[i][jy] * IntShiftTorsion[i][jy] * IntShiftTorsion[i][jy] / SQ(dzl);
+      coef3 = 0.0; // This cancels out
+    }
+
+    for(int k=0;k<nz;k++) {
+      int km = (k+nz-1) % nz, kp = (k+1) % nz;
+
+      real fx = gx, fz = gz;
+      if(enable_c) {
+	// (1/c) Grad c dot Grad x
+	real dcx = (lev.c[i+1][k] - lev.c[i-1][k]) / (2.*dxi*lev.c[i][k]);
+	real dcz = (lev.c[i][kp] - lev.c[i][km]) / (2.*dzl*lev.c[i][k]);
+
+	fx += (g11[i][jy]*dcx + g13[i][jy]*dcz) / (2.*dxi);
+	fz += (g33[i][jy]*dcz + g13[i][jy]*dcx) / (2.*dzl);
+      }
+
+      lev.cxm[i][k] = coef1 - fx;
+      lev.cxp[i][k] = coef1 + fx;
+      lev.czm[i][k] = coef2 - fz;
+      lev.czp[i][k] = coef2 + fz;
+      lev.cd[i][k]  = -2.*coef1 - 2.*coef2 + lev.a[i][k];
+      lev.cxz[i][k] = coef3;
+
+      if(nz == 1) {
+	// Single Z point: z neighbours are this point
+	lev.cd[i][k] += lev.czm[i][k] + lev.czp[i][k];
+	lev.czm[i][k] = lev.czp[i][k] = 0.0;
+	lev.cxz[i][k] = 0.0;
+      }
+    }
+  }
+}
+
+/**************************************************************************
+ * Multigrid components
+ **************************************************************************/
+
+/// Exchange one row of guard cells with X neighbours
+void LaplaceMultigrid::exchange(real **x, int nz)
+{
+  if(NXPE == 1)
+    return;
+
+  int in  = (PE_XIND > 0)      ? PROC_NUM(PE_XIND-1, PE_YIND) : MPI_PROC_NULL;
+  int out = (PE_XIND < NXPE-1) ? PROC_NUM(PE_XIND+1, PE_YIND) : MPI_PROC_NULL;
+  MPI_Status status;
+
+  MPI_Sendrecv(x[xs],   nz, MPI_DOUBLE, in,  MG_HALO_OUT,
+	       x[xe+1], nz, MPI_DOUBLE, out, MG_HALO_OUT,
+	       MPI_COMM_WORLD, &status);
+
+  MPI_Sendrecv(x[xe],   nz, MPI_DOUBLE, out, MG_HALO_IN,
+	       x[xs-1], nz, MPI_DOUBLE, in,  MG_HALO_IN,
+	       MPI_COMM_WORLD, &status);
+}
+
+/// Set X boundary cells. Coarse levels are corrections, so have homogeneous boundaries
+void LaplaceMultigrid::setBoundary(int l)
+{
+  MGLevel &lev = level[l];
+
+  if(PE_XIND == 0) {
+    for(int i=0;i<xs;i++)
+      for(int k=0;k<lev.nz;k++) {
+	if(in_grad) {
+	  lev.x[i][k] = lev.x[xs][k];
+	}else if(!in_set || (l > 0))
+	  lev.x[i][k] = 0.0;
+      }
+  }
+
+  if(PE_XIND == NXPE-1) {
+    for(int i=xe+1;i<ngx;i++)
+      for(int k=0;k<lev.nz;k++) {
+	if(out_grad) {
+	  lev.x[i][k] = lev.x[xe][k];
+	}else if(!out_set || (l > 0))
+	  lev.x[i][k] = 0.0;
+      }
+  }
+}
+
+void LaplaceMultigrid::smooth(int l, int nsweeps)
+{
+  int ncolours = (level[l].nz > 1) ? 2 : 1; // Even then odd Z lines
+  for(int s=0;s<nsweeps;s++)
+    for(int colour=0;colour<ncolours;colour++) {
+      if(single) {
+	solveLines(l, colour, swork);
+      }else
+	solveLines(l, colour, dwork);
+    }
+}
+
+/// Solve along X for every Z line of one colour, keeping the other lines fixed.
+/// Uses the parallel Thomas algorithm, with all lines sent together.
+/// The systems are for the correction to x, with the residual calculated in
+/// double precision, so w can be float without limiting the accuracy of x
+template<typename T>
+void LaplaceMultigrid::solveLines(int l, int colour, LineWork<T> &w)
+{
+  MGLevel &lev = level[l];
+  int nz = lev.nz;
+  int n = xe - xs + 1;
+
+  exchange(lev.x, nz);
+
+  // Set up tridiagonal systems
+  int nlines = 0;
+  for(int k=colour;k<nz;k+=2, nlines++) {
+    int km = (k+nz-1) % nz, kp = (k+1) % nz;
+    T *a = &w.a[nlines*n], *b = &w.b[nlines*n], *c = &w.c[nlines*n], *r = &w.r[nlines*n];
+
+    for(int i=xs;i<=xe;i++) {
+      int j = i - xs;
+      a[j] = lev.cxm[i][k];
+      b[j] = lev.cd[i][k];
+      c[j] = lev.cxp[i][k];
+      r[j] = lev.b[i][k]
+	- lev.cxm[i][k]*lev.x[i-1][k] - lev.cxp[i][k]*lev.x[i+1][k]
+	- lev.czm[i][k]*lev.x[i][km] - lev.czp[i][k]*lev.x[i][kp]
+	- lev.cd[i][k]*lev.x[i][k]
+	- lev.cxz[i][k]*(lev.x[i+1][kp] - lev.x[i+1][km] - lev.x[i-1][kp] + lev.x[i-1][km]);
+    }
+
+    // Boundary cells are fixed, or follow the nearest interior cell
+    if(PE_XIND == 0) {
+      if(in_grad)
+	b[0] += a[0];
+      a[0] = 0.0;
+    }
+    if(PE_XIND == NXPE-1) {
+      if(out_grad)
+	b[n-1] += c[n-1];
+      c[n-1] = 0.0;
+    }
+  }
+
+  // Forward elimination. gam holds c', r holds d'
+
+  MPI_Datatype type = mpi_type(w.sbuf);
+
+  if(PE_XIND > 0) {
+    MPI_Status status;
+    MPI_Recv(&w.rbuf[0], 2*nlines, type, PROC_NUM(PE_XIND-1, PE_YIND),
+	     MG_FORWARD, MPI_COMM_WORLD, &status);
+  }
+
+  for(int m=0;m<nlines;m++) {
+    T *a = &w.a[m*n], *b = &w.b[m*n], *c = &w.c[m*n], *r = &w.r[m*n], *g = &w.gam[m*n];
+
+    T cp = 0.0, dp = 0.0; // From previous processor
+    if(PE_XIND > 0) {
+      cp = w.rbuf[2*m];
+      dp = w.rbuf[2*m+1];
+    }
+
+    for(int j=0;j<n;j++) {
+      T bet = b[j] - a[j]*cp;
+      g[j] = cp = c[j] / bet;
+      r[j] = dp = (r[j] - a[j]*dp) / bet;
+    }
+
+    w.sbuf[2*m]   = cp;
+    w.sbuf[2*m+1] = dp;
+  }
+
+  if(PE_XIND < NXPE-1)
+    MPI_Send(&w.sbuf[0], 2*nlines, type, PROC_NUM(PE_XIND+1, PE_YIND),
+	     MG_FORWARD, MPI_COMM_WORLD);
+
+  // Back substitution, adding the correction to x
+
+  if(PE_XIND < NXPE-1) {
+    MPI_Status status;
+    MPI_Recv(&w.rbuf[0], nlines, type, PROC_NUM(PE_XIND+1, PE_YIND),
+	     MG_BACK, MPI_COMM_WORLD, &status);
+  }
+
+  for(int m=0;m<nlines;m++) {
+    int k = colour + 2*m;
+    T *r = &w.r[m*n], *g = &w.gam[m*n];
+
+    T dnext = (PE_XIND < NXPE-1) ? w.rbuf[m] : 0.0;
+    for(int j=n-1;j>=0;j--) {
+      dnext = r[j] - g[j]*dnext;
+      lev.x[xs+j][k] += dnext;
+    }
+    w.sbuf[m] = dnext;
+  }
+
+  if(PE_XIND > 0)
+    MPI_Send(&w.sbuf[0], nlines, type, PROC_NUM(PE_XIND-1, PE_YIND),
+	     MG_BACK, MPI_COMM_WORLD);
+
+  setBoundary(l);
+}
+
+/// Solve the coarsest level exactly when it has a single Z point. This is the
+/// tridiagonal system for the DC component in invert_laplace_ser, so use tridag.
+/// Always in double precision, as it isn't a correction
+void LaplaceMultigrid::solveCoarse(int l)
+{
+  if(NXPE > 1) {
+    smooth(l, 1); // Parallel line solve is exact
+    return;
+  }
+
+  MGLevel &lev = level[l];
+  int n = xe - xs + 1;
+
+  for(int i=xs;i<=xe;i++) {
+    int j = i - xs;
+    ca[j] = lev.cxm[i][0];
+    cb[j] = lev.cd[i][0];
+    cc[j] = lev.cxp[i][0];
+    cr[j] = lev.b[i][0];
+  }
+
+  if(in_grad) {
+    cb[0] += ca[0];
+  }else
+    cr[0] -= ca[0]*lev.x[xs-1][0];
+  if(out_grad) {
+    cb[n-1] += cc[n-1];
+  }else
+    cr[n-1] -= cc[n-1]*lev.x[xe+1][0];
+
+  if(!tridag(&ca[0], &cb[0], &cc[0], &cr[0], &cx[0], n))
+    bout_error("LaplaceMultigrid: Coarse level solve failed\n");
+
+  for(int j=0;j<n;j++)
+    lev.x[xs+j][0] = cx[j];
+  setBoundary(l);
+}
+
+/// Calculate r = b - Ax on level l. Returns the local sum of r^2
+real LaplaceMultigrid::calcResidual(int l)
+{
+  MGLevel &lev = level[l];
+  int nz = lev.nz;
+
+  exchange(lev.x, nz);
+
+  real sum = 0.0;
+  for(int i=xs;i<=xe;i++)
+    for(int k=0;k<nz;k++) {
+      int km = (k+nz-1) % nz, kp = (k+1) % nz;
+
+      lev.r[i][k] = lev.b[i][k]
+	- lev.cxm[i][k]*lev.x[i-1][k] - lev.cxp[i][k]*lev.x[i+1][k]
+	- lev.czm[i][k]*lev.x[i][km] - lev.czp[i][k]*lev.x[i][kp]
+	- lev.cd[i][k]*lev.x[i][k]
+	- lev.cxz[i][k]*(lev.x[i+1][kp] - lev.x[i+1][km] - lev.x[i-1][kp] + lev.x[i-1][km]);
+
+      sum += SQ(lev.r[i][k]);
+    }
+  return sum;
+}
+
+/// Multigrid V-cycle starting at level l
+void LaplaceMultigrid::cycle(int l)
+{
+  if(l == (int) level.size()-1) {
+    // Coarsest level
+    if(level[l].nz == 1) {
+      solveCoarse(l);
+    }else
+      smooth(l, 4*(npre + npost));
+    return;
+  }
+
+  smooth(l, npre);
+
+  calcResidual(l);
+
+  // Restrict residual to next level (full weighting in Z)
+  MGLevel &f = level[l], &c = level[l+1];
+  for(int i=0;i<ngx;i++)
+    for(int k=0;k<c.nz;k++) {
+      c.x[i][k] = 0.0;
+      c.b[i][k] = 0.0;
+    }
+
+  for(int i=xs;i<=xe;i++)
+    for(int k=0;k<c.nz;k++) {
+      int km = (2*k + f.nz - 1) % f.nz;
+      c.b[i][k] = 0.25*f.r[i][km] + 0.5*f.r[i][2*k] + 0.25*f.r[i][2*k+1];
+    }
+
+  cycle(l+1);
+
+  // Interpolate correction (linear in Z)
+  for(int i=xs;i<=xe;i++)
+    for(int k=0;k<c.nz;k++) {
+      f.x[i][2*k]   += c.x[i][k];
+      f.x[i][2*k+1] += 0.5*(c.x[i][k] + c.x[i][(k+1) % c.nz]);
+    }
+  setBoundary(l);
+
+  smooth(l, npost);
+}
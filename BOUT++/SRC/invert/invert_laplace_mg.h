@@ -0,0 +1,146 @@
+/**************************************************************************
+ * Multigrid solver for Laplacian inversion with 3D coefficients
+ *
+ * Equation solved is: \nabla^2_\perp x + (1/c)\nabla_perp c\cdot\nabla_\perp x + a x = b
+ *
+ * i.e. the same as invert_laplace.h, but a and c can vary in z.
+ *
+ * Each X-Z slice is solved using geometric multigrid. The grid is
+ * coarsened in Z only (semi-coarsening) down to a single Z point,
+ * and the smoother is zebra line Gauss-Seidel, solving a tridiagonal
+ * system along X for each Z line. Together these give a number of
+ * iterations which doesn't depend on the mesh size in either direction.
+ * On the coarsest level the problem reduces to a single tridiagonal
+ * system (the same as the DC component in invert_laplace), which is
+ * solved exactly with tridag, or the line solver if NXPE > 1. Lines are solved in parallel across X processors using
+ * the same pipelined Thomas algorithm as the simple parallel code in
+ * invert_laplace.cpp, with all lines of one colour sent together.
+ * Each line solve calculates a correction to x from the residual, so the
+ * tridiagonal systems and messages can be stored in single precision
+ * (option mg_single) without limiting the accuracy of the solution.
+ *
+ * Can be used directly (solve) or as a preconditioner (vcycle),
+ * for example in LaplaceGMRES.
+ *
+ * Changelog:
+ *
+ * 2010-10
+ *    * Initial version
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+class LaplaceMultigrid;
+
+#ifndef __INVERT_LAP_MG_H__
+#define __INVERT_LAP_MG_H__
+
+#include "field3d.h"
+#include "fieldperp.h"
+
+#include <vector>
+
+using std::vector;
+
+class LaplaceMultigrid {
+ public:
+  LaplaceMultigrid();
+  ~LaplaceMultigrid();
+
+  /// Set the coefficients. Pass NULL to omit terms
+  void setCoefs(const Field3D *a = NULL, const Field3D *c = NULL);
+
+  /// Solve for a 3D field. If allocated, x is used as the starting value
+  int solve(const Field3D &b, Field3D &x, int flags);
+
+  /// Solve a single X-Z slice, using coefficients at y = b.getIndex()
+  int solve(const FieldPerp &b, FieldPerp &x, int flags);
+
+  /// Apply V-cycles starting from x = 0. Used as a preconditioner
+  void vcycle(const FieldPerp &b, FieldPerp &x, int flags, int ncycles = 1);
+
+  /// The operator applied to x. Boundary cells contain the
+  /// boundary condition residual (e.g. x for zero value)
+  const FieldPerp apply(const FieldPerp &x, int flags);
+
+  int iterations; ///< Number of V-cycles used in the last solve
+  real residual;  ///< Final residual (relative to b) of the last solve
+
+ private:
+  /// Arrays for one level of the multigrid hierarchy
+  struct MGLevel {
+    int nz;          ///< Number of Z points
+    real **x, **b, **r;
+    real **a, **c;   ///< Coefficients (z-averaged on coarse levels)
+    // Stencil coefficients: x at (i-1,k), (i+1,k), (i,k-1), (i,k+1), (i,k)
+    real **cxm, **cxp, **czm, **czp, **cd;
+    real **cxz;      ///< Mixed derivative (i+1,k+1) - (i+1,k-1) - (i-1,k+1) + (i-1,k-1)
+  };
+
+  bool initialised;
+  vector<MGLevel> level;
+
+  // Options
+  int maxlevels;   ///< Maximum number of levels
+  int npre, npost; ///< Number of smoothing sweeps before and after coarse correction
+  int maxits;      ///< Maximum number of V-cycles
+  real rtol, atol; ///< Relative and absolute tolerance
+  bool single;     ///< Store and solve the line systems in single precision
+
+  // Coefficients
+  bool enable_a, enable_c;
+  Field3D a3d, c3d;
+
+  // Settings for the current solve
+  int flags, jy;
+  int xs, xe;      ///< Range of unknowns in X on this processor
+  bool in_grad, out_grad; ///< Zero-gradient boundaries
+  bool in_set, out_set;   ///< Boundary values set from x
+
+  /// Line solver workspace. T is float if single is set
+  template<typename T>
+  struct LineWork {
+    vector<T> a, b, c, r, gam;
+    vector<T> sbuf, rbuf;
+  };
+  LineWork<real> dwork;
+  LineWork<float> swork;
+
+  /// Tridiagonal system on the coarsest level, when it has a single Z point
+  vector<real> ca, cb, cc, cr, cx;
+
+  void init();
+  void setup(int y, int f);
+  void setStencil(int l);
+
+  void exchange(real **x, int nz);
+  void setBoundary(int l);
+  void smooth(int l, int nsweeps);
+  template<typename T>
+  void solveLines(int l, int colour, LineWork<T> &w);
+  void solveCoarse(int l);
+  real calcResidual(int l);
+  void cycle(int l);
+};
+
+#endif // __INVERT_LAP_MG_H__
+
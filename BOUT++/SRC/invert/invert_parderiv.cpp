@@ -58,6 +58,7 @@
 #include "comm_group.h" // Gather/scatter operations
 
 #include "lapack_routines.h" // For tridiagonal inversions
+#include "profile.h"
 
 #define PVEC_REAL_MPI_TYPE MPI_DOUBLE
 
@@ -243,8 +244,9 @@ namespace invpar {
    ***********************************************************************/
   
   /// Parallel inversion routine
-  const Field3D invert_parderiv(const Field2D &A, const Field2D &B, const Field3D &r)
+  Field3D invert_parderiv(const Field2D &A, const Field2D &B, const Field3D &r)
   {
+    PROFILE_REGION("invert_parderiv");
     static real *senddata;
     static real *recvdata;
     static real *resultdata;
@@ -381,21 +383,21 @@ namespace invpar {
     return result;
   }
 
-  const Field3D invert_parderiv(real val, const Field2D &B, const Field3D &r)
+  Field3D invert_parderiv(real val, const Field2D &B, const Field3D &r)
   {
     Field2D A;
     A = val;
     return invert_parderiv(A, B, r);
   }
   
-  const Field3D invert_parderiv(const Field2D &A, real val, const Field3D &r)
+  Field3D invert_parderiv(const Field2D &A, real val, const Field3D &r)
   {
     Field2D B;
     B = val;
     return invert_parderiv(A, B, r);
   }
   
-  const Field3D invert_parderiv(real val, real val2, const Field3D &r)
+  Field3D invert_parderiv(real val, real val2, const Field3D &r)
   {
     Field2D A, B;
     A = val;
@@ -6,6 +6,10 @@
  * 
  * Changelog: 
  *
+ * 2010-10
+ *    * Fixed passing data to function(), added optional
+ *      right preconditioning
+ *
  * 2007-10 Ben Dudson <bd512@york.ac.uk>
  *    * Initial version. Not working yet.
  *
@@ -39,6 +43,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 /**************************************************************************
  * Constructor / Destructor
@@ -46,7 +51,8 @@
 
 Inverter::Inverter()
 {
-  
+  enable_precon = false;
+  yindex = -1;
 }
 
 Inverter::~Inverter()
@@ -63,6 +69,10 @@ int Inverter::solve(const FieldPerp &b, FieldPerp &x, int flags, int restart, in
   int iterations;
   real residual;
   
+  yindex = b.getIndex();
+  x.Allocate();
+  x.setIndex(yindex);
+  
   int status = gmres_solve(*(b.getData()), *(x.getData()), ngx*ngz, 
 			   restart, itmax, tol, iterations, residual);
   
@@ -98,12 +108,32 @@ int Inverter::solve(const Field3D &b, Field3D &x,
 
 void Inverter::A(real *b, real *x)
 {
-  FieldPerp Fb, Fx;
+  // Copy into a FieldPerp: can't give borrowed data to a FieldPerp,
+  // since the destructor puts it onto the free block list
+  static FieldPerp Fx;
+  Fx.Allocate();
+  Fx.setIndex(yindex);
+  memcpy(*(Fx.getData()), x, sizeof(real)*ngx*ngz);
+
+  FieldPerp Fb = function(Fx);
+  memcpy(b, *(Fb.getData()), sizeof(real)*ngx*ngz);
+}
+
+void Inverter::P(real *b, real *x)
+{
+  if(!enable_precon) {
+    if(b != x)
+      memcpy(b, x, sizeof(real)*ngx*ngz);
+    return;
+  }
   
-  Fb.setData(&b);
-  Fx.setData(&x);
+  static FieldPerp Fx;
+  Fx.Allocate();
+  Fx.setIndex(yindex);
+  memcpy(*(Fx.getData()), x, sizeof(real)*ngx*ngz);
 
-  Fb = function(Fx);
+  FieldPerp Fb = precon(Fx);
+  memcpy(b, *(Fb.getData()), sizeof(real)*ngx*ngz);
 }
 
 /**************************************************************************
@@ -149,11 +179,26 @@ void Inverter::Update(real *x, int it, real **h, real *s, real *y, real **v, int
     }
   }
 
+  /* z = sum_p v_(p) * y[p] */
+  static real *z = NULL;
+  static int zsize = 0;
+  if(zsize < n) {
+    if(z != NULL)
+      free(z);
+    z = rvector(n);
+    zsize = n;
+  }
+  for(i=0;i<n;i++)
+    z[i] = 0.0;
   for(p = 0; p != it+1; p++) {
-    /* x += v_(p) * y[p] */
     for(i=0;i<n;i++)
-      x[i] += v[p][i] * y[p];
+      z[i] += v[p][i] * y[p];
   }
+  
+  /* x += P z */
+  P(z, z);
+  for(i=0;i<n;i++)
+    x[i] += z[i];
 }
 
 void Inverter::GeneratePlaneRotation(real dx, real dy, real *cs, real *sn)
@@ -263,8 +308,9 @@ int Inverter::gmres_solve(real *b, real *x, int n, int m, int itmax, real tol, i
     s[0] = beta;
     
     for(itt=0; (itt < m) && (it <= itmax); itt++, it++) {
-      /* w = A*v_(itt) */
-      A(w, v[itt]);
+      /* w = A*P*v_(itt) */
+      P(w, v[itt]);
+      A(w, w);
       
       for(p=0;p<=itt;p++) {
 	H[p][itt] = dot_product(w, v[p], n);
@@ -60,9 +60,17 @@ class Inverter {
   /// User must implement this function
   virtual const FieldPerp function(const FieldPerp &x) = 0;
   
+ protected:
+  bool enable_precon; ///< Use the preconditioner below (right preconditioning)
+  
+  /// Approximate inverse of function(). Default is the identity
+  virtual const FieldPerp precon(const FieldPerp &x) { return x; }
+  
  private:
+  int yindex; ///< Y index of the slice being solved
   
   void A(real *b, real *x); ///< Calculates b = Ax
+  void P(real *b, real *x); ///< Calculates b = Px (preconditioner)
   
   // GMRES solver code
   
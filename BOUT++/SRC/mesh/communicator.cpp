@@ -33,11 +33,13 @@
  **************************************************************************/
 
 #include "communicator.h"
+#include "fft.h"
 
 #include <stdlib.h>
 #include <string.h>
 
 #include "mpi.h"
+#include "profile.h"
 
 // This was defined in nvector.h
 #define PVEC_REAL_MPI_TYPE MPI_DOUBLE
@@ -87,6 +89,9 @@ Communicator::Communicator()
   }
 
   ybufflen = xbufflen = 0;
+  tslen = 0;
+
+  raw = false;
 }
 
 Communicator::Communicator(Communicator &copy)
@@ -120,6 +125,10 @@ Communicator::Communicator(Communicator &copy)
     request[i] = MPI_REQUEST_NULL;
     sendreq[i] = MPI_REQUEST_NULL;
   }
+
+  tslen = 0; // Allocated when needed
+
+  raw = copy.raw;
 }
 
 Communicator::~Communicator()
@@ -143,6 +152,11 @@ Communicator::~Communicator()
     delete[] omsg_sendbuff;
     delete[] omsg_recvbuff;
   }
+
+  if(tslen > 0) {
+    delete[] ts_data;
+    delete[] ts_fft;
+  }
 }
 
 /************************************************************************//**
@@ -274,6 +288,7 @@ void Communicator::post_receive()
 
 void Communicator::send()
 {
+  PROFILE_REGION("comms send");
   real *outbuff;
   int len;
   real t;
@@ -368,6 +383,8 @@ void Communicator::send()
   len = 0;
   if(UDATA_INDEST != -1) { // If there is a destination for inner x data
     len = pack_data(0, UDATA_XSPLIT, MYSUB, MYSUB+MYG, umsg_sendbuff);
+    if(TwistShift && (TwistOrder == 0) && TS_up_in && !raw)
+      shift_data(0, UDATA_XSPLIT, MYSUB, MYSUB+MYG, umsg_sendbuff, true);
     // Send the data to processor UDATA_INDEST
 
     if(async_send) {
@@ -390,6 +407,8 @@ void Communicator::send()
     outbuff = &umsg_sendbuff[len]; // A pointer to the start of the second part
                                    // of the buffer 
     len = pack_data(UDATA_XSPLIT, ngx, MYSUB, MYSUB+MYG, outbuff);
+    if(TwistShift && (TwistOrder == 0) && TS_up_out && !raw)
+      shift_data(UDATA_XSPLIT, ngx, MYSUB, MYSUB+MYG, outbuff, true);
     // Send the data to processor UDATA_OUTDEST
     if(async_send) {
       MPI_Isend(outbuff, 
@@ -413,6 +432,8 @@ void Communicator::send()
   len = 0;
   if(DDATA_INDEST != -1) { // If there is a destination for inner x data
     len = pack_data(0, DDATA_XSPLIT, MYG, 2*MYG, dmsg_sendbuff);    
+    if(TwistShift && (TwistOrder == 0) && TS_down_in && !raw)
+      shift_data(0, DDATA_XSPLIT, MYG, 2*MYG, dmsg_sendbuff, false);
     // Send the data to processor DDATA_INDEST
     if(async_send) {
       MPI_Isend(dmsg_sendbuff, 
@@ -434,6 +455,8 @@ void Communicator::send()
     outbuff = &dmsg_sendbuff[len]; // A pointer to the start of the second part
 			           // of the buffer
     len = pack_data(DDATA_XSPLIT, ngx, MYG, 2*MYG, outbuff);
+    if(TwistShift && (TwistOrder == 0) && TS_down_out && !raw)
+      shift_data(DDATA_XSPLIT, ngx, MYG, 2*MYG, outbuff, false);
     // Send the data to processor DDATA_OUTDEST
 
     if(async_send) {
@@ -508,6 +531,7 @@ void Communicator::send()
 
 void Communicator::receive()
 {
+  PROFILE_REGION("comms receive");
   MPI_Status status;
   int len;
   real t;
@@ -589,45 +613,7 @@ void Communicator::receive()
   if(pre_post)
     post_receive();
 
-  // TWIST-SHIFT CONDITION
-  if(TwistShift && (TwistOrder == 0)) {
-    int jx, jy;
-    
-    // Perform Twist-shift using shifting method (rather than in SetStencil)
-    for(std::vector<FieldData*>::iterator it = var_list.begin(); it != var_list.end(); it++)
-      if((*it)->is3D()) {
-	
-	// Lower boundary
-
-	if(TS_down_in && (DDATA_INDEST  != -1)) {
-	  for(jx=0;jx<DDATA_XSPLIT;jx++)
-	    for(jy=0;jy != MYG; jy++)
-	      (*it)->ShiftZ(jx, jy, ShiftAngle[jx]);
-      
-	}
-	if(TS_down_out && (DDATA_OUTDEST  != -1)) {
-	  for(jx=DDATA_XSPLIT;jx<ngx; jx++)
-	    for(jy=0;jy != MYG; jy++)
-	      (*it)->ShiftZ(jx, jy, ShiftAngle[jx]);
-	  
-	}
-	
-	// Upper boundary
-	
-	if(TS_up_in && (UDATA_INDEST  != -1)) {
-	  for(jx=0;jx<UDATA_XSPLIT; jx++)
-	    for(jy=ngy-MYG;jy != ngy; jy++)
-	      (*it)->ShiftZ(jx, jy, -ShiftAngle[jx]);
-	  
-	}
-	if(TS_up_out && (UDATA_OUTDEST  != -1)) {
-	  for(jx=UDATA_XSPLIT;jx<ngx; jx++)
-	    for(jy=ngy-MYG;jy != ngy; jy++)
-	      (*it)->ShiftZ(jx, jy, -ShiftAngle[jx]);
-	  
-	}
-      }
-  }
+  // Twist-shift (TwistOrder = 0) has been applied by the sender
 
   wtime += MPI_Wtime() - t;
 
@@ -675,6 +661,8 @@ int Communicator::pack_data(int xge, int xlt, int yge, int ylt, real *buffer)
     
   }
   
+  PROFILE_BYTES(len*sizeof(real));
+  
   return(len);
 }
 
@@ -711,6 +699,89 @@ int Communicator::unpack_data(int xge, int xlt, int yge, int ylt, real *buffer)
   return(len);
 }
 
+/// Shifts each Z pencil of 3D data in a packed buffer by the twist-shift
+/// angle, as it would be shifted after arriving in the guard cells: by 
+/// ShiftAngle going up (received in the lower guard cells), and by
+/// -ShiftAngle going down. Buffer layout is the same as in pack_data
+void Communicator::shift_data(int xge, int xlt, int yge, int ylt, real *buffer, bool up)
+{
+  int jx, jy, jz, c;
+  std::vector<FieldData*>::iterator it;
+  
+  if(ncz == 1)
+    return; // Nothing to shift
+  
+  // Count the pencils
+  int npencil = 0;
+  for(it = var_list.begin(); it != var_list.end(); it++)
+    if((*it)->is3D())
+      npencil += (*it)->realSize();
+  npencil *= (xlt - xge) * (ylt - yge);
+  
+  if(npencil == 0)
+    return;
+  
+  if(npencil > tslen) {
+    if(tslen > 0) {
+      delete[] ts_data;
+      delete[] ts_fft;
+    }
+    ts_data = new real[npencil*ncz];
+    ts_fft = new dcomplex[npencil*(ncz/2 + 1)];
+    tslen = npencil;
+  }
+  
+  // Gather pencils into ts_data. Components of vectors are interleaved
+  int len = 0, p = 0;
+  for(jx=xge; jx != xlt; jx++)
+    for(it = var_list.begin(); it != var_list.end(); it++) {
+      int rs = (*it)->realSize();
+      if((*it)->is3D()) {
+	for(jy=yge;jy != ylt;jy++) {
+	  for(c=0;c<rs;c++, p++)
+	    for(jz=0;jz<ncz;jz++)
+	      ts_data[p*ncz + jz] = buffer[len + jz*rs + c];
+	  len += ncz*rs;
+	}
+      }else
+	len += (ylt - yge)*rs;
+    }
+  
+  rfft_many(ts_data, ncz, npencil, ts_fft);
+  
+  // Apply the phase shifts. All pencils at the same x have the same angle
+  int nk = ncz/2 + 1;
+  int perx = npencil / (xlt - xge);
+  p = 0;
+  for(jx=xge; jx != xlt; jx++) {
+    const dcomplex *phs = zshift_phase(ShiftAngle[jx]);
+    for(int i=0;i<perx;i++, p++) {
+      if(up) {
+	cmul(ts_fft + p*nk, phs, nk);
+      }else
+	cmulconj(ts_fft + p*nk, phs, nk);
+    }
+  }
+  
+  irfft_many(ts_fft, ncz, npencil, ts_data);
+  
+  // Scatter back into the buffer
+  len = 0; p = 0;
+  for(jx=xge; jx != xlt; jx++)
+    for(it = var_list.begin(); it != var_list.end(); it++) {
+      int rs = (*it)->realSize();
+      if((*it)->is3D()) {
+	for(jy=yge;jy != ylt;jy++) {
+	  for(c=0;c<rs;c++, p++)
+	    for(jz=0;jz<ncz;jz++)
+	      buffer[len + jz*rs + c] = ts_data[p*ncz + jz];
+	  len += ncz*rs;
+	}
+      }else
+	len += (ylt - yge)*rs;
+    }
+}
+
 int Communicator::msg_len(int xge, int xlt, int yge, int ylt)
 {
   int len = 0;
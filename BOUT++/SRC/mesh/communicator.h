@@ -29,6 +29,7 @@ class Communicator;
 
 #include "globals.h"
 #include "field_data.h"
+#include "dcomplex.h"
 
 #include <vector>
 
@@ -43,6 +44,9 @@ class Communicator;
  * \note July 2008: Modified to communicate in X and Y. Generalised to use the FieldData
  * interface. Changed to use MPI_Isend instead of MPI_Send, and MPI_Waitany instead of MPI_Wait
  * for (hopefully) faster communications.
+ *
+ * \note Twist-shifts (TwistOrder = 0) are applied by the sender to the packed buffer,
+ * transforming all pencils in a message with one batch of FFTs.
  */
 class Communicator {
  public:
@@ -67,6 +71,10 @@ class Communicator {
   /// Perform communications. Same as send() then receive();
   void run();
 
+  /// Send the data unchanged, without twist-shift
+  /// Used to communicate integer data such as indices
+  void setRaw(bool r = true) { raw = r; }
+
   /// Elapsed wall-time. Used to keep track of time spent communicating
   static real wtime;
  private:
@@ -85,6 +93,12 @@ class Communicator {
   int unpack_data(int xge, int xlt, int yge, int ylt, real *buffer);
   /// Calculates the size of a message for a given x and y range
   int msg_len(int xge, int xlt, int yge, int ylt);
+  /// Twist-shift the 3D data in a packed buffer, for a message going up (+ve Y) or down
+  void shift_data(int xge, int xlt, int yge, int ylt, real *buffer, bool up);
+
+  int tslen;        ///< Number of Z pencils the twist-shift arrays can hold
+  real *ts_data;    ///< Pencils gathered from the buffer
+  dcomplex *ts_fft; ///< Fourier transform of ts_data
   
   /// Array of request handles for MPI
   MPI_Request request[6];
@@ -96,6 +110,8 @@ class Communicator {
   static bool async_send; ///< Switch to asyncronous sends (ISend, not Send)
   static bool pre_post; ///< Post receives early. May speed up comms.
 
+  bool raw; ///< Don't modify the data (see setRaw)
+
   /// When using pre_post, need to make an exception for first time
   bool first_time;
 
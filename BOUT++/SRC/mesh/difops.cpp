@@ -32,6 +32,7 @@
 #include "invert_laplace.h" // Delp2 uses same coefficients as inversion code
 
 #include "interpolation.h"
+#include "profile.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -66,7 +67,7 @@ const Field2D Grad_par(const Field2D &var, DIFF_METHOD method, CELL_LOC outloc)
   return Grad_par(var, outloc, method);
 }
 
-const Field3D Grad_par(const Field3D &var, CELL_LOC outloc, DIFF_METHOD method)
+Field3D Grad_par(const Field3D &var, CELL_LOC outloc, DIFF_METHOD method)
 {
 #ifdef CHECK
   int msg_pos = msg_stack.push("Grad_par( Field3D )");
@@ -86,7 +87,7 @@ const Field3D Grad_par(const Field3D &var, CELL_LOC outloc, DIFF_METHOD method)
   return result;
 }
 
-const Field3D Grad_par(const Field3D &var, DIFF_METHOD method, CELL_LOC outloc)
+Field3D Grad_par(const Field3D &var, DIFF_METHOD method, CELL_LOC outloc)
 {
   return Grad_par(var, outloc, method);
 }
@@ -101,12 +102,12 @@ const Field2D Vpar_Grad_par(const Field2D &v, const Field2D &f)
   return VDDY(v, f)/sqrt(g_22);
 }
 
-const Field3D Vpar_Grad_par(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D Vpar_Grad_par(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
 {
   return VDDY(v, f, outloc, method)/sqrt(g_22);
 }
 
-const Field3D Vpar_Grad_par(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D Vpar_Grad_par(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return Vpar_Grad_par(v, f, outloc, method);
 }
@@ -135,7 +136,7 @@ const Field2D Div_par(const Field2D &f)
   return result;
 }
 
-const Field3D Div_par(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D Div_par(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 {
 #ifdef CHECK
   int msg_pos = msg_stack.push("Div_par( Field3D )");
@@ -154,7 +155,7 @@ const Field3D Div_par(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
   return result;
 }
 
-const Field3D Div_par(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D Div_par(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return Div_par(f, outloc, method);
 }
@@ -165,7 +166,7 @@ const Field3D Div_par(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
  *       thing needs to be thought through.
  *******************************************************************************/
 
-const Field3D Grad_par_CtoL(const Field3D &var)
+Field3D Grad_par_CtoL(const Field3D &var)
 {
   Field3D result;
   result.Allocate();
@@ -194,7 +195,7 @@ const Field3D Grad_par_CtoL(const Field3D &var)
   return result;
 }
 
-const Field3D Vpar_Grad_par_LCtoC(const Field &v, const Field &f)
+Field3D Vpar_Grad_par_LCtoC(const Field &v, const Field &f)
 {
   bindex bx;
   bstencil fval, vval;
@@ -203,22 +204,26 @@ const Field3D Vpar_Grad_par_LCtoC(const Field &v, const Field &f)
   result.Allocate();
   real ***d = result.getData();
 
-  start_index(&bx);
-  do {
-    f.SetStencil(&fval, &bx);
-    v.SetStencil(&vval, &bx);
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      f.SetStencil(&fval, &bx);
+      v.SetStencil(&vval, &bx);
     
-    // Left side
-    d[bx.jx][bx.jy][bx.jz] = (vval.cc >= 0.0) ? vval.cc * fval.ym : vval.cc * fval.cc;
-    // Right side
-    d[bx.jx][bx.jy][bx.jz] -= (vval.yp >= 0.0) ? vval.yp * fval.cc : vval.yp * fval.yp;
+      // Left side
+      d[bx.jx][bx.jy][bx.jz] = (vval.cc >= 0.0) ? vval.cc * fval.ym : vval.cc * fval.cc;
+      // Right side
+      d[bx.jx][bx.jy][bx.jz] -= (vval.yp >= 0.0) ? vval.yp * fval.cc : vval.yp * fval.yp;
     
-  }while(next_index3(&bx));
+    }
+  }
 
   return result;
 }
 
-const Field3D Grad_par_LtoC(const Field &var)
+Field3D Grad_par_LtoC(const Field &var)
 {
   bindex bx;
   bstencil f;
@@ -227,23 +232,27 @@ const Field3D Grad_par_LtoC(const Field &var)
   result.Allocate();
   real ***d = result.getData();
 
-  start_index(&bx);
-  do {
-    var.SetStencil(&f, &bx);
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      var.SetStencil(&f, &bx);
     
-    d[bx.jx][bx.jy][bx.jz] = (f.yp - f.cc) / (dy[bx.jx][bx.jy] * sqrt(g_22[bx.jx][bx.jy]));
-  }while(next_index3(&bx));
+      d[bx.jx][bx.jy][bx.jz] = (f.yp - f.cc) / (dy[bx.jx][bx.jy] * sqrt(g_22[bx.jx][bx.jy]));
+    }
+  }
 
   return result;
 }
 
-const Field3D Div_par_LtoC(const Field2D &var)
+Field3D Div_par_LtoC(const Field2D &var)
 {
   Field3D result = Bxy*Grad_par_LtoC(var/Bxy);
   return result;
 }
 
-const Field3D Div_par_LtoC(const Field3D &var)
+Field3D Div_par_LtoC(const Field3D &var)
 {
   Field3D result = Bxy*Grad_par_LtoC(var/Bxy);
   return result;
@@ -274,7 +283,7 @@ const Field2D Grad2_par2(const Field2D &f)
   return result;
 }
 
-const Field3D Grad2_par2(const Field3D &f)
+Field3D Grad2_par2(const Field3D &f)
 {
 #ifdef CHECK
   int msg_pos = msg_stack.push("Grad2_par2( Field3D )");
@@ -303,17 +312,17 @@ const Field2D Div_par_K_Grad_par(Field2D &kY, Field2D &f)
   return kY*Grad2_par2(f) + Div_par(kY)*Grad_par(f);
 }
 
-const Field3D Div_par_K_Grad_par(Field2D &kY, Field3D &f)
+Field3D Div_par_K_Grad_par(Field2D &kY, Field3D &f)
 {
   return kY*Grad2_par2(f) + Div_par(kY)*Grad_par(f);
 }
 
-const Field3D Div_par_K_Grad_par(Field3D &kY, Field2D &f)
+Field3D Div_par_K_Grad_par(Field3D &kY, Field2D &f)
 {
   return kY*Grad2_par2(f) + Div_par(kY)*Grad_par(f);
 }
 
-const Field3D Div_par_K_Grad_par(Field3D &kY, Field3D &f)
+Field3D Div_par_K_Grad_par(Field3D &kY, Field3D &f)
 {
   return kY*Grad2_par2(f) + Div_par(kY)*Grad_par(f);
 }
@@ -338,8 +347,9 @@ const Field2D Delp2(const Field2D &f)
   return result;
 }
 
-const Field3D Delp2(const Field3D &f, real zsmooth)
+Field3D Delp2(const Field3D &f, real zsmooth)
 {
+  PROFILE_REGION("Delp2");
   Field3D result;
   real ***fd, ***rd;
 
@@ -446,7 +456,7 @@ const Field2D Laplacian(const Field2D &f)
   return result;
 }
 
-const Field3D Laplacian(const Field3D &f)
+Field3D Laplacian(const Field3D &f)
 {
 #ifdef CHECK
   int msg_pos = msg_stack.push("Laplacian( Field3D )");
@@ -507,7 +517,7 @@ const Field2D b0xGrad_dot_Grad(const Field2D &phi, const Field2D &A)
   return result;
 }
 
-const Field3D b0xGrad_dot_Grad(const Field2D &phi, const Field3D &A)
+Field3D b0xGrad_dot_Grad(const Field2D &phi, const Field3D &A)
 {
   Field2D dpdx, dpdy, dpdz;
   Field2D vx, vy, vz;
@@ -545,7 +555,7 @@ const Field3D b0xGrad_dot_Grad(const Field2D &phi, const Field3D &A)
   return result;
 }
 
-const Field3D b0xGrad_dot_Grad(const Field3D &p, const Field2D &A, CELL_LOC outloc)
+Field3D b0xGrad_dot_Grad(const Field3D &p, const Field2D &A, CELL_LOC outloc)
 {
   Field3D dpdx, dpdy, dpdz;
   Field3D vx, vy, vz;
@@ -585,8 +595,9 @@ const Field3D b0xGrad_dot_Grad(const Field3D &p, const Field2D &A, CELL_LOC outl
   return result;
 }
 
-const Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field3D &A, CELL_LOC outloc)
+Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field3D &A, CELL_LOC outloc)
 {
+  PROFILE_REGION("b0xGrad_dot_Grad");
   Field3D dpdx, dpdy, dpdz;
   Field3D vx, vy, vz;
   Field3D result;
@@ -622,3 +633,121 @@ const Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field3D &A, CELL_LOC ou
 #endif
   return result;
 }
+
+/*******************************************************************************
+ * bracket
+ * Poisson bracket [f, g] in X-Z, i.e. b0xGrad_dot_Grad(f, g) without the
+ * Y derivative terms. The non-standard methods compute the result in a single
+ * pass over the data, with no temporary fields
+ *******************************************************************************/
+
+Field3D bracket(const Field3D &f, const Field3D &g, BRACKET_METHOD method)
+{
+  PROFILE_REGION("bracket");
+  Field3D result;
+
+#ifdef CHECK
+  int msg_pos = msg_stack.push("bracket( Field3D , Field3D )");
+#endif
+
+#ifndef METRIC3D
+  if((f.getLocation() != CELL_CENTRE) || (g.getLocation() != CELL_CENTRE))
+    method = BRACKET_STD; // Staggered grids not handled here
+#else
+  method = BRACKET_STD; // Single-pass methods assume 2D metric
+#endif
+  
+  if(method == BRACKET_STD) {
+    // As b0xGrad_dot_Grad, but only the X and Z terms
+    Field3D vx = g_22*DDZ(f);
+    Field3D vz = -g_22*DDX(f);
+    if(ShiftXderivs && IncIntShear)
+      vz += IntShiftTorsion * vx; // Cancels I*DDZ(f) added by DDX
+    
+    result = VDDX(vx, g) + VDDZ(vz, g);
+    result /= J*sqrt(g_22);
+#ifdef TRACK
+    result.name = "bracket("+f.name+","+g.name+")";
+#endif
+#ifdef CHECK
+    msg_stack.pop(msg_pos);
+#endif
+    return result;
+  }
+
+#ifndef METRIC3D
+  // X neighbours need to be in real space
+  Field3D fs = f, gs = g;
+  if(ShiftXderivs) {
+    fs = f.ShiftZ(true);
+    gs = g.ShiftZ(true);
+  }
+
+  result.Allocate();
+  
+  real ***fd = fs.getData();
+  real ***gd = gs.getData();
+  real ***rd = result.getData();
+
+  for(int jx=0;jx<ngx;jx++)
+    for(int jy=0;jy<ngy;jy++)
+      for(int jz=0;jz<ngz;jz++)
+	rd[jx][jy][jz] = 0.0;
+
+  for(int jx=MXG;jx<ngx-MXG;jx++)
+    for(int jy=jstart;jy<=jend;jy++) {
+      // b0 x Grad(f) dot Grad(g) = g_22 / (J sqrt(g_22)) * (df/dz dg/dx - df/dx dg/dz)
+      real coef = sqrt(g_22[jx][jy]) / J[jx][jy];
+      real fac = coef / (4.0*dx[jx][jy]*dz);
+
+      real *fm = fd[jx-1][jy], *fc = fd[jx][jy], *fp = fd[jx+1][jy];
+      real *gm = gd[jx-1][jy], *gc = gd[jx][jy], *gp = gd[jx+1][jy];
+      real *r = rd[jx][jy];
+
+      int jzm = ncz-1;
+      for(int jz=0;jz<ncz;jz++) {
+	int jzp = (jz == ncz-1) ? 0 : jz+1;
+
+	// J++ : central differences
+	real jpp = (fc[jzp] - fc[jzm])*(gp[jz] - gm[jz])
+	  - (fp[jz] - fm[jz])*(gc[jzp] - gc[jzm]);
+	
+	if(method == BRACKET_ARAKAWA) {
+	  // J+x : f at the centre of each side, g at the corners
+	  real jpx = fc[jzp]*(gp[jzp] - gm[jzp])
+	    - fc[jzm]*(gp[jzm] - gm[jzm])
+	    - fp[jz]*(gp[jzp] - gp[jzm])
+	    + fm[jz]*(gm[jzp] - gm[jzm]);
+	  
+	  // Jx+ : g at the centre of each side, f at the corners
+	  real jxp = gp[jz]*(fp[jzp] - fp[jzm])
+	    - gm[jz]*(fm[jzp] - fm[jzm])
+	    - gc[jzp]*(fp[jzp] - fm[jzp])
+	    + gc[jzm]*(fp[jzm] - fm[jzm]);
+	  
+	  r[jz] = fac*(jpp + jpx + jxp) / 3.0;
+	}else
+	  r[jz] = fac*jpp;
+
+	jzm = jz;
+      }
+      r[ncz] = r[0]; // Periodic point
+    }
+  
+  if(ShiftXderivs)
+    result = result.ShiftZ(false); // Shift back
+
+#ifdef CHECK
+  // Mark boundaries as invalid
+  result.bndry_xin = result.bndry_xout = result.bndry_yup = result.bndry_ydown = false;
+#endif
+#endif // METRIC3D
+
+#ifdef TRACK
+  result.name = "bracket("+f.name+","+g.name+")";
+#endif
+#ifdef CHECK
+  msg_stack.pop(msg_pos);
+#endif
+  return result;
+}
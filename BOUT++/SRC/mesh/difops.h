@@ -44,51 +44,56 @@
 const Field2D Grad_par(const Field2D &var, CELL_LOC outloc=CELL_DEFAULT, DIFF_METHOD method=DIFF_DEFAULT);
 const Field2D Grad_par(const Field2D &var, DIFF_METHOD method, CELL_LOC outloc=CELL_DEFAULT);
 
-const Field3D Grad_par(const Field3D &var, CELL_LOC outloc=CELL_DEFAULT, DIFF_METHOD method=DIFF_DEFAULT);
-const Field3D Grad_par(const Field3D &var, DIFF_METHOD method, CELL_LOC outloc=CELL_DEFAULT);
+Field3D Grad_par(const Field3D &var, CELL_LOC outloc=CELL_DEFAULT, DIFF_METHOD method=DIFF_DEFAULT);
+Field3D Grad_par(const Field3D &var, DIFF_METHOD method, CELL_LOC outloc=CELL_DEFAULT);
 
 // vpar times parallel derivative (upwinding)
 const Field2D Vpar_Grad_par(const Field2D &v, const Field2D &f);
-const Field3D Vpar_Grad_par(const Field &v, const Field &f, 
+Field3D Vpar_Grad_par(const Field &v, const Field &f, 
 			    CELL_LOC outloc=CELL_DEFAULT, DIFF_METHOD method=DIFF_DEFAULT);
-const Field3D Vpar_Grad_par(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc=CELL_DEFAULT);
+Field3D Vpar_Grad_par(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc=CELL_DEFAULT);
 
 
 // parallel divergence operator B \partial_{||} (F/B)
 const Field2D Div_par(const Field2D &f);
-const Field3D Div_par(const Field3D &f, 
+Field3D Div_par(const Field3D &f, 
 		      CELL_LOC outloc=CELL_DEFAULT, DIFF_METHOD method=DIFF_DEFAULT);
-const Field3D Div_par(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc = CELL_DEFAULT);
+Field3D Div_par(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc = CELL_DEFAULT);
 
 // second parallel derivative
 const Field2D Grad2_par2(const Field2D &f);
-const Field3D Grad2_par2(const Field3D &f);
+Field3D Grad2_par2(const Field3D &f);
 
 // Parallel derivatives, converting between cell-centred and lower cell boundary
-const Field3D Grad_par_CtoL(const Field3D &var);
-const Field3D Vpar_Grad_par_LCtoC(const Field &v, const Field &f);
-const Field3D Grad_par_LtoC(const Field &var);
-const Field3D Div_par_LtoC(const Field2D &var);
-const Field3D Div_par_LtoC(const Field3D &var);
+Field3D Grad_par_CtoL(const Field3D &var);
+Field3D Vpar_Grad_par_LCtoC(const Field &v, const Field &f);
+Field3D Grad_par_LtoC(const Field &var);
+Field3D Div_par_LtoC(const Field2D &var);
+Field3D Div_par_LtoC(const Field3D &var);
 
 // Parallel divergence of diffusive flux, K*Grad_par
 const Field2D Div_par_K_Grad_par(Field2D &kY, Field2D &f);
-const Field3D Div_par_K_Grad_par(Field2D &kY, Field3D &f);
-const Field3D Div_par_K_Grad_par(Field3D &kY, Field2D &f);
-const Field3D Div_par_K_Grad_par(Field3D &kY, Field3D &f);
+Field3D Div_par_K_Grad_par(Field2D &kY, Field3D &f);
+Field3D Div_par_K_Grad_par(Field3D &kY, Field2D &f);
+Field3D Div_par_K_Grad_par(Field3D &kY, Field3D &f);
 
 // perpendicular Laplacian operator
 const Field2D Delp2(const Field2D &f);
-const Field3D Delp2(const Field3D &f, real zsmooth=0.4);
+Field3D Delp2(const Field3D &f, real zsmooth=0.4);
 
 // Full Laplacian operator
 const Field2D Laplacian(const Field2D &f);
-const Field3D Laplacian(const Field3D &f);
+Field3D Laplacian(const Field3D &f);
 
 // Terms of form b0 x Grad(phi) dot Grad(A)
 const Field2D b0xGrad_dot_Grad(const Field2D &phi, const Field2D &A);
-const Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field2D &A, CELL_LOC outloc=CELL_DEFAULT);
-const Field3D b0xGrad_dot_Grad(const Field2D &phi, const Field3D &A);
-const Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field3D &A, CELL_LOC outloc=CELL_DEFAULT);
+Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field2D &A, CELL_LOC outloc=CELL_DEFAULT);
+Field3D b0xGrad_dot_Grad(const Field2D &phi, const Field3D &A);
+Field3D b0xGrad_dot_Grad(const Field3D &phi, const Field3D &A, CELL_LOC outloc=CELL_DEFAULT);
+
+// Poisson bracket in X-Z: same as b0xGrad_dot_Grad(f, g) without Y derivatives
+// BRACKET_STD upwinds g as b0xGrad_dot_Grad does. Other methods are single-pass central
+// differences: BRACKET_SIMPLE, or BRACKET_ARAKAWA which conserves energy and enstrophy
+Field3D bracket(const Field3D &f, const Field3D &g, BRACKET_METHOD method = BRACKET_STD);
 
 #endif /* __DIFOPS_H__ */
@@ -41,6 +41,10 @@
 #include "fft.h" // For reading 3D variables
 #include "dcomplex.h"
 
+#include "bin_format.h" // For grid cache
+
+#include <sys/stat.h>
+
 #include "bout_types.h"
 
 /*******************************************************************************
@@ -168,6 +172,328 @@ void GridFile::close()
   isOpen = false;
 }
 
+/*******************************************************************************
+ * GridSynthetic class
+ * 
+ * Every variable is constant, so fetch just fills the requested block
+ *******************************************************************************/
+
+GridSynthetic::GridSynthetic(const char *section)
+{
+  int nx, ny;
+  real dxval, dyval;
+  
+  options.setSection(section);
+  options.get("nx", nx, 68);
+  options.get("ny", ny, 32);
+  options.get("dx", dxval, 1.0);
+  options.get("dy", dyval, 1.0);
+  
+  vals["nx"] = nx;
+  vals["ny"] = ny;
+  vals["dx"] = dxval;
+  vals["dy"] = dyval;
+  
+  // Closed field-lines everywhere, so Y is periodic
+  vals["ixseps1"] = vals["ixseps2"] = nx;
+  vals["jyseps1_1"] = -1;
+  vals["jyseps1_2"] = vals["jyseps2_1"] = vals["ny_inner"] = ny/2;
+  vals["jyseps2_2"] = ny-1;
+}
+
+bool GridSynthetic::hasVar(const char *name)
+{
+  return vals.find(string(name)) != vals.end();
+}
+
+vector<int> GridSynthetic::getSize(const char *name)
+{
+  vector<int> s;
+  if(hasVar(name))
+    s.push_back(1);
+  return s;
+}
+
+bool GridSynthetic::setOrigin(int x, int y, int z)
+{
+  return true;
+}
+
+bool GridSynthetic::fetch(int *var, const char *name, int lx, int ly, int lz)
+{
+  return fetch(var, string(name), lx, ly, lz);
+}
+
+bool GridSynthetic::fetch(int *var, const string &name, int lx, int ly, int lz)
+{
+  std::map<string, real>::iterator it = vals.find(name);
+  if(it == vals.end())
+    return false;
+  
+  int len = lx * ((ly > 0) ? ly : 1) * ((lz > 0) ? lz : 1);
+  for(int i=0;i<len;i++)
+    var[i] = ROUND(it->second);
+  return true;
+}
+
+bool GridSynthetic::fetch(real *var, const char *name, int lx, int ly, int lz)
+{
+  return fetch(var, string(name), lx, ly, lz);
+}
+
+bool GridSynthetic::fetch(real *var, const string &name, int lx, int ly, int lz)
+{
+  std::map<string, real>::iterator it = vals.find(name);
+  if(it == vals.end())
+    return false;
+  
+  int len = lx * ((ly > 0) ? ly : 1) * ((lz > 0) ? lz : 1);
+  for(int i=0;i<len;i++)
+    var[i] = it->second;
+  return true;
+}
+
+/*******************************************************************************
+ * GridCollective class
+ * 
+ * Reads each variable on one processor, and broadcasts to the others.
+ *******************************************************************************/
+
+GridCollective::GridCollective(GridDataSource *src, MPI_Comm c, const char *cacheprefix)
+{
+  source = src;
+  comm = c;
+  MPI_Comm_rank(comm, &rank);
+  
+  if(cacheprefix != NULL)
+    cache = string(cacheprefix);
+  
+  loaded = false;
+  x0 = y0 = z0 = 0;
+}
+
+GridCollective::~GridCollective()
+{
+  if(source != NULL)
+    delete source;
+}
+
+bool GridCollective::hasVar(const char *name)
+{
+  vector<int> s = getSize(name);
+  
+  return s.size() != 0;
+}
+
+vector<int> GridCollective::getSize(const char *name)
+{
+  string sname(name);
+  std::map<string, vector<int> >::iterator it = sizes.find(sname);
+  if(it != sizes.end())
+    return it->second;
+  
+  vector<int> s;
+  int n = 0;
+  if(rank == 0) {
+    bool found = false;
+    if(!cache.empty()) {
+      // Try the cache first
+      BinFormat bin;
+      if(bin.openr(cache + "." + sname + ".bin")) {
+	s = bin.getSize(name);
+	found = (s.size() != 0);
+	bin.close();
+      }
+    }
+    if(!found && (source != NULL))
+      s = source->getSize(name);
+    n = s.size();
+  }
+  
+  MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+  s.resize(n);
+  if(n > 0)
+    MPI_Bcast(&s[0], n, MPI_INT, 0, comm);
+  
+  sizes[sname] = s;
+  
+  return s;
+}
+
+bool GridCollective::setOrigin(int x, int y, int z)
+{
+  x0 = x;
+  y0 = y;
+  z0 = z;
+  
+  return true;
+}
+
+bool GridCollective::fetch(int *var, const char *name, int lx, int ly, int lz)
+{
+  if((lx < 0) || (ly < 0) || (lz < 0))
+    return false;
+
+  int n = ((lx > 0) ? lx : 1) * ((ly > 0) ? ly : 1) * ((lz > 0) ? lz : 1);
+  real *r = new real[n];
+  
+  bool success = copyData(r, name, lx, ly, lz);
+  if(success)
+    for(int i=0;i<n;i++)
+      var[i] = ROUND(r[i]);
+  
+  delete[] r;
+  return success;
+}
+
+bool GridCollective::fetch(int *var, const string &name, int lx, int ly, int lz)
+{
+  return fetch(var, name.c_str(), lx, ly, lz);
+}
+
+bool GridCollective::fetch(real *var, const char *name, int lx, int ly, int lz)
+{
+  return copyData(var, name, lx, ly, lz);
+}
+
+bool GridCollective::fetch(real *var, const string &name, int lx, int ly, int lz)
+{
+  return copyData(var, name.c_str(), lx, ly, lz);
+}
+
+void GridCollective::open(const char *name)
+{
+  if(name == NULL)
+    return;
+  
+  if(loaded && (varname == string(name)))
+    return; // Already have this variable
+  
+#ifdef CHECK
+  int msg_point = msg_stack.push("GridCollective::open(%s)", name);
+#endif
+
+  int ok = 0;
+  if(rank == 0)
+    ok = readVar(name, size, data) ? 1 : 0;
+  
+  MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+  
+  if(ok) {
+    int n = size.size();
+    MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+    size.resize(n);
+    MPI_Bcast(&size[0], n, MPI_INT, 0, comm);
+    
+    long len = 1;
+    for(int i=0;i<n;i++)
+      len *= size[i];
+    data.resize(len);
+    MPI_Bcast(&data[0], len, MPI_DOUBLE, 0, comm);
+    
+    varname = string(name);
+    loaded = true;
+  }else
+    loaded = false;
+  
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+}
+
+void GridCollective::close()
+{
+  loaded = false;
+  vector<real>().swap(data); // Release the memory
+}
+
+/// Read a whole variable from the cache or source. Only called on the reader
+bool GridCollective::readVar(const char *name, vector<int> &s, vector<real> &d)
+{
+  string cachefile;
+  if(!cache.empty()) {
+    cachefile = cache + "." + string(name) + ".bin";
+    
+    BinFormat bin;
+    if(bin.openr(cachefile)) {
+      s = bin.getSize(name);
+      if(s.size() != 0) {
+	long len = 1;
+	for(size_t i=0;i<s.size();i++)
+	  len *= s[i];
+	d.resize(len);
+	if(bin.read(&d[0], name, s[0], (s.size() > 1) ? s[1] : 0, (s.size() > 2) ? s[2] : 0))
+	  return true;
+      }
+    }
+  }
+  
+  if(source == NULL)
+    return false;
+  
+  s = source->getSize(name);
+  if(s.size() == 0)
+    return false;
+  
+  long len = 1;
+  for(size_t i=0;i<s.size();i++)
+    len *= s[i];
+  d.resize(len);
+  
+  int lx = s[0];
+  int ly = (s.size() > 1) ? s[1] : 0;
+  int lz = (s.size() > 2) ? s[2] : 0;
+
+  source->open(name);
+  source->setOrigin();
+  bool success = source->fetch(&d[0], name, lx, ly, lz);
+  source->close();
+  
+  if(!success)
+    return false;
+  
+  if(!cachefile.empty()) {
+    // Store in the cache for next time
+    BinFormat bin;
+    if(!bin.openw(cachefile) || !bin.write(&d[0], name, lx, ly, lz)) {
+      output.write("\tWARNING: Could not write grid cache file '%s'\n", cachefile.c_str());
+    }
+    bin.close();
+  }
+  
+  return true;
+}
+
+/// Copy part of the loaded variable, starting at the origin
+bool GridCollective::copyData(real *var, const char *name, int lx, int ly, int lz)
+{
+  if(!loaded || (varname != string(name)))
+    return false;
+  
+  if((lx < 0) || (ly < 0) || (lz < 0))
+    return false;
+  
+  int sx = (size.size() > 0) ? size[0] : 1;
+  int sy = (size.size() > 1) ? size[1] : 1;
+  int sz = (size.size() > 2) ? size[2] : 1;
+  
+  int nx = (lx > 0) ? lx : 1;
+  int ny = (ly > 0) ? ly : 1;
+  int nz = (lz > 0) ? lz : 1;
+  
+  if((x0 < 0) || (y0 < 0) || (z0 < 0) ||
+     (x0 + nx > sx) || (y0 + ny > sy) || (z0 + nz > sz))
+    return false;
+  
+  for(int i=0;i<nx;i++)
+    for(int j=0;j<ny;j++)
+      memcpy(var + ((long) i*ny + j)*nz,
+	     &data[((long) (x0+i)*sy + (y0+j))*sz + z0],
+	     nz*sizeof(real));
+  
+  return true;
+}
+
 /*******************************************************************************
  * GridData class
  *******************************************************************************/
@@ -884,14 +1210,8 @@ int GridData::readgrid_3dvar(GridDataSource *s, const char *name,
       }
       
       // Inverse FFT, shifting in the z direction
-      for(int jz=0;jz<=ncz/2;jz++) {
-	real kwave;
-	
-	kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
-      
-	// Multiply by EXP(ik*zoffset)
-	fdata[jz] *= dcomplex(cos(kwave*zShift[jx][jy]) , sin(kwave*zShift[jx][jy]));
-      }
+      // Multiply by EXP(ik*zoffset)
+      cmulconj(fdata, zshift_phase(zShift[jx][jy]), ncz/2+1);
       
       irfft(fdata, ncz, var[jx][ydest+jy]);
     }
@@ -957,12 +1277,50 @@ void GridData::cpy_2d_data(int yfrom, int yto, int xge, int xlt, real **var)
 */
 bool grid_read(DataFormat *format, const char *gridfilename)
 {
+  GridDataSource *source = new GridFile(format, gridfilename);
+
+  options.setSection(NULL);
+  bool grid_collective;
+  OPTION(grid_collective, false);
+  if(grid_collective) {
+    output.write("\tReading grid on one processor\n");
+    
+    /// Cache files are named after the grid file, its size and modification time
+    char *cachedir = options.getString("grid_cache");
+    char *prefix = NULL;
+    if((cachedir != NULL) && (MYPE == 0)) {
+      struct stat st;
+      if(stat(gridfilename, &st) == 0) {
+	const char *base = strrchr(gridfilename, '/');
+	base = (base == NULL) ? gridfilename : base+1;
+	
+	prefix = new char[strlen(cachedir) + strlen(base) + 64];
+	sprintf(prefix, "%s/%s.%lx.%lx", cachedir, base, 
+		(unsigned long) st.st_size, (unsigned long) st.st_mtime);
+	output.write("\tUsing grid cache '%s'\n", prefix);
+      }
+    }
+    
+    source = new GridCollective(source, MPI_COMM_WORLD, prefix);
+    
+    if(prefix != NULL)
+      delete[] prefix;
+  }
+
   /// Add a grid file source
-  grid.addSource(new GridFile(format, gridfilename));
+  grid.addSource(source);
   /// Read the basic topology data
   return grid.loadTopology();
 }
 
+/// Use a synthetic grid instead of a file (see GridSynthetic)
+bool grid_synthetic(const char *section)
+{
+  output.write("\tUsing synthetic grid from section [%s]\n", section);
+  grid.addSource(new GridSynthetic(section));
+  return grid.loadTopology();
+}
+
 int grid_load(real &r, const char *name)
 {
   return grid.get(r, name);
@@ -32,7 +32,10 @@
 #include "dataformat.h"
 #include "bout_types.h"
 
+#include "mpi.h"
+
 #include <list>
+#include <map>
 
 /// Interface class to serve grid data
 /*!
@@ -97,6 +100,90 @@ class GridFile : public GridDataSource {
   bool isOpen;
 };
 
+/// Collective interface to another grid data source
+/*!
+ * Only one processor (rank 0 in the communicator) reads from the 
+ * underlying source. Each variable is read as a whole in a single
+ * call when opened, and broadcast to all processors, which then
+ * serve fetch requests from memory. Size queries are also answered by
+ * the reader and broadcast, so the file is only opened by one processor.
+ *
+ * All methods must therefore be called by all processors in the same order.
+ *
+ * If a cache prefix is given, each variable read is also stored as a binary
+ * file (see bin_format.h), which is used in preference to the original source.
+ * This is intended for grids shared between many runs.
+ */
+class GridCollective : public GridDataSource {
+ public:
+  GridCollective(GridDataSource *src, MPI_Comm comm = MPI_COMM_WORLD, const char *cacheprefix = NULL);
+  ~GridCollective();
+
+  virtual bool hasVar(const char *name);
+  
+  virtual vector<int> getSize(const char *name);
+
+  virtual bool setOrigin(int x = 0, int y = 0, int z = 0);
+
+  virtual bool fetch(int *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  virtual bool fetch(int *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+  virtual bool fetch(real *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  virtual bool fetch(real *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+  
+  virtual void open(const char *name = NULL);
+  virtual void close();
+ private:
+  GridDataSource *source; ///< Only used on the reader
+  MPI_Comm comm;
+  int rank;
+  
+  string cache; ///< Cache file prefix. Empty if no cache
+  
+  std::map<string, vector<int> > sizes; ///< Sizes of variables already queried
+  
+  string varname;    ///< Name of the variable currently loaded
+  vector<int> size;  ///< Size of the loaded variable
+  vector<real> data; ///< Data for the whole variable
+  bool loaded;
+  
+  int x0, y0, z0;
+  
+  bool readVar(const char *name, vector<int> &s, vector<real> &d); ///< Read on the reader
+  bool copyData(real *var, const char *name, int lx, int ly, int lz);
+};
+
+/// Synthetic grid for testing and benchmarking
+/*!
+ * Supplies a uniform, orthogonal grid without reading a file. The size
+ * and grid spacing are read from an options section:
+ *
+ * [synthetic]
+ * nx = 68    # Including 2*MXG boundary cells
+ * ny = 32
+ * dx = 1.0
+ * dy = 1.0
+ *
+ * All other quantities take their defaults in GridData (unit metric,
+ * periodic in Y, no shift).
+ */
+class GridSynthetic : public GridDataSource {
+ public:
+  GridSynthetic(const char *section = "synthetic");
+  
+  virtual bool hasVar(const char *name);
+  
+  virtual vector<int> getSize(const char *name);
+
+  virtual bool setOrigin(int x = 0, int y = 0, int z = 0);
+
+  virtual bool fetch(int *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  virtual bool fetch(int *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+  virtual bool fetch(real *var, const char *name, int lx = 1, int ly = 0, int lz = 0);
+  virtual bool fetch(real *var, const string &name, int lx = 1, int ly = 0, int lz = 0);
+ private:
+  std::map<string, real> vals; ///< Constant value of each variable
+};
+
 /// Class to handle equilibrium grid quantities
 /*!
  * Physics code requests data from this class.
@@ -150,6 +237,7 @@ class GridData {
 };
 
 bool grid_read(DataFormat *format, const char *gridfilename);
+bool grid_synthetic(const char *section = "synthetic");
 
 int grid_load(real &r, const char *name);
 int grid_load(int &i, const char *name);
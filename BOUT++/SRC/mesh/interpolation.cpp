@@ -50,7 +50,7 @@ Communicator interp_comm;
   @param[in]   var  Input variable
   @param[in]   loc  Location of output values
 */
-const Field3D interp_to(const Field3D &var, CELL_LOC loc)
+Field3D interp_to(const Field3D &var, CELL_LOC loc)
 {
   if(StaggerGrids && (var.getLocation() != loc)) {
     
@@ -81,29 +81,41 @@ const Field3D interp_to(const Field3D &var, CELL_LOC loc)
 
       switch(dir) {
       case CELL_XLOW: {
-	start_index(&bx, RGN_NOX);
-	do {
-	  var.SetXStencil(s, bx, loc);
-	  d[bx.jx][bx.jy][bx.jz] = interp(s);
-	}while(next_index3(&bx));
+	const Region &rgn = get_region(RGN_NOX);
+	for(int i=0;i<rgn.size();i++) {
+	  bx = rgn[i];
+	  for(int jz=0;jz<ncz;jz++) {
+	    set_zindex(bx, jz);
+	    var.SetXStencil(s, bx, loc);
+	    d[bx.jx][bx.jy][bx.jz] = interp(s);
+	  }
+	}
 	break;
 	// Need to communicate in X
       }
       case CELL_YLOW: {
-	start_index(&bx, RGN_NOY);
-	do {
-	  var.SetYStencil(s, bx, loc);
-	  d[bx.jx][bx.jy][bx.jz] = interp(s);
-	}while(next_index3(&bx));
+	const Region &rgn = get_region(RGN_NOY);
+	for(int i=0;i<rgn.size();i++) {
+	  bx = rgn[i];
+	  for(int jz=0;jz<ncz;jz++) {
+	    set_zindex(bx, jz);
+	    var.SetYStencil(s, bx, loc);
+	    d[bx.jx][bx.jy][bx.jz] = interp(s);
+	  }
+	}
 	break;
 	// Need to communicate in Y
       }
       case CELL_ZLOW: {
-	start_index(&bx, RGN_NOZ);
-	do {
-	  var.SetZStencil(s, bx, loc);
-	  d[bx.jx][bx.jy][bx.jz] = interp(s);
-	}while(next_index3(&bx));
+	const Region &rgn = get_region(RGN_NOZ);
+	for(int i=0;i<rgn.size();i++) {
+	  bx = rgn[i];
+	  for(int jz=0;jz<ncz;jz++) {
+	    set_zindex(bx, jz);
+	    var.SetZStencil(s, bx, loc);
+	    d[bx.jx][bx.jy][bx.jz] = interp(s);
+	  }
+	}
 	break;
       }
       default: {
@@ -187,7 +199,7 @@ real lagrange_4pt(real v[], real offset)
   return lagrange_4pt(v[0], v[1], v[2], v[3], offset);
 }
 
-const Field3D interpolate(const Field3D &var, const Field3D &delta_x, const Field3D &delta_z)
+Field3D interpolate(const Field3D &var, const Field3D &delta_x, const Field3D &delta_z)
 {
   Field3D result;
 
@@ -288,12 +300,12 @@ const Field3D interpolate(const Field3D &var, const Field3D &delta_x, const Fiel
   return result;
 }
 
-const Field3D interpolate(const Field2D &f, const Field3D &delta_x, const Field3D &delta_z)
+Field3D interpolate(const Field2D &f, const Field3D &delta_x, const Field3D &delta_z)
 {
   return interpolate(f, delta_x);
 }
 
-const Field3D interpolate(const Field2D &f, const Field3D &delta_x)
+Field3D interpolate(const Field2D &f, const Field3D &delta_x)
 {
   Field3D result;
 
@@ -30,7 +30,7 @@
 #include "bout_types.h"
 
 /// Interpolate to a give cell location
-const Field3D interp_to(const Field3D &var, CELL_LOC loc);
+Field3D interp_to(const Field3D &var, CELL_LOC loc);
 const Field2D interp_to(const Field2D &var, CELL_LOC loc);
 
 /// Print out the cell location (for debugging)
@@ -40,9 +40,9 @@ const char* strLocation(CELL_LOC loc);
 
 
 /// Interpolate a field onto a perturbed set of points
-const Field3D interpolate(const Field3D &f, const Field3D &delta_x, const Field3D &delta_z);
+Field3D interpolate(const Field3D &f, const Field3D &delta_x, const Field3D &delta_z);
 
-const Field3D interpolate(const Field2D &f, const Field3D &delta_x, const Field3D &delta_z);
-const Field3D interpolate(const Field2D &f, const Field3D &delta_x);
+Field3D interpolate(const Field2D &f, const Field3D &delta_x, const Field3D &delta_z);
+Field3D interpolate(const Field2D &f, const Field3D &delta_x);
 
 #endif // __INTERP_H__
@@ -38,8 +38,13 @@
 #include "fft.h"
 #include "dcomplex.h"
 #include "invert_laplace.h" // For Laplacian coefficients
+#include "profile.h"
 
 #include <math.h>
+#include <string.h>
+
+#include <map>
+using std::map;
 
 // Define types for boundary functions
 typedef void (*bndry_func3d)(Field3D &);
@@ -311,6 +316,42 @@ static BndryDesc InnerBndry = {InnerBndryTable, INNER_X, "xinner", NULL, NULL},
   UpperBndry = {UpperBndryTable, UPPER_Y, "yupper", NULL, NULL}, 
   LowerBndry = {LowerBndryTable, LOWER_Y, "ylower", NULL, NULL};
 
+/////////////// COMPILED PLANS ////////////////
+
+/// Plans are identified by the variable name and the fall-back name.
+/// Strings are copied when a plan is created
+struct BndryPlanKey {
+  const char *name, *altname;
+};
+
+struct BndryPlanLess {
+  bool operator()(const BndryPlanKey &a, const BndryPlanKey &b) const {
+    int c = strcmp(a.name, b.name);
+    if(c != 0)
+      return c < 0;
+    return strcmp(a.altname, b.altname) < 0;
+  }
+};
+
+/// Copy the strings in a key, so it can be stored in a plan map
+static BndryPlanKey copy_key(const char *name, const char *altname)
+{
+  BndryPlanKey key;
+  key.name = copy_string(name);
+  key.altname = copy_string(altname);
+  return key;
+}
+
+/// Boundary type and relaxation constant for each of the four boundaries,
+/// in the order inner, outer, upper, lower
+struct BndryRelaxPlan {
+  BNDRY_TYPE type[4];
+  real tconst[4];
+};
+
+/// Relaxation plans for 2D [0] and 3D [1] variables, which look up different boundary tables
+static map<BndryPlanKey, BndryRelaxPlan, BndryPlanLess> BndryRelaxPlans[2];
+
 /// Set boundary codes. Allows a simulation to customise
 /// different regions of the domain. E.g. for tokamaks, specify 'PF' or 'CORE'
 void BndrySetName(BNDRY_LOC loc, const char *code, const char *desc = NULL)
@@ -337,6 +378,16 @@ void BndrySetName(BNDRY_LOC loc, const char *code, const char *desc = NULL)
   
   b->code = copy_string(code);
   b->desc = copy_string(desc);
+
+  // Plans may depend on the boundary codes
+  for(int d=0;d<2;d++) {
+    for(map<BndryPlanKey, BndryRelaxPlan, BndryPlanLess>::iterator it = BndryRelaxPlans[d].begin(); 
+	it != BndryRelaxPlans[d].end(); it++) {
+      free((char*) it->first.name);
+      free((char*) it->first.altname);
+    }
+    BndryRelaxPlans[d].clear();
+  }
 }
 
 /*******************************************************************************
@@ -807,6 +858,37 @@ real getBndryRelax(const char *name, const char *altname, BndryDesc *bndry, bool
   return tconst;
 }
 
+/// The four boundaries, in the order used in BndryRelaxPlan
+static BndryDesc* BndryList[] = {&InnerBndry, &OuterBndry, &UpperBndry, &LowerBndry};
+
+/// Get the plan for a variable, reading the options the first time
+static BndryRelaxPlan& getRelaxPlan(const char* name, const char* altname, bool is3d)
+{
+  BndryPlanKey key = {name, altname};
+  map<BndryPlanKey, BndryRelaxPlan, BndryPlanLess> &plans = BndryRelaxPlans[is3d ? 1 : 0];
+  
+  map<BndryPlanKey, BndryRelaxPlan, BndryPlanLess>::iterator it = plans.find(key);
+  if(it != plans.end())
+    return it->second;
+  
+  BndryRelaxPlan plan;
+  for(int i=0;i<4;i++) {
+    const char *str = getBndryString(name, altname, BndryList[i]);
+    
+    plan.type[i] = BNDRY_NULL;
+    plan.tconst[i] = -1.0;
+    if(str != NULL) {
+      if(is3d) {
+	plan.type[i] = BndryLookup3D(BndryList[i]->table, str);
+      }else
+	plan.type[i] = BndryLookup2D(BndryList[i]->table, str);
+      plan.tconst[i] = getBndryRelax(name, altname, BndryList[i]);
+    }
+  }
+  
+  return plans.insert(std::make_pair(copy_key(name, altname), plan)).first->second;
+}
+
 //////// 3D fields /////////
 
 void apply_boundary(Field3D &var, Field3D &F_var, const char* name, const char* altname,
@@ -849,7 +931,16 @@ void apply_boundary(Field3D &var, Field3D &F_var, const char* name, const char*
 /// Setting dummy=true prints out the boundary, rather than applying it.
 void apply_boundary(Field3D &var, Field3D &F_var, const char* name, const char* altname, bool dummy = false)
 {
-  if(dummy) output.write("\tBoundary condition for '%s'\n", name);
+  if(!dummy) {
+    PROFILE_REGION("boundary");
+    // Apply the compiled plan for this variable
+    BndryRelaxPlan &plan = getRelaxPlan(name, altname, true);
+    for(int i=0;i<4;i++)
+      apply_boundary(var, F_var, BndryList[i]->loc, plan.type[i], plan.tconst[i]);
+    return;
+  }
+
+  output.write("\tBoundary condition for '%s'\n", name);
 
   /// Inner boundary
   apply_boundary(var, F_var, name, altname, &InnerBndry, dummy);
@@ -911,7 +1002,16 @@ void apply_boundary(Field2D &var, Field2D &F_var, const char* name, const char*
 /// Setting dummy=true prints out the boundary, rather than applying it.
 void apply_boundary(Field2D &var, Field2D &F_var, const char* name, const char* altname, bool dummy = false)
 {
-  if(dummy) output.write("\tBoundary condition for '%s'\n", name);
+  if(!dummy) {
+    PROFILE_REGION("boundary");
+    // Apply the compiled plan for this variable
+    BndryRelaxPlan &plan = getRelaxPlan(name, altname, false);
+    for(int i=0;i<4;i++)
+      apply_boundary(var, F_var, BndryList[i]->loc, plan.type[i], plan.tconst[i]);
+    return;
+  }
+
+  output.write("\tBoundary condition for '%s'\n", name);
 
   /// Inner boundary
   apply_boundary(var, F_var, name, altname, &InnerBndry, dummy);
@@ -1129,51 +1229,118 @@ void print_boundary(const char* name, bool covariant)
   print_boundary(buffer, name);
 }
 
-/// Applies a boundary condition, depending on setting in BOUT.inp
-void apply_boundary(Field3D &var, const char* fullname, const char* shortname)
+/*******************************************************************************
+ * Compiled boundary plans
+ *
+ * The options for each variable are looked up once, on the first call,
+ * and turned into a list of boundary functions. Subsequent calls just
+ * look up the plan (by name, without allocating) and call the functions.
+ *******************************************************************************/
+
+const int BNDRY_PLAN_MAX = 8; ///< Maximum number of functions in a plan
+
+/// List of functions to apply to a Field3D
+struct BndryPlan3D {
+  int nfuncs;
+  bndry_func3d func[BNDRY_PLAN_MAX];
+};
+
+/// List of functions to apply to a Field2D
+struct BndryPlan2D {
+  int nfuncs;
+  bndry_func2d func[BNDRY_PLAN_MAX];
+};
+
+/// Vector boundary conditions, applied after the components
+struct BndryPlanVec {
+  bool inner_divcurl, outer_divcurl;
+};
+
+static map<BndryPlanKey, BndryPlan3D, BndryPlanLess> BndryPlans3D;
+static map<BndryPlanKey, BndryPlan2D, BndryPlanLess> BndryPlans2D;
+static map<BndryPlanKey, BndryPlanVec, BndryPlanLess> BndryPlansVec;
+
+/// Get a boundary option, looking under the full name, short name then "All"
+static int getBndryOpt(const char* fullname, const char* shortname, const char *bndry)
 {
   int opt;
+  
+  if(options.getInt(fullname, bndry, opt)) // Look in the section with the variable name
+    if(options.getInt(shortname, bndry, opt))
+      if(options.getInt("All", bndry, opt)) // Otherwise look for global settings
+	opt = BNDRY_NONE; // Do nothing
+  
+  return opt;
+}
+
+/// Wrappers so that all plan entries have the same signature
+static void bndry_laplace2(Field3D &var)
+{
+  bndry_core_laplace2(var);
+  bndry_pf_laplace(var);
+}
+
+static void bndry_ydown_rotate_pos(Field3D &var)
+{
+  bndry_ydown_rotate(var);
+}
+
+static void bndry_ydown_rotate_neg(Field3D &var)
+{
+  bndry_ydown_rotate(var, true);
+}
 
-  //output.write("bndry...");
+static void plan_add(BndryPlan3D &plan, bndry_func3d func)
+{
+  plan.func[plan.nfuncs++] = func;
+}
+
+static void plan_add(BndryPlan2D &plan, bndry_func2d func)
+{
+  plan.func[plan.nfuncs++] = func;
+}
+
+/// Read the options for a Field3D and turn them into a plan
+static BndryPlan3D compile_boundary3d(const char* fullname, const char* shortname)
+{
+  BndryPlan3D plan;
+  plan.nfuncs = 0;
+  int opt;
 
   // Get inner x option
-  if(options.getInt(fullname, "xinner", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "xinner", opt))
-      if(options.getInt("All", "xinner", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "xinner");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_inner_zero(var);
+    plan_add(plan, bndry_inner_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_inner_flat(var);
+    plan_add(plan, bndry_inner_flat);
     break;
   }
   case BNDRY_LAPLACE: {
-    bndry_core_laplace2(var);
-    bndry_pf_laplace(var);
+    plan_add(plan, bndry_laplace2);
     break;
   }
   case BNDRY_LAPLACE_GRAD: {
-    bndry_inner_laplace(var);
+    plan_add(plan, bndry_inner_laplace);
     break;
   }
   case BNDRY_DIVCURL: {
     break;
   }
   case BNDRY_LAPLACE_ZERO: {
-    bndry_inner_zero_laplace(var);
+    plan_add(plan, bndry_inner_zero_laplace);
     break;
   }
   case BNDRY_LAPLACE_DECAY: {
-    bndry_inner_laplace_decay(var);
+    plan_add(plan, bndry_inner_laplace_decay);
     break;
   }
   case BNDRY_C_LAPLACE_DECAY: {
-    bndry_inner_const_laplace_decay(var);
+    plan_add(plan, bndry_inner_const_laplace_decay);
     break;
   }
   default: {
@@ -1183,31 +1350,28 @@ void apply_boundary(Field3D &var, const char* fullname, const char* shortname)
   };
 
   // Get outer x option
-  if(options.getInt(fullname, "xouter", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "xouter", opt))
-      if(options.getInt("All", "xouter", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "xouter");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_sol_zero(var);
+    plan_add(plan, bndry_sol_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_sol_flat(var);
+    plan_add(plan, bndry_sol_flat);
     break;
   }
   case BNDRY_LAPLACE: {
-    bndry_sol_laplace(var);
+    plan_add(plan, bndry_sol_laplace);
     break;
   }
   case BNDRY_LAPLACE_DECAY: {
-    bndry_outer_laplace_decay(var);
+    plan_add(plan, bndry_outer_laplace_decay);
     break;
   }
   case BNDRY_C_LAPLACE_DECAY: {
-    bndry_outer_laplace_decay(var);
+    plan_add(plan, bndry_outer_laplace_decay);
     break;
   }
   case BNDRY_DIVCURL: {
@@ -1220,31 +1384,28 @@ void apply_boundary(Field3D &var, const char* fullname, const char* shortname)
   };
 
   // Get lower y option
-  if(options.getInt(fullname, "ylower", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "ylower", opt))
-      if(options.getInt("All", "ylower", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "ylower");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_ydown_zero(var);
+    plan_add(plan, bndry_ydown_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_ydown_flat(var);
+    plan_add(plan, bndry_ydown_flat);
     break;
   }
   case BNDRY_ROTATE: {
-    bndry_ydown_rotate(var);
+    plan_add(plan, bndry_ydown_rotate_pos);
     break;
   }
   case BNDRY_ZAVERAGE: {
-    bndry_ydown_zaverage(var);
+    plan_add(plan, bndry_ydown_zaverage);
     break;
   }
   case BNDRY_ROTATE_NEG: {
-    bndry_ydown_rotate(var, true);
+    plan_add(plan, bndry_ydown_rotate_neg);
     break;
   }
   default: {
@@ -1253,22 +1414,17 @@ void apply_boundary(Field3D &var, const char* fullname, const char* shortname)
   }
   };
 
-  //output.write("ly ");
-
   // Get upper y option
-  if(options.getInt(fullname, "yupper", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "yupper", opt))
-      if(options.getInt("All", "yupper", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "yupper");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_yup_zero(var);
+    plan_add(plan, bndry_yup_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_yup_flat(var);
+    plan_add(plan, bndry_yup_flat);
     break;
   }
   default: {
@@ -1277,31 +1433,29 @@ void apply_boundary(Field3D &var, const char* fullname, const char* shortname)
   }
   };
 
-  //output.write("uy ");
-
-  bndry_toroidal(var);
+  plan_add(plan, bndry_toroidal);
 
-  //output.write("done\n");
+  return plan;
 }
 
-void apply_boundary(Field2D &var, const char* fullname, const char* shortname)
+/// Read the options for a Field2D and turn them into a plan
+static BndryPlan2D compile_boundary2d(const char* fullname, const char* shortname)
 {
+  BndryPlan2D plan;
+  plan.nfuncs = 0;
   int opt;
 
   // Get inner x option
-  if(options.getInt(fullname, "xinner", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "xinner", opt))
-      if(options.getInt("All", "xinner", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "xinner");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_inner_zero(var);
+    plan_add(plan, bndry_inner_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_inner_flat(var);
+    plan_add(plan, bndry_inner_flat);
     break;
   }
   default: {
@@ -1311,19 +1465,16 @@ void apply_boundary(Field2D &var, const char* fullname, const char* shortname)
   };
 
   // Get outer x option
-  if(options.getInt(fullname, "xouter", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "xouter", opt))
-      if(options.getInt("All", "xouter", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "xouter");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_sol_zero(var);
+    plan_add(plan, bndry_sol_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_sol_flat(var);
+    plan_add(plan, bndry_sol_flat);
     break;
   }
   default: {
@@ -1333,19 +1484,16 @@ void apply_boundary(Field2D &var, const char* fullname, const char* shortname)
   };
   
   // Get lower y option
-  if(options.getInt(fullname, "ylower", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "ylower", opt))
-      if(options.getInt("All", "ylower", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "ylower");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_ydown_zero(var);
+    plan_add(plan, bndry_ydown_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_ydown_flat(var);
+    plan_add(plan, bndry_ydown_flat);
     break;
   }
   default: {
@@ -1355,19 +1503,16 @@ void apply_boundary(Field2D &var, const char* fullname, const char* shortname)
   };
 
   // Get upper y option
-  if(options.getInt(fullname, "yupper", opt)) // Look in the section with the variable name
-    if(options.getInt(shortname, "yupper", opt))
-      if(options.getInt("All", "yupper", opt)) // Otherwise look for global settings
-	opt = BNDRY_NONE; // Do nothing
+  opt = getBndryOpt(fullname, shortname, "yupper");
 
   switch(opt) {
   case BNDRY_NONE:
     break;
   case BNDRY_ZERO: { 
-    bndry_yup_zero(var);
+    plan_add(plan, bndry_yup_zero);
     break;
   }case BNDRY_GRADIENT: {
-    bndry_yup_flat(var);
+    plan_add(plan, bndry_yup_flat);
     break;
   }
   default: {
@@ -1375,6 +1520,42 @@ void apply_boundary(Field2D &var, const char* fullname, const char* shortname)
     exit(1);
   }
   };
+
+  return plan;
+}
+
+/// Applies a boundary condition, depending on setting in BOUT.inp
+void apply_boundary(Field3D &var, const char* fullname, const char* shortname)
+{
+  PROFILE_REGION("boundary");
+  BndryPlanKey key = {fullname, shortname};
+  
+  map<BndryPlanKey, BndryPlan3D, BndryPlanLess>::iterator it = BndryPlans3D.find(key);
+  if(it == BndryPlans3D.end()) {
+    // First time for this variable. Read the options
+    it = BndryPlans3D.insert(std::make_pair(copy_key(fullname, shortname), 
+					    compile_boundary3d(fullname, shortname))).first;
+  }
+  
+  BndryPlan3D &plan = it->second;
+  for(int i=0;i<plan.nfuncs;i++)
+    plan.func[i](var);
+}
+
+void apply_boundary(Field2D &var, const char* fullname, const char* shortname)
+{
+  PROFILE_REGION("boundary");
+  BndryPlanKey key = {fullname, shortname};
+  
+  map<BndryPlanKey, BndryPlan2D, BndryPlanLess>::iterator it = BndryPlans2D.find(key);
+  if(it == BndryPlans2D.end()) {
+    it = BndryPlans2D.insert(std::make_pair(copy_key(fullname, shortname), 
+					    compile_boundary2d(fullname, shortname))).first;
+  }
+  
+  BndryPlan2D &plan = it->second;
+  for(int i=0;i<plan.nfuncs;i++)
+    plan.func[i](var);
 }
 
 void apply_boundary(Field2D &var, const char* name)
@@ -1390,7 +1571,6 @@ void apply_boundary(Field3D &var, const char* name)
 void apply_boundary(Vector3D &var, const char* name)
 {
   static char buffer[128];
-  int opt;
   // X component
   
   if(var.covariant) {
@@ -1419,23 +1599,31 @@ void apply_boundary(Vector3D &var, const char* name)
   apply_boundary(var.z, buffer, name);
 
   // Check for vector boundary
+  
+  BndryPlanKey key = {name, name};
+  map<BndryPlanKey, BndryPlanVec, BndryPlanLess>::iterator it = BndryPlansVec.find(key);
+  if(it == BndryPlansVec.end()) {
+    BndryPlanVec plan;
+    int opt;
+    
+    if(options.getInt(name, "xinner", opt))
+      if(options.getInt("All", "xinner", opt))
+	opt = BNDRY_NONE; // Do nothing
+    plan.inner_divcurl = (opt == BNDRY_DIVCURL);
+    
+    if(options.getInt(name, "xouter", opt))
+      if(options.getInt("All", "xouter", opt))
+	opt = BNDRY_NONE; // Do nothing
+    plan.outer_divcurl = (opt == BNDRY_DIVCURL);
 
-  if(options.getInt(name, "xinner", opt))
-    if(options.getInt("All", "xinner", opt))
-      opt = BNDRY_NONE; // Do nothing
-
-  if(opt == BNDRY_DIVCURL) {
-    bndry_inner_divcurl(var);
+    it = BndryPlansVec.insert(std::make_pair(copy_key(name, name), plan)).first;
   }
 
-  if(options.getInt(name, "xouter", opt))
-    if(options.getInt("All", "xouter", opt))
-      opt = BNDRY_NONE; // Do nothing
-
-  if(opt == BNDRY_DIVCURL) {
+  if(it->second.inner_divcurl)
+    bndry_inner_divcurl(var);
+  
+  if(it->second.outer_divcurl)
     bndry_sol_divcurl(var);
-  }
-
 }
 
 /////////////////// X BOUNDARIES /////////////////////
@@ -2223,7 +2411,6 @@ void bndry_yup_zero(Vector3D &var)
 void bndry_ydown_rotate(Field3D &var, bool reverse)
 {
   int jx, jy, jy2, jz;
-  real kwave;
   
   static dcomplex *cv = (dcomplex*) NULL;
 
@@ -2238,11 +2425,8 @@ void bndry_ydown_rotate(Field3D &var, bool reverse)
       
       rfft(var[jx][jy2], ncz, cv);
 
-      for(jz=1;jz<=ncz/2;jz++) {
-	// Rotate by 180 degrees
-	kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
-	cv[jz] *= dcomplex(cos(kwave*PI) , sin(kwave*PI));
-      }
+      // Rotate by 180 degrees
+      cmulconj(cv, zshift_phase(PI), ncz/2+1);
       
       irfft(cv, ncz, var[jx][jy]);
       
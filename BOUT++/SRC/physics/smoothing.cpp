@@ -36,7 +36,7 @@
 
 #include "bout_types.h"
 // Smooth using simple 1-2-1 filter
-const Field3D smooth_x(const Field3D &f, bool realspace)
+Field3D smooth_x(const Field3D &f, bool realspace)
 {
   Field3D fs, result;
 
@@ -74,7 +74,7 @@ const Field3D smooth_x(const Field3D &f, bool realspace)
 }
 
 
-const Field3D smooth_y(const Field3D &f)
+Field3D smooth_y(const Field3D &f)
 {
   Field3D result;
 
@@ -191,7 +191,7 @@ void nl_filter(rvec &f, real w)
   }
 }
 
-const Field3D nl_filter_x(const Field3D &f, real w)
+Field3D nl_filter_x(const Field3D &f, real w)
 {
 #ifdef CHECK
   msg_stack.push("nl_filter_x( Field3D )");
@@ -217,7 +217,7 @@ const Field3D nl_filter_x(const Field3D &f, real w)
   return result;
 }
 
-const Field3D nl_filter_y(const Field3D &fs, real w)
+Field3D nl_filter_y(const Field3D &fs, real w)
 {
 #ifdef CHECK
   msg_stack.push("nl_filter_x( Field3D )");
@@ -239,7 +239,7 @@ const Field3D nl_filter_y(const Field3D &fs, real w)
   return result;
 }
 
-const Field3D nl_filter_z(const Field3D &fs, real w)
+Field3D nl_filter_z(const Field3D &fs, real w)
 {
 #ifdef CHECK
   msg_stack.push("nl_filter_x( Field3D )");
@@ -261,7 +261,7 @@ const Field3D nl_filter_z(const Field3D &fs, real w)
   return result;
 }
 
-const Field3D nl_filter(const Field3D &f, real w)
+Field3D nl_filter(const Field3D &f, real w)
 {
   Field3D result;
   /// Perform filtering in Z, Y then X
@@ -29,18 +29,18 @@
 #include "field3d.h"
 
 /// Smooth in X using simple 1-2-1 filter
-const Field3D smooth_x(const Field3D &f, bool realspace = true);
+Field3D smooth_x(const Field3D &f, bool realspace = true);
 
 /// Smooth in Y using 1-2-1 filter
-const Field3D smooth_y(const Field3D &f);
+Field3D smooth_y(const Field3D &f);
 
 /// Average over Y
 const Field2D average_y(const Field2D &f);
 
 /// Non-linear filter to remove grid-scale oscillations
-const Field3D nl_filter_x(const Field3D &f, real w=1.0);
-const Field3D nl_filter_y(const Field3D &f, real w=1.0);
-const Field3D nl_filter_z(const Field3D &f, real w=1.0);
-const Field3D nl_filter(const Field3D &f, real w=1.0);
+Field3D nl_filter_x(const Field3D &f, real w=1.0);
+Field3D nl_filter_y(const Field3D &f, real w=1.0);
+Field3D nl_filter_z(const Field3D &f, real w=1.0);
+Field3D nl_filter(const Field3D &f, real w=1.0);
 
 #endif // __SMOOTHING_H__
@@ -86,7 +86,7 @@ const Field2D source_expx2(const Field2D &f,real swidth,real slength)
 }
 
 // create radial buffer zones to set jpar zero near radial boundaries
-const Field3D sink_tanhx(const Field2D &f0, const Field3D &f,real swidth,real slength, bool realspace)
+Field3D sink_tanhx(const Field2D &f0, const Field3D &f,real swidth,real slength, bool realspace)
 //const Field3D sink_tanhx(const Field2D &f0, const Field3D &f, bool realspace)
 {
   Field3D fs, result;
@@ -130,7 +130,7 @@ const Field3D sink_tanhx(const Field2D &f0, const Field3D &f,real swidth,real sl
 }
 
 // create radial buffer zones to set jpar zero near radial boundaries
-const Field3D mask_x(const Field3D &f, bool realspace)
+Field3D mask_x(const Field3D &f, bool realspace)
 {
   Field3D fs, result;
 
@@ -174,7 +174,7 @@ const Field3D mask_x(const Field3D &f, bool realspace)
 }
 
 // create radial buffer zones to set jpar zero near radial boundaries
-const Field3D sink_tanhxl(const Field2D &f0, const Field3D &f,real swidth,real slength, bool realspace)
+Field3D sink_tanhxl(const Field2D &f0, const Field3D &f,real swidth,real slength, bool realspace)
 {
   Field3D fs, result;
   Field2D fs0;
@@ -217,7 +217,7 @@ const Field3D sink_tanhxl(const Field2D &f0, const Field3D &f,real swidth,real s
 }
 
 // create radial buffer zones to set jpar zero near radial boundaries
-const Field3D sink_tanhxr(const Field2D &f0, const Field3D &f,real swidth,real slength, bool realspace)
+Field3D sink_tanhxr(const Field2D &f0, const Field3D &f,real swidth,real slength, bool realspace)
 {
   Field3D fs, result;
   Field2D fs0;
@@ -259,7 +259,7 @@ const Field3D sink_tanhxr(const Field2D &f0, const Field3D &f,real swidth,real s
 }
 
 // create radial buffer zones to damp Psi to zero near radial boundaries
-const Field3D buff_x(const Field3D &f, bool realspace)
+Field3D buff_x(const Field3D &f, bool realspace)
 {
   Field3D fs, result;
 
@@ -1,371 +1,260 @@
-/*calculate locations of nonzero elelments in the Jacobian*/
+/**************************************************************************
+ * Calculate locations of nonzero elements in the Jacobian
+ *
+ * Each value is assumed to depend on all variables at nearby points:
+ *  - A box in X-Z of half-widths jac_xstencil, jac_zstencil
+ *    (covers mixed derivatives and brackets)
+ *  - A line in Y of half-width jac_ystencil
+ * and on whole Z pencils where data is shifted in Z with FFTs
+ * (X neighbours if shifting X derivatives, Y neighbours across a
+ * twist-shift, and everything if evolving Z Fourier coefficients).
+ * 2D variables depend on whole pencils of 3D variables.
+ *
+ * Couplings through Laplacian inversions are not included, so the
+ * pattern (and coloured Jacobian) is an approximation used for
+ * preconditioning
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
 
-#include <stdio.h>
-#include "petsc_solver.h"
 #include "globals.h"
-#include "communicator.h" // Parallel communication
-#include "boundary.h"
-#include "interpolation.h" // Cell interpolation
-
-//#define NR_END 1
-
-#define IJKth_index(ivar,ix,jy,kz,NVARS,NSMX,NSMXY) \
- ((ivar-1) + (ix)*NVARS + (jy)*NSMX + (kz)*NSMXY)
-
-//-neighbors on 3D stencil
-#if 0
-//-1st and 2nd order neighbors
-enum neib_type {xp1,xp2,xm1,xm2, yp1,yp2,ym1,ym2, zp1,zp2,zm1,zm2};
-int NNEIB=12; //-number of neighbors on stencil
-#else
-//-1st order neighbors
-enum neib_type {xp1,xm1,yp1,ym1,zp1,zm1};
-int NNEIB=6; //-number of neighbors on stencil
-#endif
+#include "jstruc.h"
 
-#if 1
+#include <vector>
+#include <algorithm>
 
-/*--------Parameters set in BOUT.inp---------*/
-//long NVARS=2;  //-number of plasma field variables
-//long NXPE=1;   //-number of radial subdomains
-//long MXSUB=4;  //40; //-number of radial polongs per subdomain
-//long NYPE=1;   //-number of poloidal subdomains
-//long MYSUB=8;  //64; //-number of poloidal polongs per subdomain
-//long MZ=5;     //65;    // toroidal grid size +1
-//long MYG=2;    //-poloidal guard cells
-//long MXG=2;    //-radial guard cells
+using std::vector;
 
-/*auxiliary parameters*/
-//long NSMX, NSMXY, MX, MY, ngz, neq, local_N;
+/// Settings and fields for the current call to jstruc
+static int xstencil, ystencil, zstencil;
+static bool xpencil;
 
+static int nvar2d, nvar3d, nz;
+static real ***ind2d;  ///< Index data of the 2D variables [var][x][y]
+static real ****ind3d; ///< Index data of the 3D variables [var][x][y][z]
 
-void nrerror(char error_text[])
+/// Is the Y guard cell at (jx,jy) filled by a twist-shift?
+static bool twist_cell(int jx, int jy)
 {
-        fprintf(stderr,"Run-time error...\n");
-        fprintf(stderr,"%s\n",error_text);
-        fprintf(stderr,"...now exiting to system...\n");
-        //exit(1);
+  if(!TwistShift)
+    return false;
+
+  if(jy < MYG)
+    return (jx < DDATA_XSPLIT) ? TS_down_in : TS_down_out;
+  if(jy >= MYSUB+MYG)
+    return (jx < UDATA_XSPLIT) ? TS_up_in : TS_up_out;
+  return false;
 }
 
-
-int **imatrix(long nrl, long nrh, long ncl, long nch)
-/* allocate a int matrix with subscript range m[nrl..nrh][ncl..nch] */
+/// Add the indices of all variables at (jx,jy), for Z points
+/// jz - wz ... jz + wz, or the whole Z pencil if wz < 0
+static void add_point(vector<PetscInt> &cols, int jx, int jy, int jz, int wz)
 {
-        long i, nrow=nrh-nrl+1,ncol=nch-ncl+1;
-        int **m;
-        int NR_END=1;
-
-        /* allocate pointers to rows */
-        m=(int **) malloc((size_t)((nrow+NR_END)*sizeof(int*)));
-        if (!m) nrerror("allocation failure 1 in matrix()");
-        m += NR_END;
-        m -= nrl;
-
-
-        /* allocate rows and set pointers to them */
-        m[nrl]=(int *) malloc((size_t)((nrow*ncol+NR_END)*sizeof(int)));
-        if (!m[nrl]) nrerror("allocation failure 2 in matrix()");
-        m[nrl] += NR_END;
-        m[nrl] -= ncl;
-
-        for(i=nrl+1;i<=nrh;i++) m[i]=m[i-1]+ncol;
+  if((jx < 0) || (jx >= ngx) || (jy < 0) || (jy >= ngy))
+    return;
 
-        /* return pointer to array of pointers to rows */
-        return m;
-}
-
-
-
-int Map2sv(int ivar, long ixgrid, long iygrid, long izgrid, long NVARS, long NSMX, long NSMY)
-     /*
-       Find 1D index for mapping to the state vector for given:
-       iVar-index of fluid variable, (0,1,2,3,4,5) for (rho,te,ti,ni,up,ajpar),
-       ixgrid,iygrid,izgrid - indices of grid node       
-      */
-{
-  int indx1d;
-  //long NVARS=2; // should get from BOUT.inp!!!
-  //long NSMX, NSMXY;
-  
-  indx1d=IJKth_index(ivar,ixgrid,iygrid,izgrid,NVARS,NSMX,NSMY);
+  for(int i=0;i<nvar2d;i++) {
+    PetscInt ind = (PetscInt) ind2d[i][jx][jy];
+    if(ind >= 0)
+      cols.push_back(ind);
+  }
 
-  return indx1d;
+  for(int i=0;i<nvar3d;i++) {
+    real *d = ind3d[i][jx][jy];
+
+    if(nz != ncz) {
+      // Fourier coefficients. Always the whole pencil
+      PetscInt ind = (PetscInt) d[0];
+      if(ind >= 0)
+	for(int k=0;k<nz;k++)
+	  cols.push_back(ind + k);
+    }else if((wz < 0) || (2*wz+1 >= ncz)) {
+      for(int k=0;k<ncz;k++)
+	if(d[k] >= 0.)
+	  cols.push_back((PetscInt) d[k]);
+    }else {
+      for(int k=-wz;k<=wz;k++) {
+	PetscInt ind = (PetscInt) d[(jz + k + ncz) % ncz];
+	if(ind >= 0)
+	  cols.push_back(ind);
+      }
+    }
+  }
 }
 
-
-
-void Neighbor(enum neib_type neib, long ix1, long iy1, long iz1, long *ix2, long *iy2, long *iz2)
-     /*
-       For given grid point (ix1,iy1,iz1) calculate indices of 
-       neighbor grid point (ix2,iy2,iz2)       
-     */
+/// Get the columns for a value at (jx,jy,jz). For 2D variables jz < 0
+static void get_cols(vector<PetscInt> &cols, int jx, int jy, int jz)
 {
+  cols.clear();
 
-  //-set default
-  *ix2=ix1;
-  *iy2=iy1;
-  *iz2=iz1;
-
-
-  //-next point in positive x-direction
-  if(neib==xp1)
-    {
-      if (ix1 == MX-1)
-	{
-	  *ix2=0; //-open-periodic ([0,1,..MX-1]) where 0<=>MX
-	}
-      else  *ix2=ix1+1;
-    }
-
-
-  //-next point in negative x-direction
-  if(neib== xm1)
-    {
-      if (ix1 == 0)
-	{
-	  *ix2=MX-1; //-open-periodic ([0,1,..MX-1]) where 0<=>MX
-	}
-      else  *ix2=ix1-1;
-    }
-
-
-  //-next point in positive y-direction
-  if(neib==yp1)
-    {
-      if (iy1 == MY-1)
-	{
-	  *iy2=0; //-open-periodic ([0,1,..MY-1]) where 0<=>MY
-	}
-      else  *iy2=iy1+1;
-    }
+  int wz = zstencil;
+  if(jz < 0)
+    wz = -1; // 2D variable: Whole pencils
 
+  for(int dx=-xstencil;dx<=xstencil;dx++)
+    add_point(cols, jx+dx, jy, jz, ((dx != 0) && xpencil) ? -1 : wz);
 
-  //-next point in negative y-direction
-  if(neib==ym1)
-    {
-      if (iy1 == 0)
-	{
-	  *iy2=MY-1; //-open-periodic ([0,1,..MY-1]) where 0<=>MY
-	}
-      else  *iy2=iy1-1;
+  for(int dy=-ystencil;dy<=ystencil;dy++) {
+    if(dy == 0)
+      continue;
+    add_point(cols, jx, jy+dy, jz, twist_cell(jx, jy+dy) ? -1 : ((jz < 0) ? -1 : 0));
   }
 
+  std::sort(cols.begin(), cols.end());
+  cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+}
 
-  //-next point in positive z-direction
-  if(neib==zp1)
-    {
-      if (iz1 == MZ-1)
-	{
-	  *iz2=1; //-closed-periodic ([0,1,..MZ-1]) where 0<=>MZ-1
+/// Apply op to each row on this processor, with its columns
+template <class Op>
+static void loop_rows(int rstart, int local_N, Op &op)
+{
+  vector<PetscInt> cols;
+
+  for(int jx=0;jx<ngx;jx++)
+    for(int jy=0;jy<ngy;jy++) {
+      for(int i=0;i<nvar2d;i++) {
+	PetscInt row = (PetscInt) ind2d[i][jx][jy];
+	if((row < rstart) || (row >= rstart+local_N))
+	  continue; // Not evolving, or on another processor
+	get_cols(cols, jx, jy, -1);
+	op(row, cols);
+      }
+
+      if(nz != ncz) {
+	// Fourier coefficients: All rows in a pencil have the same columns
+	get_cols(cols, jx, jy, 0);
+	for(int i=0;i<nvar3d;i++) {
+	  PetscInt row = (PetscInt) ind3d[i][jx][jy][0];
+	  if((row < rstart) || (row >= rstart+local_N))
+	    continue;
+	  for(int k=0;k<nz;k++)
+	    op(row+k, cols);
 	}
-      else  *iz2=iz1+1;
-    }
-
-
-  //-next point in negative z-direction
-  if(neib==zm1)
-    {
-      if (iz1 == 0)
-	{
-	  *iz2=MZ-2; //-closed-periodic ([0,1,..MZ-1]) where 0<=>MZ-1
+	continue;
+      }
+
+      for(int jz=0;jz<ncz;jz++) {
+	bool got = false;
+	for(int i=0;i<nvar3d;i++) {
+	  PetscInt row = (PetscInt) ind3d[i][jx][jy][jz];
+	  if((row < rstart) || (row >= rstart+local_N))
+	    continue;
+	  if(!got) {
+	    // Same columns for all variables at this point
+	    get_cols(cols, jx, jy, jz);
+	    got = true;
+	  }
+	  op(row, cols);
 	}
-      else  *iz2=iz1-1;
+      }
     }
-
-
-
-  printf("neib=%d; ", neib);
-  printf(">> ix1=%d, iy1=%d, iz1=%d; ", ix1, iy1, iz1);
-  printf("<< ix2=%d, iy2=%d, iz2=%d\n", *ix2, *iy2, *iz2);	      
 }
 
+/// Count the nonzeros in the diagonal and off-diagonal blocks of each row
+struct CountOp {
+  int rstart, rend;
+  PetscInt *d_nnz, *o_nnz;
+  void operator()(PetscInt row, const vector<PetscInt> &cols) {
+    for(size_t c=0;c<cols.size();c++) {
+      if((cols[c] >= rstart) && (cols[c] < rend)) {
+	d_nnz[row-rstart]++;
+      }else
+	o_nnz[row-rstart]++;
+    }
+  }
+};
+
+/// Insert zeros into the matrix
+struct InsertOp {
+  Mat J;
+  vector<PetscScalar> zeros;
+  void operator()(PetscInt row, const vector<PetscInt> &cols) {
+    if(zeros.size() < cols.size())
+      zeros.resize(cols.size(), 0.0);
+    MatSetValues(J, 1, &row, cols.size(), &cols[0], &zeros[0], INSERT_VALUES);
+  }
+};
 
-
-int jstruc(int NVARS, int NXPE, int MXSUB, int NYPE, int MYSUB, int MZ, int MYG, int MXG)
+int jstruc(Mat J, int rstart, int local_N,
+	   int n2d, Field2D **index2d, int n3d, Field3D **index3d, int nzvals)
 {
-  int **jmatr;
-  
-  int ivar1, ivar2;
-  long ix1, iy1, iz1;
-  long ix2, iy2, iz2;
-  long ij1, ij2;
-  enum neib_type neib;
-  int neib_tmp;
-
-  //long NVARS=2; // get from BOUT.inp!!!
-  long neq,local_N;
-
-
-  /*calculate auxiliary parametes*/
-  MX=MXSUB*NXPE+4; //-guard cells
-  MY=MYSUB*NYPE;
-  ngz=MZ;
-  int ncz=ngz-1;
-  int NSMX = NVARS*MX;
-  int NSMXY = NVARS*MX*MYSUB;
-  neq = NVARS*MX*MY*ncz;
-  //local_N = NVARS*MXSUB*MYSUB*ngz;
-
-
-  printf("\njstruc(): \n");
-  printf("NVARS=%d\n", NVARS);
-  printf("MX=%d\n", MX);
-  printf("MY=%d\n", MY);
-  printf("ngz=%d\n", ngz);
-  printf("neq=%d\n", neq);
-
-  //-allocate matrix for the jacobian (use list instead)
-  printf("Allocating Jacobian matrix, [%dx%d]\n",neq,neq);
-  jmatr=imatrix(0,neq-1,0,neq-1);
-
-
-  /*====================Local interaction on the stencil====================*/
-
-  for (ivar1=1;ivar1<=NVARS;ivar1++)
-    {
-      for (ivar2=1;ivar2<=NVARS;ivar2++)
-	{
-	  for (ix1=0;ix1<MX;ix1++)
-	    {
-	      for (iy1=0;iy1<MYSUB;iy1++)
-		{
-		  for (iz1=0;iz1<MZ;iz1++) 
-		    {
-	     	      
-		      //-find 1D index for 1st variable at this grid point
-		      ij1=Map2sv(ivar1,ix1,iy1,iz1, NVARS,NSMX,NSMXY);
-
-		      
-		      //-loop over the stencil
-		      //for (neib=0;neib<NNEIB;neib++)
-                      for (neib_tmp=0;neib_tmp<NNEIB;neib_tmp++)
-			{
-
-			  //-find 3D indices for 2nd variable for neighbor grid points
-                          neib = (neib_type)neib_tmp;
-			  Neighbor(neib, ix1, iy1, iz1, &ix2, &iy2, &iz2);
-
-			  
-			  //if (ij2>=0){ //-neighbor exists... 
-	     
-                          //-find 1D index for 2nd variable at this neighbor point
-                          ij2=Map2sv(ivar2,ix2,iy2,iz2, NVARS,NSMX,NSMXY);
-                          if (ij2>=0) //-neighbor exists..
-                            {
-			      //-record an entry in the Jacobian
-			      printf("Coupling of %d to %d\n", ij1, ij2);
-                              if (ij1<0 || ij2 <0) SETERRQ2(1,"1st: ij1 %d, ij2 %d",ij1, ij2);
-			      jmatr[ij1][ij2]=1; 
-			    }
-                        
-	   			  
-                        }
-
-
-
-		    } //-iz1
-		} //-iy1
-	    } //-ix1
-	} //-ivar2
-    } //-ivar1
- 
-
-
-
-  /*===Interaction between (ix1,iy1,iz1) and (ix2=ix1+-1,2;iy2=iy1;all iz)===*/
-  /*due to the Fourier interpolation*/
-
-  for (ivar1=1;ivar1<=NVARS;ivar1++)
-    {
-      for (ivar2=1;ivar2<=NVARS;ivar2++)
-	{
-	  for (ix1=0;ix1<MX;ix1++)
-	    {
-	      for (iy1=0;iy1<MYSUB;iy1++)
-		{
-		  for (iz1=0;iz1<MZ;iz1++) 
-		    {
-	     	      
-		      //-find 1D index for 1st variable at this grid point
-		      ij1=Map2sv(ivar1,ix1,iy1,iz1, NVARS,NSMX,NSMXY);
-
-
-		      
-		      //-loop over radial neigbors on the stencil (2 or 4 first items in the list)
-		      for (neib_tmp=0;neib_tmp<2;neib_tmp++)
-			{
-			  //-find 3D indices for 2nd variable for neighbor grid points
-                          neib = (neib_type)neib_tmp;
-			  Neighbor(neib, ix1, iy1, iz1, &ix2, &iy2, &iz2);
-
-			  //-instead of this iz2 use whole toroidal line for this (ix2,iy2)
-			  for (iz2=0;iz2<MZ;iz2++)
-			    {
-
-			      //if (ij2>=0) //-neighbor exists... 
-				//{
-				  //-find 1D index for 2nd variable at this neighbor point
-                              ij2=Map2sv(ivar2,ix2,iy2,iz2, NVARS,NSMX,NSMXY);
-                              if (ij2>=0){ //-neighbor exists...
-                                //-record an entry in the Jacobian
-                                printf("Coupling of %d to %d\n", ij1, ij2);
-                                if (ij1<0 || ij2 <0) SETERRQ2(1,"2nd: ij1 %d, ij2 %d",ij1, ij2);
-                                jmatr[ij1][ij2]=1; 
-                              }
-			      
-			    }
-	   			  
-			}
-
-
-
-		    } //-iz1
-		} //-iy1
-	    } //-ix1
-	} //-ivar2
-    } //-ivar1
-
-
-
-
-  /*====Interaction due to the vorticity inversion====================*/
-  /*between each variable at (ix1,iy1,iz1) and vorticity for (all ix,iy2=iy1,all iz)*/
-
-  for (ivar1=1;ivar1<=NVARS;ivar1++)
-    {
-      for (ix1=0;ix1<MX;ix1++)
-	{
-	  for (iy1=0;iy1<MYSUB;iy1++)
-	    {
-	      for (iz1=0;iz1<MZ;iz1++) 
-		{
-		  
-		  //-find 1D index for 1st variable at this grid point
-		  ij1=Map2sv(ivar1,ix1,iy1,iz1, NVARS,NSMX,NSMXY);
-		  
-		    
-		  for (ix2=0;ix2<MX;ix2++)
-		    {
-		      for (iz2=0;iz2<MZ;iz2++) 
-			{
-			  //-find 1D index for 2nd variable at this neighbor point
-			  ivar2=1; //-vorticity
-			  ij2=Map2sv(ivar2,ix2,iy2,iz2, NVARS,NSMX,NSMXY);
-			  
-			  //-record an entry in the Jacobian
-                          if (ij2>=0){
-                            printf("Coupling of %d to %d\n", ij1, ij2);
-                            if (ij1<0 || ij2 <0) SETERRQ2(1,"3rd: ij1 %d, ij2 %d",ij1, ij2);
-                            jmatr[ij1][ij2]=1; 
-                          }
-			}
-		    }			
-		} //-iz1
-	    } //-iy1
-	} //-ix1
-    } //-ivar1
+#ifdef CHECK
+  int msg_point = msg_stack.push("jstruc()");
+#endif
+
+  options.setSection("solver");
+  options.get("jac_xstencil", xstencil, 2);
+  options.get("jac_ystencil", ystencil, 2);
+  options.get("jac_zstencil", zstencil, 2);
+  options.get("jac_xpencil", xpencil, ShiftXderivs && (ShiftOrder == 0));
+
+  nvar2d = n2d;
+  nvar3d = n3d;
+  nz = nzvals;
+
+  ind2d = new real**[n2d];
+  for(int i=0;i<n2d;i++)
+    ind2d[i] = index2d[i]->getData();
+  ind3d = new real***[n3d];
+  for(int i=0;i<n3d;i++)
+    ind3d[i] = index3d[i]->getData();
+
+  // Count nonzeros, to preallocate
+  CountOp count;
+  count.rstart = rstart;
+  count.rend = rstart + local_N;
+  count.d_nnz = new PetscInt[local_N];
+  count.o_nnz = new PetscInt[local_N];
+  for(int i=0;i<local_N;i++)
+    count.d_nnz[i] = count.o_nnz[i] = 0;
+
+  loop_rows(rstart, local_N, count);
+
+  long nnz = 0;
+  for(int i=0;i<local_N;i++)
+    nnz += count.d_nnz[i] + count.o_nnz[i];
+  output.write("\tJacobian pattern: %ld nonzeros on this processor (%.1f per row)\n",
+	       nnz, ((real) nnz) / ((real) local_N));
+
+  MatSeqAIJSetPreallocation(J, 0, count.d_nnz);
+  MatMPIAIJSetPreallocation(J, 0, count.d_nnz, 0, count.o_nnz);
+
+  delete[] count.d_nnz;
+  delete[] count.o_nnz;
+
+  // Insert the pattern
+  InsertOp insert;
+  insert.J = J;
+  loop_rows(rstart, local_N, insert);
+
+  MatAssemblyBegin(J, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd(J, MAT_FINAL_ASSEMBLY);
+
+  delete[] ind2d;
+  delete[] ind3d;
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
 
   return 0;
 }
-
-#endif
@@ -0,0 +1,53 @@
+/*!************************************************************************
+ * Sparsity pattern of the Jacobian
+ *
+ * Used by the PETSc solver to colour the Jacobian, so that it can
+ * be calculated by finite differences using one RHS evaluation
+ * per colour.
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ * 
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#ifndef __JSTRUC_H__
+#define __JSTRUC_H__
+
+#include "petscmat.h"
+
+#include "field2d.h"
+#include "field3d.h"
+
+/// Preallocate J and insert (zero) entries for the nonzero pattern
+/*!
+ * The index fields hold the global index in the state vector of
+ * each evolving value, or -1 where there is none. Guard cells
+ * must have been communicated, so they hold the indices of values
+ * on neighbouring processors.
+ * If nzvals != ncz, 3D variables are stored as nzvals Z Fourier 
+ * coefficients, and each Z pencil holds the index of the first one.
+ *
+ * Rows rstart ... rstart + local_N - 1 are on this processor.
+ * Stencil widths are set in the [solver] section.
+ */
+int jstruc(Mat J, int rstart, int local_N,
+	   int n2d, Field2D **index2d, int n3d, Field3D **index3d, int nzvals);
+
+#endif // __JSTRUC_H__
@@ -26,6 +26,7 @@
 #include "solver.h"
 
 #include "globals.h"
+#include "profile.h"
 
 #include "mpi.h"       // MPI data types and prototypes
 #include "nvector.h"
@@ -248,7 +249,7 @@ int Solver::run(MonitorFunc monitor)
     restart.write("%s/BOUT.restart.%d.%s", restartdir.c_str(), MYPE, restartext.c_str());
     
     if((archive_restart > 0) && (iteration % archive_restart == 0)) {
-      restart.write("%s/BOUT.restart_%04d.%d.%s", restartdir.c_str(), iteration, MYPE, restartext.c_str());
+      writeArchive();
     }
     
     /// Call the monitor function
@@ -273,6 +274,7 @@ int Solver::run(MonitorFunc monitor)
 
 real Solver::run(real tout, int &ncalls, real &rhstime)
 {
+  PROFILE_REGION("solver");
   real *udata;
   int flag;
 
@@ -320,6 +322,7 @@ real Solver::run(real tout, int &ncalls, real &rhstime)
 
 void Solver::rhs(int N, real t, real *udata, real *dudata)
 {
+  PROFILE_REGION("rhs");
   int flag;
   real tstart;
 
@@ -334,6 +337,7 @@ void Solver::rhs(int N, real t, real *udata, real *dudata)
 
   // Call function
   flag = (*func)(t);
+  rhsCheckFinite(t);
 
   // Save derivatives to CVODE
   save_derivs(dudata);
@@ -348,6 +352,7 @@ void Solver::rhs(int N, real t, real *udata, real *dudata)
 
 void Solver::gloc(int N, real t, real *udata, real *dudata)
 {
+  PROFILE_REGION("rhs");
   int flag;
   real tstart;
 
@@ -385,8 +390,8 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
   unsigned int i;
   int jz;
 
-  int n2d = n2Dvars();
-  int n3d = n3Dvars();
+  unsigned int n2d = f2d.size();
+  unsigned int n3d = f3d.size();
  
   switch(op) {
   case LOAD_VARS: {
@@ -399,6 +404,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_load(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -420,6 +432,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -441,6 +460,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].F_var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
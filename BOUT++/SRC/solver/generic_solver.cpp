@@ -27,6 +27,14 @@
 #include "boundary.h"
 #include "interpolation.h"
 
+#include "bin_format.h"
+#include "bin_delta.h"
+#include "meshtopology.h"
+#include "profile.h"
+#include "fft.h"
+
+#include <string.h>
+
 /**************************************************************************
  * Constructor
  **************************************************************************/
@@ -42,6 +50,16 @@ GenericSolver::GenericSolver() {
 
   // Restart directory
   restartdir = string("data");
+
+  archive_incremental = false;
+  archive_count = 0;
+  archive_prev = -1;
+
+  check_finite = 0;
+  check_count = 0;
+
+  zdealias = false;
+  zmodes = 0;
 }
 
 /**************************************************************************
@@ -367,6 +385,25 @@ int GenericSolver::init(rhsfunc f, int argc, char **argv, bool restarting, int n
         archive_restart);
   }
 
+  OPTION(archive_incremental, false);
+  OPTION(archive_full, 10);
+  
+  OPTION(check_finite, 0);
+  if(check_finite > 0) {
+    output.write("Checking variables are finite every %d RHS calls\n", check_finite);
+  }else if(check_finite < 0)
+    output.write("Checking variables are finite every output\n");
+  
+  options.get("z_dealias", zdealias, false);
+  if(zdealias && (linear_nmodes > 0)) {
+    output.write("WARNING: z_dealias has no effect in linear mode\n");
+    zdealias = false;
+  }
+  if(zdealias) {
+    zmodes = (ncz - 1) / 3;
+    output.write("Dealiasing in Z: evolving Fourier coefficients, modes 0 - %d of %d\n", zmodes, ncz/2);
+  }
+  
   /// Get restart file extension
   const char *dump_ext, *restart_ext;
   if((dump_ext = options.getString("dump_format")) == NULL) {
@@ -381,6 +418,14 @@ int GenericSolver::init(rhsfunc f, int argc, char **argv, bool restarting, int n
   restart.setFormat(data_format(restart_ext));
   restartext = string(restart_ext);
 
+  if(archive_incremental && (archive_restart > 0)) {
+    if(strcasecmp(restart_ext, "bin") != 0) {
+      output.write("WARNING: Incremental archives need restart_format = \"bin\". Archiving full copies\n");
+      archive_incremental = false;
+    }else
+      output.write("\tArchives stored as differences, full copy every %d archives\n", archive_full);
+  }
+
   /// Add basic variables to the restart file
   restart.add(simtime,  "tt",    0);
   restart.add(iteration, "hist_hi", 0);
@@ -466,11 +511,147 @@ int GenericSolver::init(rhsfunc f, int argc, char **argv, bool restarting, int n
   return 0;
 }
 
+void GenericSolver::writeArchive()
+{
+#ifdef CHECK
+  int msg_point = msg_stack.push("GenericSolver::writeArchive()");
+#endif
+
+  if(!archive_incremental) {
+    restart.write("%s/BOUT.restart_%04d.%d.%s", restartdir.c_str(), iteration, MYPE, restartext.c_str());
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return;
+  }
+
+  if(!Datafile::enabled) {
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return;
+  }
+
+  real tstart = MPI_Wtime();
+
+  /// Map the restart file which has just been written
+  char filename[512];
+  sprintf(filename, "%s/BOUT.restart.%d.%s", restartdir.c_str(), MYPE, restartext.c_str());
+
+  BinFormat current;
+  long hdrsize, datasize;
+  const char *hdr = NULL, *data = NULL;
+  if(current.openr(filename)) {
+    hdr = current.getHeaderBlock(hdrsize);
+    data = current.getDataBlock(datasize);
+  }
+
+  if((hdr == NULL) || (data == NULL)) {
+    output.write("WARNING: Could not read '%s'. Archiving full copy\n", filename);
+    restart.write("%s/BOUT.restart_%04d.%d.%s", restartdir.c_str(), iteration, MYPE, restartext.c_str());
+    archive_ref.clear();
+#ifdef CHECK
+    msg_stack.pop(msg_point);
+#endif
+    return;
+  }
+
+  bool ok;
+  if(archive_ref.empty() || (archive_count >= archive_full) || ((long) archive_ref.size() != datasize)) {
+    // Full copy, used as the base for following differences
+    sprintf(filename, "%s/BOUT.restart_%04d.%d.bin", restartdir.c_str(), iteration, MYPE);
+    ok = bin_write_image(filename, hdr, hdrsize, data, datasize);
+    archive_count = 0;
+  }else {
+    sprintf(filename, "%s/BOUT.restart_%04d.%d.delta", restartdir.c_str(), iteration, MYPE);
+    ok = bin_delta_write(filename, iteration, archive_prev, hdr, hdrsize, 
+			 &archive_ref[0], data, datasize);
+  }
+
+  if(ok) {
+    archive_count++;
+    archive_prev = iteration;
+    archive_ref.assign(data, data + datasize);
+  }else {
+    output.write("ERROR: Failed to write archive '%s'\n", filename);
+    archive_ref.clear(); // Next archive will be a full copy
+  }
+
+  current.close();
+
+  Datafile::wtime += MPI_Wtime() - tstart;
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+}
+
 void GenericSolver::setRestartDir(const string &dir)
 {
   restartdir = dir;
 }
 
+/**************************************************************************
+ * Checking for NaN or Inf
+ **************************************************************************/
+
+/// Print the location of the first non-finite value. Returns true if one found
+static bool report_nonfinite(const Field2D &f, const string &name, real t)
+{
+  int jx, jy;
+  if(!f.findNonFinite(jx, jy))
+    return false;
+  output.write("ERROR: Non-finite value in '%s' at x=%d, y=%d (global indices), time %e\n",
+	       name.c_str(), XGLOBAL(jx), YGLOBAL(jy), t);
+  return true;
+}
+
+static bool report_nonfinite(const Field3D &f, const string &name, real t)
+{
+  int jx, jy, jz;
+  if(!f.findNonFinite(jx, jy, jz))
+    return false;
+  output.write("ERROR: Non-finite value in '%s' at x=%d, y=%d, z=%d (global indices), time %e\n",
+	       name.c_str(), XGLOBAL(jx), YGLOBAL(jy), jz, t);
+  return true;
+}
+
+void GenericSolver::checkFinite(real t)
+{
+  PROFILE_REGION("check finite");
+#ifdef CHECK
+  int msg_point = msg_stack.push("GenericSolver::checkFinite(%e)", t);
+#endif
+  
+  // Vectors are stored as components in f2d and f3d
+  bool bad = false;
+  for(unsigned int i=0;(i<f2d.size()) && !bad;i++)
+    bad = report_nonfinite(*f2d[i].var, f2d[i].name, t)
+      || report_nonfinite(*f2d[i].F_var, "ddt(" + f2d[i].name + ")", t);
+  for(unsigned int i=0;(i<f3d.size()) && !bad;i++)
+    bad = report_nonfinite(*f3d[i].var, f3d[i].name, t)
+      || report_nonfinite(*f3d[i].F_var, "ddt(" + f3d[i].name + ")", t);
+  
+  if(bad)
+    bout_error("Non-finite value in evolving variables\n");
+  
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+}
+
+void GenericSolver::rhsCheckFinite(real t)
+{
+  if(check_finite <= 0)
+    return;
+  
+  check_count++;
+  if(check_count >= check_finite) {
+    checkFinite(t);
+    check_count = 0;
+  }
+}
+
 /**************************************************************************
  * Useful routines (protected)
  **************************************************************************/
@@ -480,45 +661,80 @@ int GenericSolver::getLocalN()
   int n2d = n2Dvars();
   int n3d = n3Dvars();
   
-  int local_N = MXSUB*MYSUB*(n2d + ncz*n3d); // NOTE: Not including extra toroidal point
+  int nz = nzvals();
+  
+  int local_N = MXSUB*MYSUB*(n2d + nz*n3d); // NOTE: Not including extra toroidal point
 
   //////////// Find boundary regions ////////////
   
   // Y up
   if((UDATA_INDEST == -1) && (UDATA_XSPLIT > 0)) {
     // Boundary for 0 <= x < UDATA_XSPLIT
-    local_N += UDATA_XSPLIT * MYG * (n2d + ncz * n3d);
+    local_N += UDATA_XSPLIT * MYG * (n2d + nz * n3d);
     output.write("\tBoundary region upper Y for 0 <= x < %d\n", UDATA_XSPLIT);
   }
   if((UDATA_OUTDEST == -1) && (UDATA_XSPLIT < MXSUB)) {
     // Boundary for UDATA_XSPLIT <= x < MXSUB
-    local_N += (MXSUB - UDATA_XSPLIT) * MYG * (n2d + ncz * n3d);
+    local_N += (MXSUB - UDATA_XSPLIT) * MYG * (n2d + nz * n3d);
     output.write("\tBoundary region upper Y for %d <= x < %d\n", UDATA_XSPLIT, MXSUB);
   }
   
   // Y down
   if((DDATA_INDEST == -1) && (DDATA_XSPLIT > 0)) {
     // Boundary for 0 <= x < DDATA_XSPLIT
-    local_N += DDATA_XSPLIT * MYG * (n2d + ncz * n3d);
+    local_N += DDATA_XSPLIT * MYG * (n2d + nz * n3d);
     output.write("\tBoundary region lower Y for 0 <= x < %d\n", DDATA_XSPLIT);
   }
   if((DDATA_OUTDEST == -1) && (DDATA_XSPLIT < MXSUB)) {
     // Boundary for DDATA_XSPLIT <= x < MXSUB
-    local_N += (MXSUB - DDATA_XSPLIT) * MYG * (n2d + ncz * n3d);
+    local_N += (MXSUB - DDATA_XSPLIT) * MYG * (n2d + nz * n3d);
     output.write("\tBoundary region lower Y for %d <= x < %d\n", DDATA_XSPLIT, MXSUB);
   }
   
   // X inner
   if(IDATA_DEST == -1) {
-    local_N += MXG * MYSUB * (n2d + ncz * n3d);
+    local_N += MXG * MYSUB * (n2d + nz * n3d);
     output.write("\tBoundary region inner X\n");
   }
 
   // X outer
   if(ODATA_DEST == -1) {
-    local_N += MXG * MYSUB * (n2d + ncz * n3d);
+    local_N += MXG * MYSUB * (n2d + nz * n3d);
     output.write("\tBoundary region outer X\n");
   }
   
   return local_N;
 }
+
+void GenericSolver::zspec_load(real *d, const real *udata, int &p)
+{
+  static dcomplex *cv = (dcomplex*) NULL;
+  if(cv == (dcomplex*) NULL)
+    cv = new dcomplex[ncz/2 + 1];
+  
+  cv[0] = udata[p++];
+  for(int k=1;k<=zmodes;k++) {
+    cv[k] = dcomplex(udata[p], udata[p+1]);
+    p += 2;
+  }
+  for(int k=zmodes+1;k<=ncz/2;k++)
+    cv[k] = 0.0;
+  
+  irfft(cv, ncz, d);
+  d[ncz] = d[0];
+}
+
+void GenericSolver::zspec_save(real *d, real *udata, int &p)
+{
+  static dcomplex *cv = (dcomplex*) NULL;
+  if(cv == (dcomplex*) NULL)
+    cv = new dcomplex[ncz/2 + 1];
+  
+  rfft(d, ncz, cv);
+  
+  udata[p++] = cv[0].Real();
+  for(int k=1;k<=zmodes;k++) {
+    udata[p++] = cv[k].Real();
+    udata[p++] = cv[k].Imag();
+  }
+}
@@ -98,12 +98,35 @@ class GenericSolver {
   real rhs_wtime; ///< Wall time used in RHS
   int rhs_ncalls; ///< Number of calls to the RHS function
 
+  /// Check evolving variables and time derivatives for NaN or Inf.
+  /// Stops with an error giving the first bad location
+  void checkFinite(real t);
+  int check_finite; ///< How often to check: 0 never, N > 0 every N RHS calls, -1 every output
+
   void setRestartDir(const string &dir);
   void setRestartDir(const char* dir) {string s = string(dir); setRestartDir(s); }
 protected:
   
   /// Calculate the number of evolving variables on this processor
   int getLocalN();
+
+  /// Dealias in Z by truncating the state: 3D variables are passed to the
+  /// solver as Fourier coefficients, keeping modes 0 ... zmodes (2/3 rule).
+  /// The RHS is still evaluated on the Z grid, but truncating the state and
+  /// time-derivatives removes the aliasing from quadratic nonlinear terms
+  bool zdealias;
+  int zmodes;  ///< Highest Z mode kept if zdealias
+  
+  /// Number of values for each 3D variable at each (x,y) point
+  int nzvals() const { return zdealias ? 2*zmodes + 1 : ncz; }
+  /// Set a Z pencil from Fourier coefficients, incrementing p
+  void zspec_load(real *d, const real *udata, int &p);
+  /// Save the Fourier coefficients of a Z pencil, incrementing p
+  void zspec_save(real *d, real *udata, int &p);
+
+  /// Call checkFinite every check_finite RHS calls. Solvers call this after the RHS function
+  void rhsCheckFinite(real t);
+  int check_count; ///< RHS calls since the last check
   
   /// A structure to hold an evolving variable
   template <class T>
@@ -129,6 +152,16 @@ protected:
   string restartext;  ///< Restart file extension
   int archive_restart;
 
+  /// Write an archive copy of the restart file. Called every archive_restart
+  /// iterations, after the restart file has been written
+  void writeArchive();
+
+  bool archive_incremental; ///< Store archives as differences (binary restart files only)
+  int archive_full;         ///< Number of archives between full copies
+  int archive_count;        ///< Archives since the last full copy
+  int archive_prev;         ///< Iteration of the last archive
+  vector<char> archive_ref; ///< Data block of the last archive
+
   bool has_constraints; ///< Can this solver handle constraints? Set to true if so.
   bool initialised; ///< Has init been called yet?
 
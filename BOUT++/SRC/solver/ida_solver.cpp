@@ -30,6 +30,7 @@
 #include "ida_solver.h"
 
 #include "globals.h"
+#include "profile.h"
 #include "boundary.h"
 #include "interpolation.h" // Cell interpolation
 
@@ -235,7 +236,7 @@ int Solver::run(MonitorFunc monitor)
     restart.write("%s/BOUT.restart.%d.%s", restartdir.c_str(), MYPE, restartext.c_str());
     
     if((archive_restart > 0) && (iteration % archive_restart == 0)) {
-      restart.write("%s/BOUT.restart_%04d.%d.%s", restartdir.c_str(), iteration, MYPE, restartext.c_str());
+      writeArchive();
     }
     
     /// Call the monitor function
@@ -260,6 +261,7 @@ int Solver::run(MonitorFunc monitor)
 
 real Solver::run(real tout, int &ncalls, real &rhstime)
 {
+  PROFILE_REGION("solver");
   if(!initialised)
     bout_error("ERROR: Running IDA solver without initialisation\n");
 
@@ -305,6 +307,7 @@ real Solver::run(real tout, int &ncalls, real &rhstime)
 
 void Solver::res(real t, real *udata, real *dudata, real *rdata)
 {
+  PROFILE_REGION("rhs");
 #ifdef CHECK
   int msg_point = msg_stack.push("Running RHS: Solver::res(%e)", t);
 #endif
@@ -316,6 +319,7 @@ void Solver::res(real t, real *udata, real *dudata, real *rdata)
   
   // Call RHS function
   (*func)(t);
+  rhsCheckFinite(t);
   
   // Save derivatives to rdata (residual)
   save_derivs(rdata);
@@ -342,6 +346,7 @@ void Solver::res(real t, real *udata, real *dudata, real *rdata)
 
 void Solver::pre(real t, real cj, real delta, real *udata, real *rvec, real *zvec)
 {
+  PROFILE_REGION("precon");
 #ifdef CHECK
   int msg_point = msg_stack.push("Running preconditioner: Solver::pre(%e)", t);
 #endif
@@ -401,6 +406,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_load(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -423,6 +435,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_load(f3d[i].F_var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -448,6 +467,19 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      for(i=0;i<n3d;i++)
+	for(jz=0;jz<nzvals();jz++) {
+	  if(f3d[i].constraint) {
+	    udata[p] = ZERO;
+	  }else {
+	    udata[p] = ONE;
+	  }
+	  p++;
+	}
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -473,6 +505,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -494,6 +533,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].F_var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
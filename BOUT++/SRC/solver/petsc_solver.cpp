@@ -26,12 +26,14 @@
 #include "petsc_solver.h"
 
 #include "globals.h"
+#include "profile.h"
 
 #include <stdlib.h>
 
 #include "communicator.h" // Parallel communication
 #include "boundary.h"
 #include "interpolation.h" // Cell interpolation
+#include "jstruc.h"
 
 
 EXTERN PetscErrorCode solver_f(TS ts, real t, Vec globalin, Vec globalout, void *f_data);
@@ -219,20 +221,7 @@ int Solver::init(rhsfunc f, int argc, char **argv, bool restarting, int NOUT, re
         TSDefaultComputeJacobian(ts,simtime,u,&J,&J,&J_structure,this);
       } else { // get sparse pattern of the Jacobian
         PetscPrintf(PETSC_COMM_SELF,"get sparse pattern of the Jacobian...\n");
-        int stat;
-
-	
-	int NVARS=n3Dvars()+n2Dvars();
-        printf("NVARS=%d\n",NVARS);  
-        printf("NXPE=%d\n", NXPE);
-        printf("MXSUB=%d\n",MXSUB); 
-        printf("NYPE=%d\n",NYPE);   //-number of poloidal subdomains
-        printf("MYSUB=%d\n",MYSUB);  //64; //-number of poloidal polongs per subdomain
-        printf("MZ=%d\n",MZ);     //65;    // toroidal grid size +1
-        printf("MYG=%d\n",MYG);    //-poloidal guard cells
-        printf("MXG=%d\n",MXG);    //-radial guard cells
-
-        stat=jstruc( NVARS,  NXPE,  MXSUB,  NYPE,  MYSUB,  MZ,  MYG,  MXG);
+        jacobian_pattern(J, local_N);
       }
 
       PetscInt diag;
@@ -304,6 +293,7 @@ PetscErrorCode Solver::run(MonitorFunc mon)
 
 PetscErrorCode Solver::rhs(TS ts, real t, Vec udata, Vec dudata)
 {
+  PROFILE_REGION("rhs");
   int flag;
   real *udata_array, *dudata_array;
 
@@ -321,6 +311,7 @@ PetscErrorCode Solver::rhs(TS ts, real t, Vec udata, Vec dudata)
 
   // Call RHS function
   flag = (*func)(t);
+  rhsCheckFinite(t);
 
   // Save derivatives to PETSc
   VecGetArray(dudata, &dudata_array);
@@ -394,6 +385,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_load(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -415,6 +413,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -436,6 +441,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].F_var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -447,6 +459,35 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
     }
     break;
   }
+  case SET_INDEX: {
+    /// Store the index of each value in index2d and index3d
+    
+    for(i=0;i<n2d;i++) {
+      d2d = index2d[i].getData();
+      d2d[jx][jy] = udata[p];
+      p++;
+    }
+    
+    if(zdealias) {
+      // Each Z pencil holds the index of its first coefficient
+      for(i=0;i<n3d;i++) {
+	d3d = index3d[i].getData();
+	for(jz=0;jz<ncz;jz++)
+	  d3d[jx][jy][jz] = udata[p];
+	p += nzvals();
+      }
+      break;
+    }
+    
+    for (jz=0; jz < ncz; jz++) {
+      for(i=0;i<n3d;i++) {
+	d3d = index3d[i].getData();
+	d3d[jx][jy][jz] = udata[p];
+	p++;
+      }
+    }
+    break;
+  }
   }
 }
 
@@ -578,6 +619,62 @@ void Solver::save_derivs(real *dudata)
   loop_vars(dudata, SAVE_DERIVS);
 }
 
+/// Set the nonzero pattern of the Jacobian J, so it can be coloured
+void Solver::jacobian_pattern(Mat J, int local_N)
+{
+#ifdef CHECK
+  int msg_point = msg_stack.push("Solver::jacobian_pattern");
+#endif
+  int n2d = n2Dvars();
+  int n3d = n3Dvars();
+
+  // Global index of the first value on this processor
+  int rstart;
+  MPI_Scan(&local_N, &rstart, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  rstart -= local_N;
+
+  // Put the index of each evolving value into fields, -1 elsewhere
+  index2d = new Field2D[n2d];
+  index3d = new Field3D[n3d];
+  for(int i=0;i<n2d;i++)
+    index2d[i] = -1.0;
+  for(int i=0;i<n3d;i++)
+    index3d[i] = -1.0;
+
+  real *idata = new real[local_N];
+  for(int i=0;i<local_N;i++)
+    idata[i] = (real) (rstart + i);
+  loop_vars(idata, SET_INDEX);
+  delete[] idata;
+
+  // Get the indices of neighbouring processors' values in the guard cells
+  Communicator comm;
+  comm.setRaw(); // No twist-shift or loss of precision
+  for(int i=0;i<n2d;i++)
+    comm.add(index2d[i]);
+  for(int i=0;i<n3d;i++)
+    comm.add(index3d[i]);
+  comm.run();
+
+  Field2D **p2d = new Field2D*[n2d];
+  for(int i=0;i<n2d;i++)
+    p2d[i] = index2d + i;
+  Field3D **p3d = new Field3D*[n3d];
+  for(int i=0;i<n3d;i++)
+    p3d[i] = index3d + i;
+
+  jstruc(J, rstart, local_N, n2d, p2d, n3d, p3d, nzvals());
+
+  delete[] p2d;
+  delete[] p3d;
+  delete[] index2d;
+  delete[] index3d;
+
+#ifdef CHECK
+  msg_stack.pop(msg_point);
+#endif
+}
+
 /**************************************************************************
  * Static functions which can be used for PETSc callbacks
  **************************************************************************/
@@ -49,11 +49,10 @@ using std::vector;
 
 typedef int (*rhsfunc)(real);
 
-enum SOLVER_VAR_OP {LOAD_VARS, SAVE_VARS, SAVE_DERIVS};
+enum SOLVER_VAR_OP {LOAD_VARS, SAVE_VARS, SAVE_DERIVS, SET_INDEX};
 
 EXTERN PetscErrorCode PreStep(TS);
 EXTERN PetscErrorCode PostStep(TS);
-EXTERN int jstruc(int NVARS, int NXPE, int MXSUB, int NYPE, int MYSUB, int MZ, int MYG, int MXG);
 
 class Solver : public GenericSolver {
  public:
@@ -90,6 +89,11 @@ class Solver : public GenericSolver {
   void load_vars(real *udata);
   int save_vars(real *udata);
   void save_derivs(real *dudata);
+
+  // Index of each evolving value, used to get the Jacobian pattern
+  Field2D *index2d;
+  Field3D *index3d;
+  void jacobian_pattern(Mat J, int local_N);
 };
 
 
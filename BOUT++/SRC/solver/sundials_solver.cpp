@@ -28,6 +28,7 @@
 #include "sundials_solver.h"
 
 #include "globals.h"
+#include "profile.h"
 #include "boundary.h"
 #include "interpolation.h" // Cell interpolation
 #include "communicator.h"
@@ -129,7 +130,7 @@ int Solver::init(rhsfunc f, int argc, char **argv, bool restarting, int nout, re
   options.get("RTOL", reltol, 1.0e-5);
   options.get("maxl", maxl, 5);
   options.get("use_precon", use_precon, false);
-  options.get("use_jacobian", use_jacobian, false);
+  options.get("use_jacobian", use_jacobian, jacfunc != NULL); // On if a Jacobian function is supplied
   options.get("max_timestep", max_timestep, -1.);
   
   int mxsteps; // Maximum number of steps to take between outputs
@@ -260,7 +261,7 @@ int Solver::run(MonitorFunc monitor)
     restart.write("%s/BOUT.restart.%d.%s", restartdir.c_str(), MYPE, restartext.c_str());
     
     if((archive_restart > 0) && (iteration % archive_restart == 0)) {
-      restart.write("%s/BOUT.restart_%04d.%d.%s", restartdir.c_str(), iteration, MYPE, restartext.c_str());
+      writeArchive();
     }
     
     /// Call the monitor function
@@ -285,6 +286,7 @@ int Solver::run(MonitorFunc monitor)
 
 real Solver::run(real tout, int &ncalls, real &rhstime)
 {
+  PROFILE_REGION("solver");
 #ifdef CHECK
   int msg_point = msg_stack.push("Running solver: solver::run(%e)", tout);
 #endif
@@ -329,6 +331,7 @@ real Solver::run(real tout, int &ncalls, real &rhstime)
 
 void Solver::rhs(real t, real *udata, real *dudata)
 {
+  PROFILE_REGION("rhs");
 #ifdef CHECK
   int msg_point = msg_stack.push("Running RHS: Solver::res(%e)", t);
 #endif
@@ -340,6 +343,7 @@ void Solver::rhs(real t, real *udata, real *dudata)
   
   // Call RHS function
   (*func)(t);
+  rhsCheckFinite(t);
   
   // Save derivatives to dudata
   save_derivs(dudata);
@@ -358,6 +362,7 @@ void Solver::rhs(real t, real *udata, real *dudata)
 
 void Solver::pre(real t, real gamma, real delta, real *udata, real *rvec, real *zvec)
 {
+  PROFILE_REGION("precon");
 #ifdef CHECK
   int msg_point = msg_stack.push("Running preconditioner: Solver::pre(%e)", t);
 #endif
@@ -398,6 +403,7 @@ void Solver::pre(real t, real gamma, real delta, real *udata, real *rvec, real *
 
 void Solver::jac(real t, real *ydata, real *vdata, real *Jvdata)
 {
+  PROFILE_REGION("jacobian");
 #ifdef CHECK
   int msg_point = msg_stack.push("Running Jacobian: Solver::jac(%e)", t);
 #endif
@@ -447,6 +453,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_load(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -469,6 +482,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_load(f3d[i].F_var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -491,6 +511,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
@@ -512,6 +539,13 @@ void Solver::loop_vars_op(int jx, int jy, real *udata, int &p, SOLVER_VAR_OP op)
       p++;
     }
     
+    if(zdealias) {
+      // Z Fourier coefficients of each 3D variable
+      for(i=0;i<n3d;i++)
+	zspec_save(f3d[i].F_var->getData()[jx][jy], udata, p);
+      break;
+    }
+    
     for (jz=0; jz < ncz; jz++) {
       
       // Loop over 3D variables
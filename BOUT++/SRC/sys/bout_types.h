@@ -38,7 +38,19 @@ enum CELL_LOC {CELL_DEFAULT, CELL_CENTRE, CELL_XLOW, CELL_YLOW, CELL_ZLOW, CELL_
 /// Differential methods. Both central and upwind
 enum DIFF_METHOD {DIFF_DEFAULT, DIFF_U1, DIFF_C2, DIFF_W2, DIFF_W3, DIFF_C4, DIFF_U4, DIFF_FFT};
 
+/// Methods for the Poisson bracket [f, g] (see bracket() in difops.h)
+enum BRACKET_METHOD {BRACKET_STD, BRACKET_SIMPLE, BRACKET_ARAKAWA};
+
 /// Specify grid region for looping
-enum REGION {RGN_ALL, RGN_NOBNDRY, RGN_NOX, RGN_NOY, RGN_NOZ};
+/*!
+ * RGN_ALL, RGN_NOY and RGN_NOZ include X guard cells, RGN_NOBNDRY and RGN_NOX don't.
+ * None of these include Y guard cells.
+ * RGN_XIN, RGN_XOUT are the X guard cells (interior Y), and RGN_YDOWN, RGN_YUP
+ * the Y guard cells (all X). RGN_CORE, RGN_SOL and RGN_PF split RGN_NOBNDRY
+ * using ixseps1 and the jyseps indices.
+ */
+enum REGION {RGN_ALL, RGN_NOBNDRY, RGN_NOX, RGN_NOY, RGN_NOZ,
+	     RGN_XIN, RGN_XOUT, RGN_YDOWN, RGN_YUP,
+	     RGN_CORE, RGN_SOL, RGN_PF};
 
 #endif // __BOUT_TYPES_H__
@@ -30,279 +30,57 @@
  * 
  **************************************************************************/
 
-#include <math.h>
-
 #include "dcomplex.h"
-#include "utils.h"
-
-dcomplex::dcomplex()
-{
-}
-
-dcomplex::dcomplex(const dcomplex &rhs)
-{
-  *this = rhs;
-}
-
-dcomplex::dcomplex(real rval, real ival)
-{
-  r = rval, i = ival;
-}
-
-dcomplex::~dcomplex()
-{
-}
-
-dcomplex & dcomplex::operator=(const dcomplex &rhs)
-{
-  r = rhs.r; i = rhs.i;
-  return *this;
-}
-
-dcomplex & dcomplex::operator=(const real &rhs)
-{
-  r = rhs; i = 0.0;
-  return *this;
-}
-
-dcomplex & dcomplex::operator+=(const dcomplex &rhs)
-{
-  r += rhs.r;
-  i += rhs.i;
-  return *this;
-}
-
-dcomplex & dcomplex::operator+=(const real &rhs)
-{
-  r += rhs;
-  return *this;
-}
-
-dcomplex & dcomplex::operator-=(const dcomplex &rhs)
-{
-  r -= rhs.r;
-  i -= rhs.i;
-  return *this;
-}
-
-dcomplex & dcomplex::operator-=(const real &rhs)
-{
-  r -= rhs;
-  return *this;
-}
-
-dcomplex & dcomplex::operator*=(const dcomplex &rhs)
-{
-  real rt;
-
-  rt = r * rhs.r - i * rhs.i;
-
-  i = i*rhs.r + r*rhs.i;
-  r = rt;
-  return *this;
-}
-
-dcomplex & dcomplex::operator*=(const real &rhs)
-{
-  r *= rhs;
-  i *= rhs;
-  return *this;
-}
-
-dcomplex & dcomplex::operator/=(const dcomplex &rhs)
-{
-  real c, rt;
-
-  c = rhs.r*rhs.r + rhs.i*rhs.i;
-  
-  rt = (r*rhs.r + i*rhs.i)/c;
-  i = (i*rhs.r - r*rhs.i)/c;
-  r = rt;
-  return *this;
-}
-
-const dcomplex dcomplex::operator-() const
-{
-  dcomplex result;
-
-  result.r = -r;
-  result.i = -i;
-  
-  return result;
-}
-
-const dcomplex dcomplex::operator+(const dcomplex &rhs) const
-{
-  dcomplex result;
-  
-  result.r = r + rhs.r;
-  result.i = i + rhs.i;
-
-  return result;
-}
-
-const dcomplex dcomplex::operator+(const real &rhs) const
-{
-  dcomplex result;
-
-  result.r = r + rhs;
-  result.i = i;
-
-  return result;
-}
-
-const dcomplex dcomplex::operator-(const dcomplex &rhs) const
-{
-  dcomplex result;
-  
-  result.r = r - rhs.r;
-  result.i = i - rhs.i;
-
-  return result;
-}
-
-const dcomplex dcomplex::operator-(const real &rhs) const
-{
-  dcomplex result;
-
-  result.r = r - rhs;
-  result.i = i;
 
-  return result;
-}
-
-const dcomplex dcomplex::operator*(const dcomplex &rhs) const
-{
-  dcomplex result;
-
-  result.r = r*rhs.r - i*rhs.i;
-  result.i = i*rhs.r + r*rhs.i;
-  
-  return result;
-}
-
-const dcomplex dcomplex::operator*(const real &rhs) const
-{
-  dcomplex result;
-
-  result.r = r * rhs;
-  result.i = i * rhs;
-
-  return result;
-}
-
-const dcomplex dcomplex::operator/(const dcomplex &rhs) const
-{
-  dcomplex result;
-  real c;
-
-  c = rhs.r*rhs.r + rhs.i*rhs.i;
-  result.r = (r*rhs.r + i*rhs.i)/c;
-  result.i = (i*rhs.r - r*rhs.i)/c;
-
-  return result;
-}
-
-const dcomplex dcomplex::operator/(const real &rhs) const
+std::ostream &operator<<(std::ostream &stream, dcomplex c)
 {
-  dcomplex result;
+  stream << "(" << c.r << ", " << c.i << ")";
   
-  result.r = r / rhs;
-  result.i = i / rhs;
-
-  return result;
-}
-
-// Non-member overloaded operators
-
-const dcomplex operator+(const real &lhs, const dcomplex &rhs)
-{
-  return rhs+lhs;
-}
-
-const dcomplex operator-(const real &lhs, const dcomplex &rhs)
-{
-  dcomplex result;
-
-  result.r = lhs - rhs.r;
-  result.i = -rhs.i;
-
-  return result;
+  return stream;
 }
 
-const dcomplex operator*(const real &lhs, const dcomplex &rhs)
-{
-  return rhs*lhs;
-}
+/****************************************************************
+ * Array operations
+ * 
+ * Written on the underlying reals (see layout check in dcomplex.h)
+ * so that the compiler can vectorise the loops
+ ****************************************************************/
 
-const dcomplex operator/(const real &lhs, const dcomplex &rhs)
+void cmul(dcomplex *a, const dcomplex *b, int n)
 {
-  dcomplex result;
-  real c;
+  real *ad = (real*) a;
+  const real *bd = (const real*) b;
   
-  c = rhs.r*rhs.r + rhs.i*rhs.i;
-
-  result.r = lhs*rhs.r / c;
-  result.i = -lhs*rhs.i / c;
-
-  return result;
+  for(int k=0;k<n;k++) {
+    real ar = ad[2*k], ai = ad[2*k+1];
+    real br = bd[2*k], bi = bd[2*k+1];
+    ad[2*k]   = ar*br - ai*bi;
+    ad[2*k+1] = ai*br + ar*bi;
+  }
 }
 
-// Boolean operators
-
-bool dcomplex::operator==(const dcomplex &rhs) const
+void cmulconj(dcomplex *a, const dcomplex *b, int n)
 {
-  return (r == rhs.r) && (i == rhs.i);
-}
-
-bool dcomplex::operator==(const real &rhs) const
-{
-  return (r == rhs) && (i == 0.0);
-}
-
-bool operator==(const real &lhs, const dcomplex &rhs)
-{
-  return (lhs == rhs.r) && (rhs.i == 0);
-}
-
-real abs(const dcomplex &c)
-{
-  return sqrt(SQ(c.r) + SQ(c.i));
-}
-
-const dcomplex conj(const dcomplex &c)
-{
-  dcomplex result;
+  real *ad = (real*) a;
+  const real *bd = (const real*) b;
   
-  result.r = c.r;
-  result.i = -c.i;
-
-  return result;
+  for(int k=0;k<n;k++) {
+    real ar = ad[2*k], ai = ad[2*k+1];
+    real br = bd[2*k], bi = bd[2*k+1];
+    ad[2*k]   = ar*br + ai*bi;
+    ad[2*k+1] = ai*br - ar*bi;
+  }
 }
 
-real dcomplex::Real() const
+void caxpy(int n, const dcomplex &a, const dcomplex *x, dcomplex *y)
 {
-  return r;
-}
-
-real dcomplex::Imag() const
-{
-  return i;
-}
-
-/****************************************************************
- * Functions
- ****************************************************************/
-
-const dcomplex exp(const dcomplex &c)
-{
-  return exp(c.Real()) * dcomplex(cos(c.Imag()), sin(c.Imag()));
-}
+  real ar = a.Real(), ai = a.Imag();
+  const real *xd = (const real*) x;
+  real *yd = (real*) y;
 
-std::ostream &operator<<(std::ostream &stream, dcomplex c)
-{
-  stream << "(" << c.r << ", " << c.i << ")";
-  
-  return stream;
+  for(int k=0;k<n;k++) {
+    real xr = xd[2*k], xi = xd[2*k+1];
+    yd[2*k]   += ar*xr - ai*xi;
+    yd[2*k+1] += ai*xr + ar*xi;
+  }
 }
-
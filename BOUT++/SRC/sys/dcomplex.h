@@ -28,6 +28,7 @@
 
 #include "bout_types.h"
 
+#include <math.h>
 #include <iostream>
 #include <fstream>
 
@@ -39,64 +40,86 @@
  * On some machines the standard C++ complex class cannot be used because
  * there is a conflict between PVODE and the library's definition of real
  *
+ * All operations are inline so that loops over complex arrays can be 
+ * optimised. The layout is two reals (real, imaginary), the same as
+ * std::complex<real> and fftw_complex, so arrays can be passed to FFTW
+ * without copying.
+ *
  * \author B.Dudson
  * \date November 2007
  */
 class dcomplex {
  public:
-  dcomplex();
-  dcomplex(const dcomplex &rhs);
-  dcomplex(real rval, real ival);
-  ~dcomplex();
+  dcomplex() {}
+  dcomplex(real rval, real ival) : r(rval), i(ival) {}
 
-  dcomplex & operator=(const dcomplex &rhs);
-  dcomplex & operator=(const real &rval);
+  dcomplex & operator=(const real &rval) { r = rval; i = 0.0; return *this; }
 
-  dcomplex & operator+=(const dcomplex &rhs);
-  dcomplex & operator+=(const real &rhs);
+  dcomplex & operator+=(const dcomplex &rhs) { r += rhs.r; i += rhs.i; return *this; }
+  dcomplex & operator+=(const real &rhs) { r += rhs; return *this; }
 
-  dcomplex & operator-=(const dcomplex &rhs);
-  dcomplex & operator-=(const real &rhs);
+  dcomplex & operator-=(const dcomplex &rhs) { r -= rhs.r; i -= rhs.i; return *this; }
+  dcomplex & operator-=(const real &rhs) { r -= rhs; return *this; }
 
-  dcomplex & operator*=(const dcomplex &rhs);
-  dcomplex & operator*=(const real &rhs);
+  dcomplex & operator*=(const dcomplex &rhs) {
+    real rt = r*rhs.r - i*rhs.i;
+    i = i*rhs.r + r*rhs.i;
+    r = rt;
+    return *this;
+  }
+  dcomplex & operator*=(const real &rhs) { r *= rhs; i *= rhs; return *this; }
 
-  dcomplex & operator/=(const dcomplex &rhs);
-  dcomplex & operator/=(const real &rhs);
+  dcomplex & operator/=(const dcomplex &rhs) {
+    real c = rhs.r*rhs.r + rhs.i*rhs.i;
+    real rt = (r*rhs.r + i*rhs.i)/c;
+    i = (i*rhs.r - r*rhs.i)/c;
+    r = rt;
+    return *this;
+  }
+  dcomplex & operator/=(const real &rhs) { r /= rhs; i /= rhs; return *this; }
 
-  const dcomplex operator-() const; // negate
+  const dcomplex operator-() const { return dcomplex(-r, -i); } // negate
 
   // Binary operators
 
-  const dcomplex operator+(const dcomplex &rhs) const;
-  const dcomplex operator+(const real &rhs) const;
+  const dcomplex operator+(const dcomplex &rhs) const { return dcomplex(r + rhs.r, i + rhs.i); }
+  const dcomplex operator+(const real &rhs) const { return dcomplex(r + rhs, i); }
   
-  const dcomplex operator-(const dcomplex &rhs) const;
-  const dcomplex operator-(const real &rhs) const;
-
-  const dcomplex operator*(const dcomplex &rhs) const;
-  const dcomplex operator*(const real &rhs) const;
-
-  const dcomplex operator/(const dcomplex &rhs) const;
-  const dcomplex operator/(const real &rhs) const;
-
-
-  friend const dcomplex operator+(const real &lhs, const dcomplex &rhs);
-  friend const dcomplex operator-(const real &lhs, const dcomplex &rhs);
-  friend const dcomplex operator*(const real &lhs, const dcomplex &rhs);
-  friend const dcomplex operator/(const real &lhs, const dcomplex &rhs);
+  const dcomplex operator-(const dcomplex &rhs) const { return dcomplex(r - rhs.r, i - rhs.i); }
+  const dcomplex operator-(const real &rhs) const { return dcomplex(r - rhs, i); }
+
+  const dcomplex operator*(const dcomplex &rhs) const { 
+    return dcomplex(r*rhs.r - i*rhs.i, i*rhs.r + r*rhs.i); 
+  }
+  const dcomplex operator*(const real &rhs) const { return dcomplex(r*rhs, i*rhs); }
+
+  const dcomplex operator/(const dcomplex &rhs) const {
+    real c = rhs.r*rhs.r + rhs.i*rhs.i;
+    return dcomplex((r*rhs.r + i*rhs.i)/c, (i*rhs.r - r*rhs.i)/c);
+  }
+  const dcomplex operator/(const real &rhs) const { return dcomplex(r / rhs, i / rhs); }
+
+  friend const dcomplex operator+(const real &lhs, const dcomplex &rhs) { return rhs + lhs; }
+  friend const dcomplex operator-(const real &lhs, const dcomplex &rhs) { 
+    return dcomplex(lhs - rhs.r, -rhs.i); 
+  }
+  friend const dcomplex operator*(const real &lhs, const dcomplex &rhs) { return rhs * lhs; }
+  friend const dcomplex operator/(const real &lhs, const dcomplex &rhs) {
+    real c = rhs.r*rhs.r + rhs.i*rhs.i;
+    return dcomplex(lhs*rhs.r / c, -lhs*rhs.i / c);
+  }
 
   // Boolean operators
 
-  bool operator==(const dcomplex &rhs) const;
-  bool operator==(const real &rhs) const;
-  friend bool operator==(const real &lhs, const dcomplex &rhs);
+  bool operator==(const dcomplex &rhs) const { return (r == rhs.r) && (i == rhs.i); }
+  bool operator==(const real &rhs) const { return (r == rhs) && (i == 0.0); }
+  friend bool operator==(const real &lhs, const dcomplex &rhs) { return (lhs == rhs.r) && (rhs.i == 0); }
 
-  friend real abs(const dcomplex &c);
-  friend const dcomplex conj(const dcomplex &c); // Complex conjugate 
+  friend real abs(const dcomplex &c) { return sqrt(c.r*c.r + c.i*c.i); }
+  friend const dcomplex conj(const dcomplex &c) { return dcomplex(c.r, -c.i); } // Complex conjugate 
 
-  real Real() const;
-  real Imag() const;
+  real Real() const { return r; }
+  real Imag() const { return i; }
 
   // Stream operators
   friend std::ostream &operator<<(std::ostream &stream, dcomplex c);
@@ -105,9 +128,24 @@ class dcomplex {
 
 };
 
-const dcomplex exp(const dcomplex &c);
+/// Compile-time check of the layout (array size -1 if wrong)
+typedef char dcomplex_layout_check[(sizeof(dcomplex) == 2*sizeof(real)) ? 1 : -1];
+
+inline const dcomplex exp(const dcomplex &c)
+{
+  return exp(c.Real()) * dcomplex(cos(c.Imag()), sin(c.Imag()));
+}
 
 /// imaginary i
 const dcomplex Im = dcomplex(0.0, 1.0);
 
+// Operations on arrays
+
+/// Multiply a by b element-wise, e.g. a phase array: a[i] *= b[i]
+void cmul(dcomplex *a, const dcomplex *b, int n);
+/// Multiply a by the conjugate of b: a[i] *= conj(b[i])
+void cmulconj(dcomplex *a, const dcomplex *b, int n);
+/// Complex axpy: y[i] += a * x[i]
+void caxpy(int n, const dcomplex &a, const dcomplex *x, dcomplex *y);
+
 #endif // __DCOMPLEX_H__
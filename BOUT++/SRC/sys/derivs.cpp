@@ -29,6 +29,7 @@
 #include "utils.h"
 #include "fft.h"
 #include "interpolation.h"
+#include "profile.h"
 
 #include <math.h>
 #include <string.h>
@@ -594,11 +595,12 @@ const Field2D applyXdiff(const Field2D &var, deriv_func func, const Field2D &dd,
 
   real **r = result.getData();
 
-  start_index(&bx, RGN_NOX);
-  do {
+  const Region &rgn = get_region(RGN_NOX);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
     var.SetXStencil(s, bx, loc);
     r[bx.jx][bx.jy] = func(s) / dd[bx.jx][bx.jy];
-  }while(next_index2(&bx));
+  }
 
 #ifdef CHECK
   // Mark boundaries as invalid
@@ -608,7 +610,7 @@ const Field2D applyXdiff(const Field2D &var, deriv_func func, const Field2D &dd,
   return result;
 }
 
-const Field3D applyXdiff(const Field3D &var, deriv_func func, const Field2D &dd, CELL_LOC loc = CELL_DEFAULT)
+Field3D applyXdiff(const Field3D &var, deriv_func func, const Field2D &dd, CELL_LOC loc = CELL_DEFAULT)
 {
   Field3D result;
   result.Allocate(); // Make sure data allocated
@@ -624,11 +626,15 @@ const Field3D applyXdiff(const Field3D &var, deriv_func func, const Field2D &dd,
   bindex bx;
   real ***r = result.getData();
   
-  start_index(&bx, RGN_NOX);
-  do {
-    vs.SetXStencil(s, bx, loc);
-    r[bx.jx][bx.jy][bx.jz] = func(s) / dd[bx.jx][bx.jy];
-  }while(next_index3(&bx));
+  const Region &rgn = get_region(RGN_NOX);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      vs.SetXStencil(s, bx, loc);
+      r[bx.jx][bx.jy][bx.jz] = func(s) / dd[bx.jx][bx.jy];
+    }
+  }
   
   if(ShiftXderivs && (ShiftOrder == 0))
     result = result.ShiftZ(false); // Shift back
@@ -652,11 +658,12 @@ const Field2D applyYdiff(const Field2D &var, deriv_func func, const Field2D &dd,
   bindex bx;
   stencil s;
 
-  start_index(&bx, RGN_NOY);
-  do{
+  const Region &rgn = get_region(RGN_NOY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
     var.SetYStencil(s, bx, loc);
     r[bx.jx][bx.jy] = func(s) / dd[bx.jx][bx.jy];
-  }while(next_index2(&bx));
+  }
   
 #ifdef CHECK
   // Mark boundaries as invalid
@@ -666,7 +673,7 @@ const Field2D applyYdiff(const Field2D &var, deriv_func func, const Field2D &dd,
   return result;
 }
 
-const Field3D applyYdiff(const Field3D &var, deriv_func func, const Field2D &dd, CELL_LOC loc = CELL_DEFAULT)
+Field3D applyYdiff(const Field3D &var, deriv_func func, const Field2D &dd, CELL_LOC loc = CELL_DEFAULT)
 {
   Field3D result;
   result.Allocate(); // Make sure data allocated
@@ -674,21 +681,26 @@ const Field3D applyYdiff(const Field3D &var, deriv_func func, const Field2D &dd,
   
   stencil s;
   bindex bx;
-  start_index(&bx, RGN_NOY);
-  do {
-    var.SetYStencil(s, bx, loc);
+  const Region &rgn = get_region(RGN_NOY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      var.SetYStencil(s, bx, loc);
     
-    r[bx.jx][bx.jy][bx.jz] = func(s) / dd[bx.jx][bx.jy];
+      r[bx.jx][bx.jy][bx.jz] = func(s) / dd[bx.jx][bx.jy];
   
-#ifdef CHECK
-      if(!finite(r[bx.jx][bx.jy][bx.jz])) {
-	msg_stack.push("At [%d][%d][%d]: %e, %e, %e, %e, %e",
-		       bx.jx, bx.jy, bx.jz, 
-		       s.mm, s.m, s.c, s.p, s.pp);
-	bout_error("Non-finite value\n");
-      }
+#if CHECK > 2
+	// Per-point check. Use the check_finite option to check less often
+	if(!finite(r[bx.jx][bx.jy][bx.jz])) {
+	  msg_stack.push("At [%d][%d][%d]: %e, %e, %e, %e, %e",
+			 bx.jx, bx.jy, bx.jz, 
+			 s.mm, s.m, s.c, s.p, s.pp);
+	  bout_error("Non-finite value\n");
+	}
 #endif
-  }while(next_index3(&bx));
+    }
+  }
 
 #ifdef CHECK
   // Mark boundaries as invalid
@@ -700,7 +712,7 @@ const Field3D applyYdiff(const Field3D &var, deriv_func func, const Field2D &dd,
 
 // Z derivative
 
-const Field3D applyZdiff(const Field3D &var, deriv_func func, real dd, CELL_LOC loc = CELL_DEFAULT)
+Field3D applyZdiff(const Field3D &var, deriv_func func, real dd, CELL_LOC loc = CELL_DEFAULT)
 {
   Field3D result;
   result.Allocate(); // Make sure data allocated
@@ -709,11 +721,15 @@ const Field3D applyZdiff(const Field3D &var, deriv_func func, real dd, CELL_LOC
   bindex bx;
   stencil s;
 
-  start_index(&bx, RGN_NOZ);
-  do {
-    var.SetZStencil(s, bx, loc);
-    r[bx.jx][bx.jy][bx.jz] = func(s) / dd;
-  }while(next_index3(&bx));
+  const Region &rgn = get_region(RGN_NOZ);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      var.SetZStencil(s, bx, loc);
+      r[bx.jx][bx.jy][bx.jz] = func(s) / dd;
+    }
+  }
 
   return result;
 }
@@ -724,8 +740,9 @@ const Field3D applyZdiff(const Field3D &var, deriv_func func, real dd, CELL_LOC
 
 ////////////// X DERIVATIVE /////////////////
 
-const Field3D DDX(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D DDX(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 {
+  PROFILE_REGION("DDX");
   deriv_func func = fDDX; // Set to default function
   DiffLookup *table = FirstDerivTable;
   
@@ -786,12 +803,12 @@ const Field3D DDX(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
   return result;
 }
 
-const Field3D DDX(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D DDX(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return DDX(f, outloc, method);
 }
 
-const Field3D DDX(const Field3D &f, DIFF_METHOD method)
+Field3D DDX(const Field3D &f, DIFF_METHOD method)
 {
   return DDX(f, CELL_DEFAULT, method);
 }
@@ -803,8 +820,9 @@ const Field2D DDX(const Field2D &f)
 
 ////////////// Y DERIVATIVE /////////////////
 
-const Field3D DDY(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D DDY(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 {
+  PROFILE_REGION("DDY");
   deriv_func func = fDDY; // Set to default function
   DiffLookup *table = FirstDerivTable;
   
@@ -863,12 +881,12 @@ const Field3D DDY(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
   return interp_to(result, outloc); // Interpolate if necessary
 }
 
-const Field3D DDY(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D DDY(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return DDY(f, outloc, method);
 }
 
-const Field3D DDY(const Field3D &f, DIFF_METHOD method)
+Field3D DDY(const Field3D &f, DIFF_METHOD method)
 {
   return DDY(f, CELL_DEFAULT, method);
 }
@@ -880,8 +898,9 @@ const Field2D DDY(const Field2D &f)
 
 ////////////// Z DERIVATIVE /////////////////
 
-const Field3D DDZ(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method, bool inc_xbndry)
+Field3D DDZ(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method, bool inc_xbndry)
 {
+  PROFILE_REGION("DDZ");
   deriv_func func = fDDZ; // Set to default function
   DiffLookup *table = FirstDerivTable;
  
@@ -924,6 +943,9 @@ const Field3D DDZ(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method, bool in
     // Lookup function
     func = lookupFunc(table, method);
   }
+  
+  if(linear_nmodes > 0)
+    func = NULL; // Linear mode: Z data are mode amplitudes, so multiply by ik
 
   Field3D result;
 
@@ -965,11 +987,11 @@ const Field3D DDZ(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method, bool in
 	for(jz=0;jz<=ncz/2;jz++) {
 	  kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
 
-	  if (jz>0.4*ncz) flt=1e-10; else flt=1.0;
+	  if ((jz>0.4*ncz) && (linear_nmodes <= 0)) flt=1e-10; else flt=1.0;
 	  cv[jz] *= dcomplex(0.0, kwave) * flt;
-	  if(StaggerGrids)
-	    cv[jz] *= exp(Im * (shift * kwave * dz));
 	}
+	if(StaggerGrids && (shift != 0.))
+	  cmulconj(cv, zshift_phase(shift * dz), ncz/2+1); // exp(i*k*shift*dz)
 	
 	irfft(cv, ncz, result[jx][jy]); // Reverse FFT
 
@@ -993,17 +1015,17 @@ const Field3D DDZ(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method, bool in
   return interp_to(result, outloc);
 }
 
-const Field3D DDZ(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc, bool inc_xbndry)
+Field3D DDZ(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc, bool inc_xbndry)
 {
   return DDZ(f, outloc, method, inc_xbndry);
 }
 
-const Field3D DDZ(const Field3D &f, DIFF_METHOD method, bool inc_xbndry)
+Field3D DDZ(const Field3D &f, DIFF_METHOD method, bool inc_xbndry)
 {
   return DDZ(f, CELL_DEFAULT, method, inc_xbndry);
 }
 
-const Field3D DDZ(const Field3D &f, bool inc_xbndry)
+Field3D DDZ(const Field3D &f, bool inc_xbndry)
 {
   return DDZ(f, CELL_DEFAULT, DIFF_DEFAULT, inc_xbndry);
 }
@@ -1052,8 +1074,9 @@ const Vector2D DDZ(const Vector2D &v)
 
 ////////////// X DERIVATIVE /////////////////
 
-const Field3D D2DX2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D D2DX2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 {
+  PROFILE_REGION("D2DX2");
   deriv_func func = fD2DX2; // Set to default function
   DiffLookup *table = SecondDerivTable;
   
@@ -1125,7 +1148,7 @@ const Field3D D2DX2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
   return result;
 }
 
-const Field3D D2DX2(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D D2DX2(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return D2DX2(f, outloc, method);
 }
@@ -1146,8 +1169,9 @@ const Field2D D2DX2(const Field2D &f)
 
 ////////////// Y DERIVATIVE /////////////////
 
-const Field3D D2DY2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D D2DY2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 {
+  PROFILE_REGION("D2DY2");
   deriv_func func = fD2DY2; // Set to default function
   DiffLookup *table = SecondDerivTable;
   
@@ -1206,7 +1230,7 @@ const Field3D D2DY2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
   return interp_to(result, outloc);
 }
 
-const Field3D D2DY2(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D D2DY2(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return D2DY2(f, outloc, method);
 }
@@ -1227,8 +1251,9 @@ const Field2D D2DY2(const Field2D &f)
 
 ////////////// Z DERIVATIVE /////////////////
 
-const Field3D D2DZ2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
+Field3D D2DZ2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 {
+  PROFILE_REGION("D2DZ2");
   deriv_func func = fD2DZ2; // Set to default function
   DiffLookup *table = SecondDerivTable;
   
@@ -1273,6 +1298,9 @@ const Field3D D2DZ2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
     // Lookup function
     func = lookupFunc(table, method);
   }
+  
+  if(linear_nmodes > 0)
+    func = NULL; // Linear mode: multiply amplitudes by -k^2
 
   if(func == NULL) {
     // Use FFT
@@ -1306,12 +1334,12 @@ const Field3D D2DZ2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
 	for(jz=0;jz<=ncz/2;jz++) {
 	  kwave=jz*2.0*PI/zlength; // wave number is 1/[rad]
 	  
-	  if (jz>0.4*ncz) flt=1e-10; else flt=1.0;
+	  if ((jz>0.4*ncz) && (linear_nmodes <= 0)) flt=1e-10; else flt=1.0;
 
 	  cv[jz] *= -SQ(kwave) * flt;
-	  if(StaggerGrids)
-	    cv[jz] *= exp(Im * (shift * kwave * dz));
 	}
+	if(StaggerGrids && (shift != 0.))
+	  cmulconj(cv, zshift_phase(shift * dz), ncz/2+1); // exp(i*k*shift*dz)
 
 	irfft(cv, ncz, result[jx][jy]); // Reverse FFT
 	
@@ -1335,7 +1363,7 @@ const Field3D D2DZ2(const Field3D &f, CELL_LOC outloc, DIFF_METHOD method)
   return interp_to(result, outloc);
 }
 
-const Field3D D2DZ2(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D D2DZ2(const Field3D &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return D2DZ2(f, outloc, method);
 }
@@ -1353,8 +1381,9 @@ const Field2D D2DZ2(const Field2D &f)
  *******************************************************************************/
 
 /// X-Z mixed derivative
-const Field3D D2DXDZ(const Field3D &f)
+Field3D D2DXDZ(const Field3D &f)
 {
+  PROFILE_REGION("D2DXDZ");
   Field3D result;
   
   // Take derivative in Z, including in X boundaries. Then take derivative in X
@@ -1388,13 +1417,14 @@ const Field2D VDDX(const Field2D &v, const Field2D &f, CELL_LOC outloc, DIFF_MET
 
   bindex bx;
   stencil vs, fs;
-  start_index(&bx);
-  do {
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
     f.SetXStencil(fs, bx);
     v.SetXStencil(vs, bx);
     
     d[bx.jx][bx.jy] = func(vs, fs) / dx[bx.jx][bx.jy];
-  }while(next_index2(&bx));
+  }
 
 #ifdef CHECK
   // Mark boundaries as invalid
@@ -1410,8 +1440,11 @@ const Field2D VDDX(const Field2D &v, const Field2D &f, DIFF_METHOD method)
 }
 
 /// General version for 2 or 3-D objects
-const Field3D VDDX(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+/// If w is given, returns the derivative with respect to v in the direction w:
+/// w times the derivative upwinded on the sign of v
+static Field3D vddx(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method, const Field *w)
 {
+  PROFILE_REGION("VDDX");
   upwind_func func = fVDDX;
   DiffLookup *table = UpwindTable;
 
@@ -1453,14 +1486,35 @@ const Field3D VDDX(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
     func = lookupUpwindFunc(table, method);
   }
 
+  if(linear_nmodes > 0) {
+    // Linear mode: upwinding a perturbed v on the sign of each (Re, Im)
+    // amplitude depends on the phase, so use central differencing. Only an
+    // axisymmetric f gives a linear term; the product of two perturbations is dropped
+    const Field3D *v3d = dynamic_cast<const Field3D*>(&v);
+    const Field2D *f2d = dynamic_cast<const Field2D*>(&f);
+    if(v3d != NULL) {
+      Field3D result;
+      if(f2d == NULL) {
+	result = 0.0;
+      }else if(w != NULL) {
+	result = (*dynamic_cast<const Field3D*>(w)) * DDX(*f2d);
+      }else
+	result = (*v3d) * DDX(*f2d);
+      return interp_to(result, outloc);
+    }
+  }
+
   /// Clone inputs (for shifting)
   Field *vp = v.clone();
   Field *fp = f.clone();
+  Field *wp = (w != NULL) ? w->clone() : NULL;
   
   if(ShiftXderivs && (ShiftOrder == 0)) {
     // Shift in Z using FFT if needed
     vp->ShiftToReal(true);
     fp->ShiftToReal(true);
+    if(wp != NULL)
+      wp->ShiftToReal(true);
   }
   
   Field3D result;
@@ -1468,15 +1522,25 @@ const Field3D VDDX(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
   real ***d = result.getData();
 
   bindex bx;
-  stencil vval, fval;
+  stencil vval, fval, wval;
   
-  start_index(&bx);
-  do {
-    vp->SetXStencil(vval, bx, diffloc);
-    fp->SetXStencil(fval, bx); // Location is always the same as input
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      vp->SetXStencil(vval, bx, diffloc);
+      fp->SetXStencil(fval, bx); // Location is always the same as input
     
-    d[bx.jx][bx.jy][bx.jz] = func(vval, fval) / dx[bx.jx][bx.jy];
-  }while(next_index3(&bx));
+      if(w != NULL) {
+	// Upwind on the sign of v. This multiplies the result, so cancels
+	wp->SetXStencil(wval, bx, diffloc);
+	vval.c = (vval.c >= 0.0) ? 1.0 : -1.0;
+	d[bx.jx][bx.jy][bx.jz] = wval.c*vval.c*func(vval, fval)/dx[bx.jx][bx.jy];
+      }else
+	d[bx.jx][bx.jy][bx.jz] = func(vval, fval)/dx[bx.jx][bx.jy];
+    }
+  }
   
   if(ShiftXderivs && (ShiftOrder == 0))
     result = result.ShiftZ(false); // Shift back
@@ -1491,11 +1555,18 @@ const Field3D VDDX(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
   // Delete clones
   delete vp;
   delete fp;
+  if(wp != NULL)
+    delete wp;
   
   return interp_to(result, outloc);
 }
 
-const Field3D VDDX(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D VDDX(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return vddx(v, f, outloc, method, NULL);
+}
+
+Field3D VDDX(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return VDDX(v, f, outloc, method);
 }
@@ -1553,12 +1624,13 @@ const Field2D VDDY(const Field2D &v, const Field2D &f, CELL_LOC outloc, DIFF_MET
   result.Allocate(); // Make sure data allocated
   real **d = result.getData();
 
-  start_index(&bx);
-  do {
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
     f.SetYStencil(fval, bx);
     v.SetYStencil(vval, bx, diffloc);
     d[bx.jx][bx.jy] = func(vval,fval)/dy[bx.jx][bx.jy];
-  }while(next_index2(&bx));
+  }
 
   result.setLocation(inloc);
   
@@ -1576,8 +1648,11 @@ const Field2D VDDY(const Field2D &v, const Field2D &f, DIFF_METHOD method)
 }
 
 // general case
-const Field3D VDDY(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+/// If w is given, returns the derivative with respect to v in the direction w:
+/// w times the derivative upwinded on the sign of v
+static Field3D vddy(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method, const Field *w)
 {
+  PROFILE_REGION("VDDY");
   upwind_func func = fVDDY;
   DiffLookup *table = UpwindTable;
 
@@ -1618,20 +1693,48 @@ const Field3D VDDY(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
     // Lookup function
     func = lookupUpwindFunc(table, method);
   }
+
+  if(linear_nmodes > 0) {
+    // Linear mode: upwinding a perturbed v on the sign of each (Re, Im)
+    // amplitude depends on the phase, so use central differencing. Only an
+    // axisymmetric f gives a linear term; the product of two perturbations is dropped
+    const Field3D *v3d = dynamic_cast<const Field3D*>(&v);
+    const Field2D *f2d = dynamic_cast<const Field2D*>(&f);
+    if(v3d != NULL) {
+      Field3D result;
+      if(f2d == NULL) {
+	result = 0.0;
+      }else if(w != NULL) {
+	result = (*dynamic_cast<const Field3D*>(w)) * DDY(*f2d);
+      }else
+	result = (*v3d) * DDY(*f2d);
+      return interp_to(result, outloc);
+    }
+  }
   bindex bx;
-  stencil vval, fval;
+  stencil vval, fval, wval;
   
   Field3D result;
   result.Allocate(); // Make sure data allocated
   real ***d = result.getData();
 
-  start_index(&bx);
-  do {
-    v.SetYStencil(vval, bx, diffloc);
-    f.SetYStencil(fval, bx);
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      v.SetYStencil(vval, bx, diffloc);
+      f.SetYStencil(fval, bx);
     
-    d[bx.jx][bx.jy][bx.jz] = func(vval, fval)/dy[bx.jx][bx.jy];
-  }while(next_index3(&bx));
+      if(w != NULL) {
+	// Upwind on the sign of v. This multiplies the result, so cancels
+	w->SetYStencil(wval, bx, diffloc);
+	vval.c = (vval.c >= 0.0) ? 1.0 : -1.0;
+	d[bx.jx][bx.jy][bx.jz] = wval.c*vval.c*func(vval, fval)/dy[bx.jx][bx.jy];
+      }else
+	d[bx.jx][bx.jy][bx.jz] = func(vval, fval)/dy[bx.jx][bx.jy];
+    }
+  }
 
   result.setLocation(inloc);
 
@@ -1643,7 +1746,12 @@ const Field3D VDDY(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
   return interp_to(result, outloc);
 }
 
-const Field3D VDDY(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D VDDY(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return vddy(v, f, outloc, method, NULL);
+}
+
+Field3D VDDY(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return VDDY(v, f, outloc, method);
 }
@@ -1667,8 +1775,11 @@ const Field2D VDDZ(const Field3D &v, const Field2D &f)
 }
 
 // general case
-const Field3D VDDZ(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+/// If w is given, returns the derivative with respect to v in the direction w:
+/// w times the derivative upwinded on the sign of v
+static Field3D vddz(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method, const Field *w)
 {
+  PROFILE_REGION("VDDZ");
   upwind_func func = fVDDZ;
   DiffLookup *table = UpwindTable;
 
@@ -1709,21 +1820,44 @@ const Field3D VDDZ(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
     // Lookup function
     func = lookupUpwindFunc(table, method);
   }
+  
+  if(linear_nmodes > 0) {
+    // Linear mode: no upwinding in Z. Only an axisymmetric v gives a linear
+    // term; the product of two perturbations is dropped
+    const Field2D *v2d = dynamic_cast<const Field2D*>(&v);
+    const Field3D *f3d = dynamic_cast<const Field3D*>(&f);
+    Field3D result;
+    if((v2d == NULL) || (f3d == NULL)) {
+      result = 0.0;
+    }else
+      result = (*v2d) * DDZ(*f3d, inloc, DIFF_DEFAULT);
+    return interp_to(result, outloc);
+  }
 
   bindex bx;
-  stencil vval, fval;
+  stencil vval, fval, wval;
   
   Field3D result;
   result.Allocate(); // Make sure data allocated
   real ***d = result.getData();
   
-  start_index(&bx);
-  do {
-    v.SetZStencil(vval, bx, diffloc);
-    f.SetZStencil(fval, bx);
+  const Region &rgn = get_region(RGN_NOBNDRY);
+  for(int i=0;i<rgn.size();i++) {
+    bx = rgn[i];
+    for(int jz=0;jz<ncz;jz++) {
+      set_zindex(bx, jz);
+      v.SetZStencil(vval, bx, diffloc);
+      f.SetZStencil(fval, bx);
     
-    d[bx.jx][bx.jy][bx.jz] = func(vval, fval)/dz;
-  }while(next_index3(&bx));
+      if(w != NULL) {
+	// Upwind on the sign of v. This multiplies the result, so cancels
+	w->SetZStencil(wval, bx, diffloc);
+	vval.c = (vval.c >= 0.0) ? 1.0 : -1.0;
+	d[bx.jx][bx.jy][bx.jz] = wval.c*vval.c*func(vval, fval)/dz;
+      }else
+	d[bx.jx][bx.jy][bx.jz] = func(vval, fval)/dz;
+    }
+  }
 
   result.setLocation(inloc);
 
@@ -1735,7 +1869,37 @@ const Field3D VDDZ(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD
   return interp_to(result, outloc);
 }
 
-const Field3D VDDZ(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
+Field3D VDDZ(const Field &v, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  return vddz(v, f, outloc, method, NULL);
+}
+
+Field3D VDDZ(const Field &v, const Field &f, DIFF_METHOD method, CELL_LOC outloc)
 {
   return VDDZ(v, f, outloc, method);
 }
+
+/*******************************************************************************
+ * Linearised upwinding
+ * The derivative of VDDX(v, f) with respect to v, in the direction w.
+ * VDDX(v + w, f) = VDDX(v, f) + VDDX_dv(v, w, f) while w doesn't change
+ * the sign of v. Staggered v and w are interpolated to the location of f
+ *******************************************************************************/
+
+Field3D VDDX_dv(const Field3D &v, const Field3D &w, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  Field3D wi = interp_to(w, f.getLocation());
+  return vddx(interp_to(v, f.getLocation()), f, outloc, method, &wi);
+}
+
+Field3D VDDY_dv(const Field3D &v, const Field3D &w, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  Field3D wi = interp_to(w, f.getLocation());
+  return vddy(interp_to(v, f.getLocation()), f, outloc, method, &wi);
+}
+
+Field3D VDDZ_dv(const Field3D &v, const Field3D &w, const Field &f, CELL_LOC outloc, DIFF_METHOD method)
+{
+  Field3D wi = interp_to(w, f.getLocation());
+  return vddz(interp_to(v, f.getLocation()), f, outloc, method, &wi);
+}
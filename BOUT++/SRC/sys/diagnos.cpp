@@ -30,11 +30,18 @@
 #include "meshtopology.h"
 #include "globals.h"
 
+#include <math.h>
+
 #define PVEC_REAL_MPI_TYPE MPI_DOUBLE
 
+/// Number of max-type and sum-type values per group
+const int DIAG_NMAX = 4; // max, max(-x), max(|x|), max(zrms)
+const int DIAG_NSUM = 3; // sum(x), sum(x^2), count
+
 /// Global variable initialisation
 bool Diagnos::init = false;
 bool Diagnos::global_vals = false;
+MPI_Op Diagnos::reduce_op;
 
 Diagnos::Diagnos()
 {
@@ -43,17 +50,38 @@ Diagnos::Diagnos()
     options.setSection("diagnos");
     options.get("global", global_vals, true);
     
+    MPI_Op_create(reduce, 1, &reduce_op);
+    
     init = true;
   }
+  
+  nindx = 0;
+  active = false;
+  rtypesize = 0;
 }
 
 Diagnos::~Diagnos()
 {
-
+  int finalised;
+  MPI_Finalized(&finalised);
+  if(!finalised) { // May be a global object
+    if(active)
+      finish();
+    
+    if(rtypesize > 0)
+      MPI_Type_free(&rtype);
+  }
+  
+  for(std::vector< diag_item >::iterator it = item.begin(); it != item.end(); it++)
+    if(it->label != NULL)
+      free(it->label);
 }
 
 void Diagnos::add(FieldData &f, DIAGNOS_FUNC func, int x, int y, int z, int component, const char* label)
 {
+  if(active)
+    finish(); // Buffers are changing
+  
   diag_item i;
   
   i.func = func;
@@ -65,13 +93,42 @@ void Diagnos::add(FieldData &f, DIAGNOS_FUNC func, int x, int y, int z, int comp
   i.y = y;
   i.z = z;
 
-//  int nr = i.var->realSize(); // Number of reals per point
+  int nr = i.var->realSize(); // Number of reals per point
+  if((component < 0) || (component >= nr))
+    component = 0;
 
   i.component = component;
 
+  if(func == DIAG_INDX) {
+    i.group = nindx;
+    nindx++;
+  }else {
+    // Find a group with the same data
+    i.group = -1;
+    for(unsigned int g=0;g<group.size();g++)
+      if((group[g].var == &f) && (group[g].component == component)) {
+	i.group = g;
+	break;
+      }
+    if(i.group < 0) {
+      diag_group g;
+      g.var = &f;
+      g.component = component;
+      group.push_back(g);
+      i.group = group.size()-1;
+    }
+  }
+
   item.push_back(i);
 }
 
+const char* Diagnos::getLabel(int i) const
+{
+  if((i < 0) || (i >= (int) item.size()))
+    return NULL;
+  return item[i].label;
+}
+
 /// Calculate the values and return in an array
 const vector< real > Diagnos::run()
 {
@@ -79,80 +136,254 @@ const vector< real > Diagnos::run()
   msg_stack.push("Diagnos::run\n");
 #endif
 
-  vector< real > result;
+  start();
+  vector< real > result = finish();
+
+#ifdef CHECK
+  msg_stack.pop();
+#endif
+
+  return result;
+}
+
+void Diagnos::start()
+{
+#ifdef CHECK
+  msg_stack.push("Diagnos::start\n");
+#endif
   
-  for(std::vector< diag_item >::iterator it = item.begin(); it != item.end(); it++) {
-    result.push_back(run(*it));
+  if(active)
+    finish();
+
+  int ng = group.size();
+  int nmax = DIAG_NMAX*ng;
+  int size = 1 + nmax + DIAG_NSUM*ng + nindx;
+  
+  sendbuf.resize(size);
+  recvbuf.resize(size);
+  
+  sendbuf[0] = (real) nmax;
+  real *maxvals = &sendbuf[1];
+  real *sumvals = &sendbuf[1 + nmax];
+  
+  // One sweep per group
+  for(int g=0;g<ng;g++)
+    sweep(group[g], maxvals + DIAG_NMAX*g, sumvals + DIAG_NSUM*g);
+  
+  // Single values
+  for(std::vector< diag_item >::iterator it = item.begin(); it != item.end(); it++)
+    if(it->func == DIAG_INDX)
+      sumvals[DIAG_NSUM*ng + it->group] = indexValue(*it);
+  
+  if(global_vals && (NPES > 1)) {
+    if(rtypesize != size) {
+      if(rtypesize > 0)
+	MPI_Type_free(&rtype);
+      MPI_Type_contiguous(size, PVEC_REAL_MPI_TYPE, &rtype);
+      MPI_Type_commit(&rtype);
+      rtypesize = size;
+    }
+    
+#if MPI_VERSION >= 3
+    MPI_Iallreduce(&sendbuf[0], &recvbuf[0], 1, rtype, reduce_op, MPI_COMM_WORLD, &request);
+#else
+    MPI_Allreduce(&sendbuf[0], &recvbuf[0], 1, rtype, reduce_op, MPI_COMM_WORLD);
+    request = MPI_REQUEST_NULL;
+#endif
+  }else {
+    recvbuf = sendbuf;
+    request = MPI_REQUEST_NULL;
   }
+  active = true;
 
 #ifdef CHECK
   msg_stack.pop();
 #endif
+}
 
+bool Diagnos::ready()
+{
+  if(!active || (request == MPI_REQUEST_NULL))
+    return true;
+  
+  int flag;
+  MPI_Status status;
+  MPI_Test(&request, &flag, &status);
+  return flag != 0;
+}
+
+const vector< real > Diagnos::finish()
+{
+  vector< real > result;
+  
+  if(!active)
+    return result;
+
+  if(request != MPI_REQUEST_NULL) {
+    MPI_Status status;
+    MPI_Wait(&request, &status);
+  }
+  active = false;
+
+  int ng = group.size();
+  real *maxvals = &recvbuf[1];
+  real *sumvals = &recvbuf[1 + DIAG_NMAX*ng];
+  
+  for(std::vector< diag_item >::iterator it = item.begin(); it != item.end(); it++) {
+    real *mx = maxvals + DIAG_NMAX*it->group;
+    real *sm = sumvals + DIAG_NSUM*it->group;
+    real n = sm[2];
+    if(n < 1.0)
+      n = 1.0;
+    real val = 0.0;
+    
+    switch(it->func) {
+    case DIAG_INDX: val = sumvals[DIAG_NSUM*ng + it->group]; break;
+    case DIAG_MAX:      val = mx[0];  break;
+    case DIAG_MIN:      val = -mx[1]; break;
+    case DIAG_MAXABS:   val = mx[2];  break;
+    case DIAG_MAX_ZRMS: val = mx[3];  break;
+    case DIAG_MEAN:     val = sm[0] / n; break;
+    case DIAG_RMS:      val = sqrt(sm[1] / n); break;
+    }
+    result.push_back(val);
+  }
+  
   return result;
 }
 
-real Diagnos::run(const diag_item &i)
+/// Combine buffers from two processors
+void Diagnos::reduce(void *invec, void *inoutvec, int *len, MPI_Datatype *datatype)
 {
-  switch(i.func) {
-  case DIAG_INDX: { ///< Index 
-    if(global_vals) {
-      int nr = i.var->realSize(); // Number of reals per point
-      if(nr <= 0)
-	return 0.0;
-      
-      static real *rptr;
-      static int rlen = 0;
-      
-      if(rlen < nr) {
-	if(rlen > 0)
-	  delete[] rptr;
-	rptr = new real[nr];
-	rlen = nr;
-      }
+  int size;
+  MPI_Type_size(*datatype, &size);
+  size /= sizeof(real); // Number of reals in each buffer
+  
+  real *in = (real*) invec;
+  real *inout = (real*) inoutvec;
+  
+  for(int r=0;r<*len;r++) {
+    int nmax = (int) in[0];
+    for(int i=1;i<=nmax;i++)
+      if(in[i] > inout[i])
+	inout[i] = in[i];
+    for(int i=nmax+1;i<size;i++)
+      inout[i] += in[i];
+    
+    in += size;
+    inout += size;
+  }
+}
 
-      // Use a global index
-      int np = PROC_NUM(i.x, i.y);
-      if((np < 0) || (np >= NPES))
-	return 0.0;
-      
-      real val = 0.0;
-      if(MYPE == np) {
-	i.var->getData(XLOCAL(i.x), YLOCAL(i.y), i.z, rptr);
-	int c = i.component;
-	if((i.component < 0) || (i.component >= nr))
-	  c = 0;
-	val = rptr[c];
+/// Calculate all statistics of one field component over the local domain
+void Diagnos::sweep(const diag_group &g, real *maxvals, real *sumvals)
+{
+  real vmax = -1.0e300, vnmax = -1.0e300, vabs = 0.0, zrms = 0.0;
+  real sum = 0.0, sumsq = 0.0;
+
+  int nz = g.var->is3D() ? ngz : 1; // Stride in z
+  int nzl = g.var->is3D() ? ncz : 1; // Number of z points
+
+  real *data = g.var->getData(g.component);
+  
+  static real *line = NULL;
+  static int linelen = 0;
+  if(linelen < ngz) {
+    if(line != NULL)
+      delete[] line;
+    line = new real[ngz];
+    linelen = ngz;
+  }
+  
+  static real *rptr = NULL;
+  static int rlen = 0;
+  int nr = g.var->realSize();
+  if((data == NULL) && (rlen < nr)) {
+    if(rptr != NULL)
+      delete[] rptr;
+    rptr = new real[nr];
+    rlen = nr;
+  }
+
+  for(int jx=MXG;jx<ngx-MXG;jx++)
+    for(int jy=jstart;jy<=jend;jy++) {
+      const real *v;
+      if(data != NULL) {
+	v = data + (jx*ngy + jy)*nz;
+      }else {
+	// No direct access, so copy the line
+	for(int jz=0;jz<nzl;jz++) {
+	  g.var->getData(jx, jy, jz, rptr);
+	  line[jz] = rptr[g.component];
+	}
+	v = line;
       }
       
-      MPI_Bcast ( &val, 1, PVEC_REAL_MPI_TYPE, np, MPI_COMM_WORLD); 
-      
-      return val;
-    }else {
-      // Local index
-      
-      if((i.x < 0) || (i.x > ncx) ||
-	 (i.y < 0) || (i.y > ncy) ||
-	 (i.z < 0) || (i.z > ncz)) {
-	return 0.0;
+      real s = 0.0, ss = 0.0, mx = -1.0e300, mn = 1.0e300;
+      for(int jz=0;jz<nzl;jz++) {
+	s += v[jz];
+	ss += v[jz]*v[jz];
+	mx = (v[jz] > mx) ? v[jz] : mx;
+	mn = (v[jz] < mn) ? v[jz] : mn;
       }
+      
+      sum += s;
+      sumsq += ss;
+      if(mx > vmax)
+	vmax = mx;
+      if(-mn > vnmax)
+	vnmax = -mn;
+      real r = sqrt(ss / ((real) nzl));
+      if(r > zrms)
+	zrms = r;
     }
-    break;
-  }
-  case DIAG_MAX: {
-    
-    
-    
-    if(global_vals) {
+  vabs = (vmax > vnmax) ? vmax : vnmax;
+  if(vabs < 0.0)
+    vabs = 0.0; // No points
+
+  maxvals[0] = vmax;
+  maxvals[1] = vnmax;
+  maxvals[2] = vabs;
+  maxvals[3] = zrms;
+  
+  sumvals[0] = sum;
+  sumvals[1] = sumsq;
+  sumvals[2] = (real) ((ngx - 2*MXG) * (jend - jstart + 1) * nzl);
+}
+
+/// Value at a single index. Non-zero only on one processor if global
+real Diagnos::indexValue(const diag_item &i)
+{
+  int nr = i.var->realSize(); // Number of reals per point
+  if(nr <= 0)
+    return 0.0;
       
-    }else {
+  static real *rptr;
+  static int rlen = 0;
       
-    }
-    
-    break;
+  if(rlen < nr) {
+    if(rlen > 0)
+      delete[] rptr;
+    rptr = new real[nr];
+    rlen = nr;
   }
-  default:
-    break;
-  };
-  return 0.0;
+  
+  int x = i.x, y = i.y;
+  if(global_vals) {
+    // Use a global index
+    int np = PROC_NUM(XPROC(i.x), YPROC(i.y));
+    if(np != MYPE)
+      return 0.0; // Summed over processors
+    x = XLOCAL(i.x);
+    y = YLOCAL(i.y);
+  }
+  
+  if((x < 0) || (x >= ngx) ||
+     (y < 0) || (y >= ngy) ||
+     (i.z < 0) || (i.z >= ncz)) {
+    return 0.0;
+  }
+  
+  i.var->getData(x, y, i.z, rptr);
+  return rptr[i.component];
 }
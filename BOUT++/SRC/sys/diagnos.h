@@ -26,6 +26,8 @@
 #ifndef __DIAGNOS_H__
 #define __DIAGNOS_H__
 
+#include "mpi.h"
+
 #include <vector>
 using std::vector;
 
@@ -34,14 +36,27 @@ using std::vector;
 /// Functions which can be applied to the data
 enum DIAGNOS_FUNC {DIAG_INDX, DIAG_MAX, DIAG_MAXABS, DIAG_MIN, DIAG_MEAN, DIAG_RMS, DIAG_MAX_ZRMS};
 
+/// Calculates a set of values from fields
+/*!
+  All values are calculated from a single sweep over each field
+  component, and combined across processors in a single reduction.
+  The reduction can be overlapped with other work by calling
+  start() then finish() (non-blocking if MPI-3 is available).
+*/
 class Diagnos {
  public:
   Diagnos();
   ~Diagnos();
   void add(FieldData &f, DIAGNOS_FUNC func, int x=-1, int y=-1, int z=-1, int component=-1, const char *label = NULL);
   
-  const vector< real > run();
+  const vector< real > run(); ///< Calculate values (start then finish)
+
+  void start();  ///< Calculate local values and start the reduction
+  bool ready();  ///< Test if the reduction has finished
+  const vector< real > finish(); ///< Wait for the reduction and return values
 
+  const char* getLabel(int i) const; ///< Label of the i'th value
+  
  private:
 
   static bool init;
@@ -55,11 +70,35 @@ class Diagnos {
     DIAGNOS_FUNC func;
     int x, y, z;
     int component;
+    
+    int group;  ///< Index into group (or into buffer for DIAG_INDX)
   }diag_item;
 
   vector< diag_item > item;
 
-  real run(const diag_item &i);
+  /// All statistics of one component of a field, calculated in one sweep
+  typedef struct {
+    FieldData *var;
+    int component;
+  }diag_group;
+  
+  vector< diag_group > group;
+  int nindx; ///< Number of DIAG_INDX items
+  
+  // Buffers are packed as [nmax, max values..., sum values...]
+  // Minimum is stored as max(-x) so only two operations are needed
+  vector< real > sendbuf, recvbuf;
+  
+  bool active; ///< A reduction is in progress
+  MPI_Request request;
+  MPI_Datatype rtype; ///< Whole buffer, so one call to reduce function
+  int rtypesize;
+
+  static MPI_Op reduce_op;
+  static void reduce(void *invec, void *inoutvec, int *len, MPI_Datatype *datatype);
+  
+  void sweep(const diag_group &g, real *maxvals, real *sumvals);
+  real indexValue(const diag_item &i);
 };
 
 
@@ -193,6 +193,7 @@ GLOBAL int  MZ;           // Number of points in the Z direction
 GLOBAL int  zperiod;      // Number of z domains in 2 pi
 GLOBAL real ZMIN;
 GLOBAL real ZMAX;
+GLOBAL int  linear_nmodes; // Linear mode: number of complex Z mode amplitudes (0 = off)
 GLOBAL int  MXG;
 GLOBAL int  MYG;
 GLOBAL bool BoundaryOnCell;  ///< Boundary is on the last "real" point. Otherwise between points (old method)
@@ -32,7 +32,6 @@
 MsgStack::MsgStack()
 {
   nmsg = 0;
-  size = 0;
 }
 
 MsgStack::~MsgStack()
@@ -40,39 +39,73 @@ MsgStack::~MsgStack()
   clear();
 }
 
+/// Store the arguments without formatting. Only the conversion
+/// characters in the format are examined, to get the argument types
 int MsgStack::push(const char *s, ...)
 {
-#if CHECK > 1
-  va_list ap;  // List of arguments
-  msg_item_t *m;
-
-  if(size > nmsg) {
-    m = &msg[nmsg];
-  }else {
-    // need to allocate more memory
-    if(size == 0) {
-      msg = (msg_item_t*) malloc(sizeof(msg_item_t)*10);
-      size = 10;
-      m = msg;
-    }else {
-      msg = (msg_item_t*) realloc(msg, sizeof(msg_item_t)*(size + 10));
-      m = &msg[size];
-      size += 10;
-    }
-  }
-
+#ifdef CHECK
+  msg_item_t *m = &msg[nmsg % MSG_STACK_SIZE];
+  
+  m->fmt = s;
+  m->nargs = 0;
+  
   if(s != NULL) {
-
+    va_list ap;  // List of arguments
+    int slen = 0; // Space used in m->str
+    
     va_start(ap, s);
-      vsprintf(buffer, s, ap);
+    for(const char *c = strchr(s, '%'); c != NULL; c = strchr(c, '%')) {
+      c++;
+      if(*c == '%') {
+	c++;
+	continue;
+      }
+      // Skip flags, width and precision
+      while((*c != 0) && (strchr("-+ #0123456789.", *c) != NULL))
+	c++;
+      bool islong = false;
+      while((*c == 'l') || (*c == 'h')) {
+	if(*c == 'l')
+	  islong = true;
+	c++;
+      }
+      if((*c == 0) || (m->nargs == MSG_MAX_ARGS))
+	break;
+      
+      msg_arg_t &a = m->arg[m->nargs];
+      switch(*c) {
+      case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c': {
+	a.l = islong ? va_arg(ap, long) : va_arg(ap, int);
+	break;
+      }
+      case 'e': case 'E': case 'f': case 'g': case 'G': {
+	a.d = va_arg(ap, double);
+	break;
+      }
+      case 's': {
+	// Copy, since the string may not exist when the stack is dumped
+	const char *str = va_arg(ap, const char*);
+	a.s = slen;
+	if(str == NULL)
+	  str = "(null)";
+	int n = strlen(str);
+	if(n > MSG_STR_SIZE - 1 - slen)
+	  n = MSG_STR_SIZE - 1 - slen;
+	memcpy(m->str + slen, str, n);
+	slen += n;
+	m->str[slen++] = 0;
+	if(slen >= MSG_STR_SIZE)
+	  slen = MSG_STR_SIZE - 1; // Any further strings are empty
+	break;
+      }
+      default: {
+	a.p = va_arg(ap, const void*);
+      }
+      }
+      m->nargs++;
+    }
     va_end(ap);
-    
-    strncpy(m->str, buffer, MSG_MAX_SIZE);
-    m->str[MSG_MAX_SIZE] = '\0';
-
-    //output.write("Pushing '%s' -> %d\n", buffer, nmsg);
-  }else
-    m->str[0] = '\0';
+  }
 
   nmsg++;
   return nmsg-1;
@@ -83,7 +116,7 @@ int MsgStack::push(const char *s, ...)
 
 int MsgStack::setPoint()
 {
-#if CHECK > 1
+#ifdef CHECK
   // Create an empty message
 
   return push(NULL);
@@ -94,12 +127,10 @@ int MsgStack::setPoint()
 
 void MsgStack::pop()
 {
-#if CHECK > 1
+#ifdef CHECK
   
   if(nmsg <= 0)
     return;
-  
-  //output.write("Popping %d\n", nmsg);
 
   nmsg--;
 #endif
@@ -107,7 +138,7 @@ void MsgStack::pop()
 
 void MsgStack::pop(int id)
 {
-#if CHECK > 1
+#ifdef CHECK
   if(id < 0)
     id = 0;
 
@@ -121,22 +152,94 @@ void MsgStack::pop(int id)
 
 void MsgStack::clear()
 {
-#if CHECK > 1
+#ifdef CHECK
   nmsg = 0;
 #endif
 }
 
 void MsgStack::dump()
 {
-#if CHECK > 1
+#ifdef CHECK
+  char buffer[256];
+  
   output.write("====== Back trace ======\n");
 
-  for(int i=nmsg-1;i>=0;i--) {
-    if(msg[i].str[0] != '\0') {
-      output.write(" -> ");
-      output.write(msg[i].str);
-      output.write("\n");
+  int first = nmsg - MSG_STACK_SIZE;
+  if(first < 0)
+    first = 0;
+  
+  for(int i=nmsg-1;i>=first;i--) {
+    const msg_item_t &m = msg[i % MSG_STACK_SIZE];
+    if(m.fmt != NULL) {
+      format(m, buffer, 256);
+      output.write(" -> %s\n", buffer);
     }
   }
+  if(first > 0)
+    output.write(" ... %d earlier messages not kept\n", first);
 #endif
 }
+
+/// Format each conversion separately, copying the text in between
+void MsgStack::format(const msg_item_t &m, char *buffer, int len)
+{
+  char spec[32];
+  int p = 0, arg = 0;
+  
+  const char *c = m.fmt;
+  while((*c != 0) && (p < len-1)) {
+    if(*c != '%') {
+      buffer[p++] = *c++;
+      continue;
+    }
+    
+    // Extract the conversion specification
+    const char *start = c++;
+    if(*c == '%') {
+      buffer[p++] = '%';
+      c++;
+      continue;
+    }
+    while((*c != 0) && (strchr("-+ #0123456789.lh", *c) != NULL))
+      c++;
+    if(*c == 0)
+      break;
+    c++;
+    int n = c - start;
+    if(n > 31)
+      n = 31;
+    memcpy(spec, start, n);
+    spec[n] = 0;
+    
+    if(arg == m.nargs)
+      break;
+    const msg_arg_t &a = m.arg[arg++];
+    
+    bool islong = (strchr(spec, 'l') != NULL);
+    switch(c[-1]) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c': {
+      if(islong) {
+	n = snprintf(buffer+p, len-p, spec, a.l);
+      }else
+	n = snprintf(buffer+p, len-p, spec, (int) a.l);
+      break;
+    }
+    case 'e': case 'E': case 'f': case 'g': case 'G': {
+      n = snprintf(buffer+p, len-p, spec, a.d);
+      break;
+    }
+    case 's': {
+      n = snprintf(buffer+p, len-p, spec, m.str + a.s);
+      break;
+    }
+    default: {
+      n = snprintf(buffer+p, len-p, "%p", a.p);
+    }
+    }
+    if(n > 0)
+      p += n;
+    if(p > len-1)
+      p = len-1;
+  }
+  buffer[p] = 0;
+}
@@ -2,6 +2,16 @@
  * Provides a message stack to print more useful error 
  * messages.
  *
+ * Pushing a message only stores a pointer to the format string and
+ * the raw arguments; the message is formatted when the stack is dumped.
+ * Format strings must therefore be literals (or otherwise outlive the
+ * message), and may only contain the conversions d,i,u,x,o,c (with h or l),
+ * e,f,g, s and p. Strings passed with %s are copied (truncated).
+ *
+ * Messages are held in a fixed-size ring buffer, so pushing never allocates.
+ * If more than MSG_STACK_SIZE messages are nested, only the most recent
+ * are kept.
+ *
  **************************************************************************
  * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
  *
@@ -31,10 +41,23 @@ class MsgStack;
 
 #include <stdio.h>
 
-#define MSG_MAX_SIZE 127
+#define MSG_STACK_SIZE 64 ///< Number of messages kept
+#define MSG_MAX_ARGS 6    ///< Maximum number of arguments per message
+#define MSG_STR_SIZE 48   ///< Space for copies of string arguments
+
+/// An argument to a message
+typedef union {
+  long l;
+  double d;
+  const void *p;
+  int s;         ///< Offset of a string argument in msg_item_t::str
+}msg_arg_t;
 
 typedef struct {
-  char str[MSG_MAX_SIZE+1];
+  const char *fmt; ///< Format string. NULL for an empty message
+  int nargs;
+  msg_arg_t arg[MSG_MAX_ARGS];
+  char str[MSG_STR_SIZE];
 }msg_item_t;
 
 class MsgStack {
@@ -52,13 +75,12 @@ class MsgStack {
   void dump();         ///< Write out all messages (using output)
  
  private:
-  char buffer[256];
-  
-  msg_item_t *msg;  ///< Message stack;
+  msg_item_t msg[MSG_STACK_SIZE]; ///< Message stack (ring buffer)
   int nmsg;    ///< Current number of messages
-  int size;    ///< Size of the stack
+
+  /// Format a message into buffer
+  void format(const msg_item_t &m, char *buffer, int len);
 };
 
 
 #endif // __MSG_STACK_H__
-
@@ -7,15 +7,15 @@
  * and variables as
  * name = string ; comment
  * 
- * To Do / Known issues
- * ====================
- *
- *  * Currently uses its own hash function. Probably better to just
- *    use an STL map for this class
- *
  * ChangeLog
  * =========
  * 
+ * 2010-10-20 
+ *
+ *    * Options stored in a hash table, rather than a linear search
+ *    * Values converted to int, real and bool once, when set
+ *    * Typed handles (OptionRef) and a count of queries per option
+ *
  * 2010-02-10 Ben Dudson <bd512@york.ac.uk>
  *    
  *    * Adding set methods to allow other means to control code
@@ -56,25 +56,47 @@
 #include <ctype.h>
 #include <stdlib.h>
 
+#include <vector>
+#include <algorithm>
+
 const char SEC_CHAR='_'; ///< Used to separate sections and keys
 
 OptionFile::OptionFile()
 {
   noptions = 0;
+  nmissed = 0;
+  tablesize = 0;
   def_section = NULL;
 }
 
 OptionFile::OptionFile(const char *filename)
 {
   noptions = 0;
-  read(filename);
+  nmissed = 0;
+  tablesize = 0;
   def_section = NULL;
+  read(filename);
 }
 
 OptionFile::~OptionFile()
 {
-  if(noptions > 0)
+  if(noptions > 0) {
+    for(int i=0;i<noptions;i++) {
+      free(option[i]->name);
+      free(option[i]->string);
+      delete option[i];
+    }
     free(option);
+  }
+
+  if(nmissed > 0) {
+    for(int i=0;i<nmissed;i++)
+      free(missed[i].name);
+    free(missed);
+  }
+  
+  if(tablesize > 0)
+    delete[] table;
 
   if(def_section != NULL)
     free(def_section);
@@ -192,7 +214,7 @@ int OptionFile::command_line(int argc, char** argv)
 {
   // Go through command-line arguments
   for(int i=1;i<argc;i++) {
-    // Should contain a "key=value" string
+    // Should contain a "key=value" or "section:key=value" string
     
     // Find the position of the equality
     int p = -1;
@@ -202,21 +224,29 @@ int OptionFile::command_line(int argc, char** argv)
       if(argv[i][j] == '=') {
 	if(p != -1) {
 	  // Multiple inequalities - ignore
-	  output.write("WARNING: Ignoring command-line option %s. Multiple equalities\n");
-	  continue;
+	  output.write("WARNING: Ignoring command-line option %s. Multiple equalities\n", argv[i]);
+	  p = -2;
+	  break;
 	}
-	p = i;
+	p = j;
       }
     }
     
-    if(p == -1) {
-      output.write("WARNING: Ignoring command-line option %s. Expecting key=value\n");
-      continue;
-    }
-    argv[i][p] = 0;
+    if(p < 0)
+      continue; // Not an option (e.g. "restart"). Handled elsewhere
+    
+    // Copy, since argv is passed on to the solver
+    char *key = strdup(argv[i]);
+    key[p] = 0;
+    char *c = strchr(key, ':');
+    if(c != NULL)
+      *c = SEC_CHAR; // Same form as names read from file
+    output.write("\tCommand-line option %s = %s\n", key, key+p+1);
     
-    // Add to the hash table
-    add("", argv[i], &(argv[i][p+1]), -1);
+    // Add to the hash table. Options in the file with the same name
+    // are then ignored, so this must be called before read()
+    add(NULL, key, key+p+1, -1);
+    free(key);
   }
   return 0;
 }
@@ -227,178 +257,83 @@ int OptionFile::command_line(int argc, char** argv)
 
 int OptionFile::getInt(const char *name, int &val)
 {
-  int i;
-
-  if(name == NULL)
-    return 1;
-
-  if((i = find(name)) == -1)
-    return(1);
-
-  if(sscanf(option[i].string, "%d", &val) != 1) {
-    output.write("\tOption '%s': Integer expected\n", name);
-    return(1);
-  }
-
-  return(0);
+  return getInt(NULL, name, val);
 }
 
 int OptionFile::getInt(const char *section, const char *name, int &val)
 {
-  static char *str;
-  static int len = 0;
-  int n;
+  t_option *opt;
   
-  if(name == NULL)
+  if((opt = find(section, name)) == NULL)
     return 1;
-
-  if(section == NULL)
-    return getInt(name, val);
-
-  n = strlen(section) + strlen(name);
-
-  if(n > len) {
-    if(len != 0)
-      free(str);
-    str = (char*) malloc(sizeof(char)*(n+2));
-    len = n;
-  }
-  sprintf(str, "%s%c%s", section, SEC_CHAR, name);
-  return( getInt(str, val) );
-}
-
-int OptionFile::getReal(const char *name, real &val)
-{
-  int i;
-  double v;
   
-  if((i = find(name)) == -1)
-    return(1);
-  
-  if(sscanf(option[i].string, "%lf", &v) != 1) {
-    output.write("\tOption '%s': Float expected\n", name);
+  if(!opt->ivalid) {
+    output.write("\tOption '%s': Integer expected\n", opt->name);
     return(1);
   }
   
-  val = (real) v;
-
+  val = opt->ival;
+  
   return(0);
 }
 
+int OptionFile::getReal(const char *name, real &val)
+{
+  return getReal(NULL, name, val);
+}
+
 int OptionFile::getReal(const char *section, const char *name, real &val)
 {
-  static char *str;
-  static int len = 0;
-  int n;
+  t_option *opt;
   
-  if(name == NULL)
+  if((opt = find(section, name)) == NULL)
     return 1;
-
-  if(section == NULL)
-    return getReal(name, val);
-
-  n = strlen(section) + strlen(name);
-
-  if(n > len) {
-    if(len != 0)
-      free(str);
-    str = (char*) malloc(sizeof(char)*(n+2));
-    len = n;
+  
+  if(!opt->rvalid) {
+    output.write("\tOption '%s': Float expected\n", opt->name);
+    return(1);
   }
-  sprintf(str, "%s%c%s", section, SEC_CHAR, name);
-  return( getReal(str, val) );
+  
+  val = opt->rval;
+
+  return(0);
 }
 
 char* OptionFile::getString(const char *name)
 {
-  if(name == NULL)
-    return NULL;
-
-  if(def_section == NULL) {
-    int i;
-    if((i = find(name)) == -1)
-      return((char*) NULL);
-    
-    return(option[i].string);
-  }
-  
   return getString(def_section, name);
 }
 
 char* OptionFile::getString(const char *section, const char *name)
 {
-  static char *str;
-  static int len = 0;
-  int n;
-
-  if(name == NULL)
-    return NULL;
-
-  if(section == NULL)
-    return getString(name);
+  t_option *opt;
   
-  n = strlen(section) + strlen(name);
-
-  if(n > len) {
-    if(len != 0)
-      free(str);
-    str = (char*) malloc(sizeof(char)*(n+2));
-    len = n;
-  }
-  sprintf(str, "%s%c%s", section, SEC_CHAR, name);
-
-  int i;
-  if((i = find(str)) == -1)
+  if((opt = find(section, name)) == NULL)
     return((char*) NULL);
   
-  return(option[i].string);
+  return(opt->string);
 }
 
 int OptionFile::getBool(const char *name, bool &val)
 {
-  int i;
-  char c;
-
-  if((i = find(name)) == -1) {
-    return(1);
-  }
-
-  c = toupper(option[i].string[0]);
-
-  if((c == 'Y') || (c == 'T') || (c == '1')) {
-    val = true;
-  }else if((c == 'N') || (c == 'F') || (c == '0')) {
-    val = false;
-  }else {
-    output.write("\tOption '%s': Boolean expected\n", name);
-    return(1);
-  }
-
-  return(0);
+  return getBool(NULL, name, val);
 }
 
 int OptionFile::getBool(const char *section, const char *name, bool &val)
 {
-  static char *str;
-  static int len = 0;
-  int n;
+  t_option *opt;
   
-  if(name == NULL)
+  if((opt = find(section, name)) == NULL)
     return 1;
-
-  if(section == NULL)
-    return getBool(name, val);
-
-  n = strlen(section) + strlen(name);
-
-  if(n > len) {
-    if(len != 0)
-      free(str);
-    str = (char*) malloc(sizeof(char)*(n+2));
-    len = n;
+  
+  if(!opt->bvalid) {
+    output.write("\tOption '%s': Boolean expected\n", opt->name);
+    return(1);
   }
-  sprintf(str, "%s%c%s", section, SEC_CHAR, name);
-  return( getBool(str, val) );
+  
+  val = opt->bval;
+
+  return(0);
 }
 
 /**************************************************************************
@@ -434,6 +369,21 @@ int OptionFile::set(const char *name, bool val)
 
 int OptionFile::set(const char *name, const char *str)
 {
+  if(name == NULL)
+    return 1;
+
+  // See if the name is already set
+  t_option *opt = lookup(def_section, name);
+  if(opt != NULL) {
+    output.write("WARNING: set method changing option '%s' from '%s' to '%s'\n", 
+		 opt->name, opt->string, str);
+    
+    free(opt->string);
+    opt->string = copy_string(str);
+    parse(opt); // Update values, so handles see the change
+    return 0;
+  }
+  
   int n = strlen(name)+1;
   if(def_section != (char*) NULL)
     n += strlen(def_section) + 1;
@@ -444,33 +394,105 @@ int OptionFile::set(const char *name, const char *str)
   }else
     strcpy(s, name);
 
-  // See if the name is already set
-  n = find(s);
-  if(n != -1) {
-    output.write("WARNING: set method changing option '%s' from '%s' to '%s'\n", 
-		 s, option[n].string, str);
-    
-    free(option[n].string);
-    free(s);
-  }else {
-    // Allocate a new option
-    if(noptions == 0) {
-      option = (t_option*) malloc(sizeof(t_option));
-    }else {
-      option = (t_option*) realloc(option, (noptions+1)*sizeof(t_option));
-    }
-    n = noptions;
-    noptions++;
-    
-    option[n].name = s;
-    option[n].hash = hash_string(name);
-  }
+  insert(s, str);
   
-  option[n].string = copy_string(str);
+  return 0;
+}
+
+/**************************************************************************
+ * Typed handles
+ **************************************************************************/
+
+int OptionFile::bind(const char *name, OptionRef<int> &ref, const int def)
+{
+  return bind(def_section, name, ref, def);
+}
+
+int OptionFile::bind(const char *name, OptionRef<real> &ref, const real def)
+{
+  return bind(def_section, name, ref, def);
+}
+
+int OptionFile::bind(const char *name, OptionRef<bool> &ref, const bool def)
+{
+  return bind(def_section, name, ref, def);
+}
+
+int OptionFile::bind(const char *section, const char *name, OptionRef<int> &ref, const int def)
+{
+  int val;
   
+  ref.def = def;
+  ref.ptr = &ref.def;
+  
+  if(get(section, name, val, def))
+    return 1; // Not found, or not valid
+  
+  ref.ptr = &(lookup(section, name)->ival);
   return 0;
 }
 
+int OptionFile::bind(const char *section, const char *name, OptionRef<real> &ref, const real def)
+{
+  real val;
+  
+  ref.def = def;
+  ref.ptr = &ref.def;
+  
+  if(get(section, name, val, def))
+    return 1;
+  
+  ref.ptr = &(lookup(section, name)->rval);
+  return 0;
+}
+
+int OptionFile::bind(const char *section, const char *name, OptionRef<bool> &ref, const bool def)
+{
+  bool val;
+  
+  ref.def = def;
+  ref.ptr = &ref.def;
+  
+  if(get(section, name, val, def))
+    return 1;
+  
+  ref.ptr = &(lookup(section, name)->bval);
+  return 0;
+}
+
+/**************************************************************************
+ * Query report
+ **************************************************************************/
+
+/// Sort by decreasing count
+static bool compare_count(const std::pair<int, string> &a, const std::pair<int, string> &b)
+{
+  if(a.first != b.first)
+    return a.first > b.first;
+  return a.second < b.second;
+}
+
+void OptionFile::printQueries()
+{
+  std::vector< std::pair<int, string> > list;
+  
+  for(int i=0;i<noptions;i++)
+    list.push_back(std::make_pair(option[i]->count, 
+				  string(option[i]->name) + " = " + option[i]->string));
+  
+  for(int i=0;i<nmissed;i++) {
+    if(lookup(NULL, missed[i].name) != NULL)
+      continue; // Set after these queries
+    list.push_back(std::make_pair(missed[i].count, string(missed[i].name) + " (not set)"));
+  }
+  
+  std::sort(list.begin(), list.end(), compare_count);
+  
+  output.write("\nOption queries:\n");
+  for(std::vector< std::pair<int, string> >::iterator it = list.begin(); it != list.end(); it++)
+    output.write("\t%10d  %s\n", it->first, it->second.c_str());
+}
+
 /**************************************************************************
  * Private functions
  **************************************************************************/
@@ -484,6 +506,15 @@ void OptionFile::add(const char *section, const char *name, char *string, int li
   if(name == NULL)
     return;
 
+  if(lookup(section, name) != NULL) {
+    if(section != (char*) NULL) {
+      output.write("\tVariable '%s%c%s' re-defined on line %d. Keeping first occurrence\n", 
+		   section, SEC_CHAR, name, linenr);
+    }else
+      output.write("\tVariable '%s' re-defined on line %d. Keeping first occurrence\n", name, linenr);
+    return;
+  }
+  
   n = strlen(name)+1;
   if(section != (char*) NULL)
     n += strlen(section) + 1;
@@ -493,76 +524,181 @@ void OptionFile::add(const char *section, const char *name, char *string, int li
   }else
     strcpy(s, name);
 
-  if(find(s) != -1) {
-    output.write("\tVariable '%s' re-defined on line %d. Keeping first occurrence\n", s, linenr);
-    free(s);
-    return;
-  }
-
-  // Allocate memory
+  insert(s, string);
+}
 
+/// Add a new option. Takes ownership of name
+void OptionFile::insert(char *name, const char *string)
+{
+  t_option *opt = new t_option;
+  
+  opt->name = name;
+  opt->hash = hash_string(name);
+  opt->string = copy_string(string);
+  opt->count = 0;
+  parse(opt);
+  
+  // Add to the list
   if(noptions == 0) {
-    option = (t_option*) malloc(sizeof(t_option));
+    option = (t_option**) malloc(sizeof(t_option*));
   }else {
-    option = (t_option*) realloc(option, (noptions+1)*sizeof(t_option));
+    option = (t_option**) realloc(option, (noptions+1)*sizeof(t_option*));
   }
+  option[noptions] = opt;
+  noptions++;
+  
+  insert_index(noptions-1, opt->hash);
+}
 
-  // Copy name across
-
-  option[noptions].name = s;
-
-  // Calculate hash
+/// Put an index into the first empty slot for a hash
+static void table_add(int *table, int tablesize, unsigned int hash, int ind)
+{
+  int i = hash & (tablesize-1);
+  while(table[i] != -1)
+    i = (i+1) & (tablesize-1);
+  table[i] = ind;
+}
 
-  option[noptions].hash = hash_string(s);
+/// Add an option (ind >= 0) or miss record (-2-ind) which has just been
+/// appended to its list
+void OptionFile::insert_index(int ind, unsigned int hash)
+{
+  // Keep the hash table at most half full
+  if(2*(noptions + nmissed) > tablesize) {
+    if(tablesize > 0)
+      delete[] table;
+    
+    tablesize = (tablesize == 0) ? 64 : 2*tablesize;
+    table = new int[tablesize];
+    for(int i=0;i<tablesize;i++)
+      table[i] = -1;
+    
+    // Re-insert everything, including the new entry
+    for(int j=0;j<noptions;j++)
+      table_add(table, tablesize, option[j]->hash, j);
+    for(int j=0;j<nmissed;j++)
+      table_add(table, tablesize, missed[j].hash, -2-j);
+  }else
+    table_add(table, tablesize, hash, ind);
+}
 
-  // Copy string across
-  option[noptions].string = copy_string(string);
+/// Convert the string to each of the types
+void OptionFile::parse(t_option *opt)
+{
+  double v;
   
-  noptions++;
+  opt->ivalid = (sscanf(opt->string, "%d", &(opt->ival)) == 1);
+  
+  opt->rvalid = (sscanf(opt->string, "%lf", &v) == 1);
+  if(opt->rvalid)
+    opt->rval = (real) v;
+  
+  char c = toupper(opt->string[0]);
+  opt->bvalid = true;
+  if((c == 'Y') || (c == 'T') || (c == '1')) {
+    opt->bval = true;
+  }else if((c == 'N') || (c == 'F') || (c == '0')) {
+    opt->bval = false;
+  }else
+    opt->bvalid = false;
 }
 
-int OptionFile::find(const char *name)
+/// Compare a stored name with "<section>_<name>" (or "<name>" if section is NULL)
+static bool name_match(const char *stored, const char *section, int ls, const char *name)
 {
-  int i, n;
-  int hash;
-
-  if(name == NULL)
-    return -1;
-
-  hash = hash_string(name);
+  if(section == NULL)
+    return strcasecmp(stored, name) == 0;
+  
+  return (strncasecmp(stored, section, ls) == 0) && 
+    (stored[ls] == SEC_CHAR) &&
+    (strcasecmp(stored + ls + 1, name) == 0);
+}
 
-  n = -1;
+/// Find an option called "<section>_<name>" (or "<name>" if section is NULL)
+/// without building the combined string. If it isn't set and miss is given,
+/// this is set to the index of the record of earlier misses, or -1
+OptionFile::t_option* OptionFile::lookup(const char *section, const char *name, int *miss)
+{
+  if(miss != NULL)
+    *miss = -1;
 
-  for(i=0;i<noptions;i++) {
-    if(option[i].hash == hash) {
+  if((name == NULL) || (tablesize == 0))
+    return NULL;
+  
+  unsigned int hash = 0;
+  int ls = 0;
+  if(section != NULL) {
+    static const char sep[2] = {SEC_CHAR, 0};
+    hash = hash_add(hash, section);
+    hash = hash_add(hash, sep);
+    ls = strlen(section);
+  }
+  hash = hash_final(hash_add(hash, name));
+  
+  int i = hash & (tablesize-1);
+  while(table[i] != -1) {
+    int ind = table[i];
+    if(ind >= 0) {
       // Compare strings to be sure
-      if(strcasecmp(option[i].name, name) == 0) {
-	n = i;
-	break;
-      }
-    }
+      if((option[ind]->hash == hash) && name_match(option[ind]->name, section, ls, name))
+	return option[ind];
+    }else if((miss != NULL) && (missed[-2-ind].hash == hash) && 
+	     name_match(missed[-2-ind].name, section, ls, name))
+      *miss = -2-ind; // Keep looking, in case the option was set later
+    i = (i+1) & (tablesize-1);
   }
   
-  return(n);
+  return NULL;
 }
 
-unsigned int OptionFile::hash_string(const char *string)
+OptionFile::t_option* OptionFile::find(const char *section, const char *name)
 {
-  int i, n;
-  unsigned int hash;
-
-  if(string == NULL)
-    return 0;
-
-  n = strlen(string);
-  hash = 0;
+  int miss;
+  t_option *opt = lookup(section, name, &miss);
+  
+  if(opt != NULL) {
+    opt->count++;
+  }else if(miss >= 0) {
+    missed[miss].count++;
+  }else if(name != NULL) {
+    // First lookup of an option which isn't set. Keep track of it
+    int n = strlen(name)+1;
+    if(section != NULL)
+      n += strlen(section) + 1;
+    char *s = (char*) malloc(n);
+    if(section != NULL) {
+      sprintf(s, "%s%c%s", section, SEC_CHAR, name);
+    }else
+      strcpy(s, name);
+    
+    if(nmissed == 0) {
+      missed = (t_miss*) malloc(sizeof(t_miss));
+    }else
+      missed = (t_miss*) realloc(missed, (nmissed+1)*sizeof(t_miss));
+    missed[nmissed].name = s;
+    missed[nmissed].hash = hash_string(s);
+    missed[nmissed].count = 1;
+    nmissed++;
+    
+    insert_index(-1-nmissed, missed[nmissed-1].hash);
+  }
+  
+  return opt;
+}
 
-  for(i=0;i<n;i++) {
+/// Add a string to a (case-insensitive) hash
+unsigned int OptionFile::hash_add(unsigned int hash, const char *string)
+{
+  for(int i=0;string[i] != 0;i++) {
     hash += (unsigned int) toupper(string[i]);
     hash += hash << 10;
     hash ^= hash >> 6;
   }
+  return hash;
+}
 
+unsigned int OptionFile::hash_final(unsigned int hash)
+{
   hash += hash << 3;
   hash ^= hash >> 11;
   hash += hash << 15;
@@ -570,6 +706,14 @@ unsigned int OptionFile::hash_string(const char *string)
   return(hash);
 }
 
+unsigned int OptionFile::hash_string(const char *string)
+{
+  if(string == NULL)
+    return 0;
+
+  return hash_final(hash_add(0, string));
+}
+
 // Strips leading and trailing spaces from a string
 int OptionFile::strip_space(char *string)
 {
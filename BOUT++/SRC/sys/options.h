@@ -41,6 +41,43 @@ class OptionFile;
 #include <stdarg.h>
 #include <stdio.h>
 
+#include <map>
+#include <string>
+
+using std::map;
+using std::string;
+
+/// Handle to a typed option value
+/*!
+ * Set using OptionFile::bind, after which reading the value
+ * is just a pointer dereference. If the option is later changed
+ * with OptionFile::set, the handle sees the new value.
+ * If the option wasn't found, the handle points to the default.
+ */
+template <class T>
+class OptionRef {
+ public:
+  OptionRef() : ptr(&def), def() {}
+  OptionRef(const OptionRef &r) : def(r.def) { ptr = r.isDefault() ? &def : r.ptr; }
+  
+  OptionRef& operator=(const OptionRef &r) {
+    def = r.def;
+    ptr = r.isDefault() ? &def : r.ptr;
+    return *this;
+  }
+  
+  const T& operator*() const { return *ptr; }
+  operator const T&() const { return *ptr; }
+  
+  /// True if the option wasn't set, so the default is used
+  bool isDefault() const { return ptr == &def; }
+ private:
+  friend class OptionFile;
+  
+  const T *ptr; ///< Points to the value in OptionFile, or to def
+  T def;
+};
+
 /// Class for reading INI style configuration files
 /*!
  * 
@@ -54,6 +91,8 @@ class OptionFile {
   /// Read options from grid file
   int read(const char *filename, ...);
   
+  /// Read "key=value" or "section:key=value" arguments. These take
+  /// precedence over the file, so call this before read()
   int command_line(int argc, char** argv);
 
   int getInt(const char *name, int &val);
@@ -81,12 +120,26 @@ class OptionFile {
   int get(const char *section, const char *name, real &val, const real def);
   int get(const char *section, const char *name, bool &val, const bool def);
 
+  // Typed handles. Look up the option once, printing the value like get()
+
+  int bind(const char *name, OptionRef<int> &ref, const int def);
+  int bind(const char *name, OptionRef<real> &ref, const real def);
+  int bind(const char *name, OptionRef<bool> &ref, const bool def);
+
+  int bind(const char *section, const char *name, OptionRef<int> &ref, const int def);
+  int bind(const char *section, const char *name, OptionRef<real> &ref, const real def);
+  int bind(const char *section, const char *name, OptionRef<bool> &ref, const bool def);
+
   // Set methods to pass in options manually
   int set(const char *name, int val);
   int set(const char *name, real val);
   int set(const char *name, bool val);
   int set(const char *name, const char *string);
 
+  /// Print how many times each option has been looked up, including
+  /// options which were not found. Handles are only counted once.
+  void printQueries();
+
  private:
   
   static const char COMMENT_CHAR = ';';
@@ -94,15 +147,45 @@ class OptionFile {
 
   typedef struct {
     char *name;
-    int hash;
+    unsigned int hash;
     char *string;
+    
+    // Values converted once, when the option is set
+    int ival;
+    real rval;
+    bool bval;
+    bool ivalid, rvalid, bvalid;
+    
+    int count; ///< Number of times looked up
   }t_option;
 
   int noptions;
-  t_option *option;
+  t_option **option; ///< Options. Not moved once allocated, so handles can point to values
   
+  /// Lookups of an option which isn't set. Made on the first miss, so
+  /// later misses only increment the count
+  typedef struct {
+    char *name;
+    unsigned int hash;
+    int count;
+  }t_miss;
+
+  int nmissed;
+  t_miss *missed;
+
+  int tablesize;  ///< Size of the hash table (power of 2, or 0)
+  int *table;     ///< Open addressing hash table of indices into option, -2-index into missed, or -1 if empty
+
   void add(const char *section, const char *name, char *string, int linenr);
-  int find(const char *name);
+  void insert(char *name, const char *string);
+  void insert_index(int ind, unsigned int hash); ///< Add to the hash table, growing it if needed
+  void parse(t_option *opt);
+  
+  t_option* lookup(const char *section, const char *name, int *miss = NULL); ///< Find an option
+  t_option* find(const char *section, const char *name);   ///< Find and count the query
+  
+  unsigned int hash_add(unsigned int hash, const char *string);
+  unsigned int hash_final(unsigned int hash);
   unsigned int hash_string(const char *string);
   int strip_space(char *string);
   int get_nextline(FILE *fp, char *buffer, int maxbuffer, int first);
@@ -0,0 +1,265 @@
+/**************************************************************************
+ * Lightweight profiler for timing regions of code
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ * 
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ **************************************************************************/
+
+#include "mpi.h"
+
+#include "globals.h"
+#include "profile.h"
+
+#include <string.h>
+#include <algorithm>
+
+bool Profiler::enabled = false;
+vector<string> Profiler::names;
+vector<Profiler::ProfNode> Profiler::node;
+int Profiler::current = 0;
+real Profiler::laststep = 0.0;
+FILE* Profiler::fp = NULL;
+
+void Profiler::init(const char *dir)
+{
+  bool profile;
+  options.setSection(NULL);
+  OPTION(profile, false);
+
+  if(!profile)
+    return;
+  
+  char filename[512];
+  sprintf(filename, "%s/BOUT.prof.%d", dir, MYPE);
+  if((fp = fopen(filename, "w")) == NULL) {
+    output.write("\tWARNING: Could not open profile file '%s'\n", filename);
+  }else
+    fprintf(fp, "# BOUT++ profile for processor %d of %d\n", MYPE, NPES);
+  
+  // Root of the call tree
+  node.clear();
+  newNode(-1, -1);
+  current = 0;
+  laststep = MPI_Wtime();
+  node[0].tstart = laststep;
+  
+  enabled = true;
+}
+
+int Profiler::region(const char *name)
+{
+  for(unsigned int i=0;i<names.size();i++)
+    if(names[i] == name)
+      return i;
+  names.push_back(string(name));
+  return names.size()-1;
+}
+
+int Profiler::newNode(int region, int parent)
+{
+  ProfNode n;
+  n.region = region;
+  n.parent = parent;
+  n.depth = (parent < 0) ? 0 : node[parent].depth + 1;
+  n.tstart = 0.0;
+  n.calls = n.tcalls = 0;
+  n.incl = n.child = n.bytes = 0.0;
+  n.tincl = n.tchild = n.tbytes = 0.0;
+  node.push_back(n);
+  
+  int id = node.size() - 1;
+  if(parent >= 0)
+    node[parent].children.push_back(id);
+  return id;
+}
+
+void Profiler::enter(int id)
+{
+  // Find this region under the current node
+  int n = -1;
+  vector<int> &ch = node[current].children;
+  for(unsigned int i=0;i<ch.size();i++)
+    if(node[ch[i]].region == id) {
+      n = ch[i];
+      break;
+    }
+  if(n < 0)
+    n = newNode(id, current);
+  
+  current = n;
+  node[n].tstart = MPI_Wtime();
+}
+
+void Profiler::leave()
+{
+  ProfNode &n = node[current];
+  real t = MPI_Wtime() - n.tstart;
+  n.calls++;
+  n.incl += t;
+  if(n.parent >= 0) {
+    node[n.parent].child += t;
+    current = n.parent;
+  }
+}
+
+void Profiler::step(real simtime, int iteration)
+{
+  if(!enabled)
+    return;
+  
+  setRoot();
+  
+  if(fp != NULL) {
+    fprintf(fp, "\n# Iteration %d, time = %e\n", iteration, simtime);
+    fprintf(fp, "#      calls   inclusive   exclusive       bytes   region\n");
+    writeNode(0);
+    fflush(fp);
+  }
+  
+  accumulate();
+}
+
+/// Root node is the time since the last step
+void Profiler::setRoot()
+{
+  real t = MPI_Wtime();
+  node[0].calls = 1;
+  node[0].incl = t - laststep;
+  laststep = t;
+}
+
+/// Add values since the last step to the totals, and reset
+void Profiler::accumulate()
+{
+  for(unsigned int i=0;i<node.size();i++) {
+    ProfNode &n = node[i];
+    n.tcalls += n.calls;
+    n.tincl  += n.incl;
+    n.tchild += n.child;
+    n.tbytes += n.bytes;
+    n.calls = 0;
+    n.incl = n.child = n.bytes = 0.0;
+  }
+}
+
+void Profiler::writeNode(int n)
+{
+  ProfNode &p = node[n];
+  if(p.calls > 0) {
+    fprintf(fp, "%12ld %11.4e %11.4e %11.4e   %*s%s\n",
+	    p.calls, p.incl, p.incl - p.child, p.bytes,
+	    2*p.depth, "", (p.region < 0) ? "total" : names[p.region].c_str());
+  }
+  for(unsigned int i=0;i<p.children.size();i++)
+    writeNode(p.children[i]);
+}
+
+void Profiler::summary()
+{
+  if(!enabled)
+    return;
+  
+  // Make sure totals are up to date
+  setRoot();
+  accumulate();
+  
+  // Collect totals for each region, flattening the tree. Recursive calls
+  // only counted once in the inclusive time
+  int nreg = names.size();
+  vector<real> calls(nreg, 0.0), incl(nreg, 0.0), excl(nreg, 0.0), bytes(nreg, 0.0);
+  for(unsigned int i=1;i<node.size();i++) {
+    ProfNode &n = node[i];
+    int r = n.region;
+    calls[r] += (real) n.tcalls;
+    excl[r]  += n.tincl - n.tchild;
+    bytes[r] += n.tbytes;
+    bool outer = true;
+    for(int p=n.parent;p>0;p=node[p].parent)
+      if(node[p].region == r)
+	outer = false;
+    if(outer)
+      incl[r] += n.tincl;
+  }
+  
+  // Regions can be registered in different orders on each processor,
+  // so get a common sorted list of names
+  string local;
+  for(int i=0;i<nreg;i++)
+    local += names[i] + '\n';
+  int len = local.size();
+  vector<int> lens(NPES), offsets(NPES);
+  MPI_Allgather(&len, 1, MPI_INT, &lens[0], 1, MPI_INT, MPI_COMM_WORLD);
+  int total = 0;
+  for(int i=0;i<NPES;i++) {
+    offsets[i] = total;
+    total += lens[i];
+  }
+  vector<char> all(total+1);
+  MPI_Allgatherv((void*) local.c_str(), len, MPI_CHAR, &all[0], &lens[0], &offsets[0], MPI_CHAR, MPI_COMM_WORLD);
+  all[total] = '\0';
+  
+  vector<string> global;
+  char *s = &all[0];
+  while(*s != '\0') {
+    char *e = strchr(s, '\n');
+    global.push_back(string(s, e - s));
+    s = e+1;
+  }
+  std::sort(global.begin(), global.end());
+  global.erase(std::unique(global.begin(), global.end()), global.end());
+  
+  // Values in global order: calls, incl, excl, bytes
+  int ng = global.size();
+  vector<real> val(4*ng, 0.0), vmin(4*ng), vmax(4*ng), vsum(4*ng);
+  for(int i=0;i<nreg;i++) {
+    int g = std::lower_bound(global.begin(), global.end(), names[i]) - global.begin();
+    val[4*g]   = calls[i];
+    val[4*g+1] = incl[i];
+    val[4*g+2] = excl[i];
+    val[4*g+3] = bytes[i];
+  }
+  MPI_Reduce(&val[0], &vmin[0], 4*ng, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&val[0], &vmax[0], 4*ng, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&val[0], &vsum[0], 4*ng, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  
+  real root = node[0].tincl, rmin, rmax, rsum;
+  MPI_Reduce(&root, &rmin, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&root, &rmax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&root, &rsum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  output.write("\nProfile summary over %d processors (min / mean / max)\n", NPES);
+  output.write("Total wall time: %.3e / %.3e / %.3e s\n\n", rmin, rsum/NPES, rmax);
+  output.write("%-20s %11s   %-33s   %-33s %11s\n", "Region", "calls", "   inclusive (s)", "   exclusive (s)", "bytes");
+  for(int g=0;g<ng;g++) {
+    output.write("%-20s %11.0f   %.3e %.3e %.3e   %.3e %.3e %.3e %11.4e\n",
+		 global[g].c_str(), vsum[4*g]/NPES,
+		 vmin[4*g+1], vsum[4*g+1]/NPES, vmax[4*g+1],
+		 vmin[4*g+2], vsum[4*g+2]/NPES, vmax[4*g+2],
+		 vsum[4*g+3]/NPES);
+  }
+  output.write("\n");
+  
+  if(fp != NULL) {
+    fclose(fp);
+    fp = NULL;
+  }
+  enabled = false;
+}
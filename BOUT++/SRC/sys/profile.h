@@ -0,0 +1,125 @@
+/*!************************************************************************
+ * Lightweight profiler for timing regions of code
+ *
+ * Regions are marked using PROFILE_REGION("name") at the start of a
+ * block, and are timed until the end of the block. Nested regions form
+ * a call tree, with call counts, inclusive and exclusive times, and
+ * (optionally) bytes transferred recorded for each node.
+ *
+ * Enabled at run time by setting profile = true in BOUT.inp. When
+ * disabled each region costs one test of a static flag. Compiling with
+ * -DNOPROFILE removes the regions entirely.
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ * 
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+class Profiler;
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "bout_types.h"
+
+#include <stdio.h>
+
+#include <vector>
+#include <string>
+
+using std::vector;
+using std::string;
+
+class Profiler {
+ public:
+  static bool enabled; ///< Set by init()
+  
+  /// Read options and open the output file <dir>/BOUT.prof.<MYPE>
+  static void init(const char *dir);
+  
+  /// Returns the id of a region, creating it if needed
+  static int region(const char *name);
+  
+  static void enter(int id); ///< Start timing a region
+  static void leave();       ///< Stop timing the current region
+  
+  /// Add to the number of bytes for the current region
+  static void addBytes(real nbytes) { if(enabled) node[current].bytes += nbytes; }
+  
+  /// Write the profile since the last call to file, then reset
+  static void step(real simtime, int iteration);
+  
+  /// Print the min/mean/max across processors to output. Collective
+  static void summary();
+  
+ private:
+  /// Node in the call tree
+  struct ProfNode {
+    int region, parent, depth;
+    vector<int> children;
+    
+    real tstart;  ///< Time when region entered
+    
+    // Since last step
+    long calls;
+    real incl;  ///< Inclusive time
+    real child; ///< Time spent in child regions
+    real bytes;
+    
+    // Totals
+    long tcalls;
+    real tincl, tchild, tbytes;
+  };
+  
+  static vector<string> names; ///< Region names
+  static vector<ProfNode> node;
+  static int current;  ///< Current node
+  static real laststep; ///< Time of last call to step()
+  static FILE *fp;
+  
+  static int newNode(int region, int parent);
+  static void setRoot();
+  static void accumulate();
+  static void writeNode(int n);
+};
+
+/// Times a region from construction to destruction
+class ProfileRegion {
+ public:
+  ProfileRegion(int id) : active(Profiler::enabled) { if(active) Profiler::enter(id); }
+  ~ProfileRegion() { if(active) Profiler::leave(); }
+ private:
+  bool active;
+};
+
+#ifndef NOPROFILE
+#define PROFILE_CONCAT_(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+/// Profile from here to the end of the enclosing block
+#define PROFILE_REGION(name) \
+  static int PROFILE_CONCAT(prof_id_, __LINE__) = Profiler::region(name); \
+  ProfileRegion PROFILE_CONCAT(prof_region_, __LINE__)(PROFILE_CONCAT(prof_id_, __LINE__))
+#define PROFILE_BYTES(n) Profiler::addBytes(n)
+#else
+#define PROFILE_REGION(name)
+#define PROFILE_BYTES(n)
+#endif
+
+#endif // __PROFILE_H__
@@ -30,6 +30,9 @@ typedef double real;
 
 #include "globals.h"
 #include "stencils.h"
+#include "meshtopology.h"
+
+#include <map>
 
 /**************************************************************************
  * bvalue class
@@ -869,3 +872,80 @@ int next_indexperp(bindex *bx)
   return(1);
 }
 
+/*******************************************************************************
+ * Regions
+ *******************************************************************************/
+
+/// Is global Y index in the core (closed field-line) region?
+static bool y_in_core(int jyg)
+{
+  return ((jyg > jyseps1_1) && (jyg <= jyseps2_1)) || 
+    ((jyg > jyseps1_2) && (jyg <= jyseps2_2));
+}
+
+Region::Region(REGION rgn)
+{
+  int xs = 0, xe = ngx-1, ys = jstart, ye = jend;
+  
+  switch(rgn) {
+  case RGN_NOBNDRY:
+  case RGN_NOX:
+  case RGN_CORE:
+  case RGN_SOL:
+  case RGN_PF: {
+    xs = MXG; xe = ngx-MXG-1;
+    break;
+  }
+  case RGN_XIN: {
+    xe = MXG-1;
+    break;
+  }
+  case RGN_XOUT: {
+    xs = ngx-MXG;
+    break;
+  }
+  case RGN_YDOWN: {
+    ys = 0; ye = jstart-1;
+    break;
+  }
+  case RGN_YUP: {
+    ys = jend+1; ye = ngy-1;
+    break;
+  }
+  default:
+    break;
+  };
+
+  bindex bx;
+  bx.jz = 0;
+  bx.region = rgn;
+  
+  // Same order as next_index3, so loops give the same results
+  for(bx.jx=xs;bx.jx<=xe;bx.jx++)
+    for(bx.jy=ys;bx.jy<=ye;bx.jy++) {
+      if((rgn == RGN_CORE) || (rgn == RGN_SOL) || (rgn == RGN_PF)) {
+	bool sol = XGLOBAL(bx.jx) >= ixseps1;
+	bool core = !sol && y_in_core(YGLOBAL(bx.jy));
+	
+	if( ((rgn == RGN_CORE) && !core) ||
+	    ((rgn == RGN_SOL) && !sol) ||
+	    ((rgn == RGN_PF) && (sol || core)) )
+	  continue;
+      }
+      calc_index(&bx);
+      index.push_back(bx);
+    }
+}
+
+const Region& get_region(REGION rgn)
+{
+  static std::map<REGION, Region*> regions;
+  
+  std::map<REGION, Region*>::iterator it = regions.find(rgn);
+  if(it != regions.end())
+    return *(it->second);
+  
+  Region *r = new Region(rgn);
+  regions[rgn] = r;
+  return *r;
+}
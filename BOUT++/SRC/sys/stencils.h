@@ -28,6 +28,8 @@
 
 #include "bout_types.h"
 
+#include <vector>
+
 class bvalue {
  public:
   int jx, jy, jz;
@@ -196,4 +198,62 @@ int next_index3(bindex *bx);
 int next_index2(bindex *bx);
 int next_indexperp(bindex *bx);
 
+/// List of the (x,y) points in a region
+/*!
+ * Indices for each point, including neighbours and shift offsets, are calculated
+ * once when the region is first used. At each (x,y) the Z index runs over
+ * 0...ncz-1, which is contiguous in Field3D data, so fast loops can be written:
+ *
+ *   const Region &rgn = get_region(RGN_NOBNDRY);
+ *   for(int i=0;i<rgn.size();i++) {
+ *     real *fp = fd[rgn.jx(i)][rgn.jy(i)];
+ *     for(int jz=0;jz<ncz;jz++)
+ *       fp[jz] = ...
+ *   }
+ *
+ * and loops using stencils:
+ *
+ *   for(int i=0;i<rgn.size();i++) {
+ *     bindex bx = rgn[i];
+ *     for(int jz=0;jz<ncz;jz++) {
+ *       set_zindex(bx, jz);
+ *       f.SetXStencil(s, bx);
+ *       ...
+ */
+class Region {
+ public:
+  Region(REGION rgn);
+  
+  int size() const { return (int) index.size(); } ///< Number of (x,y) points
+  int jx(int i) const { return index[i].jx; }
+  int jy(int i) const { return index[i].jy; }
+  /// Index of point i with jz = 0, as set by calc_index
+  const bindex& operator[](int i) const { return index[i]; }
+  
+ private:
+  std::vector<bindex> index;
+};
+
+/// Returns the (cached) list of points in a region
+const Region& get_region(REGION rgn);
+
+extern int ncz; // In globals.h
+
+/// Sets the Z index and its neighbours in bx (same as calc_index)
+inline void set_zindex(bindex &bx, int jz)
+{
+  bx.jz = jz;
+  if(ncz > 2) {
+    bx.jzp  = (jz+1 < ncz) ? jz+1 : jz+1-ncz;
+    bx.jzm  = (jz > 0)     ? jz-1 : jz-1+ncz;
+    bx.jz2p = (jz+2 < ncz) ? jz+2 : jz+2-ncz;
+    bx.jz2m = (jz > 1)     ? jz-2 : jz-2+ncz;
+  }else {
+    bx.jzp  = (jz+1)%ncz;
+    bx.jzm  = (jz+ncz-1)%ncz;
+    bx.jz2p = (jz+2)%ncz;
+    bx.jz2m = (jz+2*ncz-2)%ncz;
+  }
+}
+
 #endif /* __STENCILS_H__ */
@@ -27,6 +27,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <math.h>
 
 real *rvector(int size)
 {
@@ -179,6 +181,45 @@ bool is_pow2(int x)
   return x && !((x-1) & x);
 }
 
+/// Returns the index of the first NaN or Inf in data[0...n-1], or -1 if all finite.
+/// Tests whether the exponent bits are all set, which can be vectorised,
+/// over blocks of values, and only looks for the location in a block which fails.
+int first_nonfinite(const real *data, int n)
+{
+  const int BLOCK = 256;
+  
+  if(sizeof(real) != sizeof(uint64_t)) {
+    // Not double precision
+    for(int i=0;i<n;i++)
+      if(!finite(data[i]))
+	return i;
+    return -1;
+  }
+  
+  const uint64_t expmask = 0x7ff0000000000000ULL;
+  const uint64_t explow  = 0x0010000000000000ULL; // Lowest exponent bit
+  
+  for(int i0=0;i0<n;i0+=BLOCK) {
+    int i1 = (i0 + BLOCK < n) ? i0 + BLOCK : n;
+    
+    // Adding one to the exponent only carries into the sign bit
+    // if all exponent bits are set. No branches, so vectorises
+    uint64_t bad = 0;
+    for(int i=i0;i<i1;i++) {
+      uint64_t bits;
+      memcpy(&bits, data+i, sizeof(uint64_t));
+      bad |= (bits & expmask) + explow;
+    }
+    
+    if(bad >> 63) {
+      for(int i=i0;i<i1;i++)
+	if(!finite(data[i]))
+	  return i;
+    }
+  }
+  return -1;
+}
+
 /*
 // integer power
 real operator^(real lhs, int n)
@@ -48,6 +48,8 @@ void SWAP(real &a, real &b);
 void SWAP(dcomplex &a, dcomplex &b);
 bool is_pow2(int x); // Check if a number is a power of 2
 
+int first_nonfinite(const real *data, int n); ///< Index of the first NaN or Inf, or -1
+
 /*
 real operator^(real lhs, int rhs);
 real operator^(real lhs, const real &rhs);
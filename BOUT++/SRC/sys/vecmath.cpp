@@ -0,0 +1,574 @@
+/**************************************************************************
+ * Elementwise math functions on arrays
+ *
+ * Each kernel reduces the argument to a small range, evaluates a
+ * polynomial, then puts the result back together by manipulating the
+ * exponent bits. There are no branches or calls inside the loops, so
+ * they can be vectorised. Arrays are processed in chunks, and a chunk
+ * containing arguments the kernel doesn't handle (NaN, Inf, negative
+ * numbers for log etc.) is passed to libm instead.
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#include "globals.h"
+#include "vecmath.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+int vmath_accuracy = VMATH_ACCURATE;
+
+void vmath_init()
+{
+  options.setSection("vecmath");
+  options.get("accuracy", vmath_accuracy, (int) VMATH_ACCURATE);
+
+  if((vmath_accuracy < VMATH_LIBM) || (vmath_accuracy > VMATH_FAST)) {
+    output.write("\tWARNING: vecmath accuracy must be 0, 1 or 2. Using 1\n");
+    vmath_accuracy = VMATH_ACCURATE;
+  }
+}
+
+/**************************************************************************
+ * Constants and bit manipulation
+ **************************************************************************/
+
+static const int VMATH_CHUNK = 256;     ///< Elements per chunk
+static const real VMATH_POW_MAX = 4.;   ///< Largest exponent done by multiplication
+static const real VMATH_POW_KMAX = 128.; ///< Largest exponent done by the pow kernel
+
+static const real ROUND_MAGIC = 6755399441055744.0; // 1.5*2^52: x + ROUND_MAGIC rounds x to an integer
+
+static const real LOG2E  = 1.44269504088896338700e+00;
+static const real LN2_HI = 6.93147180369123816490e-01; // Upper 32 bits of ln(2)
+static const real LN2_LO = 1.90821492927058770002e-10;
+
+static const real TWO_OVER_PI = 6.36619772367581382433e-01;
+static const real PIO2_1 = 1.57079632673412561417e+00; // pi/2 in three 33-bit parts
+static const real PIO2_2 = 6.07710050630396597660e-11;
+static const real PIO2_3 = 2.02226624871116645580e-21;
+static const real TRIG_MAX = 1.0e5; // Largest argument reduced accurately
+
+static const real SQRT2 = 1.41421356237309514547e+00;
+static const real MIN_NORMAL = 2.2250738585072014e-308;
+static const real TWO54 = 1.80143985094819840000e+16;
+static const real SPLIT = 134217729.0; // 2^27 + 1, for Dekker's product
+
+static const int64_t MANT_MASK = 0x000fffffffffffffLL;
+static const int64_t ONE_BITS  = 0x3ff0000000000000LL;
+
+static inline int64_t as_int(real x)
+{
+  int64_t i;
+  memcpy(&i, &x, sizeof(real));
+  return i;
+}
+
+static inline real as_real(int64_t i)
+{
+  real x;
+  memcpy(&x, &i, sizeof(real));
+  return x;
+}
+
+/// Integer part of t - ROUND_MAGIC, where t = x + ROUND_MAGIC
+static inline int64_t round_bits(real t)
+{
+  return as_int(t) - as_int(ROUND_MAGIC);
+}
+
+/// 2^n for n in the normal exponent range
+static inline real pow2i(int64_t n)
+{
+  return as_real((int64_t) (((uint64_t) (n + 1023)) << 52));
+}
+
+/// c ? a : b, as bit operations. The compiler won't if-convert a
+/// branch containing floating point arithmetic (which could trap)
+static inline real select(bool c, real a, real b)
+{
+  int64_t mask = -((int64_t) c);
+  return as_real((as_int(a) & mask) | (as_int(b) & ~mask));
+}
+
+/// Flips the sign of x if bit 1 of q is set
+static inline real flip_sign(real x, int64_t q)
+{
+  return as_real(as_int(x) ^ (int64_t) (((uint64_t) (q & 2)) << 62));
+}
+
+/// Horner's rule with N coefficients. Written as a recursion
+/// rather than a loop, so there is no control flow left to vectorise
+template<int N>
+static inline real poly(const real *c, real z)
+{
+  return c[0] + z*poly<N-1>(c+1, z);
+}
+
+template<>
+inline real poly<1>(const real *c, real z)
+{
+  return c[0];
+}
+
+/**************************************************************************
+ * Kernels. LOW = true uses shorter polynomials (VMATH_FAST)
+ **************************************************************************/
+
+// exp(r) - 1 = r * (1 + r/2! + r^2/3! + ...)
+static const real EXPC[] = {1., 1./2., 1./6., 1./24., 1./120., 1./720., 1./5040.,
+			    1./40320., 1./362880., 1./3628800., 1./39916800.,
+			    1./479001600., 1./6227020800.};
+
+/// exp(r) - 1 for |r| <= ln(2)/2
+template<bool LOW>
+static inline real expm1_poly(real r)
+{
+  return r*poly<LOW ? 8 : 13>(EXPC, r);
+}
+
+/// exp(x + xlo) where xlo is a small correction
+template<bool LOW>
+static inline real exp_k(real x, real xlo = 0.)
+{
+  // Clamp so 2^q stays in range
+  x = select(x > 710., 710., x);
+  x = select(x < -746., -746., x);
+
+  // x = q*ln(2) + r
+  real t = x*LOG2E + ROUND_MAGIC;
+  real q = t - ROUND_MAGIC;
+  real r = (x - q*LN2_HI) - q*LN2_LO + xlo;
+
+  real p = 1. + expm1_poly<LOW>(r);
+
+  // Multiply by 2^q in two steps, so results near overflow
+  // and underflow (subnormals) are correct
+  int64_t n1 = round_bits(0.5*q + ROUND_MAGIC);
+  int64_t n2 = round_bits(t) - n1;
+  return (p * pow2i(n1)) * pow2i(n2);
+}
+
+/// exp(x) - 1 for |x| < 700
+template<bool LOW>
+static inline real expm1_k(real x)
+{
+  real t = x*LOG2E + ROUND_MAGIC;
+  real q = t - ROUND_MAGIC;
+  real r = (x - q*LN2_HI) - q*LN2_LO;
+
+  real s = pow2i(round_bits(t));
+  return s*expm1_poly<LOW>(r) + (s - 1.);
+}
+
+/// Rounding error in a*b (ab), using Dekker's splitting
+static inline real prod_err(real a, real b, real ab)
+{
+  real c = SPLIT*a;
+  real ah = c - (c - a);
+  real al = a - ah;
+  c = SPLIT*b;
+  real bh = c - (c - b);
+  real bl = b - bh;
+  return ((ah*bh - ab) + ah*bl + al*bh) + al*bl;
+}
+
+// log(m) = 2*atanh(f) = 2f*(1 + f^2/3 + f^4/5 + ...)
+static const real LOGC[] = {1./3., 1./5., 1./7., 1./9., 1./11., 1./13., 1./15.,
+			    1./17., 1./19., 1./21.};
+
+/// log(x) = hi + lo for finite x > 0
+template<bool LOW>
+static inline real log_k(real x, real &lo)
+{
+  real e = select(x < MIN_NORMAL, -1077., -1023.); // Subnormals scaled by 2^54
+  x *= select(x < MIN_NORMAL, TWO54, 1.);
+
+  // Split x = 2^e * m, with sqrt(2)/2 < m <= sqrt(2)
+  int64_t bits = as_int(x);
+  e += as_real(((bits >> 52) & 0x7ff) + as_int(ROUND_MAGIC)) - ROUND_MAGIC;
+  real m = as_real((bits & MANT_MASK) | ONE_BITS);
+  e += select(m > SQRT2, 1., 0.);
+  m *= select(m > SQRT2, 0.5, 1.);
+
+  // f = (m - 1)/(m + 1) as f + fl. m - 1 is exact, m + 1 = v + vl
+  real u = m - 1.;
+  real v = m + 1.;
+  real vb = v - m;
+  real vl = (m - (v - vb)) + (1. - vb);
+  real f = u / v;
+  real fv = f*v;
+  real fl = ((u - fv) - prod_err(f, v, fv) - f*vl) / v;
+
+  // log(m) = lm + lml. The leading 2f is exact, the rest is small
+  real s = f*f;
+  real f2 = 2.*f;
+  real t = f2*s*poly<LOW ? 4 : 10>(LOGC, s) + 2.*fl;
+  real lm = f2 + t;
+  real lml = (f2 - lm) + t;
+
+  // Add e*ln(2). |a| >= |lm| unless e = 0
+  real a = e*LN2_HI; // Exact
+  real hi = a + lm;
+  lo = ((a - hi) + lm) + (lml + e*LN2_LO);
+  return hi;
+}
+
+/// exp(p*log(x)), for x > 0. The log and product are carried in
+/// double-double. Rounding in the small terms of the log still grows
+/// slowly with |p|, so larger exponents are passed to libm
+template<bool LOW>
+static inline real pow_k(real x, real p)
+{
+  real lo;
+  real hi = log_k<LOW>(x, lo);
+  real yh = p*hi;
+  real yl = prod_err(p, hi, yh) + p*lo;
+  return exp_k<LOW>(yh, yl);
+}
+
+// Coefficients from fdlibm, on |r| <= pi/4
+static const real SINC[] = {-1.66666666666666324348e-01, 8.33333333332248946124e-03,
+			    -1.98412698298579493134e-04, 2.75573137070700676789e-06,
+			    -2.50507602534068634195e-08, 1.58969099521155010221e-10};
+static const real COSC[] = {4.16666666666666019037e-02, -1.38888888888741095749e-03,
+			    2.48015872894767294178e-05, -2.75573143513906633035e-07,
+			    2.08757232129817482790e-09, -1.13596475577881948265e-11};
+
+/// sin(x) and cos(x) for |x| <= TRIG_MAX
+template<bool LOW>
+static inline void sincos_k(real x, real &s, real &c)
+{
+  // x = q*pi/2 + r
+  real t = x*TWO_OVER_PI + ROUND_MAGIC;
+  real q = t - ROUND_MAGIC;
+  int64_t qi = round_bits(t);
+  real r = ((x - q*PIO2_1) - q*PIO2_2) - q*PIO2_3;
+
+  real z = r*r;
+  real sr = r + r*z*poly<LOW ? 4 : 6>(SINC, z);
+  real cr = (1. - 0.5*z) + z*z*poly<LOW ? 4 : 6>(COSC, z);
+
+  // Quadrant. Swap sin and cos if q is odd
+  real sv = select(qi & 1, cr, sr);
+  real cv = select(qi & 1, sr, cr);
+  s = flip_sign(sv, qi);
+  c = flip_sign(cv, qi+1);
+}
+
+/**************************************************************************
+ * Operations. Each has the libm function, the kernel, and the range
+ * of arguments the kernel handles
+ **************************************************************************/
+
+struct ExpOp {
+  real libm(real x) const { return exp(x); }
+  template<bool LOW> real kernel(real x) const { return exp_k<LOW>(x); }
+  bool inrange(real x) const { return x == x; }
+};
+
+struct LogOp {
+  real libm(real x) const { return log(x); }
+  template<bool LOW> real kernel(real x) const { real lo; real hi = log_k<LOW>(x, lo); return hi + lo; }
+  bool inrange(real x) const { return (x > 0.) && (x <= 1.7976931348623157e+308); }
+};
+
+struct SinOp {
+  real libm(real x) const { return sin(x); }
+  template<bool LOW> real kernel(real x) const { real s, c; sincos_k<LOW>(x, s, c); return s; }
+  bool inrange(real x) const { return fabs(x) <= TRIG_MAX; }
+};
+
+struct CosOp {
+  real libm(real x) const { return cos(x); }
+  template<bool LOW> real kernel(real x) const { real s, c; sincos_k<LOW>(x, s, c); return c; }
+  bool inrange(real x) const { return fabs(x) <= TRIG_MAX; }
+};
+
+struct TanOp {
+  real libm(real x) const { return tan(x); }
+  template<bool LOW> real kernel(real x) const { real s, c; sincos_k<LOW>(x, s, c); return s/c; }
+  bool inrange(real x) const { return fabs(x) <= TRIG_MAX; }
+};
+
+struct SinhOp {
+  real libm(real x) const { return sinh(x); }
+  template<bool LOW> real kernel(real x) const {
+    real em = expm1_k<LOW>(fabs(x));
+    return copysign(0.5*(em + em/(em + 1.)), x);
+  }
+  bool inrange(real x) const { return fabs(x) <= 700.; }
+};
+
+struct CoshOp {
+  real libm(real x) const { return cosh(x); }
+  template<bool LOW> real kernel(real x) const {
+    real e = exp_k<LOW>(fabs(x));
+    return 0.5*(e + 1./e);
+  }
+  bool inrange(real x) const { return fabs(x) <= 700.; }
+};
+
+struct TanhOp {
+  real libm(real x) const { return tanh(x); }
+  template<bool LOW> real kernel(real x) const {
+    real ax = fabs(x);
+    ax = select(ax > 20., 20., ax); // tanh(20) = 1 to double precision
+    real em = expm1_k<LOW>(2.*ax);
+    return copysign(em / (em + 2.), x);
+  }
+  bool inrange(real x) const { return x == x; }
+};
+
+struct PowOp {
+  real p;
+  PowOp(real pow) : p(pow) {}
+  real libm(real x) const { return pow(x, p); }
+  template<bool LOW> real kernel(real x) const { return pow_k<LOW>(x, p); }
+  bool inrange(real x) const { return (x > 0.) && (x <= 1.7976931348623157e+308) && (fabs(p) <= VMATH_POW_KMAX); }
+};
+
+/// Exponent is a^p, with log(a) = hi + lo precomputed
+struct ExpPowOp {
+  real a, hi, lo;
+  ExpPowOp(real base) : a(base) { hi = log_k<false>(a, lo); }
+  real libm(real p) const { return pow(a, p); }
+  template<bool LOW> real kernel(real p) const {
+    real yh = p*hi;
+    return exp_k<LOW>(yh, prod_err(p, hi, yh) + p*lo);
+  }
+  bool inrange(real p) const { return fabs(p) <= VMATH_POW_KMAX; }
+};
+
+template<bool LOW, class Op>
+static void apply_kernel(const Op &op, int n, const real *x, real *y)
+{
+  for(int i=0;i<n;i++)
+    y[i] = op.template kernel<LOW>(x[i]);
+}
+
+/// Applies an operation in chunks, using libm for chunks
+/// which contain arguments out of range
+template<class Op>
+static void apply(const Op &op, int n, const real *x, real *y)
+{
+  if(vmath_accuracy == VMATH_LIBM) {
+    for(int i=0;i<n;i++)
+      y[i] = op.libm(x[i]);
+    return;
+  }
+
+  for(int i0=0;i0<n;i0+=VMATH_CHUNK) {
+    int m = (n - i0 < VMATH_CHUNK) ? n - i0 : VMATH_CHUNK;
+    const real *xc = x + i0;
+    real *yc = y + i0;
+
+    bool ok = true;
+    for(int i=0;i<m;i++)
+      ok &= op.inrange(xc[i]);
+
+    if(!ok) {
+      for(int i=0;i<m;i++)
+	yc[i] = op.libm(xc[i]);
+    }else if(vmath_accuracy == VMATH_FAST) {
+      apply_kernel<true>(op, m, xc, yc);
+    }else
+      apply_kernel<false>(op, m, xc, yc);
+  }
+}
+
+/**************************************************************************
+ * Array functions
+ **************************************************************************/
+
+void vsqrt(int n, const real *x, real *y)
+{
+  // Hardware instruction, correctly rounded
+  for(int i=0;i<n;i++)
+    y[i] = sqrt(x[i]);
+}
+
+void vexp(int n, const real *x, real *y)
+{
+  apply(ExpOp(), n, x, y);
+}
+
+void vlog(int n, const real *x, real *y)
+{
+  apply(LogOp(), n, x, y);
+}
+
+void vsin(int n, const real *x, real *y)
+{
+  apply(SinOp(), n, x, y);
+}
+
+void vcos(int n, const real *x, real *y)
+{
+  apply(CosOp(), n, x, y);
+}
+
+void vtan(int n, const real *x, real *y)
+{
+  apply(TanOp(), n, x, y);
+}
+
+void vsinh(int n, const real *x, real *y)
+{
+  apply(SinhOp(), n, x, y);
+}
+
+void vcosh(int n, const real *x, real *y)
+{
+  apply(CoshOp(), n, x, y);
+}
+
+void vtanh(int n, const real *x, real *y)
+{
+  apply(TanhOp(), n, x, y);
+}
+
+void vpow(int n, const real *x, real p, real *y)
+{
+  real ap = fabs(p);
+
+  if((vmath_accuracy == VMATH_LIBM) || (ap > VMATH_POW_MAX) || (2.*ap != floor(2.*ap))) {
+    apply(PowOp(p), n, x, y);
+    return;
+  }
+
+  // Integer or half-integer exponent: x^k by repeated squaring, times
+  // sqrt(x) if half-integer. The rounding errors of the products are
+  // carried in rl and bl (as in pow_k), so this is within 1 ulp in both tiers
+  int k = (int) ap;
+  bool half = (ap != (real) k);
+
+  real bh[VMATH_CHUNK], bl[VMATH_CHUNK], rh[VMATH_CHUNK], rl[VMATH_CHUNK];
+  for(int i0=0;i0<n;i0+=VMATH_CHUNK) {
+    int m = (n - i0 < VMATH_CHUNK) ? n - i0 : VMATH_CHUNK;
+    const real *xc = x + i0;
+    real *yc = y + i0;
+
+    // Limit the range so the products can't overflow or underflow. Negative
+    // and non-finite x with half-integer p are special cases, so use libm
+    bool ok = true;
+    for(int i=0;i<m;i++) {
+      real ax = fabs(xc[i]);
+      ok &= ((ax >= 1.e-60) && (ax <= 1.e60)) || ((ax == 0.) && (p > 0.));
+      if(half)
+	ok &= (xc[i] >= 0.);
+    }
+    if(!ok) {
+      for(int i=0;i<m;i++)
+	yc[i] = pow(xc[i], p);
+      continue;
+    }
+
+    for(int i=0;i<m;i++) {
+      bh[i] = xc[i];
+      bl[i] = 0.;
+    }
+
+    if(half) {
+      for(int i=0;i<m;i++) {
+	bh[i] += 0.; // pow(-0, k+0.5) = +0
+	rh[i] = sqrt(bh[i]);
+	real t = rh[i]*rh[i];
+	rl[i] = (rh[i] > 0.) ? ((bh[i] - t) - prod_err(rh[i], rh[i], t)) / (2.*rh[i]) : 0.;
+      }
+    }else
+      for(int i=0;i<m;i++) {
+	rh[i] = 1.;
+	rl[i] = 0.;
+      }
+
+    for(int j=k;j>0;j>>=1) {
+      if(j & 1)
+	for(int i=0;i<m;i++) {
+	  real t = rh[i]*bh[i];
+	  rl[i] = prod_err(rh[i], bh[i], t) + rh[i]*bl[i] + rl[i]*bh[i];
+	  rh[i] = t;
+	}
+      if(j > 1)
+	for(int i=0;i<m;i++) {
+	  real t = bh[i]*bh[i];
+	  bl[i] = prod_err(bh[i], bh[i], t) + 2.*bh[i]*bl[i];
+	  bh[i] = t;
+	}
+    }
+
+    if(p < 0.) {
+      // 1/(rh + rl), correcting the rounding error of 1/rh
+      for(int i=0;i<m;i++) {
+	real q = 1. / rh[i];
+	real t = rh[i]*q;
+	real e = (1. - t) - prod_err(rh[i], q, t);
+	yc[i] = q + q*(e - rl[i]*q);
+      }
+    }else
+      for(int i=0;i<m;i++)
+	yc[i] = (rh[i] == 0.) ? rh[i] : rh[i] + rl[i]; // Keeps the sign of pow(-0, k)
+  }
+}
+
+void vpow(int n, const real *x, const real *p, real *y)
+{
+  if(vmath_accuracy == VMATH_LIBM) {
+    for(int i=0;i<n;i++)
+      y[i] = pow(x[i], p[i]);
+    return;
+  }
+
+  PowOp op(0.);
+  for(int i0=0;i0<n;i0+=VMATH_CHUNK) {
+    int m = (n - i0 < VMATH_CHUNK) ? n - i0 : VMATH_CHUNK;
+    const real *xc = x + i0, *pc = p + i0;
+    real *yc = y + i0;
+
+    bool ok = true;
+    for(int i=0;i<m;i++)
+      ok &= op.inrange(xc[i]) && (fabs(pc[i]) <= VMATH_POW_KMAX);
+
+    if(!ok) {
+      for(int i=0;i<m;i++)
+	yc[i] = pow(xc[i], pc[i]);
+    }else if(vmath_accuracy == VMATH_FAST) {
+      for(int i=0;i<m;i++)
+	yc[i] = pow_k<true>(xc[i], pc[i]);
+    }else
+      for(int i=0;i<m;i++)
+	yc[i] = pow_k<false>(xc[i], pc[i]);
+  }
+}
+
+void vpow(int n, real a, const real *p, real *y)
+{
+  if(!PowOp(0.).inrange(a)) {
+    // Zero, negative or non-finite base
+    for(int i=0;i<n;i++)
+      y[i] = pow(a, p[i]);
+    return;
+  }
+  apply(ExpPowOp(a), n, p, y);
+}
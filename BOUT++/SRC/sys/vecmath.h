@@ -0,0 +1,77 @@
+/*!************************************************************************
+ * Elementwise math functions on arrays
+ *
+ * Used by the Field2D and Field3D math functions and operator^. The
+ * kernels are branch-free polynomial approximations (in the style of
+ * SLEEF or the Cephes library) written as simple loops over contiguous
+ * data, so the compiler can vectorise them (e.g. -O3 -mavx2; plain SSE2
+ * lacks the 64-bit integer operations used).
+ *
+ * The accuracy is set by the "accuracy" option in the [vecmath] section:
+ *
+ *   0  Calls libm for every element (the old behaviour)
+ *   1  Polynomial kernels, within 4 ulp (default). The largest errors
+ *      measured are 3.4 ulp for tan and 3.3 ulp for x^p with |p| near 128
+ *   2  Shorter polynomials, relative error of a few times 1e-9
+ *      (times |p| for x^p)
+ *
+ * Integer and half-integer powers with |p| <= 4 use compensated products
+ * and a sqrt, and are within 1 ulp in both tiers. Powers with |p| > 128
+ * always use libm
+ *
+ * All functions work in-place (x == y)
+ *
+ **************************************************************************
+ * Copyright 2010 B.D.Dudson, S.Farley, M.V.Umansky, X.Q.Xu
+ *
+ * Contact: Ben Dudson, bd512@york.ac.uk
+ *
+ * This file is part of BOUT++.
+ *
+ * BOUT++ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BOUT++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with BOUT++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **************************************************************************/
+
+#ifndef __VECMATH_H__
+#define __VECMATH_H__
+
+#include "bout_types.h"
+
+enum VMATH_ACCURACY {VMATH_LIBM = 0, VMATH_ACCURATE = 1, VMATH_FAST = 2};
+
+extern int vmath_accuracy;
+
+/// Read the [vecmath] options
+void vmath_init();
+
+void vsqrt(int n, const real *x, real *y);
+void vexp(int n, const real *x, real *y);
+void vlog(int n, const real *x, real *y);
+
+void vsin(int n, const real *x, real *y);
+void vcos(int n, const real *x, real *y);
+void vtan(int n, const real *x, real *y);
+
+void vsinh(int n, const real *x, real *y);
+void vcosh(int n, const real *x, real *y);
+void vtanh(int n, const real *x, real *y);
+
+/// y = x^p. Integer and half-integer p with |p| <= 4 use multiplications and a sqrt
+void vpow(int n, const real *x, real p, real *y);
+/// y = x^p elementwise
+void vpow(int n, const real *x, const real *p, real *y);
+/// y = a^p
+void vpow(int n, real a, const real *p, real *y);
+
+#endif // __VECMATH_H__
@@ -0,0 +1,168 @@
+/*
+ * Micro-benchmarks for the core operators
+ *
+ * Times each operator in isolation on a synthetic grid (see data/BOUT.inp),
+ * so the size and decomposition can be changed without a grid file.
+ * Results are appended to a text file, one line per operator:
+ *
+ *   name  nx ny nz  NXPE NYPE  repeat  min mean max
+ *
+ * where nx, ny, nz are the global sizes (excluding guard cells), and
+ * min, mean, max are the wall-time per call in seconds over processors.
+ * Lines starting with '#' describe the run.
+ */
+
+#include "bout.h"
+#include "invert_laplace.h"
+#include "invert_parderiv.h"
+#include "meshtopology.h"
+#include "derivs.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+extern bool invert_use_pdd; // In invert_laplace.cpp
+
+// Inputs and outputs for the operators
+Field3D f, g, h, result;
+Field2D a2d;
+Communicator comm;
+Datafile *file;
+char filename[512];
+
+/////////////////////////////// Operators ///////////////////////////////
+
+void bench_arith()    { result = f*g + h; result += 2.*f; result /= g; }
+void bench_ddx()      { result = DDX(f); }
+void bench_ddy()      { result = DDY(f); }
+void bench_ddz()      { result = DDZ(f); }
+void bench_vddx()     { result = VDDX(g, f); }
+void bench_delp2()    { result = Delp2(f); }
+void bench_laplace()  { invert_laplace(f, result, 0, &a2d); }
+void bench_parderiv() { result = invert_parderiv(1.0, -1.0, f); }
+void bench_comms()    { comm.run(); }
+void bench_io()       { file->write(filename); }
+
+/////////////////////////////////////////////////////////////////////////
+
+int nrepeat;
+FILE *fout;
+
+/// Time a function, and write min, mean, max over processors
+void bench(const char *name, void (*func)())
+{
+  func(); // Warm up: allocates memory, sets up FFT plans etc.
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  real t = MPI_Wtime();
+  for(int i=0;i<nrepeat;i++)
+    func();
+  t = (MPI_Wtime() - t) / ((real) nrepeat);
+
+  real tmin, tmax, tsum;
+  MPI_Reduce(&t, &tmin, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&t, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&t, &tsum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  output.write("\t%-24s %e s per call\n", name, tsum / ((real) NPES));
+
+  if(fout != NULL) {
+    fprintf(fout, "%-24s %5d %5d %5d %4d %4d %6d %e %e %e\n",
+	    name, NXPE*MXSUB, NYPE*MYSUB, ncz, NXPE, NYPE, nrepeat,
+	    tmin, tsum / ((real) NPES), tmax);
+  }
+}
+
+int physics_init()
+{
+  options.setSection("bench");
+  options.get("repeat", nrepeat, 20);
+  char *outname = options.getString("output");
+  if(outname == NULL)
+    outname = (char*) "data/bench.txt";
+
+  // Smooth, non-trivial input fields
+  f.Allocate(); g.Allocate(); h.Allocate();
+  real ***fd = f.getData(), ***gd = g.getData(), ***hd = h.getData();
+  for(int jx=0;jx<ngx;jx++)
+    for(int jy=0;jy<ngy;jy++) {
+      real x = ((real) XGLOBAL(jx)) / ((real) (NXPE*MXSUB + 2*MXG));
+      real y = TWOPI * ((real) YGLOBAL(jy)) / ((real) (NYPE*MYSUB));
+      for(int jz=0;jz<ngz;jz++) {
+	real z = TWOPI * ((real) jz) / ((real) ncz);
+	fd[jx][jy][jz] = sin(PI*x)*cos(y + 3.*z);
+	gd[jx][jy][jz] = 2. + x*sin(z - y);
+	hd[jx][jy][jz] = x*x + cos(2.*z);
+      }
+    }
+  a2d = -1.0;
+
+  comm.add(f);
+  comm.add(g);
+  comm.run(); // Need Y guard cells for DDY
+
+  // Output file in the dump file format
+  options.setSection(NULL);
+  char *ext = options.getString("dump_format");
+  if(ext == NULL)
+    ext = DEFAULT_FILE_EXT;
+  sprintf(filename, "data/bench.%d.%s", MYPE, ext);
+  file = new Datafile(data_format(ext));
+  file->add(f, "f", 0);
+  file->add(g, "g", 0);
+
+  fout = NULL;
+  if(MYPE == 0) {
+    if((fout = fopen(outname, "a")) == NULL)
+      output.write("\tWARNING: Could not open '%s' for writing\n", outname);
+  }
+  if(fout != NULL) {
+    time_t start = time((time_t*) NULL);
+    fprintf(fout, "# BOUT++ version %.2f, %s", BOUT_VERSION, ctime(&start));
+    fprintf(fout, "# name nx ny nz NXPE NYPE repeat min mean max\n");
+  }
+
+  output.write("Running benchmarks (%d repeats)\n", nrepeat);
+
+  bench("Field3D_arithmetic", bench_arith);
+  bench("DDX", bench_ddx);
+  bench("DDY", bench_ddy);
+  bench("DDZ", bench_ddz);
+  bench("VDDX", bench_vddx);
+  bench("Delp2", bench_delp2);
+
+  if(NXPE == 1) {
+    bench("invert_laplace_serial", bench_laplace);
+  }else {
+    bool pdd = invert_use_pdd;
+    invert_use_pdd = false;
+    bench("invert_laplace_SPT", bench_laplace);
+    invert_use_pdd = true;
+    bench("invert_laplace_PDD", bench_laplace);
+    invert_use_pdd = pdd;
+  }
+
+  bench("invert_parderiv", bench_parderiv);
+
+  comm.clear();
+  comm.add(f);
+  comm.add(g);
+  comm.add(h);
+  bench("Communicator_run", bench_comms);
+
+  bench("Datafile_write", bench_io);
+
+  if(fout != NULL)
+    fclose(fout);
+  delete file;
+
+  // Send an error code so quits
+  return 1;
+}
+
+int physics_run(real t)
+{
+  // Doesn't do anything
+  return 1;
+}
@@ -50,6 +50,7 @@ real nuIonNeutral; // Ion-neutral collision rate (normalised by wci)
 bool estatic, ZeroElMass; // Switch for electrostatic operation (true = no Apar)
 
 bool bout_exb;  // Use BOUT-06 expression for ExB velocity
+int bracket_method; // Method for the nonlinear ExB term (BRACKET_METHOD)
 
 real zeff, nu_perp;
 bool evolve_rho,evolve_ni, evolve_ajpar;
@@ -136,6 +137,7 @@ int physics_init()
   OPTION(ShearFactor, 1.0); // <=> options.get("ShearFactor", ShearFactor, 1.0);
   OPTION(nuIonNeutral, -1.); 
   OPTION(bout_exb,    false);
+  OPTION(bracket_method, 0);
   
   OPTION(niprofile, false);
   OPTION(evolve_source, false);
@@ -587,6 +589,9 @@ const Field3D vE_Grad(const Field3D &f, const Field3D &p)
   if(bout_exb) {
     // Use a subset of terms for comparison to BOUT-06
     result = VDDX(DDZ(p), f) + VDDZ(-DDX(p), f);
+  }else if(bracket_method != BRACKET_STD) {
+    // Single-pass Poisson bracket, without parallel derivatives
+    result = bracket(p, f, (BRACKET_METHOD) bracket_method) / Bxy;
   }else {
     // Use full expression with all terms
     result = b0xGrad_dot_Grad(p, f) / Bxy;
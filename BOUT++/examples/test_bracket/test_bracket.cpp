@@ -0,0 +1,78 @@
+/*******************************************************************
+ * Poisson bracket test
+ *
+ * Compares the bracket methods on smooth fields, with and without
+ * the integrated shear (IncIntShear) terms
+ *******************************************************************/
+
+#include "bout.h"
+#include "meshtopology.h"
+
+#include <math.h>
+
+/// Maximum of |a - b| in the domain interior
+real max_diff(const Field3D &a, const Field3D &b)
+{
+  real d = 0.0;
+  for(int jx=MXG;jx<ngx-MXG;jx++)
+    for(int jy=jstart;jy<=jend;jy++)
+      for(int jz=0;jz<ncz;jz++) {
+	real v = fabs(a[jx][jy][jz] - b[jx][jy][jz]);
+	if(v > d)
+	  d = v;
+      }
+  
+  real dall;
+  MPI_Allreduce(&d, &dall, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return dall;
+}
+
+int physics_init()
+{
+  Field3D f, g;
+  f.Allocate();
+  g.Allocate();
+  
+  for(int jx=0;jx<ngx;jx++)
+    for(int jy=0;jy<ngy;jy++)
+      for(int jz=0;jz<ngz;jz++) {
+	real x = XGLOBAL(jx)*dx[jx][jy];
+	real z = jz*dz;
+	f[jx][jy][jz] = sin(x)*cos(z) + 0.3*cos(x + z);
+	g[jx][jy][jz] = cos(2.*x)*sin(z) + 0.2*sin(x - 2.*z);
+      }
+  
+  Field3D zero;
+  zero = 0.0;
+
+  for(int shear=0;shear<2;shear++) {
+    IncIntShear = (shear == 1);
+    IntShiftTorsion = IncIntShear ? 0.5 : 0.0;
+    
+    Field3D rstd = bracket(f, g, BRACKET_STD);
+    Field3D rsimple = bracket(f, g, BRACKET_SIMPLE);
+    Field3D rarakawa = bracket(f, g, BRACKET_ARAKAWA);
+    
+    real scale = max_diff(rstd, zero);
+    real dsimple = max_diff(rstd, rsimple) / scale;
+    real darakawa = max_diff(rstd, rarakawa) / scale;
+    
+    output.write("IncIntShear = %d: relative difference SIMPLE %e, ARAKAWA %e\n",
+		 shear, dsimple, darakawa);
+    
+    // Same differencing as STD with C2 upwinding; Arakawa differs by truncation error
+    if((dsimple < 1.e-10) && (darakawa < 0.1)) {
+      output << "Bracket methods agree: SUCCESS\n";
+    }else
+      output << "Bracket methods agree: FAILED\n";
+  }
+  
+  // Send an error code so quits
+  return 1;
+}
+
+int physics_run(real t)
+{
+  // Doesn't do anything
+  return 1;
+}
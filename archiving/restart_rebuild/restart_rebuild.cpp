@@ -0,0 +1,78 @@
+/*******************************************************
+ * RESTART_REBUILD
+ * 
+ * Reconstruct binary restart files from incremental
+ * (delta) archives
+ *******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bin_delta.h"
+
+int main(int argc, char** argv)
+{
+  const char *dir = "data";
+  int iteration = -1;
+
+  for(int i=1;i<argc;i++) {
+    if(strcmp(argv[i], "-d") == 0) {
+      if(i+1 >= argc) {
+	fprintf(stderr, "Useage: %s [-d <data directory>] <iteration>\n", argv[0]);
+	return 1;
+      }
+      i++;
+      dir = argv[i];
+    }else
+      iteration = atoi(argv[i]);
+  }
+
+  if(iteration < 0) {
+    fprintf(stderr, "Useage: %s [-d <data directory>] <iteration>\n", argv[0]);
+    return 1;
+  }
+
+  // Go through processors until no archive is found
+  int pe = 0;
+  while(true) {
+    char filename[512];
+    sprintf(filename, "%s/BOUT.restart_%04d.%d.delta", dir, iteration, pe);
+    
+    FILE *fp = fopen(filename, "rb");
+    if(fp == NULL) {
+      // Check if there's a full copy
+      sprintf(filename, "%s/BOUT.restart_%04d.%d.bin", dir, iteration, pe);
+      if((fp = fopen(filename, "rb")) == NULL)
+	break; // No more processors
+      fclose(fp);
+      printf("%s already exists\n", filename);
+      pe++;
+      continue;
+    }
+    fclose(fp);
+    
+    vector<char> image;
+    long hdrsize;
+    if(!bin_archive_read(dir, iteration, pe, image, hdrsize)) {
+      fprintf(stderr, "ERROR: Could not reconstruct archive %d for processor %d\n", iteration, pe);
+      return 1;
+    }
+
+    sprintf(filename, "%s/BOUT.restart_%04d.%d.bin", dir, iteration, pe);
+    if(!bin_write_image(filename, &image[0], hdrsize, &image[0] + hdrsize, image.size() - hdrsize)) {
+      fprintf(stderr, "ERROR: Could not write '%s'\n", filename);
+      return 1;
+    }
+    printf("Written %s\n", filename);
+    
+    pe++;
+  }
+
+  if(pe == 0) {
+    fprintf(stderr, "ERROR: No archives found for iteration %d in '%s'\n", iteration, dir);
+    return 1;
+  }
+
+  return 0;
+}
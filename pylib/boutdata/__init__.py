@@ -19,3 +19,8 @@ except:
     print "Sorry, no pol_slice"
 
 
+
+try:
+    from scaling import scaling_run, scaling_table
+except:
+    print "Sorry, no scaling"
@@ -0,0 +1,132 @@
+# Scaling studies
+#
+# Runs a BOUT++ executable for a list of processor decompositions, then
+# reads the timings each run appends to BOUT.scaling in the data directory
+# and prints parallel efficiency tables.
+#
+# From the command line, e.g. inside a batch job:
+#
+#   python scaling.py ./2fluid -n 100 1:1 2:1 4:2 8:2
+#   python scaling.py --table data/BOUT.scaling
+#
+# where each decomposition is NPES:NXPE.
+
+import os
+import sys
+import subprocess
+
+def scaling_run(exe, decomps, nrhs=100, path="data", mpirun="mpirun -np", args=[]):
+    """Run exe once for each (NPES, NXPE) in decomps, timing nrhs RHS evaluations.
+
+    Dump file output is switched off ("no" argument), except for the initial
+    write which is included in the I/O time. Additional options can be passed
+    in args as "key=value" or "section:key=value" strings.
+    Returns the number of runs which failed."""
+
+    nfailed = 0
+    for npes, nxpe in decomps:
+        cmd = mpirun.split() + [str(npes), exe, "-d", path, "no",
+                                "NXPE=" + str(nxpe), "scaling_rhs=" + str(nrhs)] + list(args)
+        print("Running: " + " ".join(cmd))
+        if subprocess.call(cmd) != 0:
+            print("ERROR: Run failed with NPES=%d, NXPE=%d" % (npes, nxpe))
+            nfailed += 1
+    return nfailed
+
+def scaling_read(file="data/BOUT.scaling"):
+    """Read the results file. Returns a list of dictionaries, one per run."""
+
+    keys = ["npes", "nxpe", "nype", "nx", "ny", "nz", "nrhs",
+            "wall", "calc", "inv", "comm", "io"]
+    runs = []
+    f = open(file, "r")
+    for line in f:
+        line = line.strip()
+        if (line == "") or (line[0] == "#"):
+            continue
+        vals = line.split()
+        run = {}
+        for i in range(len(keys)):
+            if i < 7:
+                run[keys[i]] = int(vals[i])
+            else:
+                run[keys[i]] = float(vals[i])
+        runs.append(run)
+    f.close()
+    return runs
+
+def scaling_table(file="data/BOUT.scaling"):
+    """Print parallel efficiency tables.
+
+    Runs with the same global grid are a strong scaling study, with efficiency
+    relative to the run on the fewest processors T_0 N_0 / (T N).
+    Runs with the same grid per processor are a weak scaling study, with
+    efficiency T_0 / T. Calc, Inv and Comm are percentages of the wall time."""
+
+    runs = scaling_read(file)
+
+    def table(title, groups, weak):
+        for size in sorted(groups.keys()):
+            group = sorted(groups[size], key=lambda r: (r["npes"], r["nxpe"]))
+            if len(group) < 2:
+                continue
+            print("")
+            print(title + " %d x %d x %d" % size)
+            print(" NPES NXPE NYPE   Wall/RHS   Speedup  Efficiency   Calc    Inv   Comm        I/O")
+            r0 = group[0]
+            for r in group:
+                speedup = r0["wall"] / r["wall"]
+                if weak:
+                    eff = speedup
+                    speedup *= float(r["npes"]) / float(r0["npes"])
+                else:
+                    eff = speedup * float(r0["npes"]) / float(r["npes"])
+                print("%5d %4d %4d  %9.3e  %8.2f  %9.1f%%  %5.1f  %5.1f  %5.1f  %9.3e" %
+                      (r["npes"], r["nxpe"], r["nype"], r["wall"], speedup, 100.*eff,
+                       100.*r["calc"]/r["wall"], 100.*r["inv"]/r["wall"],
+                       100.*r["comm"]/r["wall"], r["io"]))
+
+    strong = {}
+    weak = {}
+    for r in runs:
+        strong.setdefault((r["nx"], r["ny"], r["nz"]), []).append(r)
+        weak.setdefault((r["nx"] // r["nxpe"], r["ny"] // r["nype"], r["nz"]), []).append(r)
+
+    table("Strong scaling, global grid", strong, False)
+    table("Weak scaling, grid per processor", weak, True)
+
+if __name__ == "__main__":
+    argv = sys.argv[1:]
+    if (len(argv) == 2) and (argv[0] == "--table"):
+        scaling_table(argv[1])
+        sys.exit(0)
+
+    if len(argv) < 2:
+        print("Usage: python scaling.py <executable> [-n nrhs] [-d path] NPES:NXPE ... [key=value ...]")
+        print("       python scaling.py --table <path>/BOUT.scaling")
+        sys.exit(1)
+
+    exe = argv[0]
+    nrhs = 100
+    path = "data"
+    decomps = []
+    args = []
+    i = 1
+    while i < len(argv):
+        if argv[i] == "-n":
+            nrhs = int(argv[i+1])
+            i += 1
+        elif argv[i] == "-d":
+            path = argv[i+1]
+            i += 1
+        elif "=" in argv[i]:
+            args.append(argv[i])
+        else:
+            npes, nxpe = argv[i].split(":")
+            decomps.append((int(npes), int(nxpe)))
+        i += 1
+
+    mpirun = os.environ.get("MPIRUN", "mpirun -np")
+    nfailed = scaling_run(exe, decomps, nrhs, path, mpirun, args)
+    scaling_table(os.path.join(path, "BOUT.scaling"))
+    sys.exit(nfailed)